@@ -1,8 +1,8 @@
 #include "DisplayManager.h"
-#include <iostream>
 #include <iomanip>
 #include "GameState.h"
 #include "lcd_display.h"
+#include "logger.h"
 
 DisplayManager::DisplayManager(GameState* gameState) 
     : gameState(gameState) {
@@ -15,11 +15,11 @@ DisplayManager::~DisplayManager() {
 void DisplayManager::updateCardAndGameDisplay(bool showOutput) {
     // Only log when debugging display issues or when showOutput is true
     if (showOutput) {
-        std::cout << "\n[DisplayManager.cpp] ====== UPDATING DISPLAY ======" << std::endl;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "\n[DisplayManager.cpp] ====== UPDATING DISPLAY ======";
     }
     
     if (!gameState) {
-        std::cerr << "[DisplayManager.cpp] ERROR: GameState not set for DisplayManager" << std::endl;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_ERROR) << "[DisplayManager.cpp] ERROR: GameState not set for DisplayManager";
         return;
     }
     
@@ -35,11 +35,11 @@ void DisplayManager::updateCardAndGameDisplay(bool showOutput) {
     
     // Debug info about what we're displaying - only if showOutput is true
     if (showOutput) {
-        std::cout << "[DisplayManager.cpp] Display update called with:" << std::endl;
-        std::cout << "[DisplayManager.cpp] Round: " << roundNumber << std::endl;
-        std::cout << "[DisplayManager.cpp] Time remaining: " << timeRemaining << " seconds" << std::endl;
-        std::cout << "[DisplayManager.cpp] Cards: ATK:" << attackCount << " DEF:" << defendCount << " BLD:" << buildCount << std::endl;
-        std::cout << "[DisplayManager.cpp] Timer stopped: " << (gameState->isTimerRunning() ? "No" : "Yes") << std::endl;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "[DisplayManager.cpp] Display update called with:";
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "[DisplayManager.cpp] Round: " << roundNumber;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "[DisplayManager.cpp] Time remaining: " << timeRemaining << " seconds";
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "[DisplayManager.cpp] Cards: ATK:" << attackCount << " DEF:" << defendCount << " BLD:" << buildCount;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "[DisplayManager.cpp] Timer stopped: " << (gameState->isTimerRunning() ? "No" : "Yes");
     }
     
     // Create game info display
@@ -62,19 +62,19 @@ void DisplayManager::updateCardAndGameDisplay(bool showOutput) {
     
     // Debug output before displaying - only if showOutput is true
     if (showOutput) {
-        std::cout << "[DisplayManager.cpp] LCD Line 1: " << line1 << std::endl;
-        std::cout << "[DisplayManager.cpp] LCD Line 2: " << line2 << std::endl;
-        std::cout << "[DisplayManager.cpp] LCD Line 3: " << line3 << std::endl;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "[DisplayManager.cpp] LCD Line 1: " << line1;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "[DisplayManager.cpp] LCD Line 2: " << line2;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "[DisplayManager.cpp] LCD Line 3: " << line3;
     }
     
     // Display the summary on LCD
     if (showOutput) {
-        std::cout << "[DisplayManager.cpp] Sending to LCD via lcd_place_message..." << std::endl;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "[DisplayManager.cpp] Sending to LCD via lcd_place_message...";
     }
     char* cardMsg[] = {line1, line2, line3};
     lcd_place_message(cardMsg, 3, lcd_center);
     if (showOutput) {
-        std::cout << "[DisplayManager.cpp] LCD update complete" << std::endl;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "[DisplayManager.cpp] LCD update complete";
     }
     
     // Also log to console - but limit output to reduce spam
@@ -92,19 +92,19 @@ void DisplayManager::updateCardAndGameDisplay(bool showOutput) {
                      showOutput;                          // Only if showOutput is true
                     
     if (shouldLog) {
-        std::cout << "\n************************************" << std::endl;
-        std::cout << "*       GAME STATE UPDATE        *" << std::endl;
-        std::cout << "************************************" << std::endl;
-        std::cout << "* ROUND: " << roundNumber << std::endl;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "\n************************************";
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "*       GAME STATE UPDATE        *";
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "************************************";
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "* ROUND: " << roundNumber;
         
         if (!gameState->isTimerRunning()) {
-            std::cout << "* TIME:  " << timeRemaining << "s (PAUSED)" << std::endl;
+            LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "* TIME:  " << timeRemaining << "s (PAUSED)";
         } else {
-            std::cout << "* TIME:  " << timeRemaining << "s" << std::endl;
+            LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "* TIME:  " << timeRemaining << "s";
         }
         
-        std::cout << "* CARDS: ATK:" << attackCount << " DEF:" << defendCount << " BLD:" << buildCount << std::endl;
-        std::cout << "************************************\n" << std::endl;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "* CARDS: ATK:" << attackCount << " DEF:" << defendCount << " BLD:" << buildCount;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "************************************\n";
     }
     
     // Update the stored values
@@ -112,7 +112,7 @@ void DisplayManager::updateCardAndGameDisplay(bool showOutput) {
     lastRoundNumber = roundNumber;
     
     if (showOutput) {
-        std::cout << "[DisplayManager.cpp] ====== DISPLAY UPDATE COMPLETE ======\n" << std::endl;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "[DisplayManager.cpp] ====== DISPLAY UPDATE COMPLETE ======\n";
     }
 }
 
@@ -127,7 +127,7 @@ void DisplayManager::displayRoundStart(int roundNumber, int timeRemaining) {
     char* startRoundMsg[] = {line1, line2};
     lcd_place_message(startRoundMsg, 2, lcd_center);
     
-    std::cout << "Round " << roundNumber << " started with " << timeRemaining << " seconds" << std::endl;
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "Round " << roundNumber << " started with " << timeRemaining << " seconds";
 }
 
 void DisplayManager::displayRoundEndConfirmation(int roundNumber, const std::string& status) {
@@ -152,21 +152,21 @@ void DisplayManager::displayRoundEndConfirmation(int roundNumber, const std::str
     char* endRoundMsg[] = {line1, line2};
     lcd_place_message(endRoundMsg, 2, lcd_center);
     
-    std::cout << "[DisplayManager.cpp] Round " << roundNumber << " ended. Status: " << status << std::endl;
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "[DisplayManager.cpp] Round " << roundNumber << " ended. Status: " << status;
 }
 
 void DisplayManager::displayGameStarting() {
     char* startingMsg[] = {"Game starting", "Get ready..."};
     lcd_place_message(startingMsg, 2, lcd_center);
     
-    std::cout << "Game is starting soon..." << std::endl;
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "Game is starting soon...";
 }
 
 void DisplayManager::displayGameStarted() {
     char* gameStartMsg[] = {"Game Started!", "Waiting for cards..."};
     lcd_place_message(gameStartMsg, 2, lcd_center);
     
-    std::cout << "Game has started!" << std::endl;
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "Game has started!";
 }
 
 void DisplayManager::displayGameEnded(bool isWinner) {
@@ -179,7 +179,7 @@ void DisplayManager::displayGameEnded(bool isWinner) {
     char* gameEndMsg[] = {line1, line2};
     lcd_place_message(gameEndMsg, 2, lcd_center);
     
-    std::cout << "Game ended. " << (isWinner ? "You won!" : "You lost.") << std::endl;
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "Game ended. " << (isWinner ? "You won!" : "You lost.");
 }
 
 void DisplayManager::displayRoomList(const std::vector<Room>& rooms) {
@@ -187,7 +187,7 @@ void DisplayManager::displayRoomList(const std::vector<Room>& rooms) {
         char* noRoomsMsg[] = {"No rooms available", "Create a new room"};
         lcd_place_message(noRoomsMsg, 2, lcd_center);
         
-        std::cout << "No rooms available. Try creating a new room." << std::endl;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "No rooms available. Try creating a new room.";
         return;
     }
     
@@ -202,22 +202,22 @@ void DisplayManager::displayRoomList(const std::vector<Room>& rooms) {
     lcd_place_message(roomsMsg, 2, lcd_center);
     
     // Detailed list on console
-    std::cout << "Available rooms:" << std::endl;
-    std::cout << "--------------------------------------------------------" << std::endl;
-    std::cout << std::left << std::setw(24) << "Room ID" << " | "
-              << std::setw(25) << "Name" << " | "
-              << std::setw(10) << "Players" << " | "
-              << std::setw(10) << "Status" << std::endl;
-    std::cout << "--------------------------------------------------------" << std::endl;
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "Available rooms:";
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "--------------------------------------------------------";
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << std::left << std::setw(24) << "Room ID" << " | "
+            << std::setw(25) << "Name" << " | "
+            << std::setw(10) << "Players" << " | "
+            << std::setw(10) << "Status";
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "--------------------------------------------------------";
     
     for (const auto& room : rooms) {
-        std::cout << std::left << std::setw(24) << room.id << " | "
-                  << std::setw(25) << room.name << " | "
-                  << std::setw(10) << room.playerCount << "/" << room.maxPlayers << " | "
-                  << std::setw(10) << room.status << std::endl;
+        LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << std::left << std::setw(24) << room.id << " | "
+                << std::setw(25) << room.name << " | "
+                << std::setw(10) << room.playerCount << "/" << room.maxPlayers << " | "
+                << std::setw(10) << room.status;
     }
     
-    std::cout << "--------------------------------------------------------" << std::endl;
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "--------------------------------------------------------";
 }
 
 void DisplayManager::displayAutoPlay(const std::string& cardType) {
@@ -230,7 +230,7 @@ void DisplayManager::displayAutoPlay(const std::string& cardType) {
     char* autoPlayMsg[] = {line1, line2};
     lcd_place_message(autoPlayMsg, 2, lcd_center);
     
-    std::cout << "Auto-playing a " << cardType << " card" << std::endl;
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "Auto-playing a " << cardType << " card";
 }
 
 void DisplayManager::displayWaitingForResponse(const std::string& requestType) {
@@ -254,7 +254,7 @@ void DisplayManager::displayRoomConnection(const std::string& roomName, int play
     char* connectedMsg[] = {line1, line2};
     lcd_place_message(connectedMsg, 2, lcd_center);
     
-    std::cout << "Connected to room: " << roomName << " (" << playerCount << "/" << maxPlayers << ")" << std::endl;
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "Connected to room: " << roomName << " (" << playerCount << "/" << maxPlayers << ")";
 }
 
 void DisplayManager::displayError(const std::string& errorMessage) {
@@ -267,7 +267,7 @@ void DisplayManager::displayError(const std::string& errorMessage) {
     char* errorMsg[] = {line1, line2};
     lcd_place_message(errorMsg, 2, lcd_center);
     
-    std::cerr << "Error: " << errorMessage << std::endl;
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_ERROR) << "Error: " << errorMessage;
 }
 
 void DisplayManager::displayMessage(const std::string& line1, const std::string& line2) {
@@ -280,7 +280,7 @@ void DisplayManager::displayMessage(const std::string& line1, const std::string&
     char* message[] = {msg1, msg2};
     lcd_place_message(message, 2, lcd_center);
     
-    std::cout << line1 << " - " << line2 << std::endl;
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << line1 << " - " << line2;
 }
 
 void DisplayManager::displayWaitingForNextRound(int completedRound) {
@@ -293,7 +293,7 @@ void DisplayManager::displayWaitingForNextRound(int completedRound) {
     char* waitingMsg[] = {line1, line2};
     lcd_place_message(waitingMsg, 2, lcd_center);
     
-    std::cout << "Round " << completedRound << " completed. Waiting for next round to start..." << std::endl;
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "Round " << completedRound << " completed. Waiting for next round to start...";
 }
 
 void DisplayManager::displayGestureConfirmed(const std::string& gesture) {
@@ -306,5 +306,5 @@ void DisplayManager::displayGestureConfirmed(const std::string& gesture) {
     char* gestureMsg[] = {line1, line2};
     lcd_place_message(gestureMsg, 2, lcd_center);
     
-    std::cout << "Gesture " << gesture << " confirmed and sent" << std::endl;
+    LOG_LINE(LOG_CAT_DISPLAY, LOG_LEVEL_INFO) << "Gesture " << gesture << " confirmed and sent";
 } 
\ No newline at end of file
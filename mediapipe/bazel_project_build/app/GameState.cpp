@@ -3,7 +3,9 @@
 #include "DisplayManager.h"
 #include "GestureDetector.h"
 #include "GestureEventSender.h"
-#include <iostream>
+#include "logger.h"
+#include "threadTopology.h"
+#include <pthread.h>
 #include <algorithm>
 #include <random>
 #include <atomic>
@@ -26,7 +28,7 @@ void GameState::startTimer(int seconds) {
     currentTurnTimeRemaining = seconds;
     timerRunning = true;
     
-    std::cout << "[GameState.cpp] Starting timer with " << seconds << " seconds" << std::endl;
+    LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_INFO) << "[GameState.cpp] Starting timer with " << seconds << " seconds";
     
     // Create new thread
     std::lock_guard<std::mutex> lock(timerMutex);
@@ -35,7 +37,7 @@ void GameState::startTimer(int seconds) {
 
 void GameState::stopTimer() {
     // Log the current timer value before stopping
-    std::cout << "[GameState.cpp] Stopping timer. Current time remaining: " << currentTurnTimeRemaining << "s" << std::endl;
+    LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_INFO) << "[GameState.cpp] Stopping timer. Current time remaining: " << currentTurnTimeRemaining << "s";
     
     // Set flag to false
     timerRunning = false;
@@ -55,6 +57,9 @@ void GameState::stopTimer() {
 }
 
 void GameState::updateTimer() {
+    // Started per turn, after the topology was applied to the other threads
+    pthread_setname_np(pthread_self(), "game_timer");
+    Topology_applySelf();
     while (timerRunning) {
         // Sleep for 1 second
         std::this_thread::sleep_for(std::chrono::seconds(1));
@@ -87,7 +92,7 @@ void GameState::updateTimer() {
 }
 
 void GameState::updateTimerFromEvent(const json& roundStartPayload) {
-    std::cout << "[GameState.cpp] Received round_start event - initializing timer" << std::endl;
+    LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_INFO) << "[GameState.cpp] Received round_start event - initializing timer";
     
     // Update round number
     if (roundStartPayload.contains("roundNumber")) {
@@ -222,17 +227,17 @@ void GameState::sendRoundEndEvent() {
     try {
         // Only send round_end_ack if we actually received a round_end event
         if (!roundEndReceived) {
-            std::cout << "[GameState.cpp] Not sending round_end_ack because no round_end was received" << std::endl;
+            LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_INFO) << "[GameState.cpp] Not sending round_end_ack because no round_end was received";
             return;
         }
 
         if (!roomManager) {
-            std::cerr << "[GameState.cpp] ERROR: Cannot send round_end_ack - roomManager not set" << std::endl;
+            LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_ERROR) << "[GameState.cpp] ERROR: Cannot send round_end_ack - roomManager not set";
             return;
         }
         
         if (!roomManager->client) {
-            std::cerr << "[GameState.cpp] ERROR: Cannot send round_end_ack - websocket client not initialized" << std::endl;
+            LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_ERROR) << "[GameState.cpp] ERROR: Cannot send round_end_ack - websocket client not initialized";
             return;
         }
         
@@ -241,7 +246,7 @@ void GameState::sendRoundEndEvent() {
             try {
                 roomManager->gestureDetector->stop();
             } catch (const std::exception& e) {
-                std::cerr << "[GameState.cpp] Error stopping gesture detector: " << e.what() << std::endl;
+                LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_ERROR) << "[GameState.cpp] Error stopping gesture detector: " << e.what();
                 // Continue anyway - this is a non-critical error
             }
         }
@@ -250,7 +255,7 @@ void GameState::sendRoundEndEvent() {
         try {
             stopTimer();
         } catch (const std::exception& e) {
-            std::cerr << "[GameState.cpp] Error stopping timer: " << e.what() << std::endl;
+            LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_ERROR) << "[GameState.cpp] Error stopping timer: " << e.what();
             // Continue anyway - this is a non-critical error
         }
         
@@ -267,24 +272,24 @@ void GameState::sendRoundEndEvent() {
             
             std::string messageStr = message.dump();
             
-            std::cout << "[GameState.cpp] Sending round_end_ack for round " << currentRoundNumber << std::endl;
+            LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_INFO) << "[GameState.cpp] Sending round_end_ack for round " << currentRoundNumber;
             
             // Safely send the message
             bool sendResult = false;
             try {
                 sendResult = roomManager->client->sendMessage(messageStr);
                 if (!sendResult) {
-                    std::cerr << "[GameState.cpp] Failed to send round_end_ack message" << std::endl;
+                    LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_ERROR) << "[GameState.cpp] Failed to send round_end_ack message";
                 }
                 roomManager->client->ensureMessageProcessing();
             } catch (const std::exception& e) {
-                std::cerr << "[GameState.cpp] Exception sending round_end_ack: " << e.what() << std::endl;
+                LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_ERROR) << "[GameState.cpp] Exception sending round_end_ack: " << e.what();
             }
             
             // Reset the roundEndReceived flag after sending the ack
             roundEndReceived = false;
         } catch (const std::exception& e) {
-            std::cerr << "[GameState.cpp] Error creating round_end_ack message: " << e.what() << std::endl;
+            LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_ERROR) << "[GameState.cpp] Error creating round_end_ack message: " << e.what();
         }
         
         // Update display to show "Waiting for next round" message
@@ -292,28 +297,28 @@ void GameState::sendRoundEndEvent() {
             try {
                 displayManager->displayWaitingForNextRound(currentRoundNumber);
             } catch (const std::exception& e) {
-                std::cerr << "[GameState.cpp] Error updating display for round end: " << e.what() << std::endl;
+                LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_ERROR) << "[GameState.cpp] Error updating display for round end: " << e.what();
             }
         }
     } catch (const std::exception& e) {
-        std::cerr << "[GameState.cpp] Unexpected exception in sendRoundEndEvent: " << e.what() << std::endl;
+        LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_ERROR) << "[GameState.cpp] Unexpected exception in sendRoundEndEvent: " << e.what();
     } catch (...) {
-        std::cerr << "[GameState.cpp] Unknown exception in sendRoundEndEvent" << std::endl;
+        LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_ERROR) << "[GameState.cpp] Unknown exception in sendRoundEndEvent";
     }
 }
 
 void GameState::autoPlayCard() {
-    std::cout << "[GameState.cpp] autoPlayCard called - timer expired" << std::endl;
+    LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_INFO) << "[GameState.cpp] autoPlayCard called - timer expired";
     
     // Don't check gameInProgress state anymore to ensure auto-play always works
     if (!roomManager) {
-        std::cout << "[GameState.cpp] Auto-play skipped: roomManager is null" << std::endl;
+        LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_INFO) << "[GameState.cpp] Auto-play skipped: roomManager is null";
         return;
     }
     
     // Stop gesture detection if it's running
     if (roomManager->gestureDetector && roomManager->gestureDetector->isRunning()) {
-        std::cout << "[GameState.cpp] Stopping gesture detection due to timer expiration" << std::endl;
+        LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_INFO) << "[GameState.cpp] Stopping gesture detection due to timer expiration";
         roomManager->gestureDetector->stop();
     }
     
@@ -325,9 +330,9 @@ void GameState::autoPlayCard() {
     int attackCount = 0, defendCount = 0, buildCount = 0;
     getCardCounts(attackCount, defendCount, buildCount);
     
-    std::cout << "[GameState.cpp] Available cards - Attack: " << attackCount 
-              << ", Defend: " << defendCount 
-              << ", Build: " << buildCount << std::endl;
+    LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_INFO) << "[GameState.cpp] Available cards - Attack: " << attackCount 
+            << ", Defend: " << defendCount 
+            << ", Build: " << buildCount;
     
     // Choose the first available card type in order of preference: attack, defend, build
     if (attackCount > 0 && playerCards.find("attack") != playerCards.end()) {
@@ -341,7 +346,7 @@ void GameState::autoPlayCard() {
         cardId = playerCards["build"];
     }
     
-    std::cout << "[GameState.cpp] Auto-playing card type: " << cardType << " with ID: " << cardId << std::endl;
+    LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_INFO) << "[GameState.cpp] Auto-playing card type: " << cardType << " with ID: " << cardId;
     
     // Send the gesture directly
     if (roomManager && roomManager->gestureEventSender) {
@@ -362,7 +367,7 @@ void GameState::autoPlayCard() {
 
 void GameState::handleConfirmedGesture(const std::string& gesture, float confidence, const std::string& cardId) {
     // Log current timer value before stopping
-    std::cout << "[GameState.cpp] Confirming gesture with " << currentTurnTimeRemaining << "s remaining" << std::endl;
+    LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_INFO) << "[GameState.cpp] Confirming gesture with " << currentTurnTimeRemaining << "s remaining";
     
     // Stop timer immediately
     stopTimer();
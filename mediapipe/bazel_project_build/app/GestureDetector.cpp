@@ -4,15 +4,28 @@
 #include "GameState.h"
 #include "DisplayManager.h"
 #include "SoundManager.h"
-#include <iostream>
 #include <unistd.h>
 #include <cmath>
 #include <algorithm>
 #include <map>
 #include <chrono>
 #include <thread>
+#include <pthread.h>
 #include "lcd_display.h"
+#include "logger.h"
+#include "metrics.h"
+#include "threadTopology.h"
+#include "trace.h"
 #include "../hal/rotary_press_statemachine.h"
+#include "../hal/input_events.h"
+
+// How long to wait before trying to open the camera again
+#define CAMERA_RETRY_MS 2000
+
+// Milliseconds elapsed since start, for the stage latency metrics
+static double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
 // Get current time in milliseconds
 long long GestureDetector::getTimeInMs() {
@@ -25,11 +38,19 @@ long long GestureDetector::getTimeInMs() {
 GestureDetector::GestureDetector(RoomManager* roomManager)
     : roomManager(roomManager), 
       runThread(false), 
+      keepAlive(false),
       handTopPosition(0.0),
       handBottomPosition(0.0),
       confidenceThreshold(0.65),
       gestureEnabled(true),
-      processingStarted(false) {
+      processingStarted(false),
+      warmStandby(true),
+      cameraReady(false),
+      cameraFailed(false),
+      inDetection(false),
+      firstResultPending(false),
+      fpsWindowFrames(0),
+      frameGrabbed(false) {
     
     // Create the gesture event sender if we have a client
     if (roomManager && roomManager->getClient()) {
@@ -41,16 +62,21 @@ GestureDetector::GestureDetector(RoomManager* roomManager)
 
 GestureDetector::~GestureDetector() {
     try {
-        std::cout << "[GestureDetector.cpp] Destructor called, cleaning up resources" << std::endl;
+        LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Destructor called, cleaning up resources";
         
-        // First set the run flag to false to tell the thread to exit
-        runThread.store(false);
+        // First clear the flags to tell the thread to exit, wherever it waits
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            keepAlive.store(false);
+            runThread.store(false);
+        }
+        stateChanged.notify_all();
         
         // Then join the thread if it's joinable
         if (gestureThread.joinable()) {
-            std::cout << "[GestureDetector.cpp] Waiting for gesture thread to join in destructor..." << std::endl;
+            LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Waiting for gesture thread to join in destructor...";
             gestureThread.join();
-            std::cout << "[GestureDetector.cpp] Gesture thread successfully joined in destructor" << std::endl;
+            LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Gesture thread successfully joined in destructor";
         }
         
         // Clean up the event sender
@@ -59,15 +85,19 @@ GestureDetector::~GestureDetector() {
             eventSender = nullptr;
         }
         
-        std::cout << "[GestureDetector.cpp] Destructor completed successfully" << std::endl;
+        LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Destructor completed successfully";
     } catch (const std::exception& e) {
-        std::cerr << "[GestureDetector.cpp] Exception in destructor: " << e.what() << std::endl;
+        LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_ERROR) << "[GestureDetector.cpp] Exception in destructor: " << e.what();
     } catch (...) {
-        std::cerr << "[GestureDetector.cpp] Unknown exception in destructor" << std::endl;
+        LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_ERROR) << "[GestureDetector.cpp] Unknown exception in destructor";
     }
 }
 
 bool GestureDetector::testCameraAccess() {
+    // While the camera thread has the camera open, nobody else can have it
+    if (isCameraReady()) {
+        return true;
+    }
     CameraHAL testCamera;
     bool success = testCamera.openCamera();
     if (success) {
@@ -78,57 +108,89 @@ bool GestureDetector::testCameraAccess() {
     return success;
 }
 
-void GestureDetector::start() {
-    // Make sure we're in a clean state before starting
-    // If thread is still joinable but runThread is false, we need to clean up first
-    if (gestureThread.joinable()) {
-        std::cout << "[GestureDetector.cpp] Thread is still joinable, cleaning up before starting new thread" << std::endl;
-        try {
-            // Force wait for thread to exit if it's still running
-            if (gestureThread.joinable()) {
-                gestureThread.join();
-            }
-        } catch (const std::exception& e) {
-            std::cerr << "[GestureDetector.cpp] Exception while joining thread: " << e.what() << std::endl;
-        }
+void GestureDetector::startCameraThread() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (keepAlive.load()) {
+        return;
     }
-    
-    // Now we can safely start a new thread
-    if (!runThread.load()) {
-        std::cout << "[GestureDetector.cpp] Starting gesture detection thread" << std::endl;
-        runThread.store(true);
-        
-        try {
-            gestureThread = std::thread(&GestureDetector::gestureLoop, this);
-            std::cout << "[GestureDetector.cpp] Gesture detection thread started successfully" << std::endl;
-        } catch (const std::exception& e) {
-            // If thread creation fails, make sure we set runThread back to false
-            runThread.store(false);
-            std::cerr << "[GestureDetector.cpp] Failed to start gesture thread: " << e.what() << std::endl;
-        }
-    } else {
-        std::cout << "[GestureDetector.cpp] Gesture detection is already running." << std::endl;
+    keepAlive.store(true);
+    try {
+        gestureThread = std::thread(&GestureDetector::gestureLoop, this);
+    } catch (const std::exception& e) {
+        keepAlive.store(false);
+        LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_ERROR) << "[GestureDetector.cpp] Failed to start camera thread: " << e.what();
     }
 }
 
-void GestureDetector::stop() {
-    std::cout << "[GestureDetector.cpp] Stopping gesture detection. Current state: " << (runThread.load() ? "running" : "not running") << std::endl;
+bool GestureDetector::warmUp(int timeoutMs) {
+    startCameraThread();
+    std::unique_lock<std::mutex> lock(stateMutex);
+    // Wait for this attempt, not an earlier failure
+    cameraFailed = false;
+    stateChanged.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                          [this]() { return cameraReady || cameraFailed || !keepAlive.load(); });
+    return cameraReady;
+}
+
+void GestureDetector::setWarmStandby(bool enabled) {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    warmStandby = enabled;
+    stateChanged.notify_all();
+    if (!enabled && keepAlive.load()) {
+        stateChanged.wait(lock, [this]() { return !cameraReady || runThread.load() || !keepAlive.load(); });
+    }
+}
+
+bool GestureDetector::isWarmStandby() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return warmStandby;
+}
+
+bool GestureDetector::isCameraReady() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return cameraReady;
+}
+
+void GestureDetector::start() {
+    if (runThread.load()) {
+        LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Gesture detection is already running.";
+        return;
+    }
+    startCameraThread();
+    if (!keepAlive.load()) {
+        return;
+    }
     
+    std::unique_lock<std::mutex> lock(stateMutex);
+    // A frame that stopped detection itself (a confirmed gesture) may still
+    // be finishing
+    stateChanged.wait(lock, [this]() { return !inDetection; });
     if (runThread.load()) {
-        runThread.store(false);
-        if (gestureThread.joinable()) {
-            std::cout << "[GestureDetector.cpp] Waiting for gesture thread to join..." << std::endl;
-            gestureThread.join();
-            std::cout << "[GestureDetector.cpp] Gesture thread successfully joined" << std::endl;
-        } else {
-            std::cout << "[GestureDetector.cpp] Gesture thread is not joinable" << std::endl;
-        }
-    } else {
-        std::cout << "[GestureDetector.cpp] Gesture detection was already stopped" << std::endl;
+        return;
     }
+    LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Starting gesture detection (camera "
+            << (cameraReady ? "already streaming" : "opening") << ")";
+    startTime = std::chrono::steady_clock::now();
+    firstResultPending = true;
+    fpsWindowStart = startTime;
+    fpsWindowFrames = 0;
+    runThread.store(true);
+    stateChanged.notify_all();
+}
+
+void GestureDetector::stop() {
+    LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Stopping gesture detection. Current state: " << (runThread.load() ? "running" : "not running");
     
-    // Force set runThread to false to ensure clean state
+    std::unique_lock<std::mutex> lock(stateMutex);
     runThread.store(false);
+    stateChanged.notify_all();
+    // Wait for the frame in progress (including a confirmation wait) unless
+    // it is the camera thread stopping itself
+    if (std::this_thread::get_id() != gestureThread.get_id()) {
+        stateChanged.wait(lock, [this]() { return !inDetection; });
+    }
+    LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Gesture detection stopped; camera "
+            << (warmStandby ? "kept in standby" : "released");
 }
 
 // Log hand position for debugging
@@ -144,7 +206,7 @@ bool GestureDetector::recognizeGesture(const handPosition& handPos, std::string&
         detectedMove = "Attack";
         actionType = "attack";
         SoundManager_playAttack();
-        std::cout << "[GestureDetector.cpp] Detected gesture: Attack" << std::endl;
+        LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Detected gesture: Attack";
         
         // Display confirmation message if we have a display manager
         if (roomManager && roomManager->gameState) {
@@ -164,7 +226,7 @@ bool GestureDetector::recognizeGesture(const handPosition& handPos, std::string&
         detectedMove = "Defend";
         actionType = "defend";
         SoundManager_playShield();
-        std::cout << "[GestureDetector.cpp] Detected gesture: Defend" << std::endl;
+        LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Detected gesture: Defend";
         
         // Display confirmation message if we have a display manager
         if (roomManager && roomManager->gameState) {
@@ -184,7 +246,7 @@ bool GestureDetector::recognizeGesture(const handPosition& handPos, std::string&
         detectedMove = "Build";
         actionType = "build";
         SoundManager_playBuild();
-        std::cout << "[GestureDetector.cpp] Detected gesture: Build" << std::endl;
+        LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Detected gesture: Build";
         
         // Display confirmation message if we have a display manager
         if (roomManager && roomManager->gameState) {
@@ -202,148 +264,279 @@ bool GestureDetector::recognizeGesture(const handPosition& handPos, std::string&
     return false;
 }
 
-void GestureDetector::gestureLoop() {
-    // Use try-catch to ensure camera is closed properly even if exceptions occur
-    try {
-        if (!camera.openCamera()) {
-            std::cout << "[GestureDetector.cpp] Failed to open camera" << std::endl;
-            return;
+void GestureDetector::detectFrame() {
+    static const int framesMetric = Metrics_registerCounter("gesture_frames_total", nullptr,
+        "Camera frames run through hand recognition.");
+    static const int fpsMetric = Metrics_registerGauge("gesture_fps", nullptr,
+        "Frames analyzed per second over the last second of detection.");
+    static const int captureMetric = Metrics_registerSummary("gesture_stage_ms", "stage=\"capture\"",
+        "Time spent in each stage of gesture detection, in ms.");
+    static const int analyzeMetric = Metrics_registerSummary("gesture_stage_ms", "stage=\"analyze\"",
+        "Time spent in each stage of gesture detection, in ms.");
+    static const int firstResultMetric = Metrics_registerSummary("gesture_first_result_ms", nullptr,
+        "Time from start() until the first frame was analyzed, in ms.");
+    static const int confirmLatencyMetric = Metrics_registerSummary("input_to_action_ms", "action=\"confirm_gesture\"",
+        "Time from the input event (kernel timestamp for buttons) until its action was done, in ms.");
+    
+    if (roomManager == nullptr) {
+        LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Room manager is null, stopping detection";
+        runThread.store(false);
+        return;
+    }
+    
+    // The frame's trace flow follows it into inference and the LCD; a
+    // message it sends gets its own flow to the WebSocket thread
+    unsigned long long frameFlow = Trace_newFlowId();
+    Trace_setFlow(frameFlow);
+    
+    cv::Mat frame;
+    auto captureStart = std::chrono::steady_clock::now();
+    Trace_begin("capture");
+    // The frame standby grabbed last is at most one frame old; decode it
+    // rather than wait for the next one
+    bool captured;
+    if (frameGrabbed) {
+        frameGrabbed = false;
+        captured = camera.retrieveFrame(frame) && !frame.empty();
+    } else {
+        captured = camera.captureFrame(frame) && !frame.empty();
+    }
+    if (captured) {
+        Trace_flowStart("frame", frameFlow);
+    }
+    Trace_end();
+    if (!captured) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return;
+    }
+    Metrics_observe(captureMetric, msSince(captureStart));
+    
+    handPosition handPos;
+    auto analyzeStart = std::chrono::steady_clock::now();
+    Trace_begin("analyze");
+    auto status = hand_analyze_image(frame, &handPos);
+    Trace_end();
+    Metrics_observe(analyzeMetric, msSince(analyzeStart));
+    Metrics_add(framesMetric, 1);
+    if (firstResultPending) {
+        firstResultPending = false;
+        Metrics_observe(firstResultMetric, msSince(startTime));
+    }
+    
+    fpsWindowFrames++;
+    double fpsWindowMs = msSince(fpsWindowStart);
+    if (fpsWindowMs >= 1000.0) {
+        Metrics_set(fpsMetric, fpsWindowFrames * 1000.0 / fpsWindowMs);
+        fpsWindowStart = std::chrono::steady_clock::now();
+        fpsWindowFrames = 0;
+    }
+    
+    if (!status.ok()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return;
+    }
+    
+    if (handPos.hand_visible) {
+        {
+            std::lock_guard<std::mutex> lock(handMutex);
+            currentHand = handPos;
         }
         
-        std::cout << "[GestureDetector.cpp] Gesture detection loop started" << std::endl;
+        // Debug output for hand position; this runs every frame
+        if (handPos.num_fingers_held_up > 0) {
+            Log_writeLimited(LOG_CAT_GESTURE, LOG_LEVEL_INFO, 2.0, 5,
+                    "[GestureDetector.cpp] Fingers up: %d (I:%d M:%d R:%d P:%d T:%d)",
+                    handPos.num_fingers_held_up, handPos.index_held_up, handPos.middle_held_up,
+                    handPos.ring_held_up, handPos.pinky_held_up, handPos.thumb_held_up);
+        }
         
-        while (runThread.load()) {
-            if (roomManager == nullptr) {
-                std::cout << "[GestureDetector.cpp] Room manager is null, exiting gesture loop" << std::endl;
-                break;
-            }
+        std::string detectedMove, actionType;
+        Trace_begin("classify");
+        bool recognized = recognizeGesture(handPos, detectedMove, actionType);
+        Trace_end();
+        if (recognized) {
+            // Watch for the confirming rotary press from now on
+            int inputSubscriber = Input_subscribe();
+            long long confirmationStartTime = getTimeInMs();
+            bool gestureConfirmed = false;
+            long long confirmPressNs = 0;
             
-            cv::Mat frame;
-            if (!camera.captureFrame(frame)) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                continue;
-            }
+            // Wait for confirmation or timeout (5 seconds)
+            const int CONFIRMATION_TIMEOUT_MS = 5000; // 5 seconds
             
-            if (frame.empty()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                continue;
+            LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Waiting for gesture confirmation... (press button)";
+            
+            // After initializing wait period, update display with time remaining info
+            if (roomManager && roomManager->gameState) {
+                DisplayManager* dm = roomManager->gameState->getDisplayManager();
+                if (dm) {
+                    dm->displayMessage(
+                        detectedMove + " DETECTED",
+                        "Press button to confirm"
+                    );
+                }
             }
             
-            handPosition handPos;
-            auto status = hand_analyze_image(frame, &handPos);
+            while (runThread.load() && (getTimeInMs() - confirmationStartTime < CONFIRMATION_TIMEOUT_MS)) {
+                // Wait for the button, waking at least every 50 ms for the countdown
+                Input_event_t inputEvent;
+                if (Input_wait(inputSubscriber, &inputEvent, 50)) {
+                    if (inputEvent.device == INPUT_DEVICE_ROTARY_BUTTON && inputEvent.type == INPUT_PRESS) {
+                        gestureConfirmed = true;
+                        confirmPressNs = inputEvent.timeNs;
+                        LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Gesture confirmed with button press";
+                        break;
+                    }
+                } else if (inputSubscriber < 0) {
+                    // No subscription; just time out
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                }
+                
+                // Update countdown display every second
+                static long long lastUpdateTime = 0;
+                long long currentTime = getTimeInMs();
+                int remainingSeconds = (CONFIRMATION_TIMEOUT_MS - (currentTime - confirmationStartTime)) / 1000;
+                
+                if (currentTime - lastUpdateTime > 1000 && roomManager && roomManager->gameState) {
+                    DisplayManager* dm = roomManager->gameState->getDisplayManager();
+                    if (dm) {
+                        char countdownMessage[32];
+                        snprintf(countdownMessage, sizeof(countdownMessage), "Confirm (%d sec left)", remainingSeconds + 1);
+                        dm->displayMessage(
+                            detectedMove + " DETECTED",
+                            countdownMessage
+                        );
+                        lastUpdateTime = currentTime;
+                    }
+                }
+            }
+            Input_unsubscribe(inputSubscriber);
             
-            if (!status.ok()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            // If confirmed or timed out
+            if (gestureConfirmed) {
+                // Send the gesture
+                LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Sending confirmed gesture: " << detectedMove;
+                confirmGesture(actionType);
+                Metrics_observe(confirmLatencyMetric, (Input_nowNs() - confirmPressNs) / 1e6);
+                
+                // After successful confirmation and sending, stop the gesture detection
+                // until it's restarted for the next round
+                LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Gesture confirmed and sent. Stopping detection until next round.";
+                runThread.store(false); // The camera thread goes back to standby
+                return;
+            } else {
+                LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Gesture confirmation timed out";
+                // Short delay to show timeout message
+                std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+            }
+        }
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+void GestureDetector::gestureLoop() {
+    static const int fpsMetric = Metrics_registerGauge("gesture_fps", nullptr,
+        "Frames analyzed per second over the last second of detection.");
+    static const int cameraOpenMetric = Metrics_registerSummary("camera_open_ms", nullptr,
+        "Time to open the camera and capture its first frame, in ms.");
+
+    pthread_setname_np(pthread_self(), "gesture_cam");
+    Topology_applySelf();
+    LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Camera thread started";
+    
+    while (keepAlive.load()) {
+        // Use try-catch so a camera error doesn't end the thread
+        try {
+            if (!runThread.load() && !isWarmStandby()) {
+                // Cold standby: release the camera until detection starts
+                if (camera.isOpen()) {
+                    LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Closing camera until detection starts";
+                    camera.closeCamera();
+                }
+                frameGrabbed = false;
+                std::unique_lock<std::mutex> lock(stateMutex);
+                cameraReady = false;
+                stateChanged.notify_all();
+                stateChanged.wait(lock, [this]() { return !keepAlive.load() || runThread.load() || warmStandby; });
                 continue;
             }
             
-            if (handPos.hand_visible) {
-                {
-                    std::lock_guard<std::mutex> lock(handMutex);
-                    currentHand = handPos;
+            if (!camera.isOpen()) {
+                auto openStart = std::chrono::steady_clock::now();
+                bool opened = camera.openCamera() && camera.grabFrame();
+                frameGrabbed = opened;
+                if (!opened) {
+                    camera.closeCamera();
                 }
-                
-                // Debug output for hand position
-                if (handPos.num_fingers_held_up > 0) {
-                    std::cout << "[GestureDetector.cpp] Fingers up: " << handPos.num_fingers_held_up 
-                            << " (I:" << handPos.index_held_up
-                            << " M:" << handPos.middle_held_up
-                            << " R:" << handPos.ring_held_up
-                            << " P:" << handPos.pinky_held_up
-                            << " T:" << handPos.thumb_held_up << ")" << std::endl;
+                std::unique_lock<std::mutex> lock(stateMutex);
+                cameraReady = opened;
+                cameraFailed = !opened;
+                stateChanged.notify_all();
+                if (!opened) {
+                    LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Failed to open camera, retrying in "
+                            << CAMERA_RETRY_MS << " ms";
+                    stateChanged.wait_for(lock, std::chrono::milliseconds(CAMERA_RETRY_MS),
+                                          [this]() { return !keepAlive.load(); });
+                    continue;
                 }
-                
-                std::string detectedMove, actionType;
-                if (recognizeGesture(handPos, detectedMove, actionType)) {
-                    // Get initial rotary encoder value
-                    int initialValue = rotary_press_statemachine_getValue();
-                    long long confirmationStartTime = getTimeInMs();
-                    bool gestureConfirmed = false;
-                    
-                    // Wait for confirmation or timeout (5 seconds)
-                    const int CONFIRMATION_TIMEOUT_MS = 5000; // 5 seconds
-                    
-                    std::cout << "[GestureDetector.cpp] Waiting for gesture confirmation... (press button)" << std::endl;
-                    
-                    // After initializing wait period, update display with time remaining info
-                    if (roomManager && roomManager->gameState) {
-                        DisplayManager* dm = roomManager->gameState->getDisplayManager();
-                        if (dm) {
-                            dm->displayMessage(
-                                detectedMove + " DETECTED",
-                                "Press button to confirm"
-                            );
-                        }
-                    }
-                    
-                    while (runThread.load() && (getTimeInMs() - confirmationStartTime < CONFIRMATION_TIMEOUT_MS)) {
-                        // Check if button was pressed
-                        int currentValue = rotary_press_statemachine_getValue();
-                        if (currentValue != initialValue) {
-                            gestureConfirmed = true;
-                            std::cout << "[GestureDetector.cpp] Gesture confirmed with button press" << std::endl;
-                            break;
-                        }
-                        
-                        // Update countdown display every second
-                        static long long lastUpdateTime = 0;
-                        long long currentTime = getTimeInMs();
-                        int remainingSeconds = (CONFIRMATION_TIMEOUT_MS - (currentTime - confirmationStartTime)) / 1000;
-                        
-                        if (currentTime - lastUpdateTime > 1000 && roomManager && roomManager->gameState) {
-                            DisplayManager* dm = roomManager->gameState->getDisplayManager();
-                            if (dm) {
-                                char countdownMessage[32];
-                                snprintf(countdownMessage, sizeof(countdownMessage), "Confirm (%d sec left)", remainingSeconds + 1);
-                                dm->displayMessage(
-                                    detectedMove + " DETECTED",
-                                    countdownMessage
-                                );
-                                lastUpdateTime = currentTime;
-                            }
-                        }
-                        
-                        // Small delay to prevent high CPU usage
-                        std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                    }
-                    
-                    // If confirmed or timed out
-                    if (gestureConfirmed) {
-                        // Send the gesture
-                        std::cout << "[GestureDetector.cpp] Sending confirmed gesture: " << detectedMove << std::endl;
-                        confirmGesture(actionType);
-                        
-                        // After successful confirmation and sending, stop the gesture detection
-                        // until it's restarted for the next round
-                        std::cout << "[GestureDetector.cpp] Gesture confirmed and sent. Stopping detection until next round." << std::endl;
-                        runThread.store(false); // Properly set runThread to false before breaking
-                        break; // Exit the main loop to stop detection
-                    } else {
-                        std::cout << "[GestureDetector.cpp] Gesture confirmation timed out" << std::endl;
-                        // Short delay to show timeout message
-                        std::this_thread::sleep_for(std::chrono::milliseconds(1500));
-                    }
+                Metrics_observe(cameraOpenMetric, msSince(openStart));
+                LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Camera streaming";
+            }
+            
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                inDetection = runThread.load();
+            }
+            if (!inDetection) {
+                // Warm standby: dequeue each frame without decoding it, so
+                // the driver's buffers keep cycling and exposure keeps up
+                frameGrabbed = camera.grabFrame();
+                if (!frameGrabbed) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
                 }
+                continue;
             }
             
+            try {
+                detectFrame();
+            } catch (const std::exception& e) {
+                LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_ERROR) << "[GestureDetector.cpp] Exception in gesture loop: " << e.what();
+            } catch (...) {
+                LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_ERROR) << "[GestureDetector.cpp] Unknown exception in gesture loop";
+            }
+            Trace_setFlow(0);
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                inDetection = false;
+            }
+            stateChanged.notify_all();
+            if (!runThread.load()) {
+                // Not detecting any more
+                Metrics_set(fpsMetric, 0);
+            }
+        }
+        catch (const std::exception& e) {
+            LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_ERROR) << "[GestureDetector.cpp] Exception in camera thread: " << e.what();
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        catch (...) {
+            LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_ERROR) << "[GestureDetector.cpp] Unknown exception in camera thread";
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
-    }
-    catch (const std::exception& e) {
-        std::cerr << "[GestureDetector.cpp] Exception in gesture loop: " << e.what() << std::endl;
-    }
-    catch (...) {
-        std::cerr << "[GestureDetector.cpp] Unknown exception in gesture loop" << std::endl;
     }
     
-    // Always make sure the camera is closed when we exit the loop
+    // Always make sure the camera is closed when the thread exits
     try {
-        std::cout << "[GestureDetector.cpp] Gesture detection loop ended, closing camera" << std::endl;
+        LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Camera thread ended, closing camera";
         camera.closeCamera();
     }
     catch (const std::exception& e) {
-        std::cerr << "[GestureDetector.cpp] Exception closing camera: " << e.what() << std::endl;
+        LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_ERROR) << "[GestureDetector.cpp] Exception closing camera: " << e.what();
     }
+    std::lock_guard<std::mutex> lock(stateMutex);
+    cameraReady = false;
+    stateChanged.notify_all();
 }
 
 handPosition GestureDetector::getCurrentHand() {
@@ -352,9 +545,14 @@ handPosition GestureDetector::getCurrentHand() {
 }
 
 void GestureDetector::runTestingMode() {
+    // The test opens the camera itself, so standby has to let go of it
+    bool wasWarm = isWarmStandby();
+    setWarmStandby(false);
+    
     // Just test the camera with simple feedback
     CameraHAL testCamera;
     if (!testCamera.openCamera()) {
+        setWarmStandby(wasWarm);
         return;
     }
     
@@ -414,6 +612,7 @@ void GestureDetector::runTestingMode() {
     }
     
     testCamera.closeCamera();
+    setWarmStandby(wasWarm);
 }
 
 void GestureDetector::confirmGesture(const std::string& actionType) {
@@ -461,5 +660,5 @@ void GestureDetector::confirmGesture(const std::string& actionType) {
     
     // Mark the thread as not running but don't call stop() to avoid deadlock
     // This is now handled in the gestureLoop with runThread.store(false)
-    std::cout << "[GestureDetector.cpp] Gesture confirmed, runThread will be set to false" << std::endl;
+    LOG_LINE(LOG_CAT_GESTURE, LOG_LEVEL_INFO) << "[GestureDetector.cpp] Gesture confirmed, runThread will be set to false";
 } 
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <opencv2/opencv.hpp>
 #include <nlohmann/json.hpp>
 #include "hand_recognition.hpp"
@@ -16,9 +18,17 @@ class GestureEventSender;
 // For convenience
 using json = nlohmann::json;
 
+// The camera thread runs from the first start() (or warmUp()) until the
+// detector is destroyed. Between rounds it keeps the camera streaming and
+// drops frames without decoding them (warm standby), and the hand tracking
+// graph stays loaded, so start() and stop() only decide whether frames are
+// analyzed, classified and sent.
 class GestureDetector {
 private:
+    // Whether frames are being detected on; what isRunning() reports
     std::atomic<bool> runThread;
+    // Cleared to end the camera thread
+    std::atomic<bool> keepAlive;
     std::thread gestureThread;
     RoomManager* roomManager;
     GestureEventSender* eventSender;
@@ -36,8 +46,28 @@ private:
     
     CameraHAL camera;
     
-    // Gesture detection loop
+    // Camera thread state, guarded by stateMutex
+    std::mutex stateMutex;
+    std::condition_variable stateChanged;
+    bool warmStandby;           // Keep the camera streaming while stopped
+    bool cameraReady;           // Open, with at least one frame captured
+    bool cameraFailed;          // The last attempt to open it failed
+    bool inDetection;           // The thread is working on a detection frame
+    // Set by start() while no detection frame is in progress
+    std::chrono::steady_clock::time_point startTime;
+    bool firstResultPending;
+    std::chrono::steady_clock::time_point fpsWindowStart;
+    int fpsWindowFrames;
+    // Camera thread only: a frame grabbed in standby that detection can
+    // decode straight away
+    bool frameGrabbed;
+    
+    // Camera thread: standby or detection, until the detector is destroyed
     void gestureLoop();
+    // Start the camera thread if it isn't running yet
+    void startCameraThread();
+    // Capture, analyze and act on one frame while detection is on
+    void detectFrame();
     
     // Gesture recognition function
     bool recognizeGesture(const handPosition& handPos, std::string& detectedMove, std::string& actionType);
@@ -59,6 +89,16 @@ public:
     void start();
     void stop();
     
+    // Open the camera ahead of the first round and wait (up to timeoutMs)
+    // for its first frame. Returns false if the camera didn't come up.
+    bool warmUp(int timeoutMs);
+    // With warm standby off, the camera is closed whenever detection stops
+    // and reopened by start(), as before. Turning it off waits for the
+    // camera to be released (unless detection is running).
+    void setWarmStandby(bool enabled);
+    bool isWarmStandby();
+    bool isCameraReady();
+    
     // Check if running
     bool isRunning() const { return runThread.load(); }
     
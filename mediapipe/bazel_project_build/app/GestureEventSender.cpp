@@ -1,6 +1,6 @@
 #include "GestureEventSender.h"
+#include "logger.h"
 #include <nlohmann/json.hpp>
-#include <iostream>
 
 using json = nlohmann::json;
 
@@ -21,27 +21,27 @@ bool GestureEventSender::sendGestureEvent(
 ) {
     // Extra safety checks to prevent segfaults
     if (!client) {
-        std::cerr << "[GestureEventSender.cpp] Client pointer is NULL, cannot send gesture event" << std::endl;
+        LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_ERROR) << "[GestureEventSender.cpp] Client pointer is NULL, cannot send gesture event";
         return false;
     }
     
     // Verify that the client is connected before proceeding
     try {
         if (!client->isConnected()) {
-            std::cerr << "[GestureEventSender.cpp] Client is not connected, cannot send gesture event" << std::endl;
+            LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_ERROR) << "[GestureEventSender.cpp] Client is not connected, cannot send gesture event";
             return false;
         }
     } catch (const std::exception& e) {
-        std::cerr << "[GestureEventSender.cpp] Exception checking connection status: " << e.what() << std::endl;
+        LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_ERROR) << "[GestureEventSender.cpp] Exception checking connection status: " << e.what();
         return false;
     } catch (...) {
-        std::cerr << "[GestureEventSender.cpp] Unknown exception checking connection status" << std::endl;
+        LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_ERROR) << "[GestureEventSender.cpp] Unknown exception checking connection status";
         return false;
     }
     
     // Validate input parameters
     if (roomId.empty() || playerId.empty() || gesture.empty()) {
-        std::cerr << "[GestureEventSender.cpp] Invalid parameters (empty roomId, playerId, or gesture)" << std::endl;
+        LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_ERROR) << "[GestureEventSender.cpp] Invalid parameters (empty roomId, playerId, or gesture)";
         return false;
     }
     
@@ -68,33 +68,33 @@ bool GestureEventSender::sendGestureEvent(
         try {
             eventString = eventJson.dump();
         } catch (const std::exception& e) {
-            std::cerr << "[GestureEventSender.cpp] Error serializing JSON: " << e.what() << std::endl;
+            LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_ERROR) << "[GestureEventSender.cpp] Error serializing JSON: " << e.what();
             return false;
         }
         
         // Verify the event string is valid before sending
         if (eventString.empty()) {
-            std::cerr << "[GestureEventSender.cpp] Generated empty event string" << std::endl;
+            LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_ERROR) << "[GestureEventSender.cpp] Generated empty event string";
             return false;
         }
         
-        std::cout << "[GestureEventSender.cpp] Sending gesture: " << gesture 
-                  << " for player " << playerId 
-                  << " in room " << roomId << std::endl;
+        LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_INFO) << "[GestureEventSender.cpp] Sending gesture: " << gesture 
+                << " for player " << playerId 
+                << " in room " << roomId;
         
         // Send via WebSocket with extra safety
         bool result = false;
         try {
             // Double-check client before sending
             if (!client || !client->isConnected()) {
-                std::cerr << "[GestureEventSender.cpp] Client became invalid before sending" << std::endl;
+                LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_ERROR) << "[GestureEventSender.cpp] Client became invalid before sending";
                 return false;
             }
             
             result = client->sendMessage(eventString);
             
             if (!result) {
-                std::cerr << "[GestureEventSender.cpp] sendMessage returned false" << std::endl;
+                LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_ERROR) << "[GestureEventSender.cpp] sendMessage returned false";
                 return false;
             }
             
@@ -104,24 +104,24 @@ bool GestureEventSender::sendGestureEvent(
                     client->ensureMessageProcessing();
                 }
             } catch (const std::exception& e) {
-                std::cerr << "[GestureEventSender.cpp] Error in ensureMessageProcessing: " << e.what() << std::endl;
+                LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_ERROR) << "[GestureEventSender.cpp] Error in ensureMessageProcessing: " << e.what();
                 // Still return true if the message was sent successfully
             }
             
-            std::cout << "[GestureEventSender.cpp] Gesture event sent successfully" << std::endl;
+            LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_INFO) << "[GestureEventSender.cpp] Gesture event sent successfully";
             return result;
         } catch (const std::exception& e) {
-            std::cerr << "[GestureEventSender.cpp] Exception sending gesture event: " << e.what() << std::endl;
+            LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_ERROR) << "[GestureEventSender.cpp] Exception sending gesture event: " << e.what();
             return false;
         } catch (...) {
-            std::cerr << "[GestureEventSender.cpp] Unknown exception sending gesture event" << std::endl;
+            LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_ERROR) << "[GestureEventSender.cpp] Unknown exception sending gesture event";
             return false;
         }
     } catch (const std::exception& e) {
-        std::cerr << "[GestureEventSender.cpp] Unexpected exception: " << e.what() << std::endl;
+        LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_ERROR) << "[GestureEventSender.cpp] Unexpected exception: " << e.what();
         return false;
     } catch (...) {
-        std::cerr << "[GestureEventSender.cpp] Unknown exception in sendGestureEvent" << std::endl;
+        LOG_LINE(LOG_CAT_NETWORK, LOG_LEVEL_ERROR) << "[GestureEventSender.cpp] Unknown exception in sendGestureEvent";
         return false;
     }
     
@@ -1,41 +1,124 @@
 #include "SoundManager.h"
+#include "sampleBank.h"
+#include "assetCache.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+// Sounds are converted once into a sample bank on local storage; later
+// startups map that with one sequential read instead of reading each WAV
+// from the NFS share. Override the location with SOUND_BANK_PATH. The WAVs
+// themselves are read from the asset cache's local copies, so checking
+// whether the bank is current doesn't touch the share either.
+#define SOUND_DIR "/mnt/remote/mediapipe/sounds/"
+#define DEFAULT_BANK_PATH "/var/tmp/gesture_game_sounds.bank"
+
+static const SampleBank_source_t sources[] = {
+    { "attack", SOUND_DIR "attack_s16.wav" },
+    { "build",  SOUND_DIR "build_s16.wav" },
+    { "shield", SOUND_DIR "shield_s16.wav" },
+};
+#define NUM_SOUNDS ((int)(sizeof(sources) / sizeof(sources[0])))
+
+static SampleBank_t *bank = NULL;
 static wavedata_t sound_attack;
 static wavedata_t sound_build;
 static wavedata_t sound_shield;
+static wavedata_t *sounds[NUM_SOUNDS] = { &sound_attack, &sound_build, &sound_shield };
 
-void SoundManager_init() {
-    char path[256];
+static SampleBank_t *openBank(const char *bankPath, const SampleBank_source_t *pSources,
+        bool allLocal)
+{
+    SampleBank_t *pBank = SampleBank_open(bankPath, AUDIOMIXER_SAMPLE_RATE);
+    if (pBank != NULL && SampleBank_isCurrent(pBank, pSources, NUM_SOUNDS)) {
+        return pBank;
+    }
+    if (!allLocal) {
+        // Rebuilding needs every file; an old bank still beats silence
+        return pBank;
+    }
+    SampleBank_close(pBank);
+
+    printf("[SoundManager] Building sample bank %s...\n", bankPath);
+    if (SampleBank_write(bankPath, pSources, NUM_SOUNDS, AUDIOMIXER_SAMPLE_RATE) != 0) {
+        return NULL;
+    }
+    return SampleBank_open(bankPath, AUDIOMIXER_SAMPLE_RATE);
+}
 
-    strcpy(path, "/mnt/remote/mediapipe/sounds/attack_s16.wav");
-    AudioMixer_readWaveFileIntoMemory(path, &sound_attack);
+void SoundManager_init() {
+    const char *bankPath = getenv("SOUND_BANK_PATH");
+    if (bankPath == NULL) {
+        bankPath = DEFAULT_BANK_PATH;
+    }
 
-    strcpy(path, "/mnt/remote/mediapipe/sounds/build_s16.wav");
-    AudioMixer_readWaveFileIntoMemory(path, &sound_build);
+    // A sound without a local copy yet (first start, or an emptied cache
+    // dir) is fetched in the background for the next start; until then it
+    // is read straight from the share
+    SampleBank_source_t localSources[NUM_SOUNDS];
+    bool allLocal = true;
+    for (int i = 0; i < NUM_SOUNDS; i++) {
+        localSources[i].name = sources[i].name;
+        localSources[i].fileName = AssetCache_getPath(sources[i].fileName);
+        if (localSources[i].fileName == NULL) {
+            printf("[SoundManager] No local copy of %s yet.\n", sources[i].fileName);
+            allLocal = false;
+        }
+    }
 
-    strcpy(path, "/mnt/remote/mediapipe/sounds/shield_s16.wav");
-    AudioMixer_readWaveFileIntoMemory(path, &sound_shield);
+    bank = openBank(bankPath, localSources, allLocal);
+    if (bank != NULL) {
+        for (int i = 0; i < NUM_SOUNDS; i++) {
+            SampleBank_get(bank, sources[i].name, sounds[i]);
+        }
+        printf("[SoundManager] Mapped %d sounds from %s.\n", NUM_SOUNDS, bankPath);
+        return;
+    }
 
-    printf("[SoundManager] Loaded all 3 sound files.\n");
+    // No usable bank (read-only storage, or some sounds not cached yet):
+    // load the files directly. A sound that fails to load just stays silent.
+    int loaded = 0;
+    for (int i = 0; i < NUM_SOUNDS; i++) {
+        const char *fileName = localSources[i].fileName != NULL ?
+                localSources[i].fileName : sources[i].fileName;
+        if (AudioMixer_readWaveFileIntoMemory(fileName, sounds[i]) == 0) {
+            loaded++;
+        }
+    }
+    printf("[SoundManager] Loaded %d of %d sound files.\n", loaded, NUM_SOUNDS);
 }
 
 void SoundManager_cleanup() {
-    AudioMixer_freeWaveFileData(&sound_attack);
-    AudioMixer_freeWaveFileData(&sound_build);
-    AudioMixer_freeWaveFileData(&sound_shield);
+    if (bank != NULL) {
+        // Sounds point into the bank mapping
+        for (int i = 0; i < NUM_SOUNDS; i++) {
+            sounds[i]->numSamples = 0;
+            sounds[i]->pData = NULL;
+        }
+        SampleBank_close(bank);
+        bank = NULL;
+    } else {
+        for (int i = 0; i < NUM_SOUNDS; i++) {
+            AudioMixer_freeWaveFileData(sounds[i]);
+        }
+    }
     printf("[SoundManager] Freed all sound files.\n");
 }
 
+static void play(wavedata_t *pSound) {
+    if (pSound->numSamples > 0) {
+        AudioMixer_queueSound(pSound);
+    }
+}
+
 void SoundManager_playAttack() {
-    AudioMixer_queueSound(&sound_attack);
+    play(&sound_attack);
 }
 
 void SoundManager_playBuild() {
-    AudioMixer_queueSound(&sound_build);
+    play(&sound_build);
 }
 
 void SoundManager_playShield() {
-    AudioMixer_queueSound(&sound_shield);
+    play(&sound_shield);
 }
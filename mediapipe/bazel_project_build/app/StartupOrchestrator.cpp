@@ -0,0 +1,189 @@
+#include "StartupOrchestrator.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <pthread.h>
+#include "metrics.h"
+#include "trace.h"
+
+// Width of the timeline bars, in characters
+#define TIMELINE_WIDTH 40
+
+static const char* stateName(StartupOrchestrator::PhaseState state) {
+    switch (state) {
+        case StartupOrchestrator::PhaseState::Waiting: return "waiting";
+        case StartupOrchestrator::PhaseState::Running: return "running";
+        case StartupOrchestrator::PhaseState::Done: return "done";
+        case StartupOrchestrator::PhaseState::Failed: return "FAILED";
+        case StartupOrchestrator::PhaseState::Skipped: return "skipped";
+    }
+    return "?";
+}
+
+void StartupOrchestrator::addPhase(const std::string& name, const std::vector<std::string>& after,
+                                   std::function<bool()> run, bool required) {
+    phases.push_back({name, after, run, required, PhaseState::Waiting, 0.0, 0.0});
+}
+
+void StartupOrchestrator::setProgressCallback(ProgressCallback callback) {
+    progressCallback = callback;
+}
+
+// Whether every dependency of the phase is Done; *pBlocked is set if one
+// of them can never finish. Unknown names block the phase.
+bool StartupOrchestrator::dependenciesDone(const Phase& phase, bool* pBlocked) const {
+    bool allDone = true;
+    *pBlocked = false;
+    for (const std::string& name : phase.after) {
+        auto it = std::find_if(phases.begin(), phases.end(),
+                               [&](const Phase& other) { return other.name == name; });
+        if (it == phases.end() || it->state == PhaseState::Failed || it->state == PhaseState::Skipped) {
+            *pBlocked = true;
+            return false;
+        }
+        if (it->state != PhaseState::Done) {
+            allDone = false;
+        }
+    }
+    return allDone;
+}
+
+void StartupOrchestrator::runPhase(size_t index) {
+    std::string name;
+    std::function<bool()> function;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        name = phases[index].name;
+        function = phases[index].run;
+    }
+    // Thread names are limited to 15 characters
+    pthread_setname_np(pthread_self(), ("init_" + name).substr(0, 15).c_str());
+
+    Trace_begin(Trace_intern(("startup " + name).c_str()));
+    bool ok = false;
+    try {
+        ok = function();
+    } catch (const std::exception& e) {
+        std::cerr << "Startup phase " << name << " threw: " << e.what() << std::endl;
+    }
+    Trace_end();
+
+    Phase finished;
+    int finishedSoFar;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Phase& phase = phases[index];
+        phase.endMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - startTime).count();
+        phase.state = ok ? PhaseState::Done : PhaseState::Failed;
+        finished = phase;
+        finishedSoFar = ++finishedCount;
+    }
+    phaseFinished.notify_all();
+
+    if (progressCallback) {
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        progressCallback(finished, finishedSoFar, (int)phases.size());
+    }
+}
+
+bool StartupOrchestrator::run() {
+    static const int startupMetric = Metrics_registerGauge("startup_ms", nullptr,
+        "Time from the start of start-up until every phase had finished, in ms.");
+
+    std::vector<std::thread> threads;
+    std::unique_lock<std::mutex> lock(mutex);
+    startTime = std::chrono::steady_clock::now();
+    finishedCount = 0;
+
+    while (true) {
+        // Start everything that is ready, and skip what never can be; a
+        // skip can unblock nothing but may block more, so repeat until stable
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t i = 0; i < phases.size(); i++) {
+                Phase& phase = phases[i];
+                if (phase.state != PhaseState::Waiting) {
+                    continue;
+                }
+                bool blocked;
+                double nowMs = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - startTime).count();
+                if (dependenciesDone(phase, &blocked)) {
+                    phase.state = PhaseState::Running;
+                    phase.startMs = nowMs;
+                    threads.emplace_back(&StartupOrchestrator::runPhase, this, i);
+                } else if (blocked) {
+                    phase.state = PhaseState::Skipped;
+                    phase.startMs = nowMs;
+                    phase.endMs = nowMs;
+                    finishedCount++;
+                    changed = true;
+                }
+            }
+        }
+
+        bool anyRunning = std::any_of(phases.begin(), phases.end(),
+                                      [](const Phase& phase) { return phase.state == PhaseState::Running; });
+        if (!anyRunning) {
+            // Whatever still waits depends on something that can't start
+            // (a cycle); give up on it
+            for (Phase& phase : phases) {
+                if (phase.state == PhaseState::Waiting) {
+                    phase.state = PhaseState::Skipped;
+                }
+            }
+            break;
+        }
+        phaseFinished.wait(lock);
+    }
+    lock.unlock();
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    Metrics_set(startupMetric, totalMs);
+
+    bool ok = true;
+    for (const Phase& phase : phases) {
+        if (phase.required && phase.state != PhaseState::Done) {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+void StartupOrchestrator::printTimeline(std::ostream& out) const {
+    std::vector<const Phase*> ordered;
+    for (const Phase& phase : phases) {
+        ordered.push_back(&phase);
+    }
+    std::stable_sort(ordered.begin(), ordered.end(),
+                     [](const Phase* a, const Phase* b) { return a->startMs < b->startMs; });
+
+    size_t nameWidth = 0;
+    for (const Phase* phase : ordered) {
+        nameWidth = std::max(nameWidth, phase->name.size());
+    }
+
+    // Formatted locally so the caller's stream keeps its own flags and precision
+    std::ostringstream timeline;
+    timeline << "Startup timeline (" << std::fixed << std::setprecision(0) << totalMs << " ms):\n";
+    for (const Phase* phase : ordered) {
+        int from = totalMs > 0 ? (int)(phase->startMs / totalMs * TIMELINE_WIDTH) : 0;
+        int to = totalMs > 0 ? (int)(phase->endMs / totalMs * TIMELINE_WIDTH) : 0;
+        to = std::min(std::max(to, from + 1), TIMELINE_WIDTH);
+        from = std::min(from, to - 1);
+        timeline << "  " << std::left << std::setw(nameWidth) << phase->name << std::right
+            << " |" << std::string(from, ' ') << std::string(to - from, '#')
+            << std::string(TIMELINE_WIDTH - to, ' ') << "| "
+            << std::setw(6) << phase->startMs << " -> " << std::setw(6) << phase->endMs
+            << " ms  " << stateName(phase->state) << '\n';
+    }
+    out << timeline.str() << std::flush;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <ostream>
+
+// Runs the application's start-up phases concurrently. Each phase names the
+// phases it must wait for; everything else runs at the same time on its own
+// thread, so e.g. the LCD reset delays, the server connection and loading
+// sounds overlap instead of adding up.
+class StartupOrchestrator {
+public:
+    enum class PhaseState { Waiting, Running, Done, Failed, Skipped };
+
+    struct Phase {
+        std::string name;
+        std::vector<std::string> after;
+        std::function<bool()> run;
+        // A required phase failing makes run() return false
+        bool required;
+        PhaseState state;
+        // Milliseconds since run() was called
+        double startMs;
+        double endMs;
+    };
+
+    // Called as each phase finishes (one call at a time), with the number
+    // of phases finished so far
+    using ProgressCallback = std::function<void(const Phase& phase, int finished, int total)>;
+
+    // Add a phase that starts once every phase in `after` is Done. If one of
+    // them fails or is skipped, this phase is Skipped. The function returns
+    // false if the phase failed.
+    void addPhase(const std::string& name, const std::vector<std::string>& after,
+                  std::function<bool()> run, bool required = true);
+    void setProgressCallback(ProgressCallback callback);
+
+    // Run every phase and wait for them all. Returns false if a required
+    // phase failed or was skipped.
+    bool run();
+
+    const std::vector<Phase>& getPhases() const { return phases; }
+    double getTotalMs() const { return totalMs; }
+    // One line per phase, in start order, with a bar showing where it ran
+    void printTimeline(std::ostream& out) const;
+
+private:
+    bool dependenciesDone(const Phase& phase, bool* pBlocked) const;
+    void runPhase(size_t index);
+
+    std::vector<Phase> phases;
+    ProgressCallback progressCallback;
+    std::mutex mutex;
+    std::condition_variable phaseFinished;
+    std::mutex callbackMutex;
+    int finishedCount = 0;
+    double totalMs = 0;
+    std::chrono::steady_clock::time_point startTime;
+};
@@ -4,7 +4,12 @@
 #include <sstream>
 #include <vector>
 #include <atomic>
+#include <chrono>
 #include <nlohmann/json.hpp>
+#include "metrics.h"
+#include "threadTopology.h"
+#include "trace.h"
+#include <pthread.h>
 
 using json = nlohmann::json;
 
@@ -39,10 +44,24 @@ static struct lws_protocols protocols[] = {
 #define MAX_SERVICE_INTERVAL_MS 3
 #define LOG_INTERVAL_MS 5000
 
+// Keep-alive sent every 20 seconds; the server answers with a pong event,
+// which gives us the round trip time
+static const char kPingMessage[] = "{\"event\":\"ping\"}";
+static const char kPongEvent[] = "\"event\":\"pong\"";
+
+static long long steadyTimeNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 WebSocketClient::WebSocketClient(const std::string& host, int port, const std::string& path, bool useTLS)
     : host(host), port(port), path(path), useTLS(useTLS), 
       connected(false), running(false), context(nullptr), wsi(nullptr), 
-      wakeRequested(false) {
+      wakeRequested(false), pingSentNs(0) {
+    queueDepthMetric = Metrics_registerGauge("websocket_send_queue_depth", nullptr,
+        "Messages waiting to be written to the server.");
+    rttMetric = Metrics_registerSummary("websocket_rtt_ms", nullptr,
+        "Round trip time of keep-alive pings to the server, in ms.");
 }
 
 WebSocketClient::~WebSocketClient() {
@@ -50,6 +69,10 @@ WebSocketClient::~WebSocketClient() {
 }
 
 void WebSocketClient::run() {
+    pthread_setname_np(pthread_self(), "ws_service");
+    // Reconnecting starts a new service thread
+    Topology_applySelf();
+    
     // Setup the lws context creation info
     struct lws_context_creation_info info;
     memset(&info, 0, sizeof(info));
@@ -137,6 +160,7 @@ void WebSocketClient::run() {
             queueSize = messageQueue.size();
             hasMessages = (queueSize > 0);
         }
+        Metrics_set(queueDepthMetric, queueSize);
         
         // Send periodic ping to keep connection alive
         auto now = std::chrono::steady_clock::now();
@@ -146,10 +170,9 @@ void WebSocketClient::run() {
         // Send a ping every 20 seconds
         if (connected && timeSinceLastPing > 20) {
             // Queue a simple ping message
-            std::string pingMsg = "{\"event\":\"ping\"}";
             {
                 std::lock_guard<std::mutex> lock(queueMutex);
-                messageQueue.push(pingMsg);
+                messageQueue.push({kPingMessage, 0});
             }
             
             // Request writable callback to send ping
@@ -260,10 +283,19 @@ bool WebSocketClient::sendMessage(const std::string& message) {
         return false;
     }
     
+    // A message sent for a traced frame gets a flow of its own to the
+    // service thread; the frame's flow already ends at the LCD
+    unsigned long long sendFlow = 0;
+    if (Trace_isEnabled() && Trace_getFlow() != 0) {
+        TRACE_SCOPE("ws_queue");
+        sendFlow = Trace_newFlowId();
+        Trace_flowStart("send", sendFlow);
+    }
+
     // Queue the message
     {
         std::lock_guard<std::mutex> lock(queueMutex);
-        messageQueue.push(message);
+        messageQueue.push({message, sendFlow});
     }
     
     // Request writable callback to send the message
@@ -289,17 +321,17 @@ bool WebSocketClient::sendMessage(const std::string& message) {
     return false;
 }
 
-std::string WebSocketClient::getNextMessage() {
+bool WebSocketClient::getNextMessage(OutgoingMessage& message) {
     std::lock_guard<std::mutex> lock(queueMutex);
     
     if (messageQueue.empty()) {
-        return "";
+        return false;
     }
     
-    std::string message = messageQueue.front();
-                messageQueue.pop();
+    message = std::move(messageQueue.front());
+    messageQueue.pop();
                 
-    return message;
+    return true;
 }
 
 void WebSocketClient::onConnected() {
@@ -330,6 +362,12 @@ void WebSocketClient::onDisconnected() {
 }
 
 void WebSocketClient::onMessageReceived(const std::string& message) {
+    long long sentNs = pingSentNs.load();
+    if (sentNs != 0 && message.find(kPongEvent) != std::string::npos) {
+        Metrics_observe(rttMetric, (steadyTimeNs() - sentNs) / 1e6);
+        pingSentNs = 0;
+    }
+    
     if (messageCallback) {
         messageCallback(message);
     }
@@ -368,11 +406,14 @@ void WebSocketClient::ensureMessageProcessing() {
 // Callback for writable buffer
 int WebSocketClient::callback_writable(struct lws *wsi) {
     // Check if we have messages to send
-    std::string message = getNextMessage();
-    
-    if (message.empty()) {
+    OutgoingMessage outgoing;
+    if (!getNextMessage(outgoing) || outgoing.text.empty()) {
         return 0;
     }
+    const std::string& message = outgoing.text;
+    
+    TRACE_SCOPE("ws_write");
+    Trace_flowEnd("send", outgoing.traceFlow);
     
     // Prepare the message for WebSocket frame
     // LWS requires extra space for headers (LWS_PRE)
@@ -389,6 +430,11 @@ int WebSocketClient::callback_writable(struct lws *wsi) {
         return -1;
     }
     
+    // Time the ping from when it actually goes out, not from when it was queued
+    if (message == kPingMessage) {
+        pingSentNs = steadyTimeNs();
+    }
+    
     // Request another writable event if we still have messages to send
     {
         std::lock_guard<std::mutex> lock(queueMutex);
@@ -16,6 +16,13 @@ struct ClientData {
     std::string fragmentBuffer;
 };
 
+// A message waiting to be written, with the trace flow (if any) of the
+// work that produced it
+struct OutgoingMessage {
+    std::string text;
+    unsigned long long traceFlow;
+};
+
 // Forward declarations for libwebsockets
 struct lws;
 enum lws_callback_reasons;
@@ -49,7 +56,7 @@ public:
     void onConnected();
     void onDisconnected();
     void onMessageReceived(const std::string& message);
-    std::string getNextMessage();
+    bool getNextMessage(OutgoingMessage& message);
     int callback_writable(struct lws *wsi);
     int callback_closed(struct lws *wsi);
     
@@ -76,9 +83,14 @@ private:
     std::atomic<bool> wakeRequested;
     
     // Message queue for outgoing messages
-    std::queue<std::string> messageQueue;
+    std::queue<OutgoingMessage> messageQueue;
     std::mutex queueMutex;
     
+    // Metrics: send queue depth and ping/pong round trip time
+    int queueDepthMetric;
+    int rttMetric;
+    std::atomic<long long> pingSentNs;  // Steady clock time of the unanswered ping, or 0
+    
     // User-defined callbacks
     std::function<void(const std::string&)> messageCallback;
     std::function<void(bool)> connectionCallback;
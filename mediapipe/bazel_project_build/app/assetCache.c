@@ -0,0 +1,572 @@
+#define _GNU_SOURCE		// pthread_timedjoin_np
+#include "assetCache.h"
+#include "lgMD5.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// The manifest has one line per local copy:
+//     <md5 hex> <size> <remote mtime> <remote path>
+// with the path last so it may hold spaces. A copy is named after its remote
+// path with every '/' turned into '_'.
+#define DEFAULT_CACHE_DIR "/var/tmp/gesture_game_assets"
+#define MANIFEST_NAME "manifest"
+// lgMd5Final() gives the digest as 32 hex digits and a NUL
+#define MD5_HEX_SIZE ASSET_CACHE_MD5_SIZE
+#define COPY_CHUNK_SIZE (64 * 1024)
+// Seconds between checks of the share
+#define REFRESH_INTERVAL_S 60
+// How long cleanup waits for a check stuck on an unresponsive share
+#define STOP_TIMEOUT_MS 500
+
+typedef struct {
+	char remotePath[ASSET_CACHE_MAX_PATH];
+	char localPath[2 * ASSET_CACHE_MAX_PATH];
+	// From the manifest; only meaningful while cached
+	bool cached;
+	char md5[MD5_HEX_SIZE];
+	uint64_t size;
+	int64_t remoteMtime;
+	// Copy checked against md5 this run
+	bool verified;
+	// Asked for this run, so kept up to date
+	bool wanted;
+	const void *pMap;
+	size_t mapSize;
+	char mapMd5[MD5_HEX_SIZE];
+} asset_t;
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeRefresh;
+static bool initialized = false;
+static char cacheDir[ASSET_CACHE_MAX_PATH];
+static asset_t assets[ASSET_CACHE_MAX_ASSETS];
+static int numAssets = 0;
+static AssetCache_stats_t stats;
+
+static pthread_t refreshThread;
+static bool refreshStarted = false;
+static bool stopping = false;
+
+static bool isMd5(const char *hex)
+{
+	return strlen(hex) == MD5_HEX_SIZE - 1 &&
+			strspn(hex, "0123456789abcdef") == MD5_HEX_SIZE - 1;
+}
+
+// Digest and size of a whole file. Returns 0 or -1 if it can't be read.
+static int md5File(const char *path, char *md5, uint64_t *pSize)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+	unsigned char *buffer = malloc(COPY_CHUNK_SIZE);
+	if (buffer == NULL) {
+		close(fd);
+		return -1;
+	}
+	lgMd5_t ctx;
+	lgMd5Init(&ctx);
+	uint64_t size = 0;
+	ssize_t n;
+	while ((n = read(fd, buffer, COPY_CHUNK_SIZE)) > 0) {
+		lgMd5Update(&ctx, buffer, n);
+		size += n;
+	}
+	free(buffer);
+	close(fd);
+	if (n < 0) {
+		return -1;
+	}
+	lgMd5Final(&ctx, (unsigned char *)md5);
+	*pSize = size;
+	return 0;
+}
+
+// Create dir and any missing parents
+static int makeDirs(const char *dir)
+{
+	char path[ASSET_CACHE_MAX_PATH];
+	snprintf(path, sizeof(path), "%s", dir);
+	for (char *p = path + 1; ; p++) {
+		if (*p != '/' && *p != '\0') {
+			continue;
+		}
+		char c = *p;
+		*p = '\0';
+		if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+			return -1;
+		}
+		*p = c;
+		if (c == '\0') {
+			return 0;
+		}
+	}
+}
+
+// Call with the mutex held
+static asset_t *findAsset(const char *remotePath, bool add)
+{
+	for (int i = 0; i < numAssets; i++) {
+		if (strcmp(assets[i].remotePath, remotePath) == 0) {
+			return &assets[i];
+		}
+	}
+	if (!add) {
+		return NULL;
+	}
+	if (numAssets == ASSET_CACHE_MAX_ASSETS || strlen(remotePath) >= ASSET_CACHE_MAX_PATH) {
+		fprintf(stderr, "ERROR: Asset cache can't hold %s.\n", remotePath);
+		return NULL;
+	}
+	asset_t *pAsset = &assets[numAssets++];
+	memset(pAsset, 0, sizeof(*pAsset));
+	strcpy(pAsset->remotePath, remotePath);
+	int len = snprintf(pAsset->localPath, sizeof(pAsset->localPath), "%s/", cacheDir);
+	for (const char *p = remotePath; *p != '\0'; p++) {
+		pAsset->localPath[len++] = *p == '/' ? '_' : *p;
+	}
+	pAsset->localPath[len] = '\0';
+	return pAsset;
+}
+
+static void readManifest(void)
+{
+	char path[2 * ASSET_CACHE_MAX_PATH];
+	snprintf(path, sizeof(path), "%s/" MANIFEST_NAME, cacheDir);
+	FILE *pFile = fopen(path, "r");
+	if (pFile == NULL) {
+		return;
+	}
+	char line[2 * ASSET_CACHE_MAX_PATH];
+	while (fgets(line, sizeof(line), pFile) != NULL) {
+		char md5[MD5_HEX_SIZE];
+		unsigned long long size;
+		long long mtime;
+		int pathStart = 0;
+		line[strcspn(line, "\n")] = '\0';
+		if (sscanf(line, "%32s %llu %lld %n", md5, &size, &mtime, &pathStart) != 3 ||
+				pathStart == 0 || line[pathStart] == '\0' || !isMd5(md5)) {
+			continue;
+		}
+		asset_t *pAsset = findAsset(line + pathStart, true);
+		if (pAsset == NULL) {
+			continue;
+		}
+		strcpy(pAsset->md5, md5);
+		pAsset->size = size;
+		pAsset->remoteMtime = mtime;
+		pAsset->cached = true;
+	}
+	fclose(pFile);
+}
+
+// Call with the mutex held. Written to a temporary file and renamed, so a
+// crash leaves the old manifest.
+static void writeManifest(void)
+{
+	char path[2 * ASSET_CACHE_MAX_PATH];
+	char tmpPath[2 * ASSET_CACHE_MAX_PATH + 4];
+	snprintf(path, sizeof(path), "%s/" MANIFEST_NAME, cacheDir);
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+	FILE *pFile = fopen(tmpPath, "w");
+	if (pFile == NULL) {
+		fprintf(stderr, "ERROR: Unable to write asset manifest %s: %s\n", tmpPath, strerror(errno));
+		return;
+	}
+	for (int i = 0; i < numAssets; i++) {
+		if (!assets[i].cached) {
+			continue;
+		}
+		fprintf(pFile, "%s %llu %lld %s\n", assets[i].md5, (unsigned long long)assets[i].size,
+				(long long)assets[i].remoteMtime, assets[i].remotePath);
+	}
+	bool ok = fflush(pFile) == 0 && fsync(fileno(pFile)) == 0;
+	if (fclose(pFile) != 0 || !ok || rename(tmpPath, path) != 0) {
+		fprintf(stderr, "ERROR: Unable to write asset manifest %s: %s\n", path, strerror(errno));
+		unlink(tmpPath);
+	}
+}
+
+// Call with the mutex held. Drops a copy that turned out to be bad.
+static void dropCopy(asset_t *pAsset)
+{
+	fprintf(stderr, "Cached copy of %s is corrupt; it will be fetched again.\n", pAsset->remotePath);
+	stats.numCorrupt++;
+	pAsset->cached = false;
+	pAsset->verified = false;
+	unlink(pAsset->localPath);
+	writeManifest();
+}
+
+int AssetCache_init(const char *dir)
+{
+	if (dir == NULL) {
+		dir = getenv("ASSET_CACHE_DIR");
+	}
+	if (dir == NULL) {
+		dir = DEFAULT_CACHE_DIR;
+	}
+	if (strlen(dir) >= sizeof(cacheDir) || makeDirs(dir) != 0) {
+		fprintf(stderr, "ERROR: Unable to create asset cache %s: %s\n", dir, strerror(errno));
+		return -1;
+	}
+
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&wakeRefresh, &attr);
+	pthread_condattr_destroy(&attr);
+
+	pthread_mutex_lock(&mutex);
+	strcpy(cacheDir, dir);
+	numAssets = 0;
+	memset(&stats, 0, sizeof(stats));
+	stopping = false;
+	readManifest();
+	initialized = true;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+const char *AssetCache_getPath(const char *remotePath)
+{
+	if (!initialized) {
+		return remotePath;
+	}
+	pthread_mutex_lock(&mutex);
+	asset_t *pAsset = findAsset(remotePath, true);
+	const char *result = NULL;
+	if (pAsset != NULL) {
+		pAsset->wanted = true;
+		if (pAsset->cached && !pAsset->verified) {
+			char md5[MD5_HEX_SIZE];
+			uint64_t size;
+			if (md5File(pAsset->localPath, md5, &size) == 0 && size == pAsset->size &&
+					strcmp(md5, pAsset->md5) == 0) {
+				pAsset->verified = true;
+			} else {
+				dropCopy(pAsset);
+			}
+		}
+		if (pAsset->cached) {
+			result = pAsset->localPath;
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+	return result;
+}
+
+const void *AssetCache_map(const char *remotePath, size_t *pSize)
+{
+	if (!initialized) {
+		return NULL;
+	}
+	pthread_mutex_lock(&mutex);
+	asset_t *pAsset = findAsset(remotePath, true);
+	if (pAsset == NULL) {
+		pthread_mutex_unlock(&mutex);
+		return NULL;
+	}
+	pAsset->wanted = true;
+	if (pAsset->pMap == NULL && pAsset->cached && pAsset->size > 0) {
+		// MAP_POPULATE reads the copy in one sequential pass; the digest
+		// below would fault every page in anyway
+		void *pMap = MAP_FAILED;
+		int fd = open(pAsset->localPath, O_RDONLY);
+		struct stat st;
+		if (fd >= 0 && fstat(fd, &st) == 0 && (uint64_t)st.st_size == pAsset->size) {
+			pMap = mmap(NULL, pAsset->size, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0);
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+		bool good = pMap != MAP_FAILED;
+		if (good && !pAsset->verified) {
+			char md5[MD5_HEX_SIZE];
+			lgMd5_t ctx;
+			lgMd5Init(&ctx);
+			lgMd5Update(&ctx, pMap, pAsset->size);
+			lgMd5Final(&ctx, (unsigned char *)md5);
+			good = strcmp(md5, pAsset->md5) == 0;
+		}
+		if (good) {
+			pAsset->pMap = pMap;
+			pAsset->mapSize = pAsset->size;
+			strcpy(pAsset->mapMd5, pAsset->md5);
+			pAsset->verified = true;
+		} else {
+			if (pMap != MAP_FAILED) {
+				munmap(pMap, pAsset->size);
+			}
+			dropCopy(pAsset);
+		}
+	}
+	const void *pMap = pAsset->pMap;
+	if (pMap != NULL && pSize != NULL) {
+		*pSize = pAsset->mapSize;
+	}
+	pthread_mutex_unlock(&mutex);
+	return pMap;
+}
+
+bool AssetCache_getMappedMd5(const char *remotePath, char *md5)
+{
+	if (!initialized) {
+		return false;
+	}
+	pthread_mutex_lock(&mutex);
+	asset_t *pAsset = findAsset(remotePath, false);
+	bool mapped = pAsset != NULL && pAsset->pMap != NULL;
+	if (mapped) {
+		strcpy(md5, pAsset->mapMd5);
+	}
+	pthread_mutex_unlock(&mutex);
+	return mapped;
+}
+
+static bool writeAll(int fd, const void *pData, size_t size)
+{
+	const char *p = pData;
+	while (size > 0) {
+		ssize_t written = write(fd, p, size);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		p += written;
+		size -= written;
+	}
+	return true;
+}
+
+// An MD5 published next to the remote file (md5sum format, e.g. made with
+// `md5sum attack_s16.wav > attack_s16.wav.md5`). Returns false if there is none.
+static bool readPublishedMd5(const char *remotePath, char *md5)
+{
+	char path[ASSET_CACHE_MAX_PATH + 4];
+	snprintf(path, sizeof(path), "%s.md5", remotePath);
+	FILE *pFile = fopen(path, "r");
+	if (pFile == NULL) {
+		return false;
+	}
+	bool found = fscanf(pFile, "%32s", md5) == 1 && isMd5(md5);
+	fclose(pFile);
+	return found;
+}
+
+// Copy remotePath to localPath if the share has a different version than
+// pAsset describes. Runs without the mutex; everything here may block on
+// the share. Returns 1 with pAsset's md5/size/remoteMtime set to the new
+// copy's, 0 if nothing changed or the share can't be reached, or -1.
+static int fetch(const char *remotePath, const char *localPath, asset_t *pAsset)
+{
+	struct stat st;
+	if (stat(remotePath, &st) != 0) {
+		return 0;
+	}
+	if (pAsset->cached && (uint64_t)st.st_size == pAsset->size &&
+			(int64_t)st.st_mtime == pAsset->remoteMtime) {
+		return 0;
+	}
+
+	int in = open(remotePath, O_RDONLY);
+	if (in < 0) {
+		fprintf(stderr, "Asset %s: %s\n", remotePath, strerror(errno));
+		return -1;
+	}
+	char tmpPath[2 * ASSET_CACHE_MAX_PATH + 4];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", localPath);
+	int out = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	unsigned char *buffer = malloc(COPY_CHUNK_SIZE);
+	if (out < 0 || buffer == NULL) {
+		fprintf(stderr, "ERROR: Unable to create %s: %s\n", tmpPath, strerror(errno));
+		if (out >= 0) {
+			close(out);
+			unlink(tmpPath);
+		}
+		free(buffer);
+		close(in);
+		return -1;
+	}
+
+	lgMd5_t ctx;
+	lgMd5Init(&ctx);
+	uint64_t size = 0;
+	bool ok = true;
+	ssize_t n;
+	while (ok && (n = read(in, buffer, COPY_CHUNK_SIZE)) != 0) {
+		if (n < 0) {
+			ok = errno == EINTR;
+			continue;
+		}
+		lgMd5Update(&ctx, buffer, n);
+		ok = writeAll(out, buffer, n);
+		size += n;
+	}
+	free(buffer);
+	char md5[MD5_HEX_SIZE];
+	lgMd5Final(&ctx, (unsigned char *)md5);
+
+	// A file rewritten while we read it is taken on the next check
+	struct stat after;
+	if (ok && (fstat(in, &after) != 0 || after.st_size != st.st_size ||
+			after.st_mtime != st.st_mtime || size != (uint64_t)st.st_size)) {
+		fprintf(stderr, "Asset %s changed while being copied.\n", remotePath);
+		ok = false;
+	}
+	close(in);
+	// Keep the remote mtime, so e.g. the sample bank sees the copy as the
+	// same file it was built from
+	struct timespec times[2] = { st.st_atim, st.st_mtim };
+	ok = ok && futimens(out, times) == 0 && fsync(out) == 0;
+	if (close(out) != 0) {
+		ok = false;
+	}
+
+	// Read the copy back, and check it against the share's own MD5 if it
+	// publishes one
+	char check[MD5_HEX_SIZE];
+	uint64_t checkSize;
+	if (ok && (md5File(tmpPath, check, &checkSize) != 0 || checkSize != size ||
+			strcmp(check, md5) != 0)) {
+		fprintf(stderr, "ERROR: Copy of %s doesn't read back correctly.\n", remotePath);
+		ok = false;
+	}
+	if (ok && readPublishedMd5(remotePath, check) && strcmp(check, md5) != 0) {
+		fprintf(stderr, "ERROR: %s doesn't match its published MD5.\n", remotePath);
+		ok = false;
+	}
+	if (!ok || rename(tmpPath, localPath) != 0) {
+		unlink(tmpPath);
+		return -1;
+	}
+
+	strcpy(pAsset->md5, md5);
+	pAsset->size = size;
+	pAsset->remoteMtime = st.st_mtime;
+	return 1;
+}
+
+static void *refreshLoop(void *arg)
+{
+	(void)arg;
+	pthread_mutex_lock(&mutex);
+	while (!stopping) {
+		for (int i = 0; i < numAssets && !stopping; i++) {
+			if (!assets[i].wanted) {
+				continue;
+			}
+			// Entries never move, but may change under us while unlocked;
+			// work on a copy
+			asset_t asset = assets[i];
+			pthread_mutex_unlock(&mutex);
+			int result = fetch(asset.remotePath, asset.localPath, &asset);
+			pthread_mutex_lock(&mutex);
+
+			if (result > 0) {
+				// A mapping of the old copy stays valid; the new one is
+				// used from the next start
+				strcpy(assets[i].md5, asset.md5);
+				assets[i].size = asset.size;
+				assets[i].remoteMtime = asset.remoteMtime;
+				assets[i].cached = true;
+				assets[i].verified = true;
+				stats.numRefreshed++;
+				writeManifest();
+				printf("[AssetCache] Updated %s\n", asset.remotePath);
+			} else if (result < 0) {
+				stats.numFailed++;
+			}
+		}
+
+		struct timespec deadline;
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += REFRESH_INTERVAL_S;
+		while (!stopping && pthread_cond_timedwait(&wakeRefresh, &mutex, &deadline) != ETIMEDOUT) {
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+	return NULL;
+}
+
+void AssetCache_startRefresh(void)
+{
+	pthread_mutex_lock(&mutex);
+	bool start = initialized && !refreshStarted;
+	refreshStarted = refreshStarted || start;
+	pthread_mutex_unlock(&mutex);
+	if (!start) {
+		return;
+	}
+	if (pthread_create(&refreshThread, NULL, refreshLoop, NULL) != 0) {
+		fprintf(stderr, "ERROR: Unable to start the asset refresh thread.\n");
+		pthread_mutex_lock(&mutex);
+		refreshStarted = false;
+		pthread_mutex_unlock(&mutex);
+		return;
+	}
+	pthread_setname_np(refreshThread, "asset_refresh");
+}
+
+void AssetCache_cleanup(void)
+{
+	pthread_mutex_lock(&mutex);
+	stopping = true;
+	pthread_cond_broadcast(&wakeRefresh);
+	bool joinRefresh = refreshStarted;
+	refreshStarted = false;
+	pthread_mutex_unlock(&mutex);
+
+	if (joinRefresh) {
+		// A stat() or read() on a hard-mounted share that went away never
+		// returns; don't let that hang the exit
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += STOP_TIMEOUT_MS * 1000000L;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+		if (pthread_timedjoin_np(refreshThread, NULL, &deadline) != 0) {
+			fprintf(stderr, "Asset refresh is stuck on the share; leaving it behind.\n");
+			pthread_detach(refreshThread);
+		}
+	}
+
+	pthread_mutex_lock(&mutex);
+	for (int i = 0; i < numAssets; i++) {
+		if (assets[i].pMap != NULL) {
+			munmap((void *)assets[i].pMap, assets[i].mapSize);
+			assets[i].pMap = NULL;
+		}
+	}
+	initialized = false;
+	pthread_mutex_unlock(&mutex);
+}
+
+void AssetCache_getStats(AssetCache_stats_t *pStats)
+{
+	pthread_mutex_lock(&mutex);
+	*pStats = stats;
+	pStats->numAssets = 0;
+	pStats->numCached = 0;
+	for (int i = 0; i < numAssets; i++) {
+		if (assets[i].wanted) {
+			pStats->numAssets++;
+			if (assets[i].cached) {
+				pStats->numCached++;
+			}
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+}
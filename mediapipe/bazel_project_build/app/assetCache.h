@@ -0,0 +1,69 @@
+// Local copies of the files the game loads from the NFS share (sounds, the
+// hand graph and models), so startup reads only local storage and a slow or
+// missing share can't stall or stop it.
+// Usage:
+//  - AssetCache_init() once, before anything loads files. It reads the local
+//    manifest only; nothing touches the share.
+//  - Loaders ask for a file by its usual (remote) path with
+//    AssetCache_getPath() or AssetCache_map() and get the local copy, checked
+//    against its MD5, or NULL if there is no good copy yet.
+//  - AssetCache_startRefresh() once startup is done. A background thread
+//    copies every file asked for whose size or mtime on the share differs
+//    from the copy's, verifies it and renames it into place. New copies are
+//    picked up by the next start; a file with no copy yet is fetched for
+//    next time.
+// The cache directory is $ASSET_CACHE_DIR, or /var/tmp/gesture_game_assets;
+// point it at a tmpfs (e.g. /dev/shm/...) to keep the copies in RAM.
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ASSET_CACHE_MAX_ASSETS 32
+#define ASSET_CACHE_MAX_PATH 256
+// An MD5 as 32 hex digits and a NUL
+#define ASSET_CACHE_MD5_SIZE 33
+
+typedef struct {
+	int numAssets;		// Files asked for since init
+	int numCached;		// ... of which have a good local copy
+	int numRefreshed;	// Copies fetched from the share since init
+	int numFailed;		// Fetches that failed (retried on the next check)
+	int numCorrupt;		// Local copies that didn't match their MD5
+} AssetCache_stats_t;
+
+// Use cacheDir, or the default when NULL. Returns 0, or -1 if the directory
+// can't be created; the cache is then off and loaders use the remote files.
+int AssetCache_init(const char *cacheDir);
+// Stops the refresh thread (without waiting on a hung share) and unmaps
+// everything from AssetCache_map()
+void AssetCache_cleanup(void);
+
+// The verified local copy of remotePath, or NULL if there isn't one. Also
+// marks remotePath to be kept up to date. With the cache off, returns
+// remotePath itself.
+const char *AssetCache_getPath(const char *remotePath);
+// The local copy of remotePath mapped read-only, verified, and valid until
+// AssetCache_cleanup(). Returns NULL if there isn't a good copy or the cache
+// is off.
+const void *AssetCache_map(const char *remotePath, size_t *pSize);
+// The MD5 of what AssetCache_map() returns for remotePath (which stays the
+// same when a refresh replaces the copy), into md5[ASSET_CACHE_MD5_SIZE].
+// Returns false if remotePath isn't mapped.
+bool AssetCache_getMappedMd5(const char *remotePath, char *md5);
+
+// Check the share in the background now and every refresh interval
+void AssetCache_startRefresh(void);
+
+void AssetCache_getStats(AssetCache_stats_t *pStats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2,6 +2,7 @@
 // which are left as incomplete.
 // Note: Generates low latency audio on BeagleBone Black; higher latency found on host.
 //#define _TIME_H 1
+#define _GNU_SOURCE
 #define _STRUCT_TIMESPEC
 #include "alsa/asoundlib.h"
 #include <time.h>
@@ -13,7 +14,14 @@
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sched.h>
+#include <errno.h>
+#include <semaphore.h>
 #include "periodTimer.h"
+#include "mixKernel.h"
+#include "waveLoader.h"
 #include "audioMixer.h"
 
 
@@ -21,7 +29,7 @@
 static snd_pcm_t *handle;
 
 #define DEFAULT_VOLUME 80
-#define SAMPLE_RATE 44100
+#define SAMPLE_RATE AUDIOMIXER_SAMPLE_RATE
 #define NUM_CHANNELS 1
 #define SAMPLE_SIZE (sizeof(short)) 			// bytes per sample
 // Sample size note: This works for mono files because each sample ("frame') is 1 value.
@@ -30,8 +38,17 @@ static snd_pcm_t *handle;
 static unsigned long playbackBufferSize = 0;
 static short *playbackBuffer = NULL;
 
+// Low latency (mmap) mode. When useMmap is set there is no playbackBuffer:
+// the playback thread mixes directly into the ALSA ring buffer, one period
+// at a time, and playbackBufferSize is the period size in frames.
+static bool useMmap = false;
+static bool useFifo = false;
+static unsigned int sampleRate = SAMPLE_RATE;
 
-// Currently active (waiting to be played) sound bites
+
+// Currently active (waiting to be played) sound bites.
+// Only the playback thread touches this list; other threads hand it new
+// sounds through commandRing below, so mixing never waits on a lock.
 #define MAX_SOUND_BITES 100
 typedef struct {
 	// A pointer to a previously allocated sound bite (wavedata_t struct).
@@ -42,41 +59,87 @@ typedef struct {
 	// The offset into the pData of pSound. Indicates how much of the
 	// sound has already been played (and hence where to start playing next).
 	int location;
+
+	// Q15 software gain for this voice (MIXKERNEL_UNITY_GAIN = as recorded)
+	int gain;
 } playbackSound_t;
 
 
 static playbackSound_t soundBites[MAX_SOUND_BITES];
+static int numSoundBites = 0;
+
+// Bounded multi-producer / single-consumer ring of sounds to start
+// (Vyukov's sequence-numbered queue). A slot whose sequence equals the
+// producer's position is free to fill; once filled its sequence is
+// position + 1, which tells the playback thread it can be read.
+#define COMMAND_RING_SIZE 128	// Must be a power of two
+typedef struct {
+	atomic_size_t sequence;
+	wavedata_t *pSound;
+	int gain;
+} audioCommand_t;
+
+static audioCommand_t commandRing[COMMAND_RING_SIZE];
+static atomic_size_t commandHead;		// Next position producers claim
+static size_t commandTail = 0;			// Next position to read (playback thread only)
+static atomic_ulong droppedSounds;		// Ring or voice list was full
+static atomic_ulong xrunCount;			// Under-runs since init
+
 // Playback threading
 void* playbackThread(void* arg);
-static _Bool stopping = false;
+static atomic_bool stopping = false;
 static pthread_t playbackThreadId;
-static pthread_mutex_t audioMutex = PTHREAD_MUTEX_INITIALIZER;
 static int volume = 0;
 
-void AudioMixer_init(void)
+// Volume control. The mixer handle is opened once and kept; the element is
+// the first of volumeControls (or AUDIO_MIXER_CONTROL) the card has, else
+// any element with a playback volume. With no hardware control at all the
+// volume is applied as a software master gain instead. Only setVolume()
+// and cleanup() touch the handle, under mixerMutex.
+static const char *const volumeControls[] = {
+	"PCM",			// ZEN cape
+	"Master", "Speaker", "Headphone", "Digital", "DAC",
+};
+static pthread_mutex_t mixerMutex = PTHREAD_MUTEX_INITIALIZER;
+static snd_mixer_t *mixerHandle = NULL;
+static snd_mixer_elem_t *volumeElem = NULL;
+static long volumeMin = 0;
+static long volumeMax = 0;
+static bool mixerProbed = false;
+
+// Software master gain (Q15). Others set the target; the playback thread
+// ramps masterGain towards it over MASTER_GAIN_RAMP_MS so changes don't click.
+#define MASTER_GAIN_RAMP_MS 20
+static atomic_int masterGainTarget = MIXKERNEL_UNITY_GAIN;
+static int masterGain = MIXKERNEL_UNITY_GAIN;	// Playback thread only
+
+// Idle handling. After IDLE_AFTER_MS of pure silence the playback thread
+// drains and stops the PCM, sets 'parked' and sleeps on 'wakeup'.
+// A producer that sees 'parked' after publishing a sound clears it and
+// posts the semaphore (sem_post never blocks, so queueSound stays safe
+// from any thread).
+#define IDLE_AFTER_MS 100
+static sem_t wakeup;
+static atomic_bool parked;
+static int silentFrames = 0;			// Playback thread only
+static long long startTimeNs = 0;
+static atomic_llong idleTimeNs;			// Completed idle spans
+static atomic_llong idleSinceNs;		// Start of the current span, 0 if awake
+static atomic_ulong idleCount;
+
+static long long getTimeInNs(void)
 {
-	AudioMixer_setVolume(DEFAULT_VOLUME);
-
-	// Initialize the currently active sound-bites being played
-	// REVISIT:- Implement this. Hint: set the pSound pointer to NULL for each
-	//     sound bite.
-    
-    pthread_mutex_lock(&audioMutex);
-    for (int i = 0; i < MAX_SOUND_BITES; i++) {
-        soundBites[i].pSound = NULL;
-        soundBites[i].location = 0;
-    }
-    pthread_mutex_unlock(&audioMutex);
-
-	// Open the PCM output
-	int err = snd_pcm_open(&handle, "default", SND_PCM_STREAM_PLAYBACK, 0);
-	if (err < 0) {
-		printf("Playback open error: %s\n", snd_strerror(err));
-		exit(EXIT_FAILURE);
-	}
+	struct timespec spec;
+	clock_gettime(CLOCK_MONOTONIC, &spec);
+	return (long long)spec.tv_sec * 1000000000LL + spec.tv_nsec;
+}
 
+// Original configuration: let ALSA pick the periods for a 50ms buffer and
+// copy each block out of playbackBuffer with snd_pcm_writei().
+static void openPcmDefault(void)
+{
 	// Configure parameters of PCM output
-	err = snd_pcm_set_params(handle,
+	int err = snd_pcm_set_params(handle,
 			SND_PCM_FORMAT_S16_LE,
 			SND_PCM_ACCESS_RW_INTERLEAVED,
 			NUM_CHANNELS,
@@ -95,50 +158,140 @@ void AudioMixer_init(void)
 	snd_pcm_get_params(handle, &unusedBufferSize, &playbackBufferSize);
 	// ..allocate playback buffer:
 	playbackBuffer = malloc(playbackBufferSize * sizeof(*playbackBuffer));
-
-	// Launch playback thread:
-	pthread_create(&playbackThreadId, NULL, playbackThread, NULL);
+	sampleRate = SAMPLE_RATE;
+	useMmap = false;
 }
 
+// Configure mmap access with explicit period / buffer sizes.
+// Returns an ALSA error code (< 0) if the device can't do it.
+static int openPcmLowLatency(unsigned int periodUs, unsigned int numPeriods)
+{
+	snd_pcm_hw_params_t *hwParams;
+	snd_pcm_sw_params_t *swParams;
+	snd_pcm_hw_params_alloca(&hwParams);
+	snd_pcm_sw_params_alloca(&swParams);
+
+	unsigned int rate = SAMPLE_RATE;
+	int dir = 0;
+	snd_pcm_uframes_t periodSize = (snd_pcm_uframes_t)SAMPLE_RATE * periodUs / 1000000;
+	unsigned int periods = numPeriods;
+
+	int err;
+	if ((err = snd_pcm_hw_params_any(handle, hwParams)) < 0 ||
+		(err = snd_pcm_hw_params_set_rate_resample(handle, hwParams, 1)) < 0 ||
+		(err = snd_pcm_hw_params_set_access(handle, hwParams, SND_PCM_ACCESS_MMAP_INTERLEAVED)) < 0 ||
+		(err = snd_pcm_hw_params_set_format(handle, hwParams, SND_PCM_FORMAT_S16_LE)) < 0 ||
+		(err = snd_pcm_hw_params_set_channels(handle, hwParams, NUM_CHANNELS)) < 0 ||
+		(err = snd_pcm_hw_params_set_rate_near(handle, hwParams, &rate, &dir)) < 0 ||
+		(err = snd_pcm_hw_params_set_period_size_near(handle, hwParams, &periodSize, &dir)) < 0 ||
+		(err = snd_pcm_hw_params_set_periods_near(handle, hwParams, &periods, &dir)) < 0 ||
+		(err = snd_pcm_hw_params(handle, hwParams)) < 0) {
+		return err;
+	}
 
-// Client code must call AudioMixer_freeWaveFileData to free dynamically allocated data.
-void AudioMixer_readWaveFileIntoMemory(char *fileName, wavedata_t *pSound)
+	// The device may have rounded any of these
+	snd_pcm_uframes_t bufferSize = 0;
+	snd_pcm_hw_params_get_period_size(hwParams, &periodSize, &dir);
+	snd_pcm_hw_params_get_buffer_size(hwParams, &bufferSize);
+
+	// Start once the whole ring is primed; wake up for every period
+	if ((err = snd_pcm_sw_params_current(handle, swParams)) < 0 ||
+		(err = snd_pcm_sw_params_set_start_threshold(handle, swParams, bufferSize)) < 0 ||
+		(err = snd_pcm_sw_params_set_avail_min(handle, swParams, periodSize)) < 0 ||
+		(err = snd_pcm_sw_params(handle, swParams)) < 0) {
+		return err;
+	}
+
+	printf("Audio: mmap output at %u Hz, %lu frame periods, %lu frame buffer (%.1f ms)\n",
+			rate, (unsigned long)periodSize, (unsigned long)bufferSize,
+			bufferSize * 1000.0 / rate);
+	playbackBufferSize = periodSize;
+	playbackBuffer = NULL;
+	sampleRate = rate;
+	useMmap = true;
+	return 0;
+}
+
+static void initCommon(void)
 {
-	assert(pSound);
+	AudioMixer_setVolume(DEFAULT_VOLUME);
+	masterGain = atomic_load(&masterGainTarget);
 
-	// The PCM data in a wave file starts after the header:
-	const int PCM_DATA_OFFSET = 44;
+	// Initialize the currently active sound-bites being played, and the
+	// command ring feeding them (before the playback thread exists).
+	for (int i = 0; i < MAX_SOUND_BITES; i++) {
+		soundBites[i].pSound = NULL;
+		soundBites[i].location = 0;
+	}
+	numSoundBites = 0;
+	for (size_t i = 0; i < COMMAND_RING_SIZE; i++) {
+		atomic_init(&commandRing[i].sequence, i);
+		commandRing[i].pSound = NULL;
+	}
+	atomic_init(&commandHead, 0);
+	commandTail = 0;
+	atomic_init(&droppedSounds, 0);
+	atomic_init(&xrunCount, 0);
+	atomic_store(&stopping, false);
+
+	sem_init(&wakeup, 0, 0);
+	atomic_init(&parked, false);
+	silentFrames = 0;
+	startTimeNs = getTimeInNs();
+	atomic_init(&idleTimeNs, 0);
+	atomic_init(&idleSinceNs, 0);
+	atomic_init(&idleCount, 0);
 
-	// Open the wave file
-	FILE *file = fopen(fileName, "rb");
-	if (file == NULL) {
-		fprintf(stderr, "ERROR: Unable to open file %s.\n", fileName);
+	// Open the PCM output
+	int err = snd_pcm_open(&handle, "default", SND_PCM_STREAM_PLAYBACK, 0);
+	if (err < 0) {
+		printf("Playback open error: %s\n", snd_strerror(err));
 		exit(EXIT_FAILURE);
 	}
+}
 
-	// Get file size
-	fseek(file, 0, SEEK_END);
-	int sizeInBytes = ftell(file) - PCM_DATA_OFFSET;
-	pSound->numSamples = sizeInBytes / SAMPLE_SIZE;
+static void startPlayback(void)
+{
+	// Launch playback thread (named for the thread topology):
+	pthread_create(&playbackThreadId, NULL, playbackThread, NULL);
+	pthread_setname_np(playbackThreadId, "audio_playback");
+}
 
-	// Search to the start of the data in the file
-	fseek(file, PCM_DATA_OFFSET, SEEK_SET);
+void AudioMixer_init(void)
+{
+	initCommon();
+	useFifo = false;
+	openPcmDefault();
+	startPlayback();
+}
 
-	// Allocate space to hold all PCM data
-	pSound->pData = malloc(sizeInBytes);
-	if (pSound->pData == 0) {
-		fprintf(stderr, "ERROR: Unable to allocate %d bytes for file %s.\n",
-				sizeInBytes, fileName);
-		exit(EXIT_FAILURE);
+void AudioMixer_initLowLatency(unsigned int periodUs, unsigned int numPeriods, bool fifo)
+{
+	assert(periodUs > 0 && numPeriods >= 2);
+	initCommon();
+	useFifo = fifo;
+	int err = openPcmLowLatency(periodUs, numPeriods);
+	if (err < 0) {
+		printf("Audio: mmap output unavailable (%s), using default buffering\n",
+				snd_strerror(err));
+		// hw_params may be half applied; start again from a fresh handle
+		snd_pcm_close(handle);
+		err = snd_pcm_open(&handle, "default", SND_PCM_STREAM_PLAYBACK, 0);
+		if (err < 0) {
+			printf("Playback open error: %s\n", snd_strerror(err));
+			exit(EXIT_FAILURE);
+		}
+		openPcmDefault();
 	}
+	startPlayback();
+}
 
-	// Read PCM data from wave file into memory
-	int samplesRead = fread(pSound->pData, SAMPLE_SIZE, pSound->numSamples, file);
-	if (samplesRead != pSound->numSamples) {
-		fprintf(stderr, "ERROR: Unable to read %d samples from file %s (read %d).\n",
-				pSound->numSamples, fileName, samplesRead);
-		exit(EXIT_FAILURE);
-	}
+
+// Client code must call AudioMixer_freeWaveFileData to free dynamically allocated data.
+int AudioMixer_readWaveFileIntoMemory(const char *fileName, wavedata_t *pSound)
+{
+	assert(pSound);
+	return WaveLoader_load(fileName, SAMPLE_RATE, &pSound->pData, &pSound->numSamples);
 }
 
 void AudioMixer_freeWaveFileData(wavedata_t *pSound)
@@ -149,52 +302,114 @@ void AudioMixer_freeWaveFileData(wavedata_t *pSound)
 }
 
 void AudioMixer_queueSound(wavedata_t *pSound)
+{
+	AudioMixer_queueSoundWithGain(pSound, AUDIOMIXER_MAX_VOLUME);
+}
+
+void AudioMixer_queueSoundWithGain(wavedata_t *pSound, int gainPercent)
 {
 	// Ensure we are only being asked to play "good" sounds:
 	assert(pSound->numSamples > 0);
 	assert(pSound->pData);
-
-	// Insert the sound by searching for an empty sound bite spot
-	/*
-	 * REVISIT: Implement this:
-	 * 1. Since this may be called by other threads, and there is a thread
-	 *    processing the soundBites[] array, we must ensure access is threadsafe.
-	 * 2. Search through the soundBites[] array looking for a free slot.
-	 * 3. If a free slot is found, place the new sound file into that slot.
-	 *    Note: You are only copying a pointer, not the entire data of the wave file!
-	 * 4. After searching through all slots, if no free slot is found then print
-	 *    an error message to the console (and likely just return vs asserting/exiting
-	 *    because the application most likely doesn't want to crash just for
-	 *    not being able to play another wave file.
-	 */
-
-	pthread_mutex_lock(&audioMutex);
-	
-	int foundSlot = 0;
-	// Insert the sound by searching for an empty sound bite slot
-	for (int i = 0; i < MAX_SOUND_BITES; i++) {
-		if (soundBites[i].pSound == NULL) {
-			soundBites[i].pSound = pSound;
-			soundBites[i].location = 0;
-			foundSlot = 1;
-			break;
+	assert(gainPercent >= 0 && gainPercent <= AUDIOMIXER_MAX_VOLUME);
+
+	// Claim the next ring position; another producer may win the race,
+	// in which case retry with the position it left behind.
+	size_t pos = atomic_load_explicit(&commandHead, memory_order_relaxed);
+	audioCommand_t *command;
+	for (;;) {
+		command = &commandRing[pos & (COMMAND_RING_SIZE - 1)];
+		size_t sequence = atomic_load_explicit(&command->sequence, memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&commandHead, &pos, pos + 1,
+					memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {
+			// Playback thread hasn't caught up with COMMAND_RING_SIZE sounds
+			atomic_fetch_add_explicit(&droppedSounds, 1, memory_order_relaxed);
+			printf("Error: Sound queue full! Sound lost\n");
+			return;
+		} else {
+			pos = atomic_load_explicit(&commandHead, memory_order_relaxed);
 		}
 	}
 
-	if (!foundSlot) {
-	printf("Error: No available slots for new sound! Sound lost");
-    }
- 
-	pthread_mutex_unlock(&audioMutex);
+	command->pSound = pSound;
+	command->gain = gainPercent * MIXKERNEL_UNITY_GAIN / AUDIOMIXER_MAX_VOLUME;
+	atomic_store_explicit(&command->sequence, pos + 1, memory_order_release);
+
+	// Pairs with the fence in waitWhileIdle(): either the playback thread
+	// sees this sound before parking, or we see it parked and wake it.
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&parked, memory_order_relaxed) &&
+			atomic_exchange(&parked, false)) {
+		sem_post(&wakeup);
+	}
+}
+
+// True if a producer has published a sound not yet taken. Playback thread only.
+static bool soundsQueued(void)
+{
+	audioCommand_t *command = &commandRing[commandTail & (COMMAND_RING_SIZE - 1)];
+	return atomic_load_explicit(&command->sequence, memory_order_acquire) == commandTail + 1;
+}
+
+// Move newly queued sounds from the command ring into the active list.
+// Playback thread only.
+static void takeQueuedSounds(void)
+{
+	for (;;) {
+		audioCommand_t *command = &commandRing[commandTail & (COMMAND_RING_SIZE - 1)];
+		size_t sequence = atomic_load_explicit(&command->sequence, memory_order_acquire);
+		if (sequence != commandTail + 1) {
+			return;
+		}
+		wavedata_t *pSound = command->pSound;
+		int gain = command->gain;
+		atomic_store_explicit(&command->sequence, commandTail + COMMAND_RING_SIZE,
+				memory_order_release);
+		commandTail++;
+
+		if (numSoundBites < MAX_SOUND_BITES) {
+			soundBites[numSoundBites].pSound = pSound;
+			soundBites[numSoundBites].location = 0;
+			soundBites[numSoundBites].gain = gain;
+			numSoundBites++;
+		} else {
+			atomic_fetch_add_explicit(&droppedSounds, 1, memory_order_relaxed);
+		}
+	}
 }
 
 void AudioMixer_cleanup(void)
 {
 	printf("Stopping audio...\n");
 
-	// Stop the PCM generation thread
-	stopping = true;
+	// Stop the PCM generation thread (waking it if idle)
+	atomic_store(&stopping, true);
+	if (atomic_exchange(&parked, false)) {
+		sem_post(&wakeup);
+	}
 	pthread_join(playbackThreadId, NULL);
+	sem_destroy(&wakeup);
+
+	unsigned long dropped = atomic_load(&droppedSounds);
+	if (dropped > 0) {
+		printf("Audio: %lu sounds were dropped (queue or voices full)\n", dropped);
+	}
+	printf("Audio: idle %.1f%% of the time (%lu idle periods)\n",
+			AudioMixer_getIdleFraction() * 100.0, atomic_load(&idleCount));
+
+	pthread_mutex_lock(&mixerMutex);
+	if (mixerHandle != NULL) {
+		snd_mixer_close(mixerHandle);
+	}
+	mixerHandle = NULL;
+	volumeElem = NULL;
+	mixerProbed = false;
+	pthread_mutex_unlock(&mixerMutex);
 
 	// Shutdown the PCM output, allowing any pending sound to play out (drain)
 	snd_pcm_drain(handle);
@@ -211,6 +426,23 @@ void AudioMixer_cleanup(void)
 }
 
 
+unsigned long AudioMixer_getXrunCount(void)
+{
+	return atomic_load_explicit(&xrunCount, memory_order_relaxed);
+}
+
+double AudioMixer_getIdleFraction(void)
+{
+	long long nowNs = getTimeInNs();
+	long long idleNs = atomic_load(&idleTimeNs);
+	long long sinceNs = atomic_load(&idleSinceNs);
+	if (sinceNs != 0) {
+		idleNs += nowNs - sinceNs;
+	}
+	long long totalNs = nowNs - startTimeNs;
+	return totalNs > 0 ? (double)idleNs / totalNs : 0.0;
+}
+
 int AudioMixer_getVolume()
 {
 	// Return the cached volume; good enough unless someone is changing
@@ -218,9 +450,64 @@ int AudioMixer_getVolume()
 	return volume;
 }
 
-// Function copied from:
+static snd_mixer_elem_t *findVolumeControl(const char *name)
+{
+	snd_mixer_selem_id_t *sid;
+	snd_mixer_selem_id_alloca(&sid);
+	snd_mixer_selem_id_set_index(sid, 0);
+	snd_mixer_selem_id_set_name(sid, name);
+	snd_mixer_elem_t *elem = snd_mixer_find_selem(mixerHandle, sid);
+	if (elem != NULL && !snd_mixer_selem_has_playback_volume(elem)) {
+		elem = NULL;
+	}
+	return elem;
+}
+
+// Open the mixer once and pick the volume element. Called with mixerMutex held.
+// Based on the function posted by StackOverflow user "trenki" at:
 // http://stackoverflow.com/questions/6787318/set-alsa-master-volume-from-c-code
-// Written by user "trenki".
+static void probeMixer(void)
+{
+	mixerProbed = true;
+	const char *card = "default";
+	if (snd_mixer_open(&mixerHandle, 0) < 0) {
+		mixerHandle = NULL;
+	} else if (snd_mixer_attach(mixerHandle, card) < 0 ||
+			snd_mixer_selem_register(mixerHandle, NULL, NULL) < 0 ||
+			snd_mixer_load(mixerHandle) < 0) {
+		snd_mixer_close(mixerHandle);
+		mixerHandle = NULL;
+	}
+
+	if (mixerHandle != NULL) {
+		const char *preferred = getenv("AUDIO_MIXER_CONTROL");
+		if (preferred != NULL) {
+			volumeElem = findVolumeControl(preferred);
+		}
+		int numControls = sizeof(volumeControls) / sizeof(volumeControls[0]);
+		for (int i = 0; volumeElem == NULL && i < numControls; i++) {
+			volumeElem = findVolumeControl(volumeControls[i]);
+		}
+		for (snd_mixer_elem_t *elem = snd_mixer_first_elem(mixerHandle);
+				volumeElem == NULL && elem != NULL; elem = snd_mixer_elem_next(elem)) {
+			if (snd_mixer_selem_has_playback_volume(elem)) {
+				volumeElem = elem;
+			}
+		}
+	}
+
+	if (volumeElem != NULL) {
+		snd_mixer_selem_get_playback_volume_range(volumeElem, &volumeMin, &volumeMax);
+		printf("Audio: volume control '%s'\n", snd_mixer_selem_get_name(volumeElem));
+	} else {
+		printf("Audio: no hardware volume control, using software gain\n");
+		if (mixerHandle != NULL) {
+			snd_mixer_close(mixerHandle);
+			mixerHandle = NULL;
+		}
+	}
+}
+
 void AudioMixer_setVolume(int newVolume)
 {
 	// Ensure volume is reasonable; If so, cache it for later getVolume() calls.
@@ -228,110 +515,251 @@ void AudioMixer_setVolume(int newVolume)
 		printf("ERROR: Volume must be between 0 and 100.\n");
 		return;
 	}
-	volume = newVolume;
-
-    long min, max;
-    snd_mixer_t *mixerHandle;
-    snd_mixer_selem_id_t *sid;
-    const char *card = "default";
-    const char *selem_name = "PCM";	// For ZEN cape
-    //const char *selem_name = "Speaker";	// For USB Audio
 
-    snd_mixer_open(&mixerHandle, 0);
-    snd_mixer_attach(mixerHandle, card);
-    snd_mixer_selem_register(mixerHandle, NULL, NULL);
-    snd_mixer_load(mixerHandle);
-
-    snd_mixer_selem_id_alloca(&sid);
-    snd_mixer_selem_id_set_index(sid, 0);
-    snd_mixer_selem_id_set_name(sid, selem_name);
-    snd_mixer_elem_t* elem = snd_mixer_find_selem(mixerHandle, sid);
+	pthread_mutex_lock(&mixerMutex);
+	volume = newVolume;
+	if (!mixerProbed) {
+		probeMixer();
+	}
+	if (volumeElem != NULL) {
+		// Pick up changes made by others (e.g. alsamixer) before writing
+		snd_mixer_handle_events(mixerHandle);
+		long value = volumeMin + (volumeMax - volumeMin) * volume / AUDIOMIXER_MAX_VOLUME;
+		snd_mixer_selem_set_playback_volume_all(volumeElem, value);
+		atomic_store(&masterGainTarget, MIXKERNEL_UNITY_GAIN);
+	} else {
+		atomic_store(&masterGainTarget,
+				volume * MIXKERNEL_UNITY_GAIN / AUDIOMIXER_MAX_VOLUME);
+	}
+	pthread_mutex_unlock(&mixerMutex);
+}
 
-    snd_mixer_selem_get_playback_volume_range(elem, &min, &max);
-    snd_mixer_selem_set_playback_volume_all(elem, volume * max / 100);
 
-    snd_mixer_close(mixerHandle);
+// Copy one voice's run into silence, applying its gain
+static void copyVoice(short *dst, const short *src, int count, int gain)
+{
+	if (gain >= MIXKERNEL_UNITY_GAIN) {
+		memcpy(dst, src, count * sizeof(short));
+	} else {
+		memset(dst, 0, count * sizeof(short));
+		MixKernel_accumulateGain(dst, src, count, gain, gain);
+	}
 }
 
+// Scale the mixed block by the master gain, moving it at most one full
+// ramp's worth (unity per MASTER_GAIN_RAMP_MS) towards the target.
+static void applyMasterGain(short *buff, int size)
+{
+	int target = atomic_load_explicit(&masterGainTarget, memory_order_relaxed);
+	int start = masterGain;
+	int end = target;
+	long long maxStep = (long long)MIXKERNEL_UNITY_GAIN * size * 1000 /
+			((long long)sampleRate * MASTER_GAIN_RAMP_MS);
+	if (end > start + maxStep) {
+		end = start + (int)maxStep;
+	} else if (end < start - maxStep) {
+		end = start - (int)maxStep;
+	}
+	MixKernel_scale(buff, size, start, end);
+	masterGain = end;
+}
 
 // Fill the buff array with new PCM values to output.
 //    buff: buffer to fill with new PCM data from sound bites.
 //    size: the number of *values* to store into buff
-static void fillPlaybackBuffer(short *buff, int size)
+// Returns how many leading values came from sounds (the rest is silence).
+static int fillPlaybackBuffer(short *buff, int size)
 {
-	/*
-	 * REVISIT: Implement this
-	 * 1. Wipe the buff to all 0's to clear any previous PCM data.
-	 *    Hint: use memset(); read the docs about its use of size.
-	 * 2. Since this is called from a background thread, and soundBites[] array
-	 *    may be used by any other thread, must synchronize this.
-	 * 3. Loop through each slot in soundBites[], which are sounds that are either
-	 *    waiting to be played, or partially already played:
-	 *    - If the sound bite slot is unused, do nothing for this slot.
-	 *    - Otherwise "add" this sound bite's data to the play-back buffer
-	 *      (other sound bites needing to be played back will also add to the same data).
-	 *      * Record that this portion of the sound bite has been played back by incrementing
-	 *        the location inside the data where play-back currently is.
-	 *      * If you have now played back the entire sample, free the slot in the
-	 *        soundBites[] array.
-	 *
-	 * Notes on "adding" PCM samples:
-	 * - PCM is stored as signed shorts (between SHRT_MIN and SHRT_MAX).
-	 * - When adding values, ensure there is not an overflow. Any values which would
-	 *   greater than SHRT_MAX should be clipped to SHRT_MAX; likewise for underflow.
-	 * - Don't overflow any arrays!
-	 * - Efficiency matters here! The compiler may do quite a bit for you, but it doesn't
-	 *   hurt to keep it in mind. Here are some tips for efficiency and readability:
-	 *   * If, for each pass of the loop which "adds" you need to change a value inside
-	 *     a struct inside an array, it may be faster to first load the value into a local
-	 *      variable, increment this variable as needed throughout the loop, and then write it
-	 *     back into the struct inside the array after. For example:
-	 *           int offset = myArray[someIdx].value;
-	 *           for (int i =...; i < ...; i++) {
-	 *               offset ++;
-	 *           }
-	 *           myArray[someIdx].value = offset;
-	 *   * If you need a value in a number of places, try loading it into a local variable
-	 *          int someNum = myArray[someIdx].value;
-	 *          if (someNum < X || someNum > Y || someNum != Z) {
-	 *              someNum = 42;
-	 *          }
-	 *          ... use someNum vs myArray[someIdx].value;
-	 *
-	 */
-
-	memset(buff, 0, size * sizeof(short));
-	memset(playbackBuffer, 0, playbackBufferSize * sizeof(*playbackBuffer));
-    
-	pthread_mutex_lock(&audioMutex);
-	for (int i = 0; i < MAX_SOUND_BITES; i++) {
-		if (soundBites[i].pSound != NULL) {
-			for (int j = 0; j < size; j++) {
-				if (soundBites[i].location < soundBites[i].pSound->numSamples) {
-					int mixedValue = buff[j] + soundBites[i].pSound->pData[soundBites[i].location];
-					if (mixedValue > SHRT_MAX) mixedValue = SHRT_MAX;
-					if (mixedValue < SHRT_MIN) mixedValue = SHRT_MIN;
-					buff[j] = (short)mixedValue;
-					soundBites[i].location++;
-				}else {
-					soundBites[i].pSound = NULL;
-					break;
-				}
-			}
+	takeQueuedSounds();
+
+	// No lock: soundBites[] belongs to this thread.
+	// Each voice contributes one contiguous run (the rest of the period, or
+	// what is left of its sound), so the kernel never checks bounds per
+	// sample. The first run is copied; the rest are saturating-added, each
+	// scaled by its voice gain, then the master gain is applied.
+	int filled = 0;
+	for (int i = 0; i < numSoundBites; ) {
+		const wavedata_t *pSound = soundBites[i].pSound;
+		int location = soundBites[i].location;
+		int run = pSound->numSamples - location;
+		if (run > size) {
+			run = size;
 		}
+
+		const short *src = pSound->pData + location;
+		int gain = soundBites[i].gain;
+		if (run > filled) {
+			// Samples past 'filled' are still silence
+			copyVoice(buff + filled, src + filled, run - filled, gain);
+			MixKernel_accumulateGain(buff, src, filled, gain, gain);
+			filled = run;
+		} else {
+			MixKernel_accumulateGain(buff, src, run, gain, gain);
+		}
+		location += run;
+
+		if (location >= pSound->numSamples) {
+			// Finished: move the last voice into this slot
+			numSoundBites--;
+			soundBites[i] = soundBites[numSoundBites];
+			soundBites[numSoundBites].pSound = NULL;
+		} else {
+			soundBites[i].location = location;
+			i++;
+		}
+	}
+	memset(buff + filled, 0, (size - filled) * sizeof(short));
+	if (filled > 0) {
+		applyMasterGain(buff, filled);
+	} else {
+		// Nothing audible to ramp; jump straight to the target
+		masterGain = atomic_load_explicit(&masterGainTarget, memory_order_relaxed);
+	}
+	return filled;
+}
+
+// Count consecutive silent frames after a block has been queued.
+static void noteBlockPlayed(int filled, int size)
+{
+	if (filled > 0 || numSoundBites > 0) {
+		silentFrames = 0;
+	} else {
+		silentFrames += size;
 	}
-	pthread_mutex_unlock(&audioMutex);
 }
 
+// Nothing has played for IDLE_AFTER_MS: let the device play out what it
+// has (all silence by now), stop it, and sleep until a sound is queued
+// or cleanup() is called. The PCM is re-prepared on the way out, so the
+// next block starts it again from a clean state.
+static void waitWhileIdle(void)
+{
+	snd_pcm_drain(handle);
+
+	long long startNs = getTimeInNs();
+	atomic_store(&idleSinceNs, startNs);
+	atomic_store(&parked, true);
+	atomic_thread_fence(memory_order_seq_cst);
+	if (!soundsQueued() && !atomic_load(&stopping)) {
+		// Whoever clears 'parked' posts the semaphore
+		while (sem_wait(&wakeup) != 0 && errno == EINTR) {
+		}
+	} else if (!atomic_exchange(&parked, false)) {
+		// A producer cleared it first; consume its post
+		while (sem_wait(&wakeup) != 0 && errno == EINTR) {
+		}
+	}
+	atomic_fetch_add(&idleTimeNs, getTimeInNs() - startNs);
+	atomic_store(&idleSinceNs, 0);
+	atomic_fetch_add(&idleCount, 1);
+
+	silentFrames = 0;
+	if (!atomic_load(&stopping)) {
+		snd_pcm_prepare(handle);
+	}
+}
+
+
+// Record how far ahead of the DAC we are after queueing a block
+static void markOutputLatency(void)
+{
+	snd_pcm_sframes_t delay = 0;
+	if (snd_pcm_delay(handle, &delay) == 0) {
+		Period_markEventWithValue(PERIOD_EVENT_AUDIO_LATENCY, delay * 1000.0 / sampleRate);
+	}
+}
+
+// Recover from an ALSA error, counting under-runs. Exits if it can't.
+static void recoverPcm(int err, const char *what)
+{
+	if (err == -EPIPE) {
+		Period_markEvent(PERIOD_EVENT_AUDIO_XRUN);
+		atomic_fetch_add_explicit(&xrunCount, 1, memory_order_relaxed);
+	} else {
+		fprintf(stderr, "AudioMixer: %s returned %i\n", what, err);
+	}
+	err = snd_pcm_recover(handle, err, 1);
+	if (err < 0) {
+		fprintf(stderr, "ERROR: Failed recovering audio after %s: %s\n",
+				what, snd_strerror(err));
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void raisePriority(void)
+{
+	struct sched_param param;
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = sched_get_priority_min(SCHED_FIFO) + 10;
+	int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if (err != 0) {
+		printf("Audio: unable to use SCHED_FIFO (%s), keeping normal priority\n",
+				strerror(err));
+	}
+}
+
+// Mix one period straight into the mmap'd ring buffer.
+static void playbackMmapPeriod(void)
+{
+	snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+	if (avail < 0) {
+		recoverPcm(avail, "avail_update()");
+		return;
+	}
+	if (avail < (snd_pcm_sframes_t)playbackBufferSize) {
+		// Wait for the DAC to free a period (the stream starts itself
+		// once the ring has been primed, see start_threshold)
+		int err = snd_pcm_wait(handle, 100);
+		if (err < 0) {
+			recoverPcm(err, "wait()");
+		}
+		return;
+	}
+
+	const snd_pcm_channel_area_t *areas;
+	snd_pcm_uframes_t offset;
+	snd_pcm_uframes_t frames = playbackBufferSize;
+	int err = snd_pcm_mmap_begin(handle, &areas, &offset, &frames);
+	if (err < 0) {
+		recoverPcm(err, "mmap_begin()");
+		return;
+	}
+
+	// Interleaved mono S16: the area is a plain array of shorts
+	short *dst = (short *)((char *)areas[0].addr + areas[0].first / 8 +
+			offset * (areas[0].step / 8));
+	Period_markEvent(PERIOD_EVENT_AUDIO_BUFFER_FILL);
+	int filled = fillPlaybackBuffer(dst, frames);
+
+	snd_pcm_sframes_t committed = snd_pcm_mmap_commit(handle, offset, frames);
+	if (committed < 0 || (snd_pcm_uframes_t)committed != frames) {
+		recoverPcm(committed < 0 ? committed : -EPIPE, "mmap_commit()");
+		return;
+	}
+	markOutputLatency();
+	noteBlockPlayed(filled, frames);
+}
 
 void* playbackThread(void* _arg)
 {
 	(void)_arg;
-	while (!stopping) {
+	if (useFifo) {
+		raisePriority();
+	}
+	const int idleAfterFrames = sampleRate * IDLE_AFTER_MS / 1000;
+	while (!atomic_load_explicit(&stopping, memory_order_relaxed)) {
+		if (silentFrames >= idleAfterFrames) {
+			waitWhileIdle();
+			continue;
+		}
+		if (useMmap) {
+			playbackMmapPeriod();
+			continue;
+		}
 
 		Period_markEvent(PERIOD_EVENT_AUDIO_BUFFER_FILL);
 		// Generate next block of audio
-		fillPlaybackBuffer(playbackBuffer, playbackBufferSize);
+		int filled = fillPlaybackBuffer(playbackBuffer, playbackBufferSize);
 
 		// Output the audio
 		snd_pcm_sframes_t frames = snd_pcm_writei(handle,
@@ -339,6 +767,10 @@ void* playbackThread(void* _arg)
 
 		// Check for (and handle) possible error conditions on output
 		if (frames < 0) {
+			if (frames == -EPIPE) {
+				Period_markEvent(PERIOD_EVENT_AUDIO_XRUN);
+				atomic_fetch_add_explicit(&xrunCount, 1, memory_order_relaxed);
+			}
 			fprintf(stderr, "AudioMixer: writei() returned %li\n", frames);
 			frames = snd_pcm_recover(handle, frames, 1);
 		}
@@ -351,6 +783,8 @@ void* playbackThread(void* _arg)
 			printf("Short write (expected %li, wrote %li)\n",
 					playbackBufferSize, frames);
 		}
+		markOutputLatency();
+		noteBlockPlayed(filled, playbackBufferSize);
 	}
 
 	return NULL;
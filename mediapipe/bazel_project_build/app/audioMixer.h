@@ -3,6 +3,8 @@
 #ifndef AUDIO_MIXER_H
 #define AUDIO_MIXER_H
 
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -15,22 +17,55 @@ typedef struct {
 
 #define AUDIOMIXER_MAX_VOLUME 100
 
+// Rate the mixer runs at; sounds must be mono S16 at this rate.
+#define AUDIOMIXER_SAMPLE_RATE 44100
+
 // init() must be called before any other functions,
 // cleanup() must be called last to stop playback threads and free memory.
 void AudioMixer_init(void);
 void AudioMixer_cleanup(void);
 
-// Read the contents of a wave file into the pSound structure. Note that
+// Alternative to init() for low latency output: the device is opened with
+// mmap access and numPeriods periods of periodUs each (e.g. 2 x 5000us),
+// and the playback thread mixes straight into the hardware ring buffer.
+// With useFifo the playback thread asks for SCHED_FIFO (needs
+// CAP_SYS_NICE; it keeps running at normal priority otherwise).
+// Falls back to the init() configuration if the device refuses mmap.
+// Under-runs and output latency are recorded with Period_markEvent()
+// (PERIOD_EVENT_AUDIO_XRUN / PERIOD_EVENT_AUDIO_LATENCY), so
+// Period_init() must have been called first.
+void AudioMixer_initLowLatency(unsigned int periodUs, unsigned int numPeriods, bool useFifo);
+
+// Read the contents of a wave file into the pSound structure, converting it
+// to mono at AUDIOMIXER_SAMPLE_RATE (see waveLoader.h). Note that
 // the pData pointer in this structure will be dynamically allocated in
 // readWaveFileIntoMemory(), and is freed by calling freeWaveFileData().
-void AudioMixer_readWaveFileIntoMemory(char *fileName, wavedata_t *pSound);
+// Returns 0, or -1 (with pSound left empty) if the file can't be used.
+int AudioMixer_readWaveFileIntoMemory(const char *fileName, wavedata_t *pSound);
 void AudioMixer_freeWaveFileData(wavedata_t *pSound);
 
 // Queue up another sound bite to play as soon as possible.
+// queueSoundWithGain() plays it at gainPercent (0..100) of its recorded
+// level; queueSound() plays it as recorded.
+// Safe from any thread and never blocks: the sound is handed to the playback
+// thread through a lock-free queue, and dropped if that queue is full.
+// If the mixer had gone idle, this wakes it and restarts the PCM.
 void AudioMixer_queueSound(wavedata_t *pSound);
+void AudioMixer_queueSoundWithGain(wavedata_t *pSound, int gainPercent);
+
+// Fraction (0..1) of the time since init() that the playback thread has
+// spent parked with the PCM stopped because nothing was playing.
+double AudioMixer_getIdleFraction(void);
+
+// Total ALSA under-runs since init(), for monitoring. (The Period events
+// above give the same information, but get cleared by whoever reads them.)
+unsigned long AudioMixer_getXrunCount(void);
 
 // Get/set the volume.
-// setVolume() function posted by StackOverflow user "trenki" at:
+// Uses the card's volume control through a mixer handle kept open between
+// calls, so changes are cheap. Cards with no volume control get a software
+// master gain that ramps to the new level instead of jumping (no clicks).
+// setVolume() is based on code posted by StackOverflow user "trenki" at:
 // http://stackoverflow.com/questions/6787318/set-alsa-master-volume-from-c-code
 int  AudioMixer_getVolume();
 void AudioMixer_setVolume(int newVolume);
@@ -0,0 +1,103 @@
+// Render + transfer cost of each DisplayManager screen, measured on the
+// virtual ST7789 backend so it runs on any host.
+// Usage: lcd_screen_bench [spi_hz] [png_dir]
+//
+// The screens are the line sets DisplayManager passes to lcd_place_message;
+// they are replayed through the real lcd_display render thread and LCD driver.
+#include "../lcd_display.h"
+#include "../../lcd/lib/Config/DEV_Virtual.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define ITERATIONS 50
+
+typedef struct {
+    const char* name;
+    int length;
+    char* lines[3];
+} screen;
+
+static screen s_screens[] = {
+    {"card_and_game", 3, {"=ROUND 3=", "ATK:2 DEF:1 BLD:3", "TIME: 27 sec"}},
+    {"card_paused",   3, {"=ROUND 3=", "ATK:2 DEF:1 BLD:3", "TIME: 27 sec (PAUSED)"}},
+    {"round_start",   2, {"ROUND 4 STARTED", "Time: 30 sec"}},
+    {"round_end",     2, {"ROUND 4 COMPLETE", "Move accepted!"}},
+    {"game_starting", 2, {"Game starting", "Get ready..."}},
+    {"game_started",  2, {"Game Started!", "Waiting for cards..."}},
+    {"game_ended",    2, {"You Won!", "Game Over"}},
+    {"no_rooms",      2, {"No rooms available", "Create a new room"}},
+    {"room_list",     2, {"Available Rooms: 3", "Check console for list"}},
+    {"auto_play",     2, {"AUTO-PLAY", "Card: attack"}},
+    {"waiting",       2, {"Waiting for response", "Request: play_card"}},
+    {"connected",     2, {"Connected to room:", "Room 1 (2/4)"}},
+    {"error",         2, {"ERROR", "Connection lost"}},
+    {"next_round",    2, {"Round 4 complete", "Waiting for others"}},
+    {"gesture",       2, {"Gesture confirmed", "attack"}},
+};
+
+static void wait_for_frame(unsigned long frames)
+{
+    lcd_render_stats stats;
+    struct timespec pause = {0, 20000};
+    do {
+        nanosleep(&pause, NULL);
+        lcd_get_render_stats(&stats);
+    } while (stats.frames_rendered < frames);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1) {
+        DEV_Virtual_SetSpiClock((uint32_t)strtoul(argv[1], NULL, 10));
+    }
+    const char* pngDir = argc > 2 ? argv[2] : NULL;
+
+    DEV_SetBackend(&DEV_Virtual_Backend);
+    lcd_init();
+
+    DEV_VIRTUAL_STATS panel;
+    DEV_Virtual_GetStats(&panel);
+    printf("virtual ST7789 at %.1f MHz, %d iterations per screen\n", panel.spi_hz / 1e6, ITERATIONS);
+    printf("%-14s %10s %10s %10s %10s %9s %8s\n",
+           "screen", "render ms", "flush ms", "spi ms", "frame ms", "bytes", "bursts");
+
+    unsigned long frames = 0;
+    lcd_render_stats stats;
+    lcd_get_render_stats(&stats);
+    frames = stats.frames_rendered;
+
+    int count = sizeof(s_screens) / sizeof(s_screens[0]);
+    for (int i = 0; i < count; i++) {
+        screen* current = &s_screens[i];
+        double renderMs = 0;
+        double flushMs = 0;
+        DEV_Virtual_ResetStats();
+
+        for (int n = 0; n < ITERATIONS; n++) {
+            lcd_place_message(current->lines, current->length, lcd_center);
+            wait_for_frame(++frames);
+            lcd_get_render_stats(&stats);
+            renderMs += stats.last_render_ms;
+            flushMs += stats.last_flush_ms;
+        }
+
+        DEV_Virtual_GetStats(&panel);
+        double spiMs = panel.simulated_spi_ns / 1e6 / ITERATIONS;
+        printf("%-14s %10.3f %10.3f %10.3f %10.3f %9llu %8llu\n", current->name,
+               renderMs / ITERATIONS, flushMs / ITERATIONS, spiMs,
+               renderMs / ITERATIONS + spiMs,
+               (unsigned long long)(panel.bytes / ITERATIONS),
+               (unsigned long long)(panel.bursts / ITERATIONS));
+
+        if (pngDir != NULL) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/%s.png", pngDir, current->name);
+            DEV_Virtual_SavePNG(path);
+        }
+    }
+
+    lcd_cleanup();
+    return 0;
+}
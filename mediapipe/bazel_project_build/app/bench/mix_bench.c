@@ -0,0 +1,127 @@
+// Mixer benchmark: per-sample voice loop vs run-length mixing with MixKernel.
+// For 1-32 simultaneous voices, mixes the same voices both ways period after
+// period (voices of different lengths, so some finish mid-period) and checks
+// the output matches sample for sample.
+#include "../mixKernel.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PERIOD_SAMPLES 441      // 10 ms at 44.1 kHz
+#define PERIODS 2000
+#define MAX_VOICES 32
+
+typedef struct {
+    const short *pData;
+    int numSamples;
+    int location;
+} voice;
+
+static long long getTimeInNs(void)
+{
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (long long)spec.tv_sec * 1000000000LL + spec.tv_nsec;
+}
+
+// The loop fillPlaybackBuffer used before: bounds check and clamp per sample
+static void mix_per_sample(short *buff, int size, voice *voices, int count)
+{
+    memset(buff, 0, size * sizeof(short));
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < size; j++) {
+            if (voices[i].location < voices[i].numSamples) {
+                int mixedValue = buff[j] + voices[i].pData[voices[i].location];
+                if (mixedValue > SHRT_MAX) mixedValue = SHRT_MAX;
+                if (mixedValue < SHRT_MIN) mixedValue = SHRT_MIN;
+                buff[j] = (short)mixedValue;
+                voices[i].location++;
+            } else {
+                break;
+            }
+        }
+    }
+}
+
+// Same shape as fillPlaybackBuffer now: one contiguous run per voice
+static void mix_runs(short *buff, int size, voice *voices, int count)
+{
+    int filled = 0;
+    for (int i = 0; i < count; i++) {
+        int run = voices[i].numSamples - voices[i].location;
+        if (run > size) {
+            run = size;
+        }
+        if (run <= 0) {
+            continue;
+        }
+        const short *src = voices[i].pData + voices[i].location;
+        if (run > filled) {
+            memcpy(buff + filled, src + filled, (run - filled) * sizeof(short));
+            MixKernel_accumulate(buff, src, filled);
+            filled = run;
+        } else {
+            MixKernel_accumulate(buff, src, run);
+        }
+        voices[i].location += run;
+    }
+    memset(buff + filled, 0, (size - filled) * sizeof(short));
+}
+
+static void restart(voice *voices, int count, int period)
+{
+    // Restart finished voices at staggered times so runs end mid-period
+    for (int i = 0; i < count; i++) {
+        if (voices[i].location >= voices[i].numSamples && (period + i) % 3 == 0) {
+            voices[i].location = 0;
+        }
+    }
+}
+
+int main(void)
+{
+    static short samples[MAX_VOICES][44100];
+    srand(433);
+    for (int v = 0; v < MAX_VOICES; v++) {
+        for (int i = 0; i < 44100; i++) {
+            samples[v][i] = (short)((rand() % 40000) - 20000);   // loud enough to saturate
+        }
+    }
+
+    int failures = 0;
+    printf("%6s %14s %14s %9s\n", "voices", "per-sample us", "runs us", "speedup");
+    for (int count = 1; count <= MAX_VOICES; count *= 2) {
+        voice a[MAX_VOICES], b[MAX_VOICES];
+        for (int v = 0; v < count; v++) {
+            a[v].pData = samples[v];
+            a[v].numSamples = 4000 + 3331 * v % 40000;
+            a[v].location = 0;
+        }
+        memcpy(b, a, sizeof(a));
+
+        short outA[PERIOD_SAMPLES], outB[PERIOD_SAMPLES];
+        long long oldNs = 0, newNs = 0;
+        int same = 1;
+        for (int p = 0; p < PERIODS; p++) {
+            long long t0 = getTimeInNs();
+            mix_per_sample(outA, PERIOD_SAMPLES, a, count);
+            long long t1 = getTimeInNs();
+            mix_runs(outB, PERIOD_SAMPLES, b, count);
+            long long t2 = getTimeInNs();
+            oldNs += t1 - t0;
+            newNs += t2 - t1;
+            if (memcmp(outA, outB, sizeof(outA)) != 0) {
+                same = 0;
+            }
+            restart(a, count, p);
+            restart(b, count, p);
+        }
+        printf("%6d %14.2f %14.2f %8.1fx %s\n", count, oldNs / 1000.0 / PERIODS,
+               newNs / 1000.0 / PERIODS, (double)oldNs / newNs, same ? "" : "MISMATCH");
+        failures += !same;
+    }
+    return failures;
+}
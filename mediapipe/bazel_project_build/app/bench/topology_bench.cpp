@@ -0,0 +1,221 @@
+// Thread topology benchmark: for each topology, restarts the hand graph with
+// its pool sizes, applies it, then runs frames through the graph for a while
+// with the mixer playing continuously, as during a round. Reports frame
+// latency (hand_analyze_image() only, not the capture) and the audio
+// under-runs and output latency over the same time.
+// Run it from the directory gesture_game runs in (it loads the same graph
+// and models); SCHED_FIFO and negative nice need root or CAP_SYS_NICE.
+//
+// Usage: topology_bench [--camera] [--seconds N] [topology ...]
+// Topologies are preset names or files (see threadTopology.h); the default
+// is every preset but "none". Without --camera the frames are noise, so only
+// palm detection runs; with it, hold a hand up to include the landmark model.
+#include "../hand_recognition.hpp"
+#include "../audioMixer.h"
+#include "../periodTimer.h"
+#include "../threadTopology.h"
+#include "../../hal/camera_hal.h"
+
+#include <pthread.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define WARM_UP_FRAMES 5
+#define TONE_MS 1000
+// Queued every half tone, so two voices overlap and the mixer never idles
+#define TONE_INTERVAL_MS 500
+#define NUM_NOISE_FRAMES 8
+
+struct Result {
+    int frames = 0;
+    double seconds = 0;
+    double p50Ms = 0;
+    double p99Ms = 0;
+    double maxMs = 0;
+    unsigned long xruns = 0;
+    double audioLatencyP99Ms = 0;
+};
+
+static std::atomic<bool> s_tonePlaying(false);
+
+static void playTone(wavedata_t* pTone) {
+    pthread_setname_np(pthread_self(), "bench_tone");
+    while (s_tonePlaying.load()) {
+        AudioMixer_queueSoundWithGain(pTone, 20);
+        std::this_thread::sleep_for(std::chrono::milliseconds(TONE_INTERVAL_MS));
+    }
+}
+
+static double percentile(std::vector<double>& samples, double fraction) {
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t index = (size_t)(fraction * (samples.size() - 1) + 0.5);
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+// Runs on a thread named like the camera thread, so the camera role places it
+static void runFrames(CameraHAL* pCamera, int seconds, Result* pResult) {
+    pthread_setname_np(pthread_self(), "gesture_cam");
+    Topology_applySelf();
+
+    std::vector<cv::Mat> noise(NUM_NOISE_FRAMES);
+    cv::RNG rng(1);
+    for (cv::Mat& frame : noise) {
+        frame.create(480, 640, CV_8UC3);
+        rng.fill(frame, cv::RNG::UNIFORM, 0, 256);
+    }
+
+    std::vector<double> latencies;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::seconds(seconds);
+    cv::Mat frame;
+    for (int i = 0; std::chrono::steady_clock::now() < end; i++) {
+        if (pCamera != nullptr) {
+            if (!pCamera->captureFrame(frame)) {
+                continue;
+            }
+        } else {
+            frame = noise[i % NUM_NOISE_FRAMES];
+        }
+        handPosition handPos;
+        auto frameStart = std::chrono::steady_clock::now();
+        absl::Status status = hand_analyze_image(frame, &handPos);
+        double frameMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - frameStart).count();
+        if (!status.ok()) {
+            fprintf(stderr, "Frame failed: %s\n", std::string(status.message()).c_str());
+            break;
+        }
+        latencies.push_back(frameMs);
+    }
+
+    pResult->frames = (int)latencies.size();
+    pResult->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!latencies.empty()) {
+        pResult->maxMs = *std::max_element(latencies.begin(), latencies.end());
+        pResult->p50Ms = percentile(latencies, 0.50);
+        pResult->p99Ms = percentile(latencies, 0.99);
+    }
+}
+
+static bool runTopology(const char* name, CameraHAL* pCamera, int seconds, Result* pResult) {
+    // Start from the baseline, so nothing carries over from the last run
+    // in roles this topology leaves alone
+    Topology_t topology;
+    Topology_load("baseline", &topology);
+    Topology_set(&topology);
+    Topology_apply();
+    if (Topology_load(name, &topology) != 0) {
+        return false;
+    }
+    Topology_set(&topology);
+
+    // Restart the graph so it starts its pools at this topology's sizes
+    // (it applies the topology to them once running)
+    hand_close_session();
+    HandWarmUpStats warmUp;
+    absl::Status status = hand_warm_up(WARM_UP_FRAMES, &warmUp);
+    if (!status.ok()) {
+        fprintf(stderr, "Hand graph failed to start: %s\n", std::string(status.message()).c_str());
+        return false;
+    }
+    Topology_apply();
+
+    Period_snapshot_t latency;
+    Period_snapshotAndClear(PERIOD_EVENT_AUDIO_LATENCY, &latency);
+    unsigned long xrunsBefore = AudioMixer_getXrunCount();
+
+    std::thread frameThread(runFrames, pCamera, seconds, pResult);
+    frameThread.join();
+
+    pResult->xruns = AudioMixer_getXrunCount() - xrunsBefore;
+    Period_snapshotAndClear(PERIOD_EVENT_AUDIO_LATENCY, &latency);
+    pResult->audioLatencyP99Ms = latency.value.p99;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int seconds = 10;
+    bool useCamera = false;
+    std::vector<std::string> topologies;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--camera") == 0) {
+            useCamera = true;
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atoi(argv[++i]);
+        } else {
+            topologies.push_back(argv[i]);
+        }
+    }
+    if (seconds <= 0) {
+        fprintf(stderr, "Usage: %s [--camera] [--seconds N] [topology ...]\n", argv[0]);
+        return 1;
+    }
+    if (topologies.empty()) {
+        for (int i = 0; Topology_presetNames[i] != nullptr; i++) {
+            if (strcmp(Topology_presetNames[i], "none") != 0) {
+                topologies.push_back(Topology_presetNames[i]);
+            }
+        }
+    }
+
+    Period_init();
+    // As gesture_game sets it up
+    AudioMixer_initLowLatency(5000, 2, true);
+
+    CameraHAL camera;
+    if (useCamera && !camera.openCamera()) {
+        fprintf(stderr, "Unable to open the camera\n");
+        AudioMixer_cleanup();
+        Period_cleanup();
+        return 1;
+    }
+
+    // A quiet 440 Hz tone, queued over and over
+    wavedata_t tone;
+    tone.numSamples = AUDIOMIXER_SAMPLE_RATE * TONE_MS / 1000;
+    tone.pData = (short*)malloc(tone.numSamples * sizeof(short));
+    for (int i = 0; i < tone.numSamples; i++) {
+        tone.pData[i] = (short)(8000 * sin(2 * M_PI * 440 * i / AUDIOMIXER_SAMPLE_RATE));
+    }
+    s_tonePlaying.store(true);
+    std::thread toneThread(playTone, &tone);
+
+    printf("%d s per topology, %s frames\n", seconds, useCamera ? "camera" : "noise");
+    printf("%-16s %7s %7s %9s %9s %9s %6s %12s\n",
+           "topology", "frames", "fps", "p50 ms", "p99 ms", "max ms", "xruns", "audio p99 ms");
+    int failed = 0;
+    for (const std::string& name : topologies) {
+        Result result;
+        if (!runTopology(name.c_str(), useCamera ? &camera : nullptr, seconds, &result)) {
+            printf("%-16s failed\n", name.c_str());
+            failed++;
+            continue;
+        }
+        printf("%-16s %7d %7.1f %9.1f %9.1f %9.1f %6lu %12.1f\n", name.c_str(),
+               result.frames, result.frames / result.seconds, result.p50Ms,
+               result.p99Ms, result.maxMs, result.xruns, result.audioLatencyP99Ms);
+    }
+
+    s_tonePlaying.store(false);
+    toneThread.join();
+    hand_close_session();
+    if (useCamera) {
+        camera.closeCamera();
+    }
+    // Stop the mixer before freeing the tone it may still be playing
+    AudioMixer_cleanup();
+    free(tone.pData);
+    Period_cleanup();
+    return failed == 0 ? 0 : 1;
+}
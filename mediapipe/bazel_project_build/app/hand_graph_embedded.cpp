@@ -0,0 +1,67 @@
+#include "hand_graph_embedded.hpp"
+
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+
+// The files are compiled in as string literals (data_as_c_string); the
+// compiler adds a terminating NUL, which isn't part of the data. Models are
+// aligned so TFLite and XNNPACK can use them where they are.
+alignas(64) static const char kHandGraph[] =
+#include "bazel_project_build/app/hand_tracking_custom.binarypb.inc"
+    ;
+alignas(64) static const char kPalmDetectionModel[] =
+#include "bazel_project_build/app/palm_detection_full.tflite.inc"
+    ;
+alignas(64) static const char kHandLandmarkModel[] =
+#include "bazel_project_build/app/hand_landmark_full.tflite.inc"
+    ;
+
+struct EmbeddedFile {
+    const char* resource_id;
+    const char* data;
+    size_t size;
+};
+
+// Resource ids are the model paths used by the model loader subgraphs
+// (model_complexity 1, the default)
+static const EmbeddedFile kEmbeddedModels[] = {
+    {"mediapipe/modules/palm_detection/palm_detection_full.tflite",
+     kPalmDetectionModel, sizeof(kPalmDetectionModel) - 1},
+    {"mediapipe/modules/hand_landmark/hand_landmark_full.tflite",
+     kHandLandmarkModel, sizeof(kHandLandmarkModel) - 1},
+};
+
+class EmbeddedResources : public mediapipe::Resources {
+public:
+    explicit EmbeddedResources(std::unique_ptr<mediapipe::Resources> fallback)
+        : fallback(std::move(fallback)) {}
+
+    absl::StatusOr<std::unique_ptr<mediapipe::Resource>> Get(
+            absl::string_view resource_id, const Options& options) const override {
+        for (const EmbeddedFile& file : kEmbeddedModels) {
+            if (resource_id == file.resource_id) {
+                // The data lives as long as the program, so nothing to free
+                return mediapipe::MakeNoCleanupResource(file.data, file.size);
+            }
+        }
+        return fallback->Get(resource_id, options);
+    }
+
+private:
+    std::unique_ptr<mediapipe::Resources> fallback;
+};
+
+absl::Status hand_embedded_graph_config(mediapipe::CalculatorGraphConfig* config) {
+    if (!config->ParseFromArray(kHandGraph, sizeof(kHandGraph) - 1)) {
+        return absl::InternalError("Embedded hand graph config is corrupt");
+    }
+    return absl::OkStatus();
+}
+
+std::shared_ptr<mediapipe::Resources> hand_embedded_resources() {
+    static std::shared_ptr<mediapipe::Resources> resources =
+        std::make_shared<EmbeddedResources>(mediapipe::CreateDefaultResources());
+    return resources;
+}
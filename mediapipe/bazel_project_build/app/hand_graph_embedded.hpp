@@ -0,0 +1,19 @@
+#pragma once
+
+#include <memory>
+#include "absl/status/status.h"
+#include "mediapipe/framework/calculator.pb.h"
+#include "mediapipe/framework/resources.h"
+
+// The hand graph and its models compiled into the binary (build with
+// --define EMBED_HAND_GRAPH=1), so gesture_game runs from any directory
+// without reading or parsing files at start-up.
+
+// The hand graph as a binary CalculatorGraphConfig, subgraphs already
+// expanded
+absl::Status hand_embedded_graph_config(mediapipe::CalculatorGraphConfig* config);
+
+// Serves the embedded models in place, by the model paths the graph asks
+// for; anything else is loaded from disk as usual. Give it to the graph as
+// kResourcesService before Initialize().
+std::shared_ptr<mediapipe::Resources> hand_embedded_resources();
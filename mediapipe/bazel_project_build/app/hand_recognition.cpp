@@ -1,27 +1,68 @@
 #include <cstdlib>
 #include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 
+#include "mediapipe/calculators/tensor/inference_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_profile.pb.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/landmark.pb.h"
+#include "mediapipe/framework/formats/rect.pb.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/resources_service.h"
+#include "mediapipe/framework/thread_pool_executor.pb.h"
 #include "mediapipe/framework/port/file_helpers.h"
 #include "mediapipe/framework/port/opencv_highgui_inc.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
 #include "mediapipe/framework/port/opencv_video_inc.h"
 #include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/profiler/graph_tracer.h"
+#include "mediapipe/framework/tool/name_util.h"
+#include "mediapipe/framework/tool/subgraph_expansion.h"
 #include "mediapipe/util/resource_util.h"
+#include "absl/time/clock.h"
 #include "hand_recognition.hpp"
+#include "assetCache.h"
+#include "logger.h"
+#include "metrics.h"
+#include "threadTopology.h"
+#include "trace.h"
+#ifdef HAND_GRAPH_EMBEDDED
+#include "hand_graph_embedded.hpp"
+#endif
 
 
 constexpr char kInputStream[] = "input_video";
 constexpr char kOutputStream[] = "landmarks";
+// Hand regions fed to the tracker by warmUp() only
+constexpr char kWarmUpRectsStream[] = "warm_up_hand_rects";
 constexpr char kWindowName[] = "MediaPipe";
 
 // Define constants for configuration
 static const char* const kCalculatorGraphConfigFile = "hand_tracking_custom.pbtxt";
+static const char* const kDefaultWeightCacheDir = "xnnpack_cache";
+// Scheduler threads are named "<prefix>/<tid>"; the thread topology's graph
+// role finds them by it
+static const char* const kGraphThreadPrefix = "mp_graph";
+// Models the model loader subgraphs read (model_complexity 1, the default),
+// relative to the working directory
+static const char* const kModelPaths[] = {
+    "mediapipe/modules/palm_detection/palm_detection_full.tflite",
+    "mediapipe/modules/hand_landmark/hand_landmark_full.tflite",
+};
+// Size of the synthetic warm-up frames; the camera's usual frame size
+static const int kWarmUpWidth = 640;
+static const int kWarmUpHeight = 480;
 
 bool initial = true;
 #define INDEX_TIP 8
@@ -126,23 +167,412 @@ void ProcessHandLandmarks(const mediapipe::NormalizedLandmarkList& landmark_list
 
 
 
-absl::Status hand_analyze_image(cv::Mat image, handPosition* hand_pos){
+// Times one stage of hand_analyze_image, as a trace span and in the stage
+// latency metric. The stage ends at stop() or when it goes out of scope,
+// so early error returns still close the span.
+class StageTimer {
+public:
+    StageTimer(const char* name, int metric)
+        : metric(metric), start(std::chrono::steady_clock::now()), running(true) {
+        Trace_begin(name);
+    }
+    ~StageTimer() { stop(); }
+    void stop() {
+        if (running) {
+            running = false;
+            Trace_end();
+            Metrics_observe(metric, std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+    }
+
+private:
+    int metric;
+    std::chrono::steady_clock::time_point start;
+    bool running;
+};
+
+// GraphProfiler histogram buckets behind the per-calculator percentiles:
+// 1 ms wide, with everything from 500 ms up in the last one
+constexpr int kHistogramIntervalUsec = 1000;
+constexpr int kHistogramIntervals = 500;
+
+// When the app trace is recording, the graph records its own calculator
+// timings too (GraphTracer); this copies the events since `since` into the
+// app trace, so one timeline shows the frame inside the graph.
+static void MergeGraphTrace(mediapipe::CalculatorGraph* graph, absl::Time since) {
+#ifdef MEDIAPIPE_PROFILER_AVAILABLE
+    mediapipe::GraphTracer* tracer = graph->profiler() ? graph->profiler()->tracer() : nullptr;
+    if (tracer == nullptr || !Trace_isEnabled()) {
+        return;
+    }
+    mediapipe::GraphTrace trace;
+    tracer->GetTrace(since, absl::InfiniteFuture(), &trace);
+
+    // GraphTracer times are wall clock micros; the app trace is monotonic
+    long long offset_ns = absl::GetCurrentTimeNanos() - Trace_nowNs();
+    const mediapipe::CalculatorGraphConfig& config = graph->Config();
+    for (const auto& calculator : trace.calculator_trace()) {
+        if (!calculator.has_start_time() || !calculator.has_finish_time() ||
+            calculator.node_id() < 0 || calculator.node_id() >= config.node_size()) {
+            continue;
+        }
+        std::string name = mediapipe::tool::CanonicalNodeName(config, calculator.node_id());
+        if (calculator.event_type() != mediapipe::GraphTrace::PROCESS) {
+            name += " " + mediapipe::GraphTrace::EventType_Name(calculator.event_type());
+        }
+        long long start_ns = (trace.base_time() + calculator.start_time()) * 1000 - offset_ns;
+        long long finish_ns = (trace.base_time() + calculator.finish_time()) * 1000 - offset_ns;
+        // Graph worker threads get their own tracks (0 is this thread)
+        Trace_complete(Trace_intern(name.c_str()), start_ns, finish_ns,
+                       calculator.thread_id() % 255 + 1);
+    }
+#endif
+}
+
+// Percentile of a GraphProfiler time histogram in ms, interpolated inside
+// the bucket it falls in
+static double HistogramPercentileMs(const mediapipe::TimeHistogram& histogram,
+                                   long long calls, double fraction) {
+    double target = fraction * calls;
+    long long below = 0;
+    for (int i = 0; i < histogram.count_size(); ++i) {
+        long long count = histogram.count(i);
+        if (count > 0 && below + count >= target) {
+            // The last bucket is open ended, so only its start is known
+            double within = (i == histogram.count_size() - 1) ? 0.0 : (target - below) / count;
+            return (i + within) * histogram.interval_size_usec() / 1000.0;
+        }
+        below += count;
+    }
+    return 0.0;
+}
+
+// The options of node i if it is an inference node, else nullptr
+static mediapipe::InferenceCalculatorOptions* InferenceOptions(mediapipe::CalculatorGraphConfig* config, int i) {
+    mediapipe::CalculatorGraphConfig::Node* node = config->mutable_node(i);
+    if (node->calculator().rfind("InferenceCalculator", 0) != 0 ||
+        !node->options().HasExtension(mediapipe::InferenceCalculatorOptions::ext)) {
+        return nullptr;
+    }
+    return node->mutable_options()->MutableExtension(mediapipe::InferenceCalculatorOptions::ext);
+}
+
+// Delete the weight cache files in dir that weren't packed from the models
+// with this fingerprint
+static void RemoveStaleWeightCaches(const std::string& dir, const std::string& fingerprint) {
+    static const std::string kSuffix = ".xnnpack_cache";
+    const std::string current = "." + fingerprint + kSuffix;
+    DIR* dir_handle = opendir(dir.c_str());
+    if (dir_handle == nullptr) {
+        return;
+    }
+    while (struct dirent* entry = readdir(dir_handle)) {
+        std::string name = entry->d_name;
+        auto ends_with = [&name](const std::string& suffix) {
+            return name.size() >= suffix.size() &&
+                   name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+        if (ends_with(kSuffix) && !ends_with(current)) {
+            unlink((dir + "/" + name).c_str());
+        }
+    }
+    closedir(dir_handle);
+}
+
+// Point every XNNPACK inference node at its own weight cache file in dir,
+// named after the node and the models' fingerprint, so weights packed from
+// a model that has since been replaced are never mapped. The subgraphs are
+// expanded here, as Initialize() would do, to reach the inference nodes
+// inside them.
+static absl::Status UseWeightCache(mediapipe::CalculatorGraphConfig* config, const std::string& dir,
+                                   const std::string& fingerprint) {
+    MP_RETURN_IF_ERROR(mediapipe::tool::ExpandSubgraphs(config));
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        // Run without the cache rather than not at all
+        Log_write(LOG_CAT_HAND, LOG_LEVEL_WARN, "Cannot create weight cache directory %s: %s",
+                  dir.c_str(), strerror(errno));
+        return absl::OkStatus();
+    }
+    RemoveStaleWeightCaches(dir, fingerprint);
+    for (int i = 0; i < config->node_size(); ++i) {
+        mediapipe::InferenceCalculatorOptions* options = InferenceOptions(config, i);
+        if (options == nullptr || !options->delegate().has_xnnpack()) {
+            continue;
+        }
+        options->mutable_delegate()->mutable_xnnpack()->set_weight_cache_file_path(
+            dir + "/" + mediapipe::tool::CanonicalNodeName(*config, i) + "." + fingerprint + ".xnnpack_cache");
+    }
+    return absl::OkStatus();
+}
+
+// Give the tracker's ROI association (which merges the palm detector's
+// regions with the ones tracked from the last frame) a third source of hand
+// regions, for warmUp(): the noise frames have no palm for the detector to
+// find, so this is how they get the landmark model to run too. Returns
+// false if the graph has no such node.
+static absl::StatusOr<bool> AddWarmUpRectsStream(mediapipe::CalculatorGraphConfig* config) {
+    MP_RETURN_IF_ERROR(mediapipe::tool::ExpandSubgraphs(config));
+    for (mediapipe::CalculatorGraphConfig::Node& node : *config->mutable_node()) {
+        if (node.calculator() == "AssociationNormRectCalculator") {
+            node.add_input_stream(kWarmUpRectsStream);
+            config->add_input_stream(kWarmUpRectsStream);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Size the pools the graph uses from the thread topology: the scheduler's
+// threads (named so Topology_apply() can place them), the XNNPACK threads
+// of each inference node, which start on and run as scheduler threads, and
+// OpenCV's pool.
+static absl::Status UseThreadTopology(mediapipe::CalculatorGraphConfig* config) {
+    if (config->executor_size() == 0) {
+        // An unnamed executor without a type configures the default one
+        mediapipe::ExecutorConfig* executor = config->add_executor();
+        mediapipe::ThreadPoolExecutorOptions* options =
+            executor->mutable_options()->MutableExtension(mediapipe::ThreadPoolExecutorOptions::ext);
+        options->set_thread_name_prefix(kGraphThreadPrefix);
+        int graph_threads = Topology_getPoolSize(TOPOLOGY_ROLE_GRAPH);
+        if (graph_threads > 0) {
+            options->set_num_threads(graph_threads);
+        }
+    }
+
+    int inference_threads = Topology_getPoolSize(TOPOLOGY_ROLE_INFERENCE);
+    if (inference_threads > 0) {
+        MP_RETURN_IF_ERROR(mediapipe::tool::ExpandSubgraphs(config));
+        for (int i = 0; i < config->node_size(); ++i) {
+            mediapipe::InferenceCalculatorOptions* options = InferenceOptions(config, i);
+            if (options == nullptr) {
+                continue;
+            }
+            options->set_cpu_num_thread(inference_threads);
+            if (options->delegate().has_xnnpack()) {
+                options->mutable_delegate()->mutable_xnnpack()->set_num_threads(inference_threads);
+            }
+        }
+    }
+
+    // Process-wide; -1 gives OpenCV back its own default
+    int opencv_threads = Topology_getPoolSize(TOPOLOGY_ROLE_OPENCV);
+    cv::setNumThreads(opencv_threads > 0 ? opencv_threads : -1);
+    return absl::OkStatus();
+}
+
+#ifndef HAND_GRAPH_EMBEDDED
+// Serves the models from the asset cache's mapped local copies, so loading
+// them doesn't read the shared working directory. Models without a copy yet
+// are read from there as before.
+class CachedModelResources : public mediapipe::Resources {
+public:
+    CachedModelResources() : fallback(mediapipe::CreateDefaultResources()) {
+        for (const char* path : kModelPaths) {
+            size_t size = 0;
+            const void* data = AssetCache_map(path, &size);
+            if (data != nullptr) {
+                models.push_back({path, static_cast<const char*>(data), size});
+            }
+        }
+    }
+
+    absl::StatusOr<std::unique_ptr<mediapipe::Resource>> Get(
+            absl::string_view resource_id, const Options& options) const override {
+        for (const CachedModel& model : models) {
+            if (resource_id == model.resource_id) {
+                // Mapped until AssetCache_cleanup(), after the graph is gone
+                return mediapipe::MakeNoCleanupResource(model.data, model.size);
+            }
+        }
+        return fallback->Get(resource_id, options);
+    }
+
+private:
+    struct CachedModel {
+        const char* resource_id;
+        const char* data;
+        size_t size;
+    };
+    std::vector<CachedModel> models;
+    std::unique_ptr<mediapipe::Resources> fallback;
+};
+
+static std::shared_ptr<mediapipe::Resources> CachedModels() {
+    static std::shared_ptr<mediapipe::Resources> resources = std::make_shared<CachedModelResources>();
+    return resources;
+}
+#endif
+
+// Size and mtime of path, or "none"
+static std::string StatFingerprint(const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return "none";
+    }
+    char fingerprint[40];
+    snprintf(fingerprint, sizeof(fingerprint), "%llx-%llx",
+             (unsigned long long)st.st_size, (unsigned long long)st.st_mtime);
+    return fingerprint;
+}
+
+// Identifies the models the graph loads: the start of the MD5 of each
+// mapped local copy, else the size and mtime of the file read in its place.
+// Embedded models change only with the binary.
+static std::string ModelFingerprint() {
+#ifdef HAND_GRAPH_EMBEDDED
+    return StatFingerprint("/proc/self/exe");
+#else
+    // Maps the local copies, if there are any yet
+    CachedModels();
+    std::string fingerprint;
+    for (const char* path : kModelPaths) {
+        if (!fingerprint.empty()) {
+            fingerprint += "_";
+        }
+        char md5[ASSET_CACHE_MD5_SIZE];
+        if (AssetCache_getMappedMd5(path, md5)) {
+            fingerprint.append(md5, 8);
+        } else {
+            fingerprint += StatFingerprint(path);
+        }
+    }
+    return fingerprint;
+#endif
+}
+
+// The hand graph, built on the first frame and then kept running, so the
+// models are loaded once and the tracker can follow the hand from one frame
+// to the next. It's rebuilt when the profiler settings it was started with
+// no longer match (profiling mode, or the app trace switched on or off).
+class HandTrackingSession {
+public:
+    // With warm_up_hand, the landmark model also runs on a made-up hand
+    // region in the middle of the frame
+    absl::Status analyze(const cv::Mat& image, handPosition* hand_pos, bool warm_up_hand = false);
+    void setProfiling(const HandProfilingOptions& options);
+    HandProfilingOptions getProfiling();
+    std::vector<HandCalculatorStats> getCalculatorStats();
+    absl::Status warmUp(int frames, HandWarmUpStats* stats);
+    void setWeightCacheDir(const std::string& dir);
+    void close();
+
+private:
+    absl::Status start(bool with_tracing);
+    void stop();
+
+    std::mutex mutex;
+    HandProfilingOptions profiling;
+    std::string weight_cache_dir = kDefaultWeightCacheDir;
+    // Whether the running graph keeps GraphTracer events for the app trace
+    bool tracing = false;
+    size_t last_timestamp_us = 0;
+    // The graph takes warm-up hand regions until the first real frame
+    bool warm_up_rects_open = false;
+    std::unique_ptr<mediapipe::CalculatorGraph> graph;
+    std::unique_ptr<mediapipe::OutputStreamPoller> poller;
+};
+
+absl::Status HandTrackingSession::start(bool with_tracing) {
+#ifdef HAND_GRAPH_EMBEDDED
+    mediapipe::CalculatorGraphConfig config;
+    MP_RETURN_IF_ERROR(hand_embedded_graph_config(&config));
+#else
     std::string calculator_graph_config_contents;
     
-    // Use the fixed path directly instead of GetFlag
+    // Use the fixed path directly instead of GetFlag, through the asset cache
+    const char* config_path = AssetCache_getPath(kCalculatorGraphConfigFile);
     MP_RETURN_IF_ERROR(mediapipe::file::GetContents(
-      kCalculatorGraphConfigFile,
+      config_path != nullptr ? config_path : kCalculatorGraphConfigFile,
       &calculator_graph_config_contents));
 
     mediapipe::CalculatorGraphConfig config =
       mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig>(
           calculator_graph_config_contents);
-          mediapipe::CalculatorGraph graph;
-    MP_RETURN_IF_ERROR(graph.Initialize(config));
+#endif
+    if (!weight_cache_dir.empty()) {
+        MP_RETURN_IF_ERROR(UseWeightCache(&config, weight_cache_dir, ModelFingerprint()));
+    }
+    MP_RETURN_IF_ERROR(UseThreadTopology(&config));
+    MP_ASSIGN_OR_RETURN(bool has_warm_up_rects, AddWarmUpRectsStream(&config));
+    mediapipe::ProfilerConfig* profiler_config = config.mutable_profiler_config();
+    if (profiling.enabled) {
+        profiler_config->set_enable_profiler(true);
+        profiler_config->set_histogram_interval_size_usec(kHistogramIntervalUsec);
+        profiler_config->set_num_histogram_intervals(kHistogramIntervals);
+        profiler_config->set_trace_enabled(true);
+        if (!profiling.trace_log_path.empty()) {
+            profiler_config->set_trace_log_path(profiling.trace_log_path);
+            profiler_config->set_trace_log_interval_usec(profiling.trace_log_interval_ms * 1000LL);
+        } else {
+            profiler_config->set_trace_log_disabled(true);
+        }
+    }
+    if (with_tracing && !profiler_config->trace_enabled()) {
+        // Keep the events in memory only, for MergeGraphTrace
+        profiler_config->set_trace_enabled(true);
+        profiler_config->set_trace_log_disabled(true);
+        profiler_config->set_trace_log_capacity(4096);
+    }
+
+    auto new_graph = absl::make_unique<mediapipe::CalculatorGraph>();
+#ifdef HAND_GRAPH_EMBEDDED
+    // The models come from the binary rather than the working directory
+    MP_RETURN_IF_ERROR(new_graph->SetServiceObject(mediapipe::kResourcesService,
+                                                   hand_embedded_resources()));
+#else
+    MP_RETURN_IF_ERROR(new_graph->SetServiceObject(mediapipe::kResourcesService,
+                                                   CachedModels()));
+#endif
+    MP_RETURN_IF_ERROR(new_graph->Initialize(config));
+    MP_ASSIGN_OR_RETURN(mediapipe::OutputStreamPoller output_poller,
+      new_graph->AddOutputStreamPoller(kOutputStream));
+    MP_RETURN_IF_ERROR(new_graph->StartRun({}));
+    // Place the new scheduler threads
+    Topology_apply();
+
+    poller = absl::make_unique<mediapipe::OutputStreamPoller>(std::move(output_poller));
+    graph = std::move(new_graph);
+    tracing = with_tracing;
+    warm_up_rects_open = has_warm_up_rects;
+    last_timestamp_us = 0;
+    return absl::OkStatus();
+}
+
+void HandTrackingSession::stop() {
+    if (!graph) {
+        return;
+    }
+    // Closing the inputs (the frames, and the warm-up hand regions if still
+    // open) lets the graph finish, and the profiler write out the rest of its
+    // trace log
+    graph->CloseAllInputStreams().IgnoreError();
+    warm_up_rects_open = false;
+    graph->WaitUntilDone().IgnoreError();
+    poller.reset();
+    graph.reset();
+}
+
+absl::Status HandTrackingSession::analyze(const cv::Mat& image, handPosition* hand_pos, bool warm_up_hand) {
+    static const int setup_metric = Metrics_registerSummary("gesture_stage_ms", "stage=\"graph_setup\"",
+        "Time spent in each stage of gesture detection, in ms.");
+    static const int preprocess_metric = Metrics_registerSummary("gesture_stage_ms", "stage=\"preprocess\"",
+        "Time spent in each stage of gesture detection, in ms.");
+    static const int inference_metric = Metrics_registerSummary("gesture_stage_ms", "stage=\"inference\"",
+        "Time spent in each stage of gesture detection, in ms.");
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    StageTimer setup_stage("graph_setup", setup_metric);
+    if (graph && tracing != Trace_isEnabled()) {
+        stop();
+    }
+    if (!graph) {
+        MP_RETURN_IF_ERROR(start(Trace_isEnabled()));
+    }
+    setup_stage.stop();
 
-    MP_ASSIGN_OR_RETURN(mediapipe::OutputStreamPoller poller,
-      graph.AddOutputStreamPoller(kOutputStream));
-    graph.StartRun({});
+    StageTimer preprocess_stage("preprocess", preprocess_metric);
     cv::Mat camera_frame;
     cv::cvtColor(image, camera_frame, cv::COLOR_BGR2RGB);
 
@@ -154,64 +584,82 @@ absl::Status hand_analyze_image(cv::Mat image, handPosition* hand_pos){
         mediapipe::ImageFrame::kDefaultAlignmentBoundary);
     cv::Mat input_frame_mat = mediapipe::formats::MatView(input_frame.get());
     camera_frame.copyTo(input_frame_mat);
+    preprocess_stage.stop();
     
 
+    StageTimer inference_stage("inference", inference_metric);
+    Trace_flowStep("frame", Trace_getFlow());
+    absl::Time frame_start = absl::Now();
     size_t frame_timestamp_us =
         (double)cv::getTickCount() / (double)cv::getTickFrequency() * 1e6;
-    graph.AddPacketToInputStream(
-        kInputStream, mediapipe::Adopt(input_frame.release())
-                          .At(mediapipe::Timestamp(frame_timestamp_us)));
-    graph.WaitUntilIdle(); // prevents off-by-one error of .jpg processing during runtime
+    // The graph keeps running, so timestamps must keep increasing
+    frame_timestamp_us = std::max(frame_timestamp_us, last_timestamp_us + 1);
+    last_timestamp_us = frame_timestamp_us;
+    absl::Status status = absl::OkStatus();
+    if (warm_up_rects_open) {
+        if (warm_up_hand) {
+            auto rects = absl::make_unique<std::vector<mediapipe::NormalizedRect>>(1);
+            mediapipe::NormalizedRect& rect = rects->front();
+            rect.set_x_center(0.5f);
+            rect.set_y_center(0.5f);
+            rect.set_width(0.5f);
+            rect.set_height(0.5f);
+            status = graph->AddPacketToInputStream(
+                kWarmUpRectsStream, mediapipe::Adopt(rects.release())
+                                        .At(mediapipe::Timestamp(frame_timestamp_us)));
+        } else {
+            // A real frame: the tracker mustn't wait on this stream from now on
+            status = graph->CloseInputStream(kWarmUpRectsStream);
+            warm_up_rects_open = false;
+        }
+    }
+    if (status.ok()) {
+        status = graph->AddPacketToInputStream(
+            kInputStream, mediapipe::Adopt(input_frame.release())
+                              .At(mediapipe::Timestamp(frame_timestamp_us)));
+    }
+    if (status.ok()) {
+        status = graph->WaitUntilIdle(); // prevents off-by-one error of .jpg processing during runtime
+    }
+    inference_stage.stop();
+    if (!status.ok()) {
+        // Start again with a new graph on the next frame
+        stop();
+        return status;
+    }
+    if (tracing) {
+        MergeGraphTrace(graph.get(), frame_start);
+    }
 
     mediapipe::Packet detection_packet;
     
-    // Static counter to limit log messages for missing landmarks
-    static int noLandmarksCounter = 0;
-    
-    if (!poller.QueueSize()) {
-        // Only log every 30 frames (about once per second at 30fps)
-        if (noLandmarksCounter++ % 30 == 0) {
-            std::cout << "No new landmarks available. Skipping..." << std::endl;
-        }
+    if (!poller->QueueSize()) {
+        // At most about once a second
+        Log_writeLimited(LOG_CAT_HAND, LOG_LEVEL_INFO, 1.0, 1, "No new landmarks available. Skipping...");
         hand_pos->hand_visible = false;
-        // Clean up before returning
-        graph.CloseInputStream(kInputStream);
-        graph.WaitUntilDone();
         return absl::OkStatus();
     }
     
-    // Reset counter when we have landmarks
-    noLandmarksCounter = 0;
-    
-    //std::cout << "Queue size: " << poller.QueueSize() << std::endl;
-    if (!poller.Next(&detection_packet)) {
-      std::cout << "Poller failed. Skipping...\n" << std::endl;
+    // The messages below can come every frame; at most about once a second each
+    if (!poller->Next(&detection_packet)) {
+      Log_writeLimited(LOG_CAT_HAND, LOG_LEVEL_WARN, 1.0, 1, "Poller failed. Skipping...");
       hand_pos->hand_visible = false;
-      // Clean up before returning
-      graph.CloseInputStream(kInputStream);
-      graph.WaitUntilDone();
       return absl::OkStatus();
     } 
     
     auto &output_landmarks = detection_packet.Get<std::vector<::mediapipe::NormalizedLandmarkList>>();
     
     if (output_landmarks.empty()) {
-        std::cout << "No hand detected. Skipping this frame.\n" << std::endl;
+        Log_writeLimited(LOG_CAT_HAND, LOG_LEVEL_INFO, 1.0, 1, "No hand detected. Skipping this frame.");
         hand_pos->hand_visible = false;
-        // Clean up before returning
-        graph.CloseInputStream(kInputStream);
-        graph.WaitUntilDone();
         return absl::OkStatus();
     }
 
     mediapipe::NormalizedLandmarkList landmarks = output_landmarks[0];
     
     if (landmarks.landmark_size() < 21) {
-      std::cout << "Detected hand has insufficient landmarks. Skipping...\n" << std::endl;
+      Log_writeLimited(LOG_CAT_HAND, LOG_LEVEL_INFO, 1.0, 1, "Detected hand has insufficient landmarks. Skipping...");
       hand_pos->hand_visible = false;
-      // Clean up before returning
-      graph.CloseInputStream(kInputStream);
-      graph.WaitUntilDone();
       return absl::OkStatus();
     }
     
@@ -226,15 +674,137 @@ absl::Status hand_analyze_image(cv::Mat image, handPosition* hand_pos){
         }
     }
     if (all_landmarks_invalid) {
-        std::cout << "No valid hand landmarks detected. Skipping...\n" << std::endl;
+        Log_writeLimited(LOG_CAT_HAND, LOG_LEVEL_INFO, 1.0, 1, "No valid hand landmarks detected. Skipping...");
         hand_pos->hand_visible = false;
-        // Clean up before returning
-        graph.CloseInputStream(kInputStream);
-        graph.WaitUntilDone();
         return absl::OkStatus();
     }
     
     ProcessHandLandmarks(landmarks, hand_pos);
-    MP_RETURN_IF_ERROR(graph.CloseInputStream(kInputStream));
-    return graph.WaitUntilDone();
+    return absl::OkStatus();
+}
+
+void HandTrackingSession::setProfiling(const HandProfilingOptions& options) {
+    std::lock_guard<std::mutex> lock(mutex);
+    profiling = options;
+    // The next frame starts a graph with the new profiler_config
+    stop();
+}
+
+HandProfilingOptions HandTrackingSession::getProfiling() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return profiling;
+}
+
+std::vector<HandCalculatorStats> HandTrackingSession::getCalculatorStats() {
+    std::vector<HandCalculatorStats> stats;
+    std::vector<mediapipe::CalculatorProfile> profiles;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!graph || !profiling.enabled || graph->profiler() == nullptr ||
+            !graph->profiler()->GetCalculatorProfiles(&profiles).ok()) {
+            return stats;
+        }
+    }
+
+    for (const auto& profile : profiles) {
+        const mediapipe::TimeHistogram& runtime = profile.process_runtime();
+        long long calls = 0;
+        for (long long count : runtime.count()) {
+            calls += count;
+        }
+        if (calls == 0) {
+            continue;
+        }
+        HandCalculatorStats calculator;
+        // Nodes from subgraphs are named "subgraph__...__Calculator"; the
+        // top-level HandLandmarkTrackingCpu prefix is the same for them all
+        calculator.name = profile.name();
+        size_t separator = calculator.name.find("__");
+        if (separator != std::string::npos &&
+            calculator.name.find("__", separator + 2) != std::string::npos) {
+            calculator.name = calculator.name.substr(separator + 2);
+        }
+        calculator.count = calls;
+        calculator.total_ms = runtime.total() / 1000.0;
+        calculator.p50_ms = HistogramPercentileMs(runtime, calls, 0.50);
+        calculator.p90_ms = HistogramPercentileMs(runtime, calls, 0.90);
+        calculator.p99_ms = HistogramPercentileMs(runtime, calls, 0.99);
+        stats.push_back(calculator);
+    }
+    std::sort(stats.begin(), stats.end(),
+              [](const HandCalculatorStats& a, const HandCalculatorStats& b) {
+                  return a.total_ms > b.total_ms;
+              });
+    return stats;
+}
+
+absl::Status HandTrackingSession::warmUp(int frames, HandWarmUpStats* stats) {
+    *stats = HandWarmUpStats();
+    auto start_time = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!graph) {
+            MP_RETURN_IF_ERROR(start(Trace_isEnabled()));
+        }
+    }
+    stats->start_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start_time).count();
+
+    // Noise rather than a flat colour, so the image steps do their usual work
+    cv::Mat frame(kWarmUpHeight, kWarmUpWidth, CV_8UC3);
+    cv::RNG rng(1);
+    rng.fill(frame, cv::RNG::UNIFORM, 0, 256);
+    for (int i = 0; i < frames; ++i) {
+        auto frame_start = std::chrono::steady_clock::now();
+        handPosition hand_pos;
+        MP_RETURN_IF_ERROR(analyze(frame, &hand_pos, /*warm_up_hand=*/true));
+        double frame_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - frame_start).count();
+        if (i == 0) {
+            stats->first_frame_ms = frame_ms;
+        }
+        stats->last_frame_ms = frame_ms;
+        stats->frames++;
+    }
+    return absl::OkStatus();
+}
+
+void HandTrackingSession::setWeightCacheDir(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(mutex);
+    weight_cache_dir = dir;
+}
+
+void HandTrackingSession::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop();
+}
+
+static HandTrackingSession session;
+
+absl::Status hand_analyze_image(cv::Mat image, handPosition* hand_pos){
+    return session.analyze(image, hand_pos);
+}
+
+void hand_set_profiling(const HandProfilingOptions& options) {
+    session.setProfiling(options);
+}
+
+HandProfilingOptions hand_get_profiling() {
+    return session.getProfiling();
+}
+
+std::vector<HandCalculatorStats> hand_get_calculator_stats() {
+    return session.getCalculatorStats();
+}
+
+void hand_close_session() {
+    session.close();
+}
+
+absl::Status hand_warm_up(int frames, HandWarmUpStats* stats) {
+    return session.warmUp(frames, stats);
+}
+
+void hand_set_weight_cache_dir(const std::string& dir) {
+    session.setWeightCacheDir(dir);
 }
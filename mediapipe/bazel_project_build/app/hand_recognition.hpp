@@ -2,6 +2,8 @@
 
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
 #include "absl/status/status.h"
 
 // Forward declarations for MediaPipe types
@@ -37,8 +39,59 @@ public:
     bool compare(handPosition reference);
 };
 
+// Settings for profiling the hand graph with MediaPipe's GraphProfiler
+struct HandProfilingOptions {
+    bool enabled = false;
+    // GraphProfiler trace logs go to <trace_log_path>0.binarypb, 1.binarypb, ...
+    // (view them in the MediaPipe visualizer); empty keeps them in memory only
+    std::string trace_log_path;
+    int trace_log_interval_ms = 1000;
+};
+
+// Process() times of one calculator in the hand graph
+struct HandCalculatorStats {
+    std::string name;
+    long long count = 0;
+    double total_ms = 0;
+    double p50_ms = 0;
+    double p90_ms = 0;
+    double p99_ms = 0;
+};
+
+// Timings of hand_warm_up()
+struct HandWarmUpStats {
+    int frames = 0;
+    // Starting the graph: loading the models and packing (or mapping) weights
+    double start_ms = 0;
+    double first_frame_ms = 0;
+    double last_frame_ms = 0;
+};
+
+// Runs one frame through the hand graph. The graph is started on the first
+// call and kept running between frames; calls from several threads take turns.
 absl::Status hand_analyze_image(cv::Mat image, handPosition* hand_pos);
 
+// Turn profiling on or off; the graph restarts with it on the next frame
+void hand_set_profiling(const HandProfilingOptions& options);
+HandProfilingOptions hand_get_profiling();
+// Per-calculator Process() times since profiling was turned on, busiest
+// calculator first. Empty while profiling is off.
+std::vector<HandCalculatorStats> hand_get_calculator_stats();
+// Start the graph if it isn't running and put `frames` synthetic frames
+// through it, so the first camera frame doesn't pay for TFLite's lazy
+// allocations and cold caches. The frames are noise, which runs palm
+// detection; each also comes with a made-up hand region, which runs the
+// landmark model.
+absl::Status hand_warm_up(int frames, HandWarmUpStats* stats);
+// Directory where XNNPACK keeps each model's packed weights, so the next
+// start maps them instead of packing them again (default "xnnpack_cache"
+// in the working directory; empty turns the cache off). Takes effect when
+// the graph next starts. The files are named after the models they were
+// packed from; ones from replaced models are deleted when the graph starts.
+void hand_set_weight_cache_dir(const std::string& dir);
+// Stop the graph (and flush the profiler's trace log)
+void hand_close_session();
+
 // Declaration for the hand landmarks processing function (implementation details hidden)
 void ProcessHandLandmarks(const mediapipe::NormalizedLandmarkList& landmark_list, handPosition* ret);
 
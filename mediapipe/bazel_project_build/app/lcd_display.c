@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 /*
 #include "../lcd/lib/Config/DEV_Config.h"
 #include "../lcd/lib/LCD/LCD_1in54.h"
@@ -15,9 +16,11 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
 #include "lcd_display.h"
+#include "trace.h"
 #include <string.h>
-static UWORD *s_fb;
 static bool lcd_initialized = false;
 
 //Taken and (slightly) adapted from Dr Brian Frasers demo code
@@ -37,94 +40,192 @@ static bool lcd_initialized = false;
 #define OFFSET_REGULAR 21
 #define OFFSET_LARGE 29
 
+// Render service
+// Callers only copy their text into s_pending and return. The render thread
+// picks up the latest scene (older unrendered scenes are coalesced away),
+// draws it into the back buffer, pushes it over SPI and then swaps buffers.
+#define LCD_MAX_LINES 8
+#define LCD_MAX_LINE_LENGTH 32
+
+typedef struct {
+    bool clear_only;
+    int length;
+    lcd_location location;
+    char lines[LCD_MAX_LINES][LCD_MAX_LINE_LENGTH];
+    unsigned long long trace_flow;  // Trace flow of whatever asked for the update
+} lcd_scene;
+
+static UWORD *s_buffers[2];
+static int s_back = 0;
+
+static pthread_t s_renderThread;
+static pthread_mutex_t s_sceneMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_sceneCond = PTHREAD_COND_INITIALIZER;
+static lcd_scene s_pending;
+static bool s_hasPending = false;
+static bool s_stopping = false;
+
+// Rows of the panel holding text from the last flushed scene; these must be
+// repainted when the next scene is flushed so stale lines get erased.
+static int s_prevTop = LCD_1IN54_HEIGHT;
+static int s_prevBottom = 0;
+
+// Guarded by s_sceneMutex
+static lcd_render_stats s_stats;
+
+static long long getTimeInNs(void)
+{
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (long long)spec.tv_sec * 1000000000LL + spec.tv_nsec;
+}
+
+static void* render_thread(void* arg);
+
 //From the example LCD code
 void lcd_init(){
     assert(!lcd_initialized);
     // Exception handling:ctrl + c
     // signal(SIGINT, Handler_1IN54_LCD);
-    
+
     // Module Init
     if(DEV_ModuleInit() != 0){
         DEV_ModuleExit();
         exit(0);
     }
-	
-    // LCD Init
-    DEV_Delay_ms(2000);
+
+    // LCD Init (the controller's own reset timing is in LCD_1IN54_Reset)
 	LCD_1IN54_Init(HORIZONTAL);
 	LCD_1IN54_Clear(WHITE);
 	LCD_SetBacklight(1023);
 
     UDOUBLE Imagesize = LCD_1IN54_HEIGHT*LCD_1IN54_WIDTH*2;
-    if((s_fb = (UWORD *)malloc(Imagesize)) == NULL) {
-        perror("Failed to apply for black memory");
+    for (int i = 0; i < 2; i++) {
+        if((s_buffers[i] = (UWORD *)malloc(Imagesize)) == NULL) {
+            perror("Failed to apply for black memory");
+            exit(0);
+        }
+    }
+    s_back = 0;
+    s_prevTop = LCD_1IN54_HEIGHT;
+    s_prevBottom = 0;
+
+    pthread_mutex_lock(&s_sceneMutex);
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_hasPending = false;
+    s_stopping = false;
+    pthread_mutex_unlock(&s_sceneMutex);
+
+    if (pthread_create(&s_renderThread, NULL, render_thread, NULL) != 0) {
+        perror("Failed to create LCD render thread");
         exit(0);
     }
+    pthread_setname_np(s_renderThread, "lcd_render");
     lcd_initialized = true;
 }
 
+// Hand a scene to the render thread without waiting for it to be drawn.
+static void post_scene(const lcd_scene* scene)
+{
+    pthread_mutex_lock(&s_sceneMutex);
+    if (s_hasPending) {
+        s_stats.updates_coalesced++;
+    }
+    s_pending = *scene;
+    s_pending.trace_flow = Trace_getFlow();
+    s_hasPending = true;
+    s_stats.updates_posted++;
+    pthread_cond_signal(&s_sceneCond);
+    pthread_mutex_unlock(&s_sceneMutex);
+}
+
 void lcd_clear_screen(){
-    LCD_1IN54_Clear(WHITE);
+    assert(lcd_initialized);
+    lcd_scene scene;
+    memset(&scene, 0, sizeof(scene));
+    scene.clear_only = true;
+    post_scene(&scene);
 }
 
 void lcd_cleanup()
 {
     assert(lcd_initialized);
+    // Let the render thread flush whatever is still pending, then stop it
+    pthread_mutex_lock(&s_sceneMutex);
+    s_stopping = true;
+    pthread_cond_signal(&s_sceneCond);
+    pthread_mutex_unlock(&s_sceneMutex);
+    pthread_join(s_renderThread, NULL);
+
     //LCD_1IN54_Clear(BLACK);
     // Module Exit
-    free(s_fb);
-    s_fb = NULL;
+    for (int i = 0; i < 2; i++) {
+        free(s_buffers[i]);
+        s_buffers[i] = NULL;
+    }
     DEV_ModuleExit();
     lcd_initialized = false;
 }
 
-typedef struct{
-    int x;
-    int y;
-}message_size;
-
-static int getCenter(char * message){
-    int length = strlen(message);
-    int width;
-
-    width = FONT_REGULAR_WIDTH;
+void lcd_get_render_stats(lcd_render_stats* stats)
+{
+    assert(stats);
+    pthread_mutex_lock(&s_sceneMutex);
+    *stats = s_stats;
+    pthread_mutex_unlock(&s_sceneMutex);
 
-    return (LCD_1IN54_WIDTH - (length * width)) / 2;
+    DEV_SPI_STATS spi;
+    DEV_SPI_GetStats(&spi);
+    stats->spi_bytes = spi.bytes;
+    stats->spi_messages = spi.messages;
+    stats->spi_bytes_per_sec = spi.busy_ns ? spi.bytes * 1e9 / spi.busy_ns : 0.0;
+    stats->spi_bus_bytes_per_sec = spi.speed_hz / 8.0;
 }
 
-static message_size get_message_size(char* message){
+static int getCenter(const char * message){
     int length = strlen(message);
     int width;
-    int height;
 
     width = FONT_REGULAR_WIDTH;
-    height = FONT_REGULAR_HEIGHT;
 
-    message_size ret;
-    ret.x = width * length;
-    ret.y = height;
-    return ret;
+    return (LCD_1IN54_WIDTH - (length * width)) / 2;
 }
 
 void lcd_place_message(char** messages, int length, lcd_location location){
+    assert(lcd_initialized);
+    lcd_scene scene;
+    memset(&scene, 0, sizeof(scene));
+    if (length > LCD_MAX_LINES) {
+        length = LCD_MAX_LINES;
+    }
+    scene.length = length;
+    scene.location = location;
+    for (int i = 0; i < length; i++) {
+        snprintf(scene.lines[i], LCD_MAX_LINE_LENGTH, "%s", messages[i]);
+    }
+    post_scene(&scene);
+}
+
+// Draw the scene into fb. Returns the band of rows [*top, *bottom) it wrote text to.
+static void render_scene(const lcd_scene* scene, UWORD* fb, int* top, int* bottom){
     int x;
     int y;
-    assert(lcd_initialized);
     // Initialize the RAM frame buffer to be blank (white)
     int DEFAULT_DEPTH = 16;
-    Paint_NewImage(s_fb, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT, 0, WHITE, DEFAULT_DEPTH);
+    Paint_NewImage(fb, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT, 0, WHITE, DEFAULT_DEPTH);
     Paint_Clear(WHITE);
     int offset;
 
     offset = OFFSET_REGULAR;
 
-    int x_clear = TOP_LEFT_EDGE;
-    for (int i = 0; i < length; i++){
-        switch (location){
+    *top = LCD_1IN54_HEIGHT;
+    *bottom = 0;
+    for (int i = 0; i < scene->length; i++){
+        const char* message = scene->lines[i];
+        switch (scene->location){
             case lcd_center://Center
-                x = getCenter(messages[i]);
+                x = getCenter(message);
                 y = CENTER + (offset*i);
-                x_clear = x;
                 break;
             case lcd_top_left://Top Left
                 x = TOP_LEFT_EDGE;
@@ -143,18 +244,87 @@ void lcd_place_message(char** messages, int length, lcd_location location){
                 y = BOTTOM_EDGE + (offset*i);
                 break;
             default:    //Center
-                x = getCenter(messages[i]);
+                x = getCenter(message);
                 y = CENTER + (offset*i);
                 break;
             }
+        if (x < 0) {
+            x = 0;
+        }
 
-        message_size curr_size = get_message_size(messages[i]);
-        Paint_DrawString_EN(x, y, messages[i], &Font16, WHITE, BLACK);
-        LCD_1IN54_DisplayWindows(x-x_clear, y, x+curr_size.x+30, y+curr_size.y, s_fb);
-       
+        Paint_DrawString_EN(x, y, message, &Font16, WHITE, BLACK);
+        if (y < *top) {
+            *top = y;
+        }
+        if (y + FONT_REGULAR_HEIGHT > *bottom) {
+            *bottom = y + FONT_REGULAR_HEIGHT;
+        }
+    }
+    if (*bottom > LCD_1IN54_HEIGHT) {
+        *bottom = LCD_1IN54_HEIGHT;
     }
-    return;
 }
 
+static void* render_thread(void* arg)
+{
+    (void)arg;
+    lcd_scene scene;
+    while (true) {
+        pthread_mutex_lock(&s_sceneMutex);
+        while (!s_hasPending && !s_stopping) {
+            pthread_cond_wait(&s_sceneCond, &s_sceneMutex);
+        }
+        if (!s_hasPending) {
+            pthread_mutex_unlock(&s_sceneMutex);
+            break;
+        }
+        scene = s_pending;
+        s_hasPending = false;
+        pthread_mutex_unlock(&s_sceneMutex);
+
+        long long startNs = getTimeInNs();
+        Trace_begin("lcd_frame");
+        Trace_flowEnd("frame", scene.trace_flow);
+        UWORD* fb = s_buffers[s_back];
+        int top = 0;
+        int bottom = 0;
+        Trace_begin("lcd_render");
+        render_scene(&scene, fb, &top, &bottom);
+        Trace_end();
+        long long renderedNs = getTimeInNs();
+
+        // Repaint every row that held text before or holds text now
+        int flushTop = top < s_prevTop ? top : s_prevTop;
+        int flushBottom = bottom > s_prevBottom ? bottom : s_prevBottom;
+        if (scene.clear_only) {
+            flushTop = 0;
+            flushBottom = LCD_1IN54_HEIGHT;
+        }
+        if (flushBottom > flushTop) {
+            Trace_begin("lcd_flush");
+            LCD_1IN54_DisplayWindows(0, flushTop, LCD_1IN54_WIDTH, flushBottom, fb);
+            Trace_end();
+        }
+        Trace_end();
+        long long doneNs = getTimeInNs();
 
+        s_prevTop = top;
+        s_prevBottom = bottom;
+        s_back ^= 1;
 
+        double renderMs = (renderedNs - startNs) / 1000000.0;
+        double flushMs = (doneNs - renderedNs) / 1000000.0;
+        double frameMs = (doneNs - startNs) / 1000000.0;
+        pthread_mutex_lock(&s_sceneMutex);
+        s_stats.frames_rendered++;
+        s_stats.last_render_ms = renderMs;
+        s_stats.last_flush_ms = flushMs;
+        s_stats.last_frame_ms = frameMs;
+        s_stats.total_frame_ms += frameMs;
+        if (frameMs > s_stats.max_frame_ms) {
+            s_stats.max_frame_ms = frameMs;
+        }
+        pthread_mutex_unlock(&s_sceneMutex);
+    }
+    return NULL;
+}
@@ -17,13 +17,37 @@ typedef enum {
 typedef enum{
     font_regular,
 }font_size;
+//Frame timing collected by the render thread.
+//Updates that were replaced by a newer one before being drawn are counted
+//in updates_coalesced (latest wins, the older one is never drawn).
+typedef struct {
+    unsigned long updates_posted;
+    unsigned long updates_coalesced;
+    unsigned long frames_rendered;
+    double last_render_ms;
+    double last_flush_ms;
+    double last_frame_ms;
+    double max_frame_ms;
+    double total_frame_ms;
+    //SPI link totals since lcd_init; bytes_per_sec is measured while
+    //transferring, bus_bytes_per_sec is the SCLK limit for comparison
+    unsigned long long spi_bytes;
+    unsigned long long spi_messages;
+    double spi_bytes_per_sec;
+    double spi_bus_bytes_per_sec;
+} lcd_render_stats;
+
 //Module must be initialized before use and cleaned up after use
+//init starts a render thread which owns the panel and its two framebuffers
 void lcd_init(void);
 void lcd_cleanup(void);
 void lcd_clear_screen(void);
 //Takes in an array of strings and the length of the array,
 //And prints each message on a seperate row in order of the array
+//Does not block on SPI: the strings are copied and drawn by the render thread
 void lcd_place_message(char** messages, int length, lcd_location location);
+//Copies the render thread's frame statistics into stats
+void lcd_get_render_stats(lcd_render_stats* stats);
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,511 @@
+#define _GNU_SOURCE
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+// Bytes the writer gathers before each write()
+#define BATCH_SIZE 8192
+// The writer also wakes this often, in case a wake-up was missed
+#define WRITER_POLL_MS 1000
+
+// Position pos uses slot pos % LOG_QUEUE_SIZE on lap pos / LOG_QUEUE_SIZE.
+// The slot is free for that lap when seq == 2 * lap and holds its message
+// when seq == 2 * lap + 1, so the all-zero ring starts out free (a bounded
+// MPSC queue in the style of D. Vyukov's).
+typedef struct {
+    atomic_ullong seq;
+    long long timeNs;               // CLOCK_REALTIME
+    unsigned char level;
+    unsigned char category;
+    unsigned short length;
+    char text[LOG_MAX_MESSAGE];
+} logSlot_t;
+
+typedef struct {
+    atomic_uintptr_t key;           // The format string; 0 while unused
+    atomic_flag lock;
+    double tokens;
+    long long lastNs;
+    unsigned int suppressed;
+} limiter_t;
+
+static const char *const s_levelNames[LOG_NUM_LEVELS] = { "debug", "info", "warn", "error" };
+static const char s_levelLetters[LOG_NUM_LEVELS] = { 'D', 'I', 'W', 'E' };
+static const char *const s_categoryNames[LOG_NUM_CATEGORIES] = {
+    "main", "gesture", "hand", "network", "game", "display", "audio", "input"
+};
+
+static logSlot_t s_ring[LOG_QUEUE_SIZE];
+static atomic_ullong s_head = 0;    // Next position to claim
+static unsigned long long s_tail = 0;   // Next position to write out (writer only)
+static atomic_int s_levels[LOG_NUM_CATEGORIES] = {
+    LOG_LEVEL_INFO, LOG_LEVEL_INFO, LOG_LEVEL_INFO, LOG_LEVEL_INFO,
+    LOG_LEVEL_INFO, LOG_LEVEL_INFO, LOG_LEVEL_INFO, LOG_LEVEL_INFO,
+};
+_Static_assert(LOG_NUM_CATEGORIES == 8, "s_levels needs a default for every category");
+static limiter_t s_limiters[LOG_MAX_LIMITERS];
+
+static atomic_bool s_running = false;
+static atomic_bool s_writerSleeping = false;
+static int s_wakeFd = -1;
+static pthread_t s_writerThread;
+static atomic_int s_fileFd = -1;
+
+static atomic_ullong s_written = 0;
+static atomic_ullong s_dropped = 0;
+static atomic_ullong s_suppressed = 0;
+
+static unsigned long long lapOf(unsigned long long pos)
+{
+    return pos / LOG_QUEUE_SIZE;
+}
+
+static long long realtimeNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static long long monotonicNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void writeAll(int fd, const char *pData, size_t size)
+{
+    while (size > 0) {
+        ssize_t written = write(fd, pData, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        pData += written;
+        size -= written;
+    }
+}
+
+// Append one message to the console and file batches, writing them out
+// when full
+static void formatRecord(const logSlot_t *pSlot, char *consoleBatch, size_t *pConsoleUsed,
+        char *fileBatch, size_t *pFileUsed, int fileFd)
+{
+    if (*pConsoleUsed + pSlot->length + 1 > BATCH_SIZE) {
+        writeAll(STDOUT_FILENO, consoleBatch, *pConsoleUsed);
+        *pConsoleUsed = 0;
+    }
+    memcpy(consoleBatch + *pConsoleUsed, pSlot->text, pSlot->length);
+    *pConsoleUsed += pSlot->length;
+    consoleBatch[(*pConsoleUsed)++] = '\n';
+
+    if (fileFd < 0) {
+        return;
+    }
+    // e.g. "2026-10-18 14:03:07.123 I gesture: ..."
+    char prefix[64];
+    time_t seconds = pSlot->timeNs / 1000000000LL;
+    struct tm local;
+    localtime_r(&seconds, &local);
+    size_t prefixLength = strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &local);
+    prefixLength += snprintf(prefix + prefixLength, sizeof(prefix) - prefixLength, ".%03d %c %s: ",
+            (int)(pSlot->timeNs / 1000000 % 1000), s_levelLetters[pSlot->level],
+            s_categoryNames[pSlot->category]);
+    if (*pFileUsed + prefixLength + pSlot->length + 1 > BATCH_SIZE) {
+        writeAll(fileFd, fileBatch, *pFileUsed);
+        *pFileUsed = 0;
+    }
+    memcpy(fileBatch + *pFileUsed, prefix, prefixLength);
+    *pFileUsed += prefixLength;
+    memcpy(fileBatch + *pFileUsed, pSlot->text, pSlot->length);
+    *pFileUsed += pSlot->length;
+    fileBatch[(*pFileUsed)++] = '\n';
+}
+
+// Write out everything published so far. Only the writer thread (or, with
+// no writer running, whoever holds s_drainMutex) may call this.
+static pthread_mutex_t s_drainMutex = PTHREAD_MUTEX_INITIALIZER;
+static int drain(void)
+{
+    static char consoleBatch[BATCH_SIZE];
+    static char fileBatch[BATCH_SIZE];
+    size_t consoleUsed = 0;
+    size_t fileUsed = 0;
+    int fileFd = atomic_load(&s_fileFd);
+    int count = 0;
+
+    while (true) {
+        logSlot_t *pSlot = &s_ring[s_tail % LOG_QUEUE_SIZE];
+        if (atomic_load_explicit(&pSlot->seq, memory_order_acquire) != 2 * lapOf(s_tail) + 1) {
+            break;
+        }
+        formatRecord(pSlot, consoleBatch, &consoleUsed, fileBatch, &fileUsed, fileFd);
+        atomic_store_explicit(&pSlot->seq, 2 * (lapOf(s_tail) + 1), memory_order_release);
+        s_tail++;
+        count++;
+    }
+    writeAll(STDOUT_FILENO, consoleBatch, consoleUsed);
+    if (fileFd >= 0) {
+        writeAll(fileFd, fileBatch, fileUsed);
+    }
+    atomic_fetch_add(&s_written, count);
+    return count;
+}
+
+static void *writerLoop(void *arg)
+{
+    (void)arg;
+    while (true) {
+        pthread_mutex_lock(&s_drainMutex);
+        drain();
+        pthread_mutex_unlock(&s_drainMutex);
+        if (!atomic_load(&s_running)) {
+            break;
+        }
+
+        // Announce the sleep, then look again: a message published before
+        // the announcement is seen here, one after it wakes us
+        atomic_store(&s_writerSleeping, true);
+        atomic_thread_fence(memory_order_seq_cst);
+        logSlot_t *pSlot = &s_ring[s_tail % LOG_QUEUE_SIZE];
+        if (atomic_load_explicit(&pSlot->seq, memory_order_acquire) != 2 * lapOf(s_tail) + 1 &&
+                atomic_load(&s_running)) {
+            struct pollfd pfd = { .fd = s_wakeFd, .events = POLLIN };
+            poll(&pfd, 1, WRITER_POLL_MS);
+            eventfd_t count;
+            eventfd_read(s_wakeFd, &count);
+        }
+        atomic_store(&s_writerSleeping, false);
+    }
+    return NULL;
+}
+
+static void wakeWriter(void)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&s_writerSleeping, memory_order_relaxed) &&
+            atomic_exchange(&s_writerSleeping, false)) {
+        eventfd_write(s_wakeFd, 1);
+    }
+}
+
+void Log_init(void)
+{
+    const char *setting = getenv("GESTURE_LOG");
+    if (setting != NULL && Log_configure(setting) != 0) {
+        fprintf(stderr, "Log: couldn't understand all of GESTURE_LOG=%s\n", setting);
+    }
+
+    s_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (s_wakeFd < 0) {
+        perror("ERROR: Log unable to create eventfd");
+        return;
+    }
+    atomic_store(&s_running, true);
+    if (pthread_create(&s_writerThread, NULL, writerLoop, NULL) != 0) {
+        fprintf(stderr, "ERROR: Log unable to start the writer thread\n");
+        atomic_store(&s_running, false);
+        close(s_wakeFd);
+        s_wakeFd = -1;
+        return;
+    }
+    pthread_setname_np(s_writerThread, "log_writer");
+}
+
+void Log_cleanup(void)
+{
+    if (atomic_exchange(&s_running, false)) {
+        eventfd_write(s_wakeFd, 1);
+        pthread_join(s_writerThread, NULL);
+        close(s_wakeFd);
+        s_wakeFd = -1;
+    }
+    // Anything logged while stopping
+    pthread_mutex_lock(&s_drainMutex);
+    drain();
+    pthread_mutex_unlock(&s_drainMutex);
+
+    int fileFd = atomic_exchange(&s_fileFd, -1);
+    if (fileFd >= 0) {
+        close(fileFd);
+    }
+}
+
+int Log_openFile(const char *fileName)
+{
+    int fd = open(fileName, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: Unable to open log file %s: %s\n", fileName, strerror(errno));
+        return -1;
+    }
+    int oldFd = atomic_exchange(&s_fileFd, fd);
+    if (oldFd >= 0) {
+        // The writer may still be using it for the current batch
+        pthread_mutex_lock(&s_drainMutex);
+        close(oldFd);
+        pthread_mutex_unlock(&s_drainMutex);
+    }
+    return 0;
+}
+
+void Log_setLevel(enum Log_category category, enum Log_level level)
+{
+    if (category >= 0 && category < LOG_NUM_CATEGORIES) {
+        atomic_store_explicit(&s_levels[category], level, memory_order_relaxed);
+    }
+}
+
+void Log_setAllLevels(enum Log_level level)
+{
+    for (int i = 0; i < LOG_NUM_CATEGORIES; i++) {
+        Log_setLevel((enum Log_category)i, level);
+    }
+}
+
+enum Log_level Log_getLevel(enum Log_category category)
+{
+    return (enum Log_level)atomic_load_explicit(&s_levels[category], memory_order_relaxed);
+}
+
+bool Log_isEnabled(enum Log_category category, enum Log_level level)
+{
+    return (int)level >= atomic_load_explicit(&s_levels[category], memory_order_relaxed);
+}
+
+static int parseLevel(const char *name, size_t length)
+{
+    for (int i = 0; i < LOG_NUM_LEVELS; i++) {
+        if (strlen(s_levelNames[i]) == length && strncmp(name, s_levelNames[i], length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int Log_configure(const char *setting)
+{
+    int result = 0;
+    const char *p = setting;
+    while (*p != '\0') {
+        size_t length = strcspn(p, ",");
+        const char *equals = memchr(p, '=', length);
+        if (equals == NULL) {
+            // A bare level applies to every category
+            int level = parseLevel(p, length);
+            if (level < 0) {
+                result = -1;
+            } else {
+                Log_setAllLevels((enum Log_level)level);
+            }
+        } else {
+            int category = -1;
+            for (int i = 0; i < LOG_NUM_CATEGORIES; i++) {
+                if (strlen(s_categoryNames[i]) == (size_t)(equals - p) &&
+                        strncmp(p, s_categoryNames[i], equals - p) == 0) {
+                    category = i;
+                }
+            }
+            int level = parseLevel(equals + 1, p + length - equals - 1);
+            if (category < 0 || level < 0) {
+                result = -1;
+            } else {
+                Log_setLevel((enum Log_category)category, (enum Log_level)level);
+            }
+        }
+        p += length;
+        if (*p == ',') {
+            p++;
+        }
+    }
+    return result;
+}
+
+// Format into the next free slot, or count the message as dropped
+static void enqueue(enum Log_category category, enum Log_level level, unsigned int suppressed,
+        const char *format, va_list args)
+{
+    logSlot_t *pSlot;
+    unsigned long long pos = atomic_load_explicit(&s_head, memory_order_relaxed);
+    while (true) {
+        pSlot = &s_ring[pos % LOG_QUEUE_SIZE];
+        unsigned long long seq = atomic_load_explicit(&pSlot->seq, memory_order_acquire);
+        if (seq == 2 * lapOf(pos)) {
+            if (atomic_compare_exchange_weak_explicit(&s_head, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (seq < 2 * lapOf(pos)) {
+            // The writer hasn't freed this slot yet: the ring is full
+            atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+            return;
+        } else {
+            pos = atomic_load_explicit(&s_head, memory_order_relaxed);
+        }
+    }
+
+    pSlot->timeNs = realtimeNs();
+    pSlot->level = level;
+    pSlot->category = category;
+    int length = vsnprintf(pSlot->text, LOG_MAX_MESSAGE, format, args);
+    if (length < 0) {
+        length = 0;
+    } else if (length >= LOG_MAX_MESSAGE) {
+        length = LOG_MAX_MESSAGE - 1;
+    }
+    if (suppressed > 0 && length < LOG_MAX_MESSAGE - 1) {
+        int extra = snprintf(pSlot->text + length, LOG_MAX_MESSAGE - length,
+                " (%u more suppressed)", suppressed);
+        length = extra < LOG_MAX_MESSAGE - length ? length + extra : LOG_MAX_MESSAGE - 1;
+    }
+    pSlot->length = length;
+    atomic_store_explicit(&pSlot->seq, 2 * lapOf(pos) + 1, memory_order_release);
+}
+
+static void writeMessage(enum Log_category category, enum Log_level level, unsigned int suppressed,
+        const char *format, va_list args)
+{
+    if (category < 0 || category >= LOG_NUM_CATEGORIES || level < 0 || level >= LOG_NUM_LEVELS) {
+        return;
+    }
+    enqueue(category, level, suppressed, format, args);
+    if (atomic_load_explicit(&s_running, memory_order_acquire)) {
+        wakeWriter();
+    } else {
+        // No writer: write it out now
+        pthread_mutex_lock(&s_drainMutex);
+        drain();
+        pthread_mutex_unlock(&s_drainMutex);
+    }
+}
+
+void Log_write(enum Log_category category, enum Log_level level, const char *format, ...)
+{
+    if (!Log_isEnabled(category, level)) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    writeMessage(category, level, 0, format, args);
+    va_end(args);
+}
+
+static limiter_t *findLimiter(const char *format, int burst)
+{
+    uintptr_t key = (uintptr_t)format;
+    for (int probe = 0; probe < LOG_MAX_LIMITERS; probe++) {
+        limiter_t *pLimiter = &s_limiters[(key / sizeof(void *) + probe) % LOG_MAX_LIMITERS];
+        uintptr_t current = atomic_load_explicit(&pLimiter->key, memory_order_acquire);
+        if (current == key) {
+            return pLimiter;
+        }
+        if (current == 0) {
+            // Claim it; the bucket starts full
+            while (atomic_flag_test_and_set_explicit(&pLimiter->lock, memory_order_acquire)) {
+            }
+            uintptr_t expected = 0;
+            bool claimed = atomic_load_explicit(&pLimiter->key, memory_order_relaxed) == 0;
+            if (claimed) {
+                pLimiter->tokens = burst;
+                pLimiter->lastNs = monotonicNs();
+                pLimiter->suppressed = 0;
+                atomic_compare_exchange_strong(&pLimiter->key, &expected, key);
+            }
+            atomic_flag_clear_explicit(&pLimiter->lock, memory_order_release);
+            if (atomic_load_explicit(&pLimiter->key, memory_order_acquire) == key) {
+                return pLimiter;
+            }
+        }
+    }
+    return NULL;
+}
+
+void Log_writeLimited(enum Log_category category, enum Log_level level,
+        double perSecond, int burst, const char *format, ...)
+{
+    if (!Log_isEnabled(category, level)) {
+        return;
+    }
+    unsigned int suppressed = 0;
+    limiter_t *pLimiter = findLimiter(format, burst);
+    if (pLimiter != NULL) {
+        while (atomic_flag_test_and_set_explicit(&pLimiter->lock, memory_order_acquire)) {
+        }
+        long long nowNs = monotonicNs();
+        pLimiter->tokens += (nowNs - pLimiter->lastNs) / 1e9 * perSecond;
+        if (pLimiter->tokens > burst) {
+            pLimiter->tokens = burst;
+        }
+        pLimiter->lastNs = nowNs;
+        bool allowed = pLimiter->tokens >= 1.0;
+        if (allowed) {
+            pLimiter->tokens -= 1.0;
+            suppressed = pLimiter->suppressed;
+            pLimiter->suppressed = 0;
+        } else {
+            pLimiter->suppressed++;
+        }
+        atomic_flag_clear_explicit(&pLimiter->lock, memory_order_release);
+        if (!allowed) {
+            atomic_fetch_add_explicit(&s_suppressed, 1, memory_order_relaxed);
+            return;
+        }
+    }
+    va_list args;
+    va_start(args, format);
+    writeMessage(category, level, suppressed, format, args);
+    va_end(args);
+}
+
+bool Log_flush(int timeoutMs)
+{
+    unsigned long long target = atomic_load(&s_head);
+    long long deadlineNs = monotonicNs() + timeoutMs * 1000000LL;
+    while (true) {
+        pthread_mutex_lock(&s_drainMutex);
+        bool done = s_tail >= target;
+        if (!done && !atomic_load(&s_running)) {
+            drain();
+            done = s_tail >= target;
+        }
+        pthread_mutex_unlock(&s_drainMutex);
+        if (done) {
+            return true;
+        }
+        if (monotonicNs() >= deadlineNs) {
+            return false;
+        }
+        wakeWriter();
+        usleep(1000);
+    }
+}
+
+void Log_getStats(Log_stats_t *pStats)
+{
+    pStats->written = atomic_load(&s_written);
+    pStats->dropped = atomic_load(&s_dropped);
+    pStats->suppressed = atomic_load(&s_suppressed);
+}
+
+const char *Log_levelName(enum Log_level level)
+{
+    return level >= 0 && level < LOG_NUM_LEVELS ? s_levelNames[level] : "?";
+}
+
+const char *Log_categoryName(enum Log_category category)
+{
+    return category >= 0 && category < LOG_NUM_CATEGORIES ? s_categoryNames[category] : "?";
+}
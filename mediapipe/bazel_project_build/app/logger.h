@@ -0,0 +1,124 @@
+// Levelled log messages per module, written by a background thread so the
+// code that logs never waits on the console (a serial console can take
+// milliseconds per line) or the log file.
+// Usage:
+//  - Log_write(LOG_CAT_GAME, LOG_LEVEL_INFO, "Round %d", round), or in C++
+//    LOG_LINE(LOG_CAT_GAME, LOG_LEVEL_INFO) << "Round " << round;
+//  - Messages that can repeat every frame go through Log_writeLimited(),
+//    which lets through at most `burst` at once and `perSecond` after that
+//    from each call site, and tells how many were held back.
+//  - Each category has its own level; messages below it cost one relaxed
+//    load. Set them with Log_setLevel() or GESTURE_LOG, e.g.
+//    GESTURE_LOG=debug or GESTURE_LOG=info,display=warn,gesture=debug.
+//
+// The message is formatted by the caller into a slot of one lock-free ring of
+// LOG_QUEUE_SIZE slots, and the writer thread copies whatever is queued to
+// stdout and the log file in batches. If the ring is full the message is
+// dropped and counted rather than waiting. Before Log_init() and after
+// Log_cleanup() messages are written straight away instead.
+#ifndef _LOGGER_H_
+#define _LOGGER_H_
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_QUEUE_SIZE 512
+// Longer messages are cut short
+#define LOG_MAX_MESSAGE 240
+// Call sites Log_writeLimited() keeps a bucket for; further ones aren't limited
+#define LOG_MAX_LIMITERS 64
+
+enum Log_level {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_NUM_LEVELS
+};
+
+enum Log_category {
+    LOG_CAT_MAIN,
+    LOG_CAT_GESTURE,                // GestureDetector and the camera
+    LOG_CAT_HAND,                   // hand_recognition and MediaPipe
+    LOG_CAT_NETWORK,                // WebSocket and server messages
+    LOG_CAT_GAME,                   // GameState and rooms
+    LOG_CAT_DISPLAY,                // DisplayManager and the LCD
+    LOG_CAT_AUDIO,
+    LOG_CAT_INPUT,
+    LOG_NUM_CATEGORIES
+};
+
+typedef struct {
+    unsigned long long written;     // Messages written out
+    unsigned long long dropped;     // Lost because the ring was full
+    unsigned long long suppressed;  // Held back by Log_writeLimited()
+} Log_stats_t;
+
+// Start the writer thread and apply GESTURE_LOG
+void Log_init(void);
+// Write out everything queued and stop the writer thread
+void Log_cleanup(void);
+
+// Also write every message to fileName (appended), with time, level and
+// category. Returns 0, or -1 if it can't be opened.
+int Log_openFile(const char *fileName);
+
+void Log_setLevel(enum Log_category category, enum Log_level level);
+void Log_setAllLevels(enum Log_level level);
+enum Log_level Log_getLevel(enum Log_category category);
+bool Log_isEnabled(enum Log_category category, enum Log_level level);
+// Apply a GESTURE_LOG style setting. Returns 0, or -1 if part of it wasn't
+// understood (the rest is still applied).
+int Log_configure(const char *setting);
+
+void Log_write(enum Log_category category, enum Log_level level, const char *format, ...)
+        __attribute__((format(printf, 3, 4)));
+// As Log_write(), through a token bucket per format string: up to burst
+// messages at once, refilled at perSecond
+void Log_writeLimited(enum Log_category category, enum Log_level level,
+        double perSecond, int burst, const char *format, ...)
+        __attribute__((format(printf, 5, 6)));
+
+// Wait up to timeoutMs for the writer to catch up with everything logged so
+// far. Returns false on timeout.
+bool Log_flush(int timeoutMs);
+
+void Log_getStats(Log_stats_t *pStats);
+
+const char *Log_levelName(enum Log_level level);
+const char *Log_categoryName(enum Log_category category);
+
+#ifdef __cplusplus
+}
+
+#include <sstream>
+
+// Collects one message with << and logs it when the statement ends
+class LogLine {
+public:
+    LogLine(enum Log_category category, enum Log_level level) : category(category), level(level) {}
+    ~LogLine() { Log_write(category, level, "%s", stream.str().c_str()); }
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    template <typename T>
+    LogLine& operator<<(const T& value) {
+        stream << value;
+        return *this;
+    }
+
+private:
+    enum Log_category category;
+    enum Log_level level;
+    std::ostringstream stream;
+};
+
+// Nothing after << is evaluated when the level is off
+#define LOG_LINE(category, level) \
+    if (!Log_isEnabled(category, level)) {} else LogLine(category, level)
+#endif
+
+#endif
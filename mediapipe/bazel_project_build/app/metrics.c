@@ -0,0 +1,492 @@
+#define _GNU_SOURCE
+#include "metrics.h"
+#include "periodTimer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+// How often the server thread checks whether it should stop
+#define POLL_INTERVAL_MS 250
+// Scrapers that don't send their request within this long are dropped
+#define REQUEST_TIMEOUT_S 1
+#define MAX_REQUEST_SIZE 1024
+
+typedef enum {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_SUMMARY,
+} metricType_t;
+
+typedef struct {
+    metricType_t type;
+    char name[METRICS_MAX_NAME];
+    char labels[METRICS_MAX_LABELS];
+    char *help;
+    atomic_ullong count;        // Counters: sum of Metrics_add()
+    atomic_ullong valueBits;    // Last Metrics_set() value's bit pattern
+    int eventId;                // Summaries: periodTimer event
+} metric_t;
+
+typedef struct {
+    Metrics_collector_t collector;
+    void *pContext;
+} collector_t;
+
+// Registration takes the lock; updates only need the metric to be published,
+// which happens when s_numMetrics is incremented (release) after it's filled.
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static metric_t s_metrics[METRICS_MAX_METRICS];
+static atomic_int s_numMetrics = 0;
+static collector_t s_collectors[METRICS_MAX_COLLECTORS];
+static int s_numCollectors = 0;
+
+static int s_listenFd = -1;
+static pthread_t s_serverThreadId;
+static atomic_bool s_stopping = false;
+
+
+static int registerMetric(metricType_t type, const char *name, const char *labels,
+        const char *help)
+{
+    if (labels == NULL) {
+        labels = "";
+    }
+    if (strlen(name) >= METRICS_MAX_NAME || strlen(labels) >= METRICS_MAX_LABELS) {
+        fprintf(stderr, "ERROR: Metric name %s{%s} is too long.\n", name, labels);
+        return -1;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    int numMetrics = atomic_load(&s_numMetrics);
+    for (int i = 0; i < numMetrics; i++) {
+        if (strcmp(s_metrics[i].name, name) == 0 && strcmp(s_metrics[i].labels, labels) == 0) {
+            pthread_mutex_unlock(&s_lock);
+            return s_metrics[i].type == type ? i : -1;
+        }
+    }
+    if (numMetrics == METRICS_MAX_METRICS) {
+        pthread_mutex_unlock(&s_lock);
+        fprintf(stderr, "ERROR: No room to register metric %s.\n", name);
+        return -1;
+    }
+
+    metric_t *pMetric = &s_metrics[numMetrics];
+    pMetric->type = type;
+    strcpy(pMetric->name, name);
+    strcpy(pMetric->labels, labels);
+    pMetric->help = strdup(help != NULL ? help : name);
+    atomic_init(&pMetric->count, 0);
+    atomic_init(&pMetric->valueBits, 0);
+    pMetric->eventId = -1;
+    if (type == METRIC_SUMMARY) {
+        char eventName[PERIOD_MAX_EVENT_NAME];
+        snprintf(eventName, sizeof(eventName), "metric_%d", numMetrics);
+        pMetric->eventId = Period_registerEvent(eventName);
+        if (pMetric->eventId < 0) {
+            free(pMetric->help);
+            pthread_mutex_unlock(&s_lock);
+            return -1;
+        }
+    }
+    atomic_store_explicit(&s_numMetrics, numMetrics + 1, memory_order_release);
+    pthread_mutex_unlock(&s_lock);
+    return numMetrics;
+}
+
+int Metrics_registerCounter(const char *name, const char *labels, const char *help)
+{
+    return registerMetric(METRIC_COUNTER, name, labels, help);
+}
+
+int Metrics_registerGauge(const char *name, const char *labels, const char *help)
+{
+    return registerMetric(METRIC_GAUGE, name, labels, help);
+}
+
+int Metrics_registerSummary(const char *name, const char *labels, const char *help)
+{
+    return registerMetric(METRIC_SUMMARY, name, labels, help);
+}
+
+static metric_t *getMetric(int metricId)
+{
+    if (metricId < 0 || metricId >= atomic_load_explicit(&s_numMetrics, memory_order_acquire)) {
+        return NULL;
+    }
+    return &s_metrics[metricId];
+}
+
+void Metrics_add(int metricId, unsigned long long amount)
+{
+    metric_t *pMetric = getMetric(metricId);
+    if (pMetric != NULL) {
+        atomic_fetch_add_explicit(&pMetric->count, amount, memory_order_relaxed);
+    }
+}
+
+void Metrics_set(int metricId, double value)
+{
+    metric_t *pMetric = getMetric(metricId);
+    if (pMetric == NULL) {
+        return;
+    }
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    atomic_store_explicit(&pMetric->valueBits, bits, memory_order_relaxed);
+}
+
+void Metrics_observe(int metricId, double value)
+{
+    metric_t *pMetric = getMetric(metricId);
+    if (pMetric != NULL && pMetric->type == METRIC_SUMMARY) {
+        Period_markWithValue(pMetric->eventId, value > 0 ? value : 0);
+    }
+}
+
+void Metrics_addCollector(Metrics_collector_t collector, void *pContext)
+{
+    pthread_mutex_lock(&s_lock);
+    if (s_numCollectors < METRICS_MAX_COLLECTORS) {
+        s_collectors[s_numCollectors].collector = collector;
+        s_collectors[s_numCollectors].pContext = pContext;
+        s_numCollectors++;
+    } else {
+        fprintf(stderr, "ERROR: No room for another metrics collector.\n");
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+
+// Process metrics, read from /proc/self only when rendering
+static pthread_once_t s_processOnce = PTHREAD_ONCE_INIT;
+static int s_cpuMetric = -1;
+static int s_rssMetric = -1;
+static int s_threadsMetric = -1;
+
+static void registerProcessMetrics(void)
+{
+    s_cpuMetric = Metrics_registerCounter("process_cpu_seconds_total", NULL,
+            "User and system CPU time of this process in seconds.");
+    s_rssMetric = Metrics_registerGauge("process_resident_memory_bytes", NULL,
+            "Resident set size of this process in bytes.");
+    s_threadsMetric = Metrics_registerGauge("process_threads", NULL,
+            "Number of threads in this process.");
+}
+
+static void collectProcessMetrics(void)
+{
+    pthread_once(&s_processOnce, registerProcessMetrics);
+
+    char stat[1024];
+    FILE *pFile = fopen("/proc/self/stat", "r");
+    if (pFile == NULL) {
+        return;
+    }
+    size_t length = fread(stat, 1, sizeof(stat) - 1, pFile);
+    fclose(pFile);
+    stat[length] = '\0';
+
+    // Fields after the command name (which may contain spaces), starting
+    // with field 3 (state): utime is 14, stime 15, num_threads 20, rss 24
+    const char *pFields = strrchr(stat, ')');
+    unsigned long utime = 0;
+    unsigned long stime = 0;
+    long numThreads = 0;
+    long rssPages = 0;
+    if (pFields == NULL || sscanf(pFields + 1,
+            " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %*d %*d %*d %*d %ld %*d %*s %*s %ld",
+            &utime, &stime, &numThreads, &rssPages) != 4) {
+        return;
+    }
+    Metrics_set(s_cpuMetric, (double)(utime + stime) / sysconf(_SC_CLK_TCK));
+    Metrics_set(s_rssMetric, (double)rssPages * sysconf(_SC_PAGESIZE));
+    Metrics_set(s_threadsMetric, numThreads);
+}
+
+
+typedef struct {
+    char *pData;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} buffer_t;
+
+static void appendf(buffer_t *pBuffer, const char *format, ...)
+{
+    if (pBuffer->failed) {
+        return;
+    }
+    while (true) {
+        va_list args;
+        va_start(args, format);
+        size_t space = pBuffer->capacity - pBuffer->length;
+        int needed = vsnprintf(pBuffer->pData + pBuffer->length, space, format, args);
+        va_end(args);
+        if (needed < 0) {
+            pBuffer->failed = true;
+            return;
+        }
+        if ((size_t)needed < space) {
+            pBuffer->length += needed;
+            return;
+        }
+        size_t capacity = pBuffer->capacity * 2 + needed;
+        char *pData = realloc(pBuffer->pData, capacity);
+        if (pData == NULL) {
+            pBuffer->failed = true;
+            return;
+        }
+        pBuffer->pData = pData;
+        pBuffer->capacity = capacity;
+    }
+}
+
+// One sample line: name[suffix]{labels[,extra]} value
+static void appendSample(buffer_t *pBuffer, const metric_t *pMetric, const char *suffix,
+        const char *extraLabel, double value)
+{
+    const char *labels = pMetric->labels;
+    bool hasLabels = labels[0] != '\0';
+    bool hasExtra = extraLabel != NULL;
+    appendf(pBuffer, "%s%s%s%s%s%s%s %.10g\n",
+            pMetric->name, suffix,
+            hasLabels || hasExtra ? "{" : "",
+            labels,
+            hasLabels && hasExtra ? "," : "",
+            hasExtra ? extraLabel : "",
+            hasLabels || hasExtra ? "}" : "",
+            value);
+}
+
+static double loadDouble(const atomic_ullong *pBits)
+{
+    unsigned long long bits = atomic_load_explicit(pBits, memory_order_relaxed);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// The samples of one label set
+static void appendMetric(buffer_t *pBuffer, int metricId)
+{
+    const metric_t *pMetric = &s_metrics[metricId];
+    switch (pMetric->type) {
+    case METRIC_COUNTER:
+        // Whatever was added, plus any total mirrored with Metrics_set()
+        appendSample(pBuffer, pMetric, "", NULL,
+                (double)atomic_load_explicit(&pMetric->count, memory_order_relaxed) +
+                loadDouble(&pMetric->valueBits));
+        break;
+    case METRIC_GAUGE:
+        appendSample(pBuffer, pMetric, "", NULL, loadDouble(&pMetric->valueBits));
+        break;
+    case METRIC_SUMMARY: {
+        Period_snapshot_t snapshot;
+        Period_snapshot(pMetric->eventId, &snapshot);
+        const Period_distribution_t *pValue = &snapshot.value;
+        appendSample(pBuffer, pMetric, "", "quantile=\"0.5\"", pValue->p50);
+        appendSample(pBuffer, pMetric, "", "quantile=\"0.9\"", pValue->p90);
+        appendSample(pBuffer, pMetric, "", "quantile=\"0.99\"", pValue->p99);
+        appendSample(pBuffer, pMetric, "_sum", NULL, pValue->mean * pValue->count);
+        appendSample(pBuffer, pMetric, "_count", NULL, (double)pValue->count);
+        break;
+    }
+    }
+}
+
+char *Metrics_render(void)
+{
+    collector_t collectors[METRICS_MAX_COLLECTORS];
+    pthread_mutex_lock(&s_lock);
+    int numCollectors = s_numCollectors;
+    memcpy(collectors, s_collectors, numCollectors * sizeof(collectors[0]));
+    pthread_mutex_unlock(&s_lock);
+
+    // Collectors may take their own locks; don't hold ours while they run
+    for (int i = 0; i < numCollectors; i++) {
+        collectors[i].collector(collectors[i].pContext);
+    }
+    collectProcessMetrics();
+
+    buffer_t buffer = { .pData = malloc(4096), .length = 0, .capacity = 4096, .failed = false };
+    if (buffer.pData == NULL) {
+        return NULL;
+    }
+    buffer.pData[0] = '\0';
+    // A name's label sets may be registered far apart, but the text format
+    // wants each family in one block: HELP and TYPE, then every label set
+    static const char *const typeNames[] = { "counter", "gauge", "summary" };
+    int numMetrics = atomic_load_explicit(&s_numMetrics, memory_order_acquire);
+    for (int i = 0; i < numMetrics; i++) {
+        const metric_t *pMetric = &s_metrics[i];
+        bool firstOfName = true;
+        for (int j = 0; j < i && firstOfName; j++) {
+            firstOfName = strcmp(s_metrics[j].name, pMetric->name) != 0;
+        }
+        if (!firstOfName) {
+            continue;
+        }
+        appendf(&buffer, "# HELP %s %s\n# TYPE %s %s\n",
+                pMetric->name, pMetric->help, pMetric->name, typeNames[pMetric->type]);
+        for (int j = i; j < numMetrics; j++) {
+            if (strcmp(s_metrics[j].name, pMetric->name) == 0) {
+                appendMetric(&buffer, j);
+            }
+        }
+    }
+    if (buffer.failed) {
+        free(buffer.pData);
+        return NULL;
+    }
+    return buffer.pData;
+}
+
+
+static bool writeAll(int fd, const char *pData, size_t size)
+{
+    while (size > 0) {
+        ssize_t written = send(fd, pData, size, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        pData += written;
+        size -= written;
+    }
+    return true;
+}
+
+// Answer one HTTP/1.0-style request and close the connection
+static void serveClient(int clientFd)
+{
+    struct timeval timeout = { .tv_sec = REQUEST_TIMEOUT_S, .tv_usec = 0 };
+    setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(clientFd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // Only the request line matters; read until the end of the headers
+    char request[MAX_REQUEST_SIZE];
+    size_t length = 0;
+    while (length < sizeof(request) - 1) {
+        ssize_t received = recv(clientFd, request + length, sizeof(request) - 1 - length, 0);
+        if (received <= 0) {
+            break;
+        }
+        length += received;
+        request[length] = '\0';
+        if (strstr(request, "\r\n\r\n") != NULL || strstr(request, "\n\n") != NULL) {
+            break;
+        }
+    }
+    request[length] = '\0';
+
+    char header[256];
+    char *pBody = NULL;
+    if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0) {
+        pBody = Metrics_render();
+    }
+    if (pBody != NULL) {
+        size_t bodyLength = strlen(pBody);
+        int headerLength = snprintf(header, sizeof(header),
+                "HTTP/1.0 200 OK\r\n"
+                "Content-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: %zu\r\n"
+                "Connection: close\r\n\r\n", bodyLength);
+        if (writeAll(clientFd, header, headerLength)) {
+            writeAll(clientFd, pBody, bodyLength);
+        }
+        free(pBody);
+    } else {
+        int headerLength = snprintf(header, sizeof(header),
+                "HTTP/1.0 404 Not Found\r\n"
+                "Content-Length: 0\r\n"
+                "Connection: close\r\n\r\n");
+        writeAll(clientFd, header, headerLength);
+    }
+    close(clientFd);
+}
+
+static void *serverThread(void *arg)
+{
+    (void)arg;
+    struct pollfd listenPoll = { .fd = s_listenFd, .events = POLLIN };
+    while (!atomic_load(&s_stopping)) {
+        int ready = poll(&listenPoll, 1, POLL_INTERVAL_MS);
+        if (ready <= 0) {
+            continue;
+        }
+        int clientFd = accept(s_listenFd, NULL, NULL);
+        if (clientFd >= 0) {
+            serveClient(clientFd);
+        }
+    }
+    return NULL;
+}
+
+void Metrics_init(void)
+{
+    int port = METRICS_DEFAULT_PORT;
+    const char *portText = getenv("METRICS_PORT");
+    if (portText != NULL) {
+        port = atoi(portText);
+    }
+    if (port <= 0 || port > 65535) {
+        printf("Metrics server disabled.\n");
+        return;
+    }
+
+    s_listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (s_listenFd < 0) {
+        fprintf(stderr, "ERROR: Unable to create metrics socket: %s\n", strerror(errno));
+        return;
+    }
+    int reuse = 1;
+    setsockopt(s_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Loopback only: reach it from elsewhere through an SSH tunnel
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(s_listenFd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+            listen(s_listenFd, 4) != 0) {
+        fprintf(stderr, "ERROR: Unable to serve metrics on port %d: %s\n", port, strerror(errno));
+        close(s_listenFd);
+        s_listenFd = -1;
+        return;
+    }
+
+    atomic_store(&s_stopping, false);
+    if (pthread_create(&s_serverThreadId, NULL, serverThread, NULL) != 0) {
+        fprintf(stderr, "ERROR: Unable to start metrics thread.\n");
+        close(s_listenFd);
+        s_listenFd = -1;
+        return;
+    }
+    pthread_setname_np(s_serverThreadId, "metrics");
+    printf("Serving metrics on http://127.0.0.1:%d/metrics\n", port);
+}
+
+void Metrics_cleanup(void)
+{
+    if (s_listenFd < 0) {
+        return;
+    }
+    atomic_store(&s_stopping, true);
+    pthread_join(s_serverThreadId, NULL);
+    close(s_listenFd);
+    s_listenFd = -1;
+}
@@ -0,0 +1,63 @@
+// Registry of run-time metrics (counters, gauges and latency summaries),
+// served in Prometheus text format on a loopback HTTP port so the board can
+// be watched while it runs:
+//     curl http://127.0.0.1:9464/metrics
+// Updating a metric is a relaxed atomic add/store (summaries go through the
+// lock-free periodTimer histograms), and all formatting happens when somebody
+// reads them, so instrumentation can stay enabled in production.
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define METRICS_MAX_METRICS 64
+#define METRICS_MAX_NAME 48
+#define METRICS_MAX_LABELS 48
+#define METRICS_MAX_COLLECTORS 8
+
+// Port used when METRICS_PORT isn't set; METRICS_PORT=0 disables the server
+#define METRICS_DEFAULT_PORT 9464
+
+// Start/stop the HTTP server thread. The registry itself works without
+// init(), but summaries are kept by the periodTimer module, so
+// Period_init() must have been called before any are registered and
+// Period_cleanup() must come after Metrics_cleanup().
+void Metrics_init(void);
+void Metrics_cleanup(void);
+
+// Register a metric and return its id; registering the same name and labels
+// again returns the same id. labels is NULL or a Prometheus label list
+// without braces, e.g. "stage=\"capture\"". Returns -1 if the registry is
+// full, and every update function ignores an id of -1, so callers don't
+// need to check.
+//  - Counters only go up (Metrics_add), or mirror a total kept elsewhere
+//    (Metrics_set from a collector).
+//  - Gauges hold the last value given to Metrics_set.
+//  - Summaries record every Metrics_observe value (e.g. a latency in ms)
+//    and are reported as count, sum and p50/p90/p99 since startup.
+int Metrics_registerCounter(const char *name, const char *labels, const char *help);
+int Metrics_registerGauge(const char *name, const char *labels, const char *help);
+int Metrics_registerSummary(const char *name, const char *labels, const char *help);
+
+void Metrics_add(int metricId, unsigned long long amount);
+void Metrics_set(int metricId, double value);
+void Metrics_observe(int metricId, double value);
+
+// Collectors are called (on the reading thread) at the start of every
+// Metrics_render(), to Metrics_set values that are cheaper to pull than to
+// push, such as another module's statistics.
+typedef void (*Metrics_collector_t)(void *pContext);
+void Metrics_addCollector(Metrics_collector_t collector, void *pContext);
+
+// Run the collectors, refresh the process_* metrics (CPU time, RSS, threads)
+// and return everything in Prometheus text format. The string is malloc'd;
+// the caller frees it. Returns NULL if out of memory.
+char *Metrics_render(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,144 @@
+#include "mixKernel.h"
+
+#include <limits.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static inline short saturate(int value)
+{
+    return (short)(value > SHRT_MAX ? SHRT_MAX : (value < SHRT_MIN ? SHRT_MIN : value));
+}
+
+void MixKernel_accumulateScalar(short *dst, const short *src, int count)
+{
+    for (int i = 0; i < count; i++) {
+        dst[i] = saturate(dst[i] + src[i]);
+    }
+}
+
+static inline int applyGain(int sample, int gain)
+{
+    return (sample * gain + 0x4000) >> 15;
+}
+
+// Gain for sample i of a ramp over count samples
+static inline int rampGain(int gainStart, int gainEnd, int i, int count)
+{
+    return gainStart + (int)((long long)(gainEnd - gainStart) * i / count);
+}
+
+#if defined(__ARM_NEON)
+// vqrdmulh computes (2ab + 0x8000) >> 16, i.e. applyGain() for gain < 0x8000
+static inline int16x8_t scale8(int16x8_t samples, short gain)
+{
+    return vqrdmulhq_n_s16(samples, gain);
+}
+#elif defined(__SSE2__)
+static inline __m128i scale8(__m128i samples, __m128i gain)
+{
+    __m128i lo = _mm_mullo_epi16(samples, gain);
+    __m128i hi = _mm_mulhi_epi16(samples, gain);
+    __m128i round = _mm_set1_epi32(0x4000);
+    __m128i p0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), 15);
+    __m128i p1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), 15);
+    return _mm_packs_epi32(p0, p1);
+}
+#endif
+
+void MixKernel_accumulateGain(short *dst, const short *src, int count,
+        int gainStart, int gainEnd)
+{
+    if (gainStart != gainEnd) {
+        for (int i = 0; i < count; i++) {
+            int gain = rampGain(gainStart, gainEnd, i, count);
+            dst[i] = saturate(dst[i] + applyGain(src[i], gain));
+        }
+        return;
+    }
+    if (gainStart >= MIXKERNEL_UNITY_GAIN) {
+        MixKernel_accumulate(dst, src, count);
+        return;
+    }
+
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t scaled = scale8(vld1q_s16(src + i), (short)gainStart);
+        vst1q_s16(dst + i, vqaddq_s16(vld1q_s16(dst + i), scaled));
+    }
+#elif defined(__SSE2__)
+    __m128i gain = _mm_set1_epi16((short)gainStart);
+    for (; i + 8 <= count; i += 8) {
+        __m128i scaled = scale8(_mm_loadu_si128((const __m128i *)(src + i)), gain);
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_adds_epi16(a, scaled));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = saturate(dst[i] + applyGain(src[i], gainStart));
+    }
+}
+
+void MixKernel_scale(short *buf, int count, int gainStart, int gainEnd)
+{
+    if (gainStart != gainEnd) {
+        for (int i = 0; i < count; i++) {
+            buf[i] = (short)applyGain(buf[i], rampGain(gainStart, gainEnd, i, count));
+        }
+        return;
+    }
+    if (gainStart >= MIXKERNEL_UNITY_GAIN) {
+        return;
+    }
+
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 8 <= count; i += 8) {
+        vst1q_s16(buf + i, scale8(vld1q_s16(buf + i), (short)gainStart));
+    }
+#elif defined(__SSE2__)
+    __m128i gain = _mm_set1_epi16((short)gainStart);
+    for (; i + 8 <= count; i += 8) {
+        __m128i samples = _mm_loadu_si128((const __m128i *)(buf + i));
+        _mm_storeu_si128((__m128i *)(buf + i), scale8(samples, gain));
+    }
+#endif
+    for (; i < count; i++) {
+        buf[i] = (short)applyGain(buf[i], gainStart);
+    }
+}
+
+void MixKernel_accumulate(short *dst, const short *src, int count)
+{
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 32 <= count; i += 32) {
+        vst1q_s16(dst + i,      vqaddq_s16(vld1q_s16(dst + i),      vld1q_s16(src + i)));
+        vst1q_s16(dst + i + 8,  vqaddq_s16(vld1q_s16(dst + i + 8),  vld1q_s16(src + i + 8)));
+        vst1q_s16(dst + i + 16, vqaddq_s16(vld1q_s16(dst + i + 16), vld1q_s16(src + i + 16)));
+        vst1q_s16(dst + i + 24, vqaddq_s16(vld1q_s16(dst + i + 24), vld1q_s16(src + i + 24)));
+    }
+    for (; i + 8 <= count; i += 8) {
+        vst1q_s16(dst + i, vqaddq_s16(vld1q_s16(dst + i), vld1q_s16(src + i)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 32 <= count; i += 32) {
+        for (int k = 0; k < 32; k += 8) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(dst + i + k));
+            __m128i b = _mm_loadu_si128((const __m128i *)(src + i + k));
+            _mm_storeu_si128((__m128i *)(dst + i + k), _mm_adds_epi16(a, b));
+        }
+    }
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_adds_epi16(a, b));
+    }
+#endif
+    // Tail (< 8 samples), or everything on targets without SIMD
+    MixKernel_accumulateScalar(dst + i, src + i, count - i);
+}
@@ -0,0 +1,37 @@
+#ifndef _MIX_KERNEL_H_
+#define _MIX_KERNEL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sample kernels for the audio mixer.
+// PCM is signed 16 bit; sums saturate at SHRT_MIN/SHRT_MAX after every
+// voice, so mixing voice by voice gives the same result on every path.
+// NEON (vqaddq_s16) on ARM, SSE2 (_mm_adds_epi16) on x86, scalar otherwise.
+
+// dst[i] = saturate(dst[i] + src[i]) for i in [0, count)
+void MixKernel_accumulate(short *dst, const short *src, int count);
+
+// Same result, one sample at a time; used as the reference in benchmarks
+void MixKernel_accumulateScalar(short *dst, const short *src, int count);
+
+// Gains are Q15: MIXKERNEL_UNITY_GAIN is 1.0, valid range [0, UNITY].
+// A sample scaled by gain g is (s * g + 0x4000) >> 15 on every path.
+// When gainStart != gainEnd the gain moves linearly from gainStart (first
+// sample) towards gainEnd (reached after the last sample) so volume
+// changes don't click; ramps are short, so that case is scalar.
+#define MIXKERNEL_UNITY_GAIN 32768
+
+// dst[i] = saturate(dst[i] + src[i] * gain(i))
+void MixKernel_accumulateGain(short *dst, const short *src, int count,
+        int gainStart, int gainEnd);
+
+// buf[i] = buf[i] * gain(i), in place
+void MixKernel_scale(short *buf, int count, int gainStart, int gainEnd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -3,147 +3,521 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
+#include <time.h>
 #include "periodTimer.h"
 
 // Written by Brian Fraser - used for joystick in PROJECT
 
-// Data collected
+// Log-bucketed histogram: values below 32 get a bucket each; above that
+// each power of two is split into 32 buckets, so a bucket is at most ~3%
+// wide. Values of 2^40 or more (18 minutes in ns) share the top bucket.
+#define SUB_BUCKET_BITS 5
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define MAX_VALUE_BITS 40
+#define NUM_BUCKETS ((MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS)
+
+// Values passed with marks are stored in thousandths
+#define VALUE_SCALE 1000.0
+
+// One thread's data for one event. Only the owning thread writes it
+// (plain load + store, no read-modify-write); snapshots read it from
+// other threads, hence the atomics.
+typedef struct {
+    atomic_ullong count;
+    atomic_ullong sum;
+    atomic_uint buckets[NUM_BUCKETS];
+} histogram_t;
+
+typedef struct {
+    atomic_ullong numMarks;
+    long long prevTimestampInNs;    // Owner only; 0 before the first mark
+    histogram_t periods;            // ns between marks
+    histogram_t values;             // value * VALUE_SCALE
+} threadEvent_t;
+
+typedef struct threadData {
+    struct threadData *pNext;
+    pthread_t owner;
+    _Atomic(threadEvent_t *) events[PERIOD_MAX_EVENTS];
+} threadData_t;
+
+// Merged (and baseline) copies of the histograms
+typedef struct {
+    unsigned long long count;
+    unsigned long long sum;
+    unsigned long long buckets[NUM_BUCKETS];
+} mergedHistogram_t;
+
 typedef struct {
-    // Store the timestamp samples each time we mark an event.
-    long timestampCount;
-    long long timestampsInNs[MAX_EVENT_TIMESTAMPS];
+    unsigned long long numMarks;
+    mergedHistogram_t periods;
+    mergedHistogram_t values;
+} mergedEvent_t;
 
-    // Used for recording the event between analysis periods.
-    long long prevTimestampInNs;
-} timestamps_t;
-static timestamps_t s_eventData[NUM_PERIOD_EVENTS];
+// Every live thread that has marked an event, newest first. Threads push
+// themselves without the lock; entries are unlinked and freed (under
+// s_lock) when their thread exits, or all at once by cleanup(). A thread's
+// pointer is stale once s_generation moves.
+static _Atomic(threadData_t *) s_threads = NULL;
+static atomic_uint s_generation = 0;
+static __thread threadData_t *t_data = NULL;
+static __thread unsigned int t_generation = 0;
+static pthread_once_t s_keyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t s_threadKey;
 
+// Registry and snapshot baselines: only registration and snapshots take
+// s_lock, never the marking path.
 static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static char s_names[PERIOD_MAX_EVENTS][PERIOD_MAX_EVENT_NAME];
+static atomic_int s_numEvents = 0;
+static mergedEvent_t *s_baselines[PERIOD_MAX_EVENTS];
+// What threads that have since exited counted for each event
+static mergedEvent_t *s_retired[PERIOD_MAX_EVENTS];
 static bool s_initialized = false;
 
+static const char *const s_builtinNames[NUM_PERIOD_EVENTS] = {
+    [PERIOD_EVENT_AUDIO_BUFFER_FILL] = "audio_buffer_fill",
+    [PERIOD_EVENT_ACCELEROMETER_SAMPLE] = "accelerometer_sample",
+    [PERIOD_EVENT_AUDIO_XRUN] = "audio_xrun",
+    [PERIOD_EVENT_AUDIO_LATENCY] = "audio_latency",
+};
+
 
 // Prototypes
-static void updateStats(
-    timestamps_t *pData, 
-    Period_statistics_t *pStats
-);
 static long long getTimeInNanoS(void);
+static void createThreadKey(void);
 
 
 void Period_init(void)
 {
-    memset(s_eventData, 0, sizeof(s_eventData[0]) * NUM_PERIOD_EVENTS);
+    pthread_once(&s_keyOnce, createThreadKey);
+    pthread_mutex_lock(&s_lock);
+    atomic_store(&s_numEvents, 0);
+    for (int i = 0; i < NUM_PERIOD_EVENTS; i++) {
+        snprintf(s_names[i], PERIOD_MAX_EVENT_NAME, "%s", s_builtinNames[i]);
+    }
+    atomic_store(&s_numEvents, NUM_PERIOD_EVENTS);
     s_initialized = true;
+    pthread_mutex_unlock(&s_lock);
 }
+
 void Period_cleanup(void)
 {
-    // nothing
+    pthread_mutex_lock(&s_lock);
     s_initialized = false;
+    atomic_fetch_add(&s_generation, 1);
+
+    threadData_t *pThread = atomic_exchange(&s_threads, NULL);
+    while (pThread != NULL) {
+        threadData_t *pNext = pThread->pNext;
+        for (int i = 0; i < PERIOD_MAX_EVENTS; i++) {
+            free(atomic_load(&pThread->events[i]));
+        }
+        free(pThread);
+        pThread = pNext;
+    }
+    for (int i = 0; i < PERIOD_MAX_EVENTS; i++) {
+        free(s_baselines[i]);
+        s_baselines[i] = NULL;
+        free(s_retired[i]);
+        s_retired[i] = NULL;
+    }
+    atomic_store(&s_numEvents, 0);
+    pthread_mutex_unlock(&s_lock);
 }
 
-void Period_markEvent(enum Period_whichEvent whichEvent)
+int Period_registerEvent(const char *name)
 {
-    assert (whichEvent >= 0 && whichEvent < NUM_PERIOD_EVENTS);
-    assert (s_initialized);
-
-    timestamps_t *pData = &s_eventData[whichEvent];
+    assert(s_initialized);
     pthread_mutex_lock(&s_lock);
-    {
-        if (pData->timestampCount < MAX_EVENT_TIMESTAMPS) {
-            pData->timestampsInNs[pData->timestampCount] = getTimeInNanoS();
-            pData->timestampCount++;
-        } else {
-            printf("WARNING: No sample space for event collection on %d\n", whichEvent);
+    int numEvents = atomic_load(&s_numEvents);
+    int id = -1;
+    for (int i = 0; i < numEvents; i++) {
+        if (strncmp(s_names[i], name, PERIOD_MAX_EVENT_NAME - 1) == 0) {
+            id = i;
+            break;
         }
     }
+    if (id < 0 && numEvents < PERIOD_MAX_EVENTS) {
+        id = numEvents;
+        snprintf(s_names[id], PERIOD_MAX_EVENT_NAME, "%s", name);
+        atomic_store_explicit(&s_numEvents, numEvents + 1, memory_order_release);
+    }
     pthread_mutex_unlock(&s_lock);
+
+    if (id < 0) {
+        printf("WARNING: No space to register event %s\n", name);
+    }
+    return id;
 }
 
-void Period_getStatisticsAndClear(
-    enum Period_whichEvent whichEvent,
-    Period_statistics_t *pStats
-)
+int Period_getEventCount(void)
 {
-    assert (whichEvent >= 0 && whichEvent < NUM_PERIOD_EVENTS);
-    assert (s_initialized);
-    timestamps_t *pData = &s_eventData[whichEvent];
-    pthread_mutex_lock(&s_lock);
-    {
-        // Compute stats
-        updateStats(pData, pStats);
+    return atomic_load_explicit(&s_numEvents, memory_order_acquire);
+}
 
-        // Update the "previous" sample (if we have any)
-        if (pData->timestampCount > 0) {
-            pData->prevTimestampInNs = pData->timestampsInNs[pData->timestampCount - 1];
+const char *Period_getEventName(int eventId)
+{
+    assert(eventId >= 0 && eventId < Period_getEventCount());
+    return s_names[eventId];
+}
+
+static int bucketIndex(unsigned long long value)
+{
+    if (value >= (1ULL << MAX_VALUE_BITS)) {
+        value = (1ULL << MAX_VALUE_BITS) - 1;
+    }
+    if (value < SUB_BUCKETS) {
+        return (int)value;
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    int subBucket = (int)(value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + subBucket;
+}
+
+// Middle of the range of values that land in a bucket
+static double bucketValue(int index)
+{
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    int exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    unsigned long long width = 1ULL << (exponent - SUB_BUCKET_BITS);
+    unsigned long long lower = (unsigned long long)(SUB_BUCKETS + index % SUB_BUCKETS) * width;
+    return lower + (width - 1) / 2.0;
+}
+
+// Single-writer increments: the owner is the only thread that stores
+static inline void addRelaxed(atomic_ullong *pCounter, unsigned long long amount)
+{
+    atomic_store_explicit(pCounter,
+            atomic_load_explicit(pCounter, memory_order_relaxed) + amount,
+            memory_order_relaxed);
+}
+
+static void record(histogram_t *pHistogram, unsigned long long value)
+{
+    atomic_uint *pBucket = &pHistogram->buckets[bucketIndex(value)];
+    atomic_store_explicit(pBucket,
+            atomic_load_explicit(pBucket, memory_order_relaxed) + 1,
+            memory_order_relaxed);
+    addRelaxed(&pHistogram->sum, value);
+    addRelaxed(&pHistogram->count, 1);
+}
+
+// This thread's data for an event, creating it on first use
+static threadEvent_t *getThreadEvent(int eventId)
+{
+    unsigned int generation = atomic_load_explicit(&s_generation, memory_order_relaxed);
+    if (t_data == NULL || t_generation != generation) {
+        t_data = calloc(1, sizeof(*t_data));
+        if (t_data == NULL) {
+            return NULL;
         }
+        t_data->owner = pthread_self();
+        t_generation = generation;
+        threadData_t *pHead = atomic_load(&s_threads);
+        do {
+            t_data->pNext = pHead;
+        } while (!atomic_compare_exchange_weak(&s_threads, &pHead, t_data));
+        pthread_setspecific(s_threadKey, t_data);
+    }
 
-        // Clear
-        pData->timestampCount = 0;
+    threadEvent_t *pEvent = atomic_load_explicit(&t_data->events[eventId], memory_order_relaxed);
+    if (pEvent == NULL) {
+        pEvent = calloc(1, sizeof(*pEvent));
+        if (pEvent != NULL) {
+            atomic_store_explicit(&t_data->events[eventId], pEvent, memory_order_release);
+        }
+    }
+    return pEvent;
+}
+
+static void markNow(int eventId, bool hasValue, double value)
+{
+    assert(s_initialized);
+    assert(eventId >= 0 && eventId < Period_getEventCount());
+
+    threadEvent_t *pEvent = getThreadEvent(eventId);
+    if (pEvent == NULL) {
+        return;
+    }
+    long long nowInNs = getTimeInNanoS();
+    if (pEvent->prevTimestampInNs != 0) {
+        record(&pEvent->periods, nowInNs - pEvent->prevTimestampInNs);
+    }
+    pEvent->prevTimestampInNs = nowInNs;
+    if (hasValue) {
+        double scaled = value * VALUE_SCALE + 0.5;
+        record(&pEvent->values, scaled > 0 ? (unsigned long long)scaled : 0);
+    }
+    addRelaxed(&pEvent->numMarks, 1);
+}
+
+void Period_mark(int eventId)
+{
+    markNow(eventId, false, 0);
+}
+
+void Period_markWithValue(int eventId, double value)
+{
+    markNow(eventId, true, value);
+}
+
+void Period_markEvent(enum Period_whichEvent whichEvent)
+{
+    Period_mark(whichEvent);
+}
+
+void Period_markEventWithValue(enum Period_whichEvent whichEvent, double value)
+{
+    Period_markWithValue(whichEvent, value);
+}
+
+static void mergeHistogram(mergedHistogram_t *pMerged, const histogram_t *pHistogram)
+{
+    pMerged->count += atomic_load_explicit(&pHistogram->count, memory_order_relaxed);
+    pMerged->sum += atomic_load_explicit(&pHistogram->sum, memory_order_relaxed);
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        pMerged->buckets[i] += atomic_load_explicit(&pHistogram->buckets[i], memory_order_relaxed);
+    }
+}
+
+// Merge every thread's data for the event, including threads that have
+// exited. Called with s_lock held.
+static void mergeEvent(int eventId, mergedEvent_t *pMerged)
+{
+    memset(pMerged, 0, sizeof(*pMerged));
+    if (s_retired[eventId] != NULL) {
+        memcpy(pMerged, s_retired[eventId], sizeof(*pMerged));
+    }
+    for (threadData_t *pThread = atomic_load(&s_threads); pThread != NULL;
+            pThread = pThread->pNext) {
+        const threadEvent_t *pEvent =
+                atomic_load_explicit(&pThread->events[eventId], memory_order_acquire);
+        if (pEvent != NULL) {
+            pMerged->numMarks += atomic_load_explicit(&pEvent->numMarks, memory_order_relaxed);
+            mergeHistogram(&pMerged->periods, &pEvent->periods);
+            mergeHistogram(&pMerged->values, &pEvent->values);
+        }
+    }
+}
+
+// Take pData out of s_threads. Called with s_lock held; threads may still
+// push onto the head meanwhile, but nothing else changes the list.
+// Returns false if it isn't there (cleanup() has already freed it).
+static bool unlinkThread(threadData_t *pData)
+{
+    threadData_t *pHead = atomic_load(&s_threads);
+    if (pHead == pData &&
+            atomic_compare_exchange_strong(&s_threads, &pHead, pData->pNext)) {
+        return true;
+    }
+    // Not the head, or a new thread pushed in front of it just now
+    for (threadData_t *pPrev = atomic_load(&s_threads); pPrev != NULL; pPrev = pPrev->pNext) {
+        if (pPrev->pNext == pData) {
+            pPrev->pNext = pData->pNext;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Thread-exit destructor: fold the thread's counts into s_retired and
+// free its histograms, so short-lived threads don't pile up until cleanup()
+static void retireThread(void *pValue)
+{
+    threadData_t *pData = pValue;
+    pthread_mutex_lock(&s_lock);
+    // After cleanup() the pointer may be freed, or even reused by another
+    // thread's data, so only touch it if it is still listed as ours
+    bool listed = false;
+    for (threadData_t *pThread = atomic_load(&s_threads); pThread != NULL;
+            pThread = pThread->pNext) {
+        if (pThread == pData) {
+            listed = pthread_equal(pData->owner, pthread_self());
+            break;
+        }
+    }
+    if (listed) {
+        bool haveRetired = true;
+        for (int i = 0; i < PERIOD_MAX_EVENTS; i++) {
+            if (atomic_load(&pData->events[i]) != NULL && s_retired[i] == NULL) {
+                s_retired[i] = calloc(1, sizeof(*s_retired[i]));
+                haveRetired = haveRetired && s_retired[i] != NULL;
+            }
+        }
+        // Out of memory: leave it listed for cleanup() rather than lose counts
+        if (haveRetired && unlinkThread(pData)) {
+            for (int i = 0; i < PERIOD_MAX_EVENTS; i++) {
+                threadEvent_t *pEvent = atomic_load(&pData->events[i]);
+                if (pEvent != NULL) {
+                    s_retired[i]->numMarks += atomic_load(&pEvent->numMarks);
+                    mergeHistogram(&s_retired[i]->periods, &pEvent->periods);
+                    mergeHistogram(&s_retired[i]->values, &pEvent->values);
+                    free(pEvent);
+                }
+            }
+            free(pData);
+        }
     }
     pthread_mutex_unlock(&s_lock);
 }
 
-static void updateStats(
-    timestamps_t *pData, 
-    Period_statistics_t *pStats
-)
+static void createThreadKey(void)
+{
+    pthread_key_create(&s_threadKey, retireThread);
+}
+
+// Turn *pCounter from a running total into the change since *pBaseline,
+// optionally moving the baseline up to the total
+static inline void takeDelta(unsigned long long *pCounter, unsigned long long *pBaseline,
+        bool advance)
 {
-    long long prevInNs = pData->prevTimestampInNs;
+    unsigned long long total = *pCounter;
+    *pCounter = total - *pBaseline;
+    if (advance) {
+        *pBaseline = total;
+    }
+}
 
-    // Handle startup (no previous sample)
-    if (prevInNs == 0) {
-        prevInNs = pData->timestampsInNs[0];
+static void takeHistogramDelta(mergedHistogram_t *pTotal, mergedHistogram_t *pBaseline,
+        bool advance)
+{
+    takeDelta(&pTotal->count, &pBaseline->count, advance);
+    takeDelta(&pTotal->sum, &pBaseline->sum, advance);
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        takeDelta(&pTotal->buckets[i], &pBaseline->buckets[i], advance);
     }
-    
-    // Find min/max/sum time delta between consecutive samples
-    long long sumDeltasNs = 0;
-    long long minNs = 0;
-    long long maxNs = 0;
-    for (int i = 0; i < pData->timestampCount; i++) {
-        long long thisTime = pData->timestampsInNs[i];
-        long long deltaNs = thisTime - prevInNs;
-        sumDeltasNs += deltaNs;
+}
 
-        if (i == 0 || deltaNs < minNs) {
-            minNs = deltaNs;
+static double percentile(const mergedHistogram_t *pHistogram, unsigned long long total,
+        double fraction)
+{
+    unsigned long long rank = (unsigned long long)(fraction * total + 0.999999);
+    if (rank == 0) {
+        rank = 1;
+    }
+    unsigned long long seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        seen += pHistogram->buckets[i];
+        if (seen >= rank) {
+            return bucketValue(i);
         }
-        if (i == 0 || deltaNs > maxNs) {
-            maxNs = deltaNs;
+    }
+    return 0;
+}
+
+static void summarize(const mergedHistogram_t *pHistogram, double scale,
+        Period_distribution_t *pDistribution)
+{
+    memset(pDistribution, 0, sizeof(*pDistribution));
+    // Buckets and count are read separately from a live thread, so take
+    // the bucket total as the count the percentiles are relative to.
+    unsigned long long total = 0;
+    int first = -1;
+    int last = -1;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        if (pHistogram->buckets[i] != 0) {
+            total += pHistogram->buckets[i];
+            if (first < 0) {
+                first = i;
+            }
+            last = i;
         }
+    }
+    if (total == 0) {
+        return;
+    }
+    pDistribution->count = total;
+    pDistribution->min = bucketValue(first) / scale;
+    pDistribution->max = bucketValue(last) / scale;
+    pDistribution->mean = pHistogram->count > 0 ?
+            (double)pHistogram->sum / pHistogram->count / scale : 0;
+    pDistribution->p50 = percentile(pHistogram, total, 0.50) / scale;
+    pDistribution->p90 = percentile(pHistogram, total, 0.90) / scale;
+    pDistribution->p99 = percentile(pHistogram, total, 0.99) / scale;
+    pDistribution->p999 = percentile(pHistogram, total, 0.999) / scale;
+}
 
-        prevInNs = thisTime;
+static void takeSnapshot(int eventId, Period_snapshot_t *pSnapshot, bool clear)
+{
+    assert(s_initialized);
+    assert(eventId >= 0 && eventId < Period_getEventCount());
+
+    mergedEvent_t *pMerged = malloc(sizeof(*pMerged));
+    memset(pSnapshot, 0, sizeof(*pSnapshot));
+    pSnapshot->name = s_names[eventId];
+    if (pMerged == NULL) {
+        return;
     }
 
-    long long avgNs = 0;
-    if (pData->timestampCount > 0) {
-        avgNs = sumDeltasNs / pData->timestampCount;
-    } 
+    pthread_mutex_lock(&s_lock);
+    {
+        mergeEvent(eventId, pMerged);
+        mergedEvent_t *pBaseline = s_baselines[eventId];
+        if (clear) {
+            if (pBaseline == NULL) {
+                pBaseline = s_baselines[eventId] = calloc(1, sizeof(*pBaseline));
+            }
+        }
+        if (pBaseline != NULL) {
+            // Report only what arrived after the last clear (and, when
+            // clearing, move the baseline up to now)
+            takeDelta(&pMerged->numMarks, &pBaseline->numMarks, clear);
+            takeHistogramDelta(&pMerged->periods, &pBaseline->periods, clear);
+            takeHistogramDelta(&pMerged->values, &pBaseline->values, clear);
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
 
-    // Save stats
-    #define MS_PER_NS (1000*1000.0)
-    pStats->minPeriodInMs = minNs / MS_PER_NS;
-    pStats->maxPeriodInMs = maxNs / MS_PER_NS;
-    pStats->avgPeriodInMs = avgNs / MS_PER_NS;
-    pStats->numSamples = pData->timestampCount;
+    #define NS_PER_MS (1000*1000.0)
+    pSnapshot->numMarks = pMerged->numMarks;
+    summarize(&pMerged->periods, NS_PER_MS, &pSnapshot->periodMs);
+    summarize(&pMerged->values, VALUE_SCALE, &pSnapshot->value);
+    free(pMerged);
 }
 
+void Period_snapshot(int eventId, Period_snapshot_t *pSnapshot)
+{
+    takeSnapshot(eventId, pSnapshot, false);
+}
 
+void Period_snapshotAndClear(int eventId, Period_snapshot_t *pSnapshot)
+{
+    takeSnapshot(eventId, pSnapshot, true);
+}
 
+void Period_getStatisticsAndClear(
+    enum Period_whichEvent whichEvent,
+    Period_statistics_t *pStats
+)
+{
+    assert (whichEvent >= 0 && whichEvent < NUM_PERIOD_EVENTS);
+    Period_snapshot_t snapshot;
+    Period_snapshotAndClear(whichEvent, &snapshot);
+
+    pStats->numSamples = (int)snapshot.numMarks;
+    pStats->minPeriodInMs = snapshot.periodMs.min;
+    pStats->maxPeriodInMs = snapshot.periodMs.max;
+    pStats->avgPeriodInMs = snapshot.periodMs.mean;
+    pStats->minValue = snapshot.value.min;
+    pStats->maxValue = snapshot.value.max;
+    pStats->avgValue = snapshot.value.mean;
+}
 
 
 // Timing function
-static long long getTimeInNanoS(void) 
+static long long getTimeInNanoS(void)
 {
     struct timespec spec;
     clock_gettime(CLOCK_BOOTTIME, &spec);
     long long seconds = spec.tv_sec;
     long long nanoSeconds = spec.tv_nsec + seconds * 1000*1000*1000;
 	assert(nanoSeconds > 0);
-    
-    static long long lastTimeHack = 0;
-    assert(nanoSeconds > lastTimeHack);
-    lastTimeHack = nanoSeconds;
 
     return nanoSeconds;
 }
@@ -152,4 +526,4 @@ unsigned long long periodTimer_getCurrentTimeMs(void) {
     struct timespec now;
     clock_gettime(CLOCK_MONOTONIC, &now);
     return ((unsigned long long)now.tv_sec * 1000) + (now.tv_nsec / 1000000);
-}
\ No newline at end of file
+}
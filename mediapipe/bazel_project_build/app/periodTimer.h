@@ -1,6 +1,8 @@
 #ifndef _PERIOD_TIMER_H_
 #define _PERIOD_TIMER_H_
 
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -8,23 +10,36 @@ extern "C" {
 // Module to record and report the timing of periodic events.
 //     Written by Brian Fraser
 // Usage:
-//  1. Define your Period_whichEvent enums of interest
-//     (ensure NUM_PERIOD_EVENTS is last).
-//  2. Call Period_markEvent() periodically to mark each
+//  1. Register an event with Period_registerEvent("name") (or use one
+//     of the built-in Period_whichEvent enums, which are registered by
+//     Period_init()).
+//  2. Call Period_mark() periodically to mark each
 //     occurrence of the event. For example, call this function
 //     each time you sample the A2D.
-//  3. Call getStatisticsAndClear() to get the statistics for
-//     an event of interest. Calling this will clear the 
+//  3. Call Period_snapshotAndClear() (or the older
+//     Period_getStatisticsAndClear()) to get the statistics for
+//     an event of interest. Calling this will clear the
 //     data collected for this event (but not others).
 //     For example, call this function once a second to get timing
 //     information to print to the screen.
+//
+// Marks are recorded without locks: every thread records into its own
+// log-bucketed histograms (HDR style, ~3% resolution) which snapshots
+// merge, so hot paths on several threads can be instrumented all the time.
+// The period of an event is measured between marks made by the same
+// thread. The first mark of an event on a thread allocates that thread's
+// histograms for it; later marks don't allocate. When the thread exits
+// they are freed and their counts kept in a total for exited threads.
 
-// Maximum number of timestamps to record for a given event.
-#define MAX_EVENT_TIMESTAMPS (1024*4)
+// Maximum number of distinct events (built-in + registered)
+#define PERIOD_MAX_EVENTS 64
+#define PERIOD_MAX_EVENT_NAME 32
 
 enum Period_whichEvent {
     PERIOD_EVENT_AUDIO_BUFFER_FILL,
     PERIOD_EVENT_ACCELEROMETER_SAMPLE,
+    PERIOD_EVENT_AUDIO_XRUN,        // One mark per ALSA under-run
+    PERIOD_EVENT_AUDIO_LATENCY,     // Value: ms queued ahead of the DAC
     NUM_PERIOD_EVENTS
 };
 
@@ -33,18 +48,67 @@ typedef struct {
     double minPeriodInMs;
     double maxPeriodInMs;
     double avgPeriodInMs;
+    // Only meaningful for events marked with Period_markEventWithValue()
+    double minValue;
+    double maxValue;
+    double avgValue;
 } Period_statistics_t;
 
+// Summary of one histogram. min/max and the percentiles are accurate to
+// the bucket resolution; mean is exact.
+typedef struct {
+    unsigned long long count;
+    double min;
+    double max;
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double p999;
+} Period_distribution_t;
+
+typedef struct {
+    const char *name;
+    unsigned long long numMarks;
+    Period_distribution_t periodMs;    // Time between marks on a thread
+    Period_distribution_t value;       // Values passed with the marks
+} Period_snapshot_t;
+
 // Initialize/cleanup the module's data structures.
+// No thread may be marking events during cleanup().
 void Period_init(void);
 void Period_cleanup(void);
 
-// Record the current time as a timestamp for the 
-// indicated event. This allows later calls to 
+// Return the id of the event called name, registering it if needed.
+// Returns -1 if PERIOD_MAX_EVENTS are already registered.
+int Period_registerEvent(const char *name);
+
+// Number of registered events (ids are 0 .. count-1) and their names.
+int Period_getEventCount(void);
+const char *Period_getEventName(int eventId);
+
+// Record the current time as a timestamp for the event, and optionally
+// a measurement taken at that time (for example a latency). Values are
+// kept with 0.001 resolution and must be >= 0. Lock-free.
+void Period_mark(int eventId);
+void Period_markWithValue(int eventId, double value);
+
+// Merge every thread's data for the event. The AndClear version reports
+// only what was recorded since its previous call for that event.
+void Period_snapshot(int eventId, Period_snapshot_t *pSnapshot);
+void Period_snapshotAndClear(int eventId, Period_snapshot_t *pSnapshot);
+
+// Record the current time as a timestamp for the
+// indicated event. This allows later calls to
 // Period_getStatisticsAndClear() to access these timestamps
 // and compute the timing statistics for this periodic event.
 void Period_markEvent(enum Period_whichEvent whichEvent);
 
+// Same as Period_markEvent(), also recording a measurement taken at
+// that time (for example a latency); its min/max/avg are reported in
+// the value fields of the statistics.
+void Period_markEventWithValue(enum Period_whichEvent whichEvent, double value);
+
 // Fill the `pStats` struct, which must be allocated by the calling
 // code, with the statistics about the periodic event `whichEvent`.
 // This function is threadsafe, and may be called by any thread.
@@ -61,4 +125,4 @@ unsigned long long periodTimer_getCurrentTimeMs(void);
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,275 @@
+#include "sampleBank.h"
+#include "waveLoader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// File layout (host byte order; the bank is a local cache, not an
+// interchange format):
+//   bankHeader_t, numEntries x bankEntry_t, padding to a page,
+//   then each sound's S16 samples, each starting on a cache line.
+#define BANK_MAGIC "SBNK"
+#define BANK_VERSION 1
+#define BANK_DATA_ALIGN 64
+#define BANK_HEADER_ALIGN 4096
+
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint32_t sampleRate;
+	uint32_t numEntries;
+} bankHeader_t;
+
+typedef struct {
+	char name[SAMPLE_BANK_MAX_NAME];
+	uint64_t sourceSize;
+	int64_t sourceMtime;
+	uint64_t offset;		// Bytes from the start of the file
+	uint32_t numSamples;
+	uint32_t reserved;
+} bankEntry_t;
+
+struct SampleBank {
+	const unsigned char *pMap;
+	size_t mapSize;
+	const bankHeader_t *pHeader;
+	const bankEntry_t *pEntries;
+};
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+static bool writeAll(int fd, const void *pData, size_t size)
+{
+	const char *p = pData;
+	while (size > 0) {
+		ssize_t written = write(fd, p, size);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		p += written;
+		size -= written;
+	}
+	return true;
+}
+
+int SampleBank_write(const char *bankPath, const SampleBank_source_t *sources,
+		int numSources, unsigned int sampleRate)
+{
+	if (numSources <= 0) {
+		fprintf(stderr, "ERROR: Sample bank %s needs at least one sound.\n", bankPath);
+		return -1;
+	}
+
+	bankEntry_t *entries = calloc(numSources, sizeof(*entries));
+	short **samples = calloc(numSources, sizeof(*samples));
+	if (entries == NULL || samples == NULL) {
+		fprintf(stderr, "ERROR: Unable to allocate sample bank index.\n");
+		free(entries);
+		free(samples);
+		return -1;
+	}
+
+	// Convert everything first so a bad source leaves the old bank alone
+	int result = 0;
+	uint64_t offset = alignUp(sizeof(bankHeader_t) + numSources * sizeof(bankEntry_t),
+			BANK_HEADER_ALIGN);
+	for (int i = 0; i < numSources && result == 0; i++) {
+		if (strlen(sources[i].name) >= SAMPLE_BANK_MAX_NAME) {
+			fprintf(stderr, "ERROR: Sound name %s is too long.\n", sources[i].name);
+			result = -1;
+			break;
+		}
+		if (sources[i].fileName == NULL) {
+			fprintf(stderr, "ERROR: No file for sound %s.\n", sources[i].name);
+			result = -1;
+			break;
+		}
+		int numSamples = 0;
+		if (WaveLoader_load(sources[i].fileName, sampleRate, &samples[i], &numSamples) != 0) {
+			result = -1;
+			break;
+		}
+		struct stat st;
+		if (stat(sources[i].fileName, &st) == 0) {
+			entries[i].sourceSize = st.st_size;
+			entries[i].sourceMtime = st.st_mtime;
+		}
+		strcpy(entries[i].name, sources[i].name);
+		entries[i].offset = offset;
+		entries[i].numSamples = numSamples;
+		offset = alignUp(offset + numSamples * sizeof(short), BANK_DATA_ALIGN);
+	}
+
+	char tmpPath[512];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", bankPath);
+	int fd = -1;
+	if (result == 0) {
+		fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) {
+			fprintf(stderr, "ERROR: Unable to create sample bank %s: %s\n",
+					tmpPath, strerror(errno));
+			result = -1;
+		}
+	}
+	if (result == 0) {
+		bankHeader_t header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, BANK_MAGIC, sizeof(header.magic));
+		header.version = BANK_VERSION;
+		header.sampleRate = sampleRate;
+		header.numEntries = numSources;
+
+		bool ok = writeAll(fd, &header, sizeof(header)) &&
+				writeAll(fd, entries, numSources * sizeof(*entries));
+		for (int i = 0; i < numSources && ok; i++) {
+			// Samples go at their offset; the gaps read back as zeros
+			ok = lseek(fd, entries[i].offset, SEEK_SET) >= 0 &&
+					writeAll(fd, samples[i], entries[i].numSamples * sizeof(short));
+		}
+		ok = ok && ftruncate(fd, offset) == 0 && fsync(fd) == 0;
+		if (close(fd) != 0) {
+			ok = false;
+		}
+		if (!ok || rename(tmpPath, bankPath) != 0) {
+			fprintf(stderr, "ERROR: Unable to write sample bank %s: %s\n",
+					bankPath, strerror(errno));
+			unlink(tmpPath);
+			result = -1;
+		}
+	}
+
+	for (int i = 0; i < numSources; i++) {
+		free(samples[i]);
+	}
+	free(samples);
+	free(entries);
+	return result;
+}
+
+SampleBank_t *SampleBank_open(const char *bankPath, unsigned int sampleRate)
+{
+	int fd = open(bankPath, O_RDONLY);
+	if (fd < 0) {
+		if (errno != ENOENT) {
+			fprintf(stderr, "Sample bank %s: %s\n", bankPath, strerror(errno));
+		}
+		return NULL;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(bankHeader_t)) {
+		fprintf(stderr, "Sample bank %s is truncated\n", bankPath);
+		close(fd);
+		return NULL;
+	}
+
+	// MAP_POPULATE reads the whole (small) file in one sequential pass now,
+	// instead of page faults on the audio thread later.
+	size_t size = st.st_size;
+	void *pMap = mmap(NULL, size, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0);
+	close(fd);
+	if (pMap == MAP_FAILED) {
+		fprintf(stderr, "Unable to map sample bank %s: %s\n", bankPath, strerror(errno));
+		return NULL;
+	}
+	// Best effort: keep it resident (needs RLIMIT_MEMLOCK headroom)
+	madvise(pMap, size, MADV_WILLNEED);
+	mlock(pMap, size);
+
+	const bankHeader_t *pHeader = pMap;
+	const bankEntry_t *pEntries = (const bankEntry_t *)(pHeader + 1);
+	bool valid = memcmp(pHeader->magic, BANK_MAGIC, sizeof(pHeader->magic)) == 0 &&
+			pHeader->version == BANK_VERSION &&
+			pHeader->numEntries > 0 &&
+			sizeof(*pHeader) + (uint64_t)pHeader->numEntries * sizeof(*pEntries) <= size;
+	for (uint32_t i = 0; valid && i < pHeader->numEntries; i++) {
+		valid = memchr(pEntries[i].name, '\0', SAMPLE_BANK_MAX_NAME) != NULL &&
+				pEntries[i].offset % sizeof(short) == 0 &&
+				pEntries[i].offset <= size &&
+				pEntries[i].numSamples > 0 &&
+				pEntries[i].numSamples <= (size - pEntries[i].offset) / sizeof(short);
+	}
+	if (!valid || pHeader->sampleRate != sampleRate) {
+		fprintf(stderr, "Sample bank %s is %s\n", bankPath,
+				valid ? "for another sample rate" : "corrupt");
+		munmap(pMap, size);
+		return NULL;
+	}
+
+	SampleBank_t *pBank = malloc(sizeof(*pBank));
+	if (pBank == NULL) {
+		munmap(pMap, size);
+		return NULL;
+	}
+	pBank->pMap = pMap;
+	pBank->mapSize = size;
+	pBank->pHeader = pHeader;
+	pBank->pEntries = pEntries;
+	return pBank;
+}
+
+static const bankEntry_t *findEntry(const SampleBank_t *pBank, const char *name)
+{
+	for (uint32_t i = 0; i < pBank->pHeader->numEntries; i++) {
+		if (strcmp(pBank->pEntries[i].name, name) == 0) {
+			return &pBank->pEntries[i];
+		}
+	}
+	return NULL;
+}
+
+bool SampleBank_isCurrent(const SampleBank_t *pBank,
+		const SampleBank_source_t *sources, int numSources)
+{
+	if (pBank->pHeader->numEntries != (uint32_t)numSources) {
+		return false;
+	}
+	for (int i = 0; i < numSources; i++) {
+		const bankEntry_t *pEntry = findEntry(pBank, sources[i].name);
+		if (pEntry == NULL) {
+			return false;
+		}
+		struct stat st;
+		if (sources[i].fileName != NULL && stat(sources[i].fileName, &st) == 0 &&
+				((uint64_t)st.st_size != pEntry->sourceSize ||
+				 (int64_t)st.st_mtime != pEntry->sourceMtime)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int SampleBank_get(const SampleBank_t *pBank, const char *name, wavedata_t *pSound)
+{
+	const bankEntry_t *pEntry = findEntry(pBank, name);
+	if (pEntry == NULL) {
+		pSound->numSamples = 0;
+		pSound->pData = NULL;
+		return -1;
+	}
+	// The mixer only reads pData; the mapping itself is read-only
+	pSound->numSamples = pEntry->numSamples;
+	pSound->pData = (short *)(pBank->pMap + pEntry->offset);
+	return 0;
+}
+
+void SampleBank_close(SampleBank_t *pBank)
+{
+	if (pBank == NULL) {
+		return;
+	}
+	munlock(pBank->pMap, pBank->mapSize);
+	munmap((void *)pBank->pMap, pBank->mapSize);
+	free(pBank);
+}
@@ -0,0 +1,52 @@
+// A sample bank packs a set of sounds, already converted to the mixer's
+// format, into one file. Opening it maps the whole file and faults it in
+// with a single sequential read, so playback only ever touches
+// page-cache-backed memory and startup doesn't depend on where the
+// original WAV files live (e.g. an NFS share).
+#ifndef SAMPLE_BANK_H
+#define SAMPLE_BANK_H
+
+#include <stdbool.h>
+#include "audioMixer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SAMPLE_BANK_MAX_NAME 32
+
+typedef struct {
+	const char *name;		// Key used with SampleBank_get(), < SAMPLE_BANK_MAX_NAME chars
+	const char *fileName;	// WAV file the sound is converted from, or NULL if unavailable
+} SampleBank_source_t;
+
+typedef struct SampleBank SampleBank_t;
+
+// Convert every source with the wave loader and write them to bankPath
+// (via a temporary file renamed into place). Returns 0 or -1 on error.
+int SampleBank_write(const char *bankPath, const SampleBank_source_t *sources,
+		int numSources, unsigned int sampleRate);
+
+// Map a bank written for sampleRate. Returns NULL (and says why) if the file
+// is missing, corrupt or for another rate.
+SampleBank_t *SampleBank_open(const char *bankPath, unsigned int sampleRate);
+
+// True if the bank holds exactly these sources and none of the source files
+// that can be stat'ed has changed size or mtime since it was written.
+// Sources that can't be reached (share not mounted) or have no fileName
+// count as unchanged.
+bool SampleBank_isCurrent(const SampleBank_t *pBank,
+		const SampleBank_source_t *sources, int numSources);
+
+// Point pSound at the named sound inside the mapping. The data is read-only
+// and stays valid until SampleBank_close(); don't pass it to
+// AudioMixer_freeWaveFileData(). Returns 0, or -1 if there is no such sound.
+int SampleBank_get(const SampleBank_t *pBank, const char *name, wavedata_t *pSound);
+
+void SampleBank_close(SampleBank_t *pBank);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,510 @@
+#define _GNU_SOURCE
+#include "threadTopology.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#define MAX_CPUS 32
+#define MAX_PREFIXES 4
+#define MAX_TOPOLOGY_FILE 4096
+#define THREAD_NAME_SIZE 16
+
+static const char *const s_roleNames[TOPOLOGY_NUM_ROLES] = {
+    "audio", "camera", "graph", "inference", "opencv", "lcd", "network", "input", "background"
+};
+
+// Thread names (as set with pthread_setname_np) that belong to each role,
+// matched as prefixes so "mp_graph/<tid>" and "joystick_adc" are found.
+// None may be a prefix of "gesture_game", the name of the main thread and
+// of every thread that never names itself. Inference and OpenCV have no
+// threads of their own to move.
+static const char *const s_rolePrefixes[TOPOLOGY_NUM_ROLES][MAX_PREFIXES] = {
+    [TOPOLOGY_ROLE_AUDIO] = { "audio_playback" },
+    [TOPOLOGY_ROLE_CAMERA] = { "gesture_cam" },
+    [TOPOLOGY_ROLE_GRAPH] = { "mp_graph" },
+    [TOPOLOGY_ROLE_LCD] = { "lcd_render" },
+    [TOPOLOGY_ROLE_NETWORK] = { "ws_service" },
+    [TOPOLOGY_ROLE_INPUT] = { "joystick", "rotary", "input_" },
+    [TOPOLOGY_ROLE_BACKGROUND] = { "log_writer", "asset_refresh", "metrics", "game_timer" },
+};
+
+typedef struct {
+    const char *name;
+    const char *text;
+} preset_t;
+
+// CPU numbers are for the 4-core A53; CPUs the process can't use are
+// dropped when applying.
+static const preset_t s_presets[] = {
+    // Leave every thread as it starts
+    { "none", "" },
+    // Undo any earlier topology: no pinning, no priorities, default pools
+    { "baseline",
+      "audio; camera; graph; inference; opencv; lcd; network; input; background" },
+    // Priorities only, every thread free to use any CPU
+    { "priorities",
+      "audio fifo=20\n"
+      "input nice=-5\n"
+      "camera nice=-5\n"
+      "graph nice=-5\n"
+      "background nice=10\n" },
+    // Audio and the input/LCD threads, which mostly wait, on CPU 3; vision
+    // on 0-2 with the pools sized to fit
+    { "default",
+      "audio cpus=3 fifo=20\n"
+      "input cpus=3 nice=-5\n"
+      "lcd cpus=3\n"
+      "camera cpus=0-2 nice=-5\n"
+      "graph cpus=0-2 nice=-5 threads=3\n"
+      "inference threads=2\n"
+      "opencv threads=1\n"
+      "network cpus=0-2\n"
+      "background cpus=0-2 nice=10\n" },
+    // CPU 3 for audio alone; everything else shares 0-2
+    { "audio_isolated",
+      "audio cpus=3 fifo=20\n"
+      "input cpus=0-2 nice=-5\n"
+      "lcd cpus=0-2\n"
+      "camera cpus=0-2 nice=-5\n"
+      "graph cpus=0-2 nice=-5 threads=3\n"
+      "inference threads=3\n"
+      "opencv threads=1\n"
+      "network cpus=0-2\n"
+      "background cpus=0-2 nice=10\n" },
+};
+#define NUM_PRESETS ((int)(sizeof(s_presets) / sizeof(s_presets[0])))
+
+const char *const Topology_presetNames[] = {
+    "none", "baseline", "priorities", "default", "audio_isolated", NULL
+};
+
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static Topology_t s_current = { .name = "none" };
+// Roles whose failure has been reported since the topology was set
+static bool s_reported[TOPOLOGY_NUM_ROLES];
+
+static bool hasThreads(enum Topology_role role)
+{
+    return s_rolePrefixes[role][0] != NULL;
+}
+
+static int findRole(const char *name, size_t length)
+{
+    for (int i = 0; i < TOPOLOGY_NUM_ROLES; i++) {
+        if (strlen(s_roleNames[i]) == length && strncmp(name, s_roleNames[i], length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Parse an integer that must fill value and lie in [min, max]
+static int parseInt(const char *value, int min, int max, int *pResult)
+{
+    char *end;
+    errno = 0;
+    long result = strtol(value, &end, 10);
+    if (errno != 0 || end == value || *end != '\0' || result < min || result > max) {
+        return -1;
+    }
+    *pResult = (int)result;
+    return 0;
+}
+
+// "0,2-3" -> bits 0, 2 and 3
+static int parseCpus(const char *value, unsigned int *pCpus)
+{
+    unsigned int cpus = 0;
+    const char *p = value;
+    while (*p != '\0') {
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end == p) {
+            return -1;
+        }
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1) {
+                return -1;
+            }
+            p = end;
+        }
+        if (first < 0 || last >= MAX_CPUS || first > last) {
+            return -1;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            cpus |= 1u << cpu;
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0') {
+            return -1;
+        }
+    }
+    if (cpus == 0) {
+        return -1;
+    }
+    *pCpus = cpus;
+    return 0;
+}
+
+// One "<role> key=value ..." entry, with any comment removed
+static int parseEntry(char *entry, Topology_t *pTopology)
+{
+    char *save;
+    char *word = strtok_r(entry, " \t", &save);
+    if (word == NULL) {
+        return 0;
+    }
+    int role = findRole(word, strlen(word));
+    if (role < 0) {
+        fprintf(stderr, "Topology: unknown role '%s'\n", word);
+        return -1;
+    }
+    Topology_roleConfig_t *pRole = &pTopology->roles[role];
+    memset(pRole, 0, sizeof(*pRole));
+    pRole->listed = true;
+
+    while ((word = strtok_r(NULL, " \t", &save)) != NULL) {
+        char *value = strchr(word, '=');
+        if (value == NULL) {
+            fprintf(stderr, "Topology: expected key=value for %s, got '%s'\n", s_roleNames[role], word);
+            return -1;
+        }
+        *value++ = '\0';
+        int result;
+        if (strcmp(word, "threads") == 0) {
+            result = parseInt(value, 1, 64, &pRole->poolSize);
+        } else if (!hasThreads(role)) {
+            fprintf(stderr, "Topology: %s only takes threads=\n", s_roleNames[role]);
+            return -1;
+        } else if (strcmp(word, "cpus") == 0) {
+            result = parseCpus(value, &pRole->cpus);
+        } else if (strcmp(word, "fifo") == 0 || strcmp(word, "rr") == 0) {
+            pRole->policy = word[0] == 'f' ? TOPOLOGY_POLICY_FIFO : TOPOLOGY_POLICY_RR;
+            result = parseInt(value, 1, 99, &pRole->priority);
+        } else if (strcmp(word, "nice") == 0) {
+            pRole->policy = TOPOLOGY_POLICY_OTHER;
+            result = parseInt(value, -20, 19, &pRole->priority);
+        } else {
+            fprintf(stderr, "Topology: unknown setting '%s' for %s\n", word, s_roleNames[role]);
+            return -1;
+        }
+        if (result != 0) {
+            fprintf(stderr, "Topology: bad value '%s' for %s %s\n", value, s_roleNames[role], word);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int Topology_parse(const char *text, const char *name, Topology_t *pTopology)
+{
+    Topology_t topology;
+    memset(&topology, 0, sizeof(topology));
+    snprintf(topology.name, sizeof(topology.name), "%s", name);
+
+    char *copy = strdup(text);
+    if (copy == NULL) {
+        return -1;
+    }
+    int result = 0;
+    int lineNumber = 1;
+    char *p = copy;
+    while (*p != '\0' && result == 0) {
+        size_t length = strcspn(p, ";\n");
+        char separator = p[length];
+        p[length] = '\0';
+        char *comment = strchr(p, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        if (parseEntry(p, &topology) != 0) {
+            fprintf(stderr, "Topology: in %s line %d\n", name, lineNumber);
+            result = -1;
+        }
+        if (separator == '\n') {
+            lineNumber++;
+        }
+        p += length + (separator != '\0');
+    }
+    free(copy);
+    if (result == 0) {
+        *pTopology = topology;
+    }
+    return result;
+}
+
+int Topology_load(const char *presetOrFile, Topology_t *pTopology)
+{
+    for (int i = 0; i < NUM_PRESETS; i++) {
+        if (strcmp(presetOrFile, s_presets[i].name) == 0) {
+            return Topology_parse(s_presets[i].text, s_presets[i].name, pTopology);
+        }
+    }
+
+    FILE *pFile = fopen(presetOrFile, "r");
+    if (pFile == NULL) {
+        fprintf(stderr, "ERROR: Topology '%s' is neither a preset nor a readable file: %s\n",
+                presetOrFile, strerror(errno));
+        return -1;
+    }
+    char text[MAX_TOPOLOGY_FILE];
+    size_t length = fread(text, 1, sizeof(text) - 1, pFile);
+    bool tooLong = !feof(pFile);
+    fclose(pFile);
+    if (tooLong) {
+        fprintf(stderr, "ERROR: Topology file %s is over %d bytes\n", presetOrFile, MAX_TOPOLOGY_FILE - 1);
+        return -1;
+    }
+    text[length] = '\0';
+    return Topology_parse(text, presetOrFile, pTopology);
+}
+
+int Topology_init(void)
+{
+    const char *setting = getenv("GESTURE_TOPOLOGY");
+    Topology_t topology;
+    if (Topology_load(setting != NULL ? setting : "default", &topology) != 0) {
+        return -1;
+    }
+    Topology_set(&topology);
+    return 0;
+}
+
+void Topology_set(const Topology_t *pTopology)
+{
+    pthread_mutex_lock(&s_mutex);
+    s_current = *pTopology;
+    memset(s_reported, 0, sizeof(s_reported));
+    pthread_mutex_unlock(&s_mutex);
+}
+
+void Topology_get(Topology_t *pTopology)
+{
+    pthread_mutex_lock(&s_mutex);
+    *pTopology = s_current;
+    pthread_mutex_unlock(&s_mutex);
+}
+
+const char *Topology_getName(void)
+{
+    // Names only change with the whole topology, from the main thread
+    return s_current.name;
+}
+
+int Topology_getPoolSize(enum Topology_role role)
+{
+    if (role < 0 || role >= TOPOLOGY_NUM_ROLES) {
+        return 0;
+    }
+    pthread_mutex_lock(&s_mutex);
+    int poolSize = s_current.roles[role].poolSize;
+    pthread_mutex_unlock(&s_mutex);
+    return poolSize;
+}
+
+static int roleOfThread(const char *threadName)
+{
+    for (int role = 0; role < TOPOLOGY_NUM_ROLES; role++) {
+        for (int i = 0; i < MAX_PREFIXES && s_rolePrefixes[role][i] != NULL; i++) {
+            const char *prefix = s_rolePrefixes[role][i];
+            if (strncmp(threadName, prefix, strlen(prefix)) == 0) {
+                return role;
+            }
+        }
+    }
+    return -1;
+}
+
+// Report a failure once per role until the topology changes. Called with
+// s_mutex held.
+static void reportFailure(int role, const char *what, int error)
+{
+    if (!s_reported[role]) {
+        s_reported[role] = true;
+        fprintf(stderr, "Topology: unable to set %s for %s threads: %s\n",
+                what, s_roleNames[role], strerror(error));
+    }
+}
+
+// Called with s_mutex held. Returns 0 if everything was applied.
+static int applyToThread(pid_t tid, int role)
+{
+    const Topology_roleConfig_t *pRole = &s_current.roles[role];
+    int result = 0;
+
+    // Start from the CPUs the process may use (the main thread is never
+    // moved), so a topology for more CPUs than this machine has still runs
+    cpu_set_t cpus;
+    if (sched_getaffinity(getpid(), sizeof(cpus), &cpus) != 0) {
+        reportFailure(role, "cpus", errno);
+        return -1;
+    }
+    cpu_set_t allowed = cpus;
+    if (pRole->cpus != 0) {
+        for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+            if (!(pRole->cpus & (1u << cpu))) {
+                CPU_CLR(cpu, &cpus);
+            }
+        }
+        if (CPU_COUNT(&cpus) == 0) {
+            reportFailure(role, "cpus (none of them are available, using any)", EINVAL);
+            cpus = allowed;
+            result = -1;
+        }
+    }
+    if (sched_setaffinity(tid, sizeof(cpus), &cpus) != 0) {
+        reportFailure(role, "cpus", errno);
+        result = -1;
+    }
+
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    if (pRole->policy == TOPOLOGY_POLICY_OTHER) {
+        // Leaving a real-time policy never needs privileges
+        if (sched_setscheduler(tid, SCHED_OTHER, &param) != 0) {
+            reportFailure(role, "SCHED_OTHER", errno);
+            result = -1;
+        } else if (setpriority(PRIO_PROCESS, (id_t)tid, pRole->priority) != 0) {
+            reportFailure(role, "nice", errno);
+            result = -1;
+        }
+    } else {
+        param.sched_priority = pRole->priority;
+        int policy = pRole->policy == TOPOLOGY_POLICY_FIFO ? SCHED_FIFO : SCHED_RR;
+        if (sched_setscheduler(tid, policy, &param) != 0) {
+            reportFailure(role, policy == SCHED_FIFO ? "SCHED_FIFO" : "SCHED_RR", errno);
+            result = -1;
+        }
+    }
+    return result;
+}
+
+static bool readThreadName(const char *tidName, char *name, size_t size)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/proc/self/task/%s/comm", tidName);
+    FILE *pFile = fopen(path, "r");
+    if (pFile == NULL) {
+        // It has exited since the directory was read
+        return false;
+    }
+    bool ok = fgets(name, (int)size, pFile) != NULL;
+    fclose(pFile);
+    name[strcspn(name, "\n")] = '\0';
+    return ok;
+}
+
+int Topology_apply(void)
+{
+    DIR *pDir = opendir("/proc/self/task");
+    if (pDir == NULL) {
+        fprintf(stderr, "ERROR: Topology unable to list threads: %s\n", strerror(errno));
+        return 0;
+    }
+    int moved = 0;
+    pthread_mutex_lock(&s_mutex);
+    struct dirent *pEntry;
+    while ((pEntry = readdir(pDir)) != NULL) {
+        if (!isdigit((unsigned char)pEntry->d_name[0])) {
+            continue;
+        }
+        char name[THREAD_NAME_SIZE + 1];
+        if (!readThreadName(pEntry->d_name, name, sizeof(name))) {
+            continue;
+        }
+        pid_t tid = (pid_t)atoi(pEntry->d_name);
+        int role = roleOfThread(name);
+        if (tid == getpid() || role < 0 || !s_current.roles[role].listed) {
+            continue;
+        }
+        if (applyToThread(tid, role) == 0) {
+            moved++;
+        }
+    }
+    pthread_mutex_unlock(&s_mutex);
+    closedir(pDir);
+    return moved;
+}
+
+int Topology_applySelf(void)
+{
+    char name[THREAD_NAME_SIZE];
+    if (pthread_getname_np(pthread_self(), name, sizeof(name)) != 0) {
+        return -1;
+    }
+    int result = -1;
+    pthread_mutex_lock(&s_mutex);
+    pid_t tid = (pid_t)syscall(SYS_gettid);
+    int role = roleOfThread(name);
+    if (tid != getpid() && role >= 0 && s_current.roles[role].listed) {
+        result = applyToThread(tid, role);
+    }
+    pthread_mutex_unlock(&s_mutex);
+    return result;
+}
+
+static void printCpus(unsigned int cpus, FILE *pFile)
+{
+    const char *separator = " cpus=";
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (!(cpus & (1u << cpu))) {
+            continue;
+        }
+        int last = cpu;
+        while (last + 1 < MAX_CPUS && (cpus & (1u << (last + 1)))) {
+            last++;
+        }
+        if (last == cpu) {
+            fprintf(pFile, "%s%d", separator, cpu);
+        } else {
+            fprintf(pFile, "%s%d-%d", separator, cpu, last);
+        }
+        separator = ",";
+        cpu = last;
+    }
+}
+
+void Topology_print(const Topology_t *pTopology, FILE *pFile)
+{
+    fprintf(pFile, "# %s\n", pTopology->name);
+    for (int role = 0; role < TOPOLOGY_NUM_ROLES; role++) {
+        const Topology_roleConfig_t *pRole = &pTopology->roles[role];
+        if (!pRole->listed) {
+            continue;
+        }
+        fprintf(pFile, "%s", s_roleNames[role]);
+        printCpus(pRole->cpus, pFile);
+        if (pRole->policy == TOPOLOGY_POLICY_FIFO) {
+            fprintf(pFile, " fifo=%d", pRole->priority);
+        } else if (pRole->policy == TOPOLOGY_POLICY_RR) {
+            fprintf(pFile, " rr=%d", pRole->priority);
+        } else if (pRole->priority != 0) {
+            fprintf(pFile, " nice=%d", pRole->priority);
+        }
+        if (pRole->poolSize > 0) {
+            fprintf(pFile, " threads=%d", pRole->poolSize);
+        }
+        fprintf(pFile, "\n");
+    }
+}
+
+const char *Topology_roleName(enum Topology_role role)
+{
+    if (role < 0 || role >= TOPOLOGY_NUM_ROLES) {
+        return "?";
+    }
+    return s_roleNames[role];
+}
@@ -0,0 +1,100 @@
+// Where each kind of thread runs: the CPUs it may use, its scheduling
+// policy and priority, and how many threads the pools start.
+// Usage:
+//  - Topology_init() picks the topology from GESTURE_TOPOLOGY (a preset
+//    name or a file), else the "default" preset.
+//  - Pools read their size with Topology_getPoolSize() when they start.
+//  - Topology_apply() once the threads are running moves every thread whose
+//    name belongs to a role; threads started later call Topology_applySelf()
+//    after naming themselves. The main thread is never moved.
+//
+// A topology is text, one role per line (or separated by ';'), '#' comments:
+//     <role> [cpus=<list>] [fifo=<1..99> | rr=<1..99> | nice=<-20..19>] [threads=<n>]
+// e.g. "audio cpus=3 fifo=20" or "graph cpus=0-2 nice=-5 threads=3".
+// Settings left out of a listed role go back to the defaults (any CPU,
+// SCHED_OTHER at nice 0, the pool's own size); roles not listed are left
+// alone. Real-time policies and negative nice need CAP_SYS_NICE; without it
+// the rest is still applied and the failure reported once per role.
+#ifndef _THREAD_TOPOLOGY_H_
+#define _THREAD_TOPOLOGY_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TOPOLOGY_MAX_NAME 32
+
+enum Topology_role {
+    TOPOLOGY_ROLE_AUDIO,            // ALSA playback ("audio_playback")
+    TOPOLOGY_ROLE_CAMERA,           // Camera capture and landmarks ("gesture_cam")
+    TOPOLOGY_ROLE_GRAPH,            // MediaPipe scheduler pool ("mp_graph/<tid>")
+    TOPOLOGY_ROLE_INFERENCE,        // XNNPACK threads per model (pool size only;
+                                    // they run as "mp_graph" threads)
+    TOPOLOGY_ROLE_OPENCV,           // OpenCV's pool (size only; it runs as the
+                                    // threads that call it)
+    TOPOLOGY_ROLE_LCD,              // LCD rendering and SPI writes ("lcd_render")
+    TOPOLOGY_ROLE_NETWORK,          // libwebsockets service ("ws_service")
+    TOPOLOGY_ROLE_INPUT,            // Joystick, rotary and input actions
+    TOPOLOGY_ROLE_BACKGROUND,       // Logging, asset refresh, metrics, timers
+    TOPOLOGY_NUM_ROLES
+};
+
+enum Topology_policy {
+    TOPOLOGY_POLICY_OTHER,          // SCHED_OTHER at `priority` as nice
+    TOPOLOGY_POLICY_FIFO,
+    TOPOLOGY_POLICY_RR,
+};
+
+typedef struct {
+    bool listed;                    // Mentioned in the topology at all
+    unsigned int cpus;              // Bit per CPU; 0 = any
+    enum Topology_policy policy;
+    int priority;                   // Real-time priority, or nice for OTHER
+    int poolSize;                   // 0 = the pool's default
+} Topology_roleConfig_t;
+
+typedef struct {
+    char name[TOPOLOGY_MAX_NAME];
+    Topology_roleConfig_t roles[TOPOLOGY_NUM_ROLES];
+} Topology_t;
+
+// NULL-terminated names of the built-in topologies
+extern const char *const Topology_presetNames[];
+
+// Load the topology named by GESTURE_TOPOLOGY, or the "default" preset,
+// and make it current. Returns 0, or -1 if the setting couldn't be used
+// (the current topology is then left as it was).
+int Topology_init(void);
+
+// Parse topology text. Returns 0, or -1 with the line reported to stderr.
+int Topology_parse(const char *text, const char *name, Topology_t *pTopology);
+// A preset by name, or else a topology file. Returns 0 or -1.
+int Topology_load(const char *presetOrFile, Topology_t *pTopology);
+
+// Make pTopology current (pools pick up sizes when they next start)
+void Topology_set(const Topology_t *pTopology);
+void Topology_get(Topology_t *pTopology);
+const char *Topology_getName(void);
+// The current pool size for role, or 0 for the pool's default
+int Topology_getPoolSize(enum Topology_role role);
+
+// Apply the current topology to every running thread of this process that
+// belongs to a listed role. Returns how many threads were moved.
+int Topology_apply(void);
+// Apply it to the calling thread only, by its name. Returns 0, or -1 if it
+// belongs to no listed role or couldn't be (fully) applied.
+int Topology_applySelf(void);
+
+// Write the topology in the form Topology_parse() reads
+void Topology_print(const Topology_t *pTopology, FILE *pFile);
+
+const char *Topology_roleName(enum Topology_role role);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
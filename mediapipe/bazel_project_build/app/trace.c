@@ -0,0 +1,442 @@
+#define _GNU_SOURCE
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// Chrome trace phases
+#define PHASE_BEGIN 'B'
+#define PHASE_END 'E'
+#define PHASE_COMPLETE 'X'
+#define PHASE_INSTANT 'i'
+#define PHASE_COUNTER 'C'
+#define PHASE_FLOW_START 's'
+#define PHASE_FLOW_STEP 't'
+#define PHASE_FLOW_END 'f'
+
+// Tracks from Trace_complete() get tids that can't clash with real ones
+#define TRACK_TID_BASE 0x40000000
+#define MAX_TRACKS 256
+#define MAX_INTERNED 256
+
+// Every field is atomic so the dump can read a ring while its thread keeps
+// writing: seq is a per-slot seqlock, 0 while the slot is being written and
+// index + 1 once the event at that index is complete.
+typedef struct {
+    atomic_ullong seq;
+    atomic_llong timeNs;
+    atomic_uintptr_t name;
+    atomic_ullong arg;          // Flow id, counter value bits, or span end time
+    atomic_int phaseAndTrack;   // phase | track << 8
+} traceEvent_t;
+
+typedef struct threadRing {
+    struct threadRing *pNext;
+    pid_t tid;
+    char threadName[16];
+    atomic_bool retired;            // Its thread has exited
+    atomic_ullong firstIndex;       // Events before this belong to a previous thread
+    atomic_ullong nextIndex;        // Only written by the owning thread
+    traceEvent_t events[TRACE_EVENTS_PER_THREAD];
+} threadRing_t;
+
+static atomic_bool s_enabled = false;
+static atomic_ullong s_nextFlowId = 1;
+
+// Ring list changes and dumps take the lock; recording doesn't
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static threadRing_t *s_rings = NULL;
+static int s_numRings = 0;
+static pthread_key_t s_ringKey;
+static pthread_once_t s_keyOnce = PTHREAD_ONCE_INIT;
+static __thread threadRing_t *t_ring = NULL;
+static __thread int t_depth = 0;
+static __thread unsigned long long t_flowId = 0;
+
+static char *s_interned[MAX_INTERNED];
+static int s_numInterned = 0;
+static char s_trackPrefix[TRACE_MAX_NAME] = "track ";
+
+
+static void retireRing(void *pRing)
+{
+    atomic_store(&((threadRing_t *)pRing)->retired, true);
+}
+
+static void createKey(void)
+{
+    pthread_key_create(&s_ringKey, retireRing);
+}
+
+void Trace_init(void)
+{
+    pthread_once(&s_keyOnce, createKey);
+    const char *enable = getenv("GESTURE_TRACE");
+    if (enable != NULL && atoi(enable) != 0) {
+        Trace_setEnabled(true);
+    }
+}
+
+void Trace_cleanup(void)
+{
+    // Rings stay allocated: threads that are still running may hold them
+    Trace_setEnabled(false);
+}
+
+void Trace_setEnabled(bool enabled)
+{
+    atomic_store(&s_enabled, enabled);
+}
+
+bool Trace_isEnabled(void)
+{
+    return atomic_load_explicit(&s_enabled, memory_order_relaxed);
+}
+
+long long Trace_nowNs(void)
+{
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (long long)spec.tv_sec * 1000000000LL + spec.tv_nsec;
+}
+
+const char *Trace_intern(const char *name)
+{
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < s_numInterned; i++) {
+        if (strcmp(s_interned[i], name) == 0) {
+            pthread_mutex_unlock(&s_lock);
+            return s_interned[i];
+        }
+    }
+    const char *result = "(too many names)";
+    if (s_numInterned < MAX_INTERNED) {
+        char *copy = strdup(name);
+        if (copy != NULL) {
+            s_interned[s_numInterned++] = copy;
+            result = copy;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return result;
+}
+
+void Trace_setTrackPrefix(const char *trackPrefix)
+{
+    pthread_mutex_lock(&s_lock);
+    snprintf(s_trackPrefix, sizeof(s_trackPrefix), "%s", trackPrefix);
+    pthread_mutex_unlock(&s_lock);
+}
+
+static void readThreadName(pid_t tid, char *name, size_t size)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/comm", (int)tid);
+    FILE *pFile = fopen(path, "r");
+    if (pFile == NULL) {
+        return;
+    }
+    if (fgets(name, size, pFile) != NULL) {
+        name[strcspn(name, "\n")] = '\0';
+    }
+    fclose(pFile);
+}
+
+// The calling thread's ring, taking over a retired one if there are
+// already TRACE_MAX_THREADS. NULL if none can be had.
+static threadRing_t *getRing(void)
+{
+    if (t_ring != NULL) {
+        return t_ring;
+    }
+    pthread_once(&s_keyOnce, createKey);
+    pid_t tid = (pid_t)syscall(SYS_gettid);
+
+    pthread_mutex_lock(&s_lock);
+    threadRing_t *pRing = NULL;
+    if (s_numRings < TRACE_MAX_THREADS) {
+        pRing = calloc(1, sizeof(*pRing));
+        if (pRing != NULL) {
+            pRing->pNext = s_rings;
+            s_rings = pRing;
+            s_numRings++;
+        }
+    } else {
+        for (threadRing_t *p = s_rings; p != NULL; p = p->pNext) {
+            if (atomic_load(&p->retired)) {
+                pRing = p;
+                atomic_store(&pRing->firstIndex, atomic_load(&pRing->nextIndex));
+                atomic_store(&pRing->retired, false);
+                break;
+            }
+        }
+    }
+    if (pRing != NULL) {
+        pRing->tid = tid;
+        strcpy(pRing->threadName, "thread");
+        readThreadName(tid, pRing->threadName, sizeof(pRing->threadName));
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    if (pRing != NULL) {
+        pthread_setspecific(s_ringKey, pRing);
+    }
+    t_ring = pRing;
+    return pRing;
+}
+
+static void record(char phase, const char *name, long long timeNs,
+        unsigned long long arg, int track)
+{
+    threadRing_t *pRing = getRing();
+    if (pRing == NULL) {
+        return;
+    }
+    unsigned long long index = atomic_load_explicit(&pRing->nextIndex, memory_order_relaxed);
+    traceEvent_t *pEvent = &pRing->events[index % TRACE_EVENTS_PER_THREAD];
+
+    atomic_store_explicit(&pEvent->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&pEvent->timeNs, timeNs, memory_order_relaxed);
+    atomic_store_explicit(&pEvent->name, (uintptr_t)name, memory_order_relaxed);
+    atomic_store_explicit(&pEvent->arg, arg, memory_order_relaxed);
+    atomic_store_explicit(&pEvent->phaseAndTrack, phase | track << 8, memory_order_relaxed);
+    atomic_store_explicit(&pEvent->seq, index + 1, memory_order_release);
+    atomic_store_explicit(&pRing->nextIndex, index + 1, memory_order_release);
+}
+
+void Trace_begin(const char *name)
+{
+    if (!Trace_isEnabled()) {
+        return;
+    }
+    record(PHASE_BEGIN, name, Trace_nowNs(), 0, 0);
+    t_depth++;
+}
+
+void Trace_end(void)
+{
+    // Close spans that were opened, even if tracing was disabled since
+    if (t_depth == 0) {
+        return;
+    }
+    t_depth--;
+    record(PHASE_END, NULL, Trace_nowNs(), 0, 0);
+}
+
+void Trace_complete(const char *name, long long startNs, long long endNs, int track)
+{
+    if (!Trace_isEnabled() || track < 0 || track >= MAX_TRACKS) {
+        return;
+    }
+    record(PHASE_COMPLETE, name, startNs, endNs > startNs ? endNs : startNs, track);
+}
+
+void Trace_instant(const char *name)
+{
+    if (Trace_isEnabled()) {
+        record(PHASE_INSTANT, name, Trace_nowNs(), 0, 0);
+    }
+}
+
+void Trace_counter(const char *name, double value)
+{
+    if (Trace_isEnabled()) {
+        unsigned long long bits;
+        memcpy(&bits, &value, sizeof(bits));
+        record(PHASE_COUNTER, name, Trace_nowNs(), bits, 0);
+    }
+}
+
+unsigned long long Trace_newFlowId(void)
+{
+    return atomic_fetch_add_explicit(&s_nextFlowId, 1, memory_order_relaxed);
+}
+
+void Trace_flowStart(const char *name, unsigned long long flowId)
+{
+    if (Trace_isEnabled() && flowId != 0) {
+        record(PHASE_FLOW_START, name, Trace_nowNs(), flowId, 0);
+    }
+}
+
+void Trace_flowStep(const char *name, unsigned long long flowId)
+{
+    if (Trace_isEnabled() && flowId != 0) {
+        record(PHASE_FLOW_STEP, name, Trace_nowNs(), flowId, 0);
+    }
+}
+
+void Trace_flowEnd(const char *name, unsigned long long flowId)
+{
+    if (Trace_isEnabled() && flowId != 0) {
+        record(PHASE_FLOW_END, name, Trace_nowNs(), flowId, 0);
+    }
+}
+
+void Trace_setFlow(unsigned long long flowId)
+{
+    t_flowId = flowId;
+}
+
+unsigned long long Trace_getFlow(void)
+{
+    return t_flowId;
+}
+
+
+static void writeJsonString(FILE *pFile, const char *text)
+{
+    fputc('"', pFile);
+    for (const char *p = text; *p != '\0'; p++) {
+        unsigned char c = *p;
+        if (c == '"' || c == '\\') {
+            fprintf(pFile, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(pFile, "\\u%04x", c);
+        } else {
+            fputc(c, pFile);
+        }
+    }
+    fputc('"', pFile);
+}
+
+static void writeThreadName(FILE *pFile, int pid, int tid, const char *prefix,
+        const char *name, bool *pFirst)
+{
+    fprintf(pFile, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,"
+            "\"args\":{\"name\":", *pFirst ? "" : ",\n", pid, tid);
+    char label[TRACE_MAX_NAME + 32];
+    snprintf(label, sizeof(label), "%s%s", prefix, name);
+    writeJsonString(pFile, label);
+    fputs("}}", pFile);
+    *pFirst = false;
+}
+
+// Copy out the event at index if it is still in the ring and complete
+static bool readEvent(const threadRing_t *pRing, unsigned long long index,
+        long long *pTimeNs, const char **pName, unsigned long long *pArg, int *pPhaseAndTrack)
+{
+    const traceEvent_t *pEvent = &pRing->events[index % TRACE_EVENTS_PER_THREAD];
+    unsigned long long seq = atomic_load_explicit(&pEvent->seq, memory_order_acquire);
+    *pTimeNs = atomic_load_explicit(&pEvent->timeNs, memory_order_relaxed);
+    *pName = (const char *)atomic_load_explicit(&pEvent->name, memory_order_relaxed);
+    *pArg = atomic_load_explicit(&pEvent->arg, memory_order_relaxed);
+    *pPhaseAndTrack = atomic_load_explicit(&pEvent->phaseAndTrack, memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    return seq == index + 1 &&
+            atomic_load_explicit(&pEvent->seq, memory_order_relaxed) == seq;
+}
+
+static void writeRing(FILE *pFile, int pid, threadRing_t *pRing, bool *pFirst,
+        bool *tracksSeen)
+{
+    if (!atomic_load(&pRing->retired)) {
+        readThreadName(pRing->tid, pRing->threadName, sizeof(pRing->threadName));
+    }
+    writeThreadName(pFile, pid, pRing->tid, "", pRing->threadName, pFirst);
+
+    unsigned long long endIndex = atomic_load_explicit(&pRing->nextIndex, memory_order_acquire);
+    unsigned long long startIndex = atomic_load(&pRing->firstIndex);
+    if (endIndex - startIndex > TRACE_EVENTS_PER_THREAD) {
+        startIndex = endIndex - TRACE_EVENTS_PER_THREAD;
+    }
+    // Skip Ends whose Begin was overwritten, so spans still pair up
+    int depth = 0;
+    for (unsigned long long index = startIndex; index < endIndex; index++) {
+        long long timeNs;
+        const char *name;
+        unsigned long long arg;
+        int phaseAndTrack;
+        if (!readEvent(pRing, index, &timeNs, &name, &arg, &phaseAndTrack)) {
+            continue;
+        }
+        char phase = phaseAndTrack & 0xff;
+        int track = phaseAndTrack >> 8;
+        if (phase == PHASE_BEGIN) {
+            depth++;
+        } else if (phase == PHASE_END) {
+            if (depth == 0) {
+                continue;
+            }
+            depth--;
+        }
+
+        int tid = pRing->tid;
+        if (track != 0) {
+            tid = TRACK_TID_BASE + track;
+            tracksSeen[track] = true;
+        }
+        fprintf(pFile, "%s{\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f",
+                *pFirst ? "" : ",\n", phase, pid, tid, timeNs / 1000.0);
+        *pFirst = false;
+        if (name != NULL) {
+            fputs(",\"name\":", pFile);
+            writeJsonString(pFile, name);
+        }
+        switch (phase) {
+        case PHASE_COMPLETE:
+            fprintf(pFile, ",\"dur\":%.3f", ((long long)arg - timeNs) / 1000.0);
+            break;
+        case PHASE_INSTANT:
+            fputs(",\"s\":\"t\"", pFile);
+            break;
+        case PHASE_COUNTER: {
+            double value;
+            memcpy(&value, &arg, sizeof(value));
+            fprintf(pFile, ",\"args\":{\"value\":%.6g}", value);
+            break;
+        }
+        case PHASE_FLOW_START:
+        case PHASE_FLOW_STEP:
+        case PHASE_FLOW_END:
+            // Bind to the span that encloses the flow event on this thread
+            // (steps and ends otherwise bind to the next span to start)
+            fprintf(pFile, ",\"cat\":\"flow\",\"id\":%llu%s", arg,
+                    phase != PHASE_FLOW_START ? ",\"bp\":\"e\"" : "");
+            break;
+        default:
+            break;
+        }
+        fputc('}', pFile);
+    }
+}
+
+int Trace_dump(const char *fileName)
+{
+    FILE *pFile = fopen(fileName, "w");
+    if (pFile == NULL) {
+        fprintf(stderr, "ERROR: Unable to write trace to %s.\n", fileName);
+        return -1;
+    }
+    int pid = getpid();
+    bool first = true;
+    bool tracksSeen[MAX_TRACKS] = { false };
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", pFile);
+    pthread_mutex_lock(&s_lock);
+    for (threadRing_t *pRing = s_rings; pRing != NULL; pRing = pRing->pNext) {
+        writeRing(pFile, pid, pRing, &first, tracksSeen);
+    }
+    for (int track = 1; track < MAX_TRACKS; track++) {
+        if (tracksSeen[track]) {
+            char number[16];
+            snprintf(number, sizeof(number), "%d", track);
+            writeThreadName(pFile, pid, TRACK_TID_BASE + track, s_trackPrefix, number, &first);
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    fputs("\n]}\n", pFile);
+
+    if (fclose(pFile) != 0) {
+        fprintf(stderr, "ERROR: Unable to write trace to %s.\n", fileName);
+        return -1;
+    }
+    return 0;
+}
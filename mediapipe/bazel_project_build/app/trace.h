@@ -0,0 +1,85 @@
+// Timeline tracing across threads, exported as Chrome trace JSON (open the
+// file in chrome://tracing or https://ui.perfetto.dev).
+// Usage:
+//  1. Trace_setEnabled(true) (or start with GESTURE_TRACE=1).
+//  2. Wrap interesting work in Trace_begin()/Trace_end(), or TRACE_SCOPE()
+//     in C++. Spans on one thread must nest.
+//  3. To follow one item (e.g. a camera frame) across threads, take a
+//     Trace_newFlowId() and mark it with Trace_flowStart/Step/End() inside
+//     spans on each thread it passes through. Trace_setFlow() remembers
+//     the id for the current thread so code further down the call chain can
+//     pick it up with Trace_getFlow() without passing it around.
+//  4. Trace_dump() writes the most recent events of every thread.
+//
+// Each thread records into its own ring of TRACE_EVENTS_PER_THREAD events
+// with no locks, so old events are overwritten rather than ever blocking.
+// The ring is allocated on the thread's first event. While disabled every
+// call returns after one relaxed load.
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_EVENTS_PER_THREAD 8192
+// Threads with a ring at once; rings of exited threads are reused after this
+#define TRACE_MAX_THREADS 32
+#define TRACE_MAX_NAME 48
+
+void Trace_init(void);
+void Trace_cleanup(void);
+
+void Trace_setEnabled(bool enabled);
+bool Trace_isEnabled(void);
+
+// Monotonic clock used for all events, in ns
+long long Trace_nowNs(void);
+
+// Event names are stored by pointer: pass string literals, or names from
+// Trace_intern(), which keeps one copy of each distinct string.
+const char *Trace_intern(const char *name);
+
+void Trace_begin(const char *name);
+void Trace_end(void);
+// A finished span with explicit times, optionally drawn on a separate
+// numbered track (e.g. another framework's worker thread); track 0 is the
+// calling thread. Tracks are labelled trackPrefix + number in the export.
+void Trace_complete(const char *name, long long startNs, long long endNs, int track);
+void Trace_instant(const char *name);
+void Trace_counter(const char *name, double value);
+
+unsigned long long Trace_newFlowId(void);
+void Trace_flowStart(const char *name, unsigned long long flowId);
+void Trace_flowStep(const char *name, unsigned long long flowId);
+void Trace_flowEnd(const char *name, unsigned long long flowId);
+void Trace_setFlow(unsigned long long flowId);
+unsigned long long Trace_getFlow(void);
+
+// Label for tracks passed to Trace_complete(), e.g. "mediapipe "
+void Trace_setTrackPrefix(const char *trackPrefix);
+
+// Write everything still in the rings as Chrome trace JSON.
+// Returns 0, or -1 if the file can't be written.
+int Trace_dump(const char *fileName);
+
+#ifdef __cplusplus
+}
+
+// Trace_begin() now, Trace_end() when the scope exits
+class TraceScope {
+public:
+    explicit TraceScope(const char *name) { Trace_begin(name); }
+    ~TraceScope() { Trace_end(); }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#endif
+
+#endif
@@ -0,0 +1,263 @@
+#include "waveLoader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#define WAVE_FORMAT_PCM         0x0001
+#define WAVE_FORMAT_IEEE_FLOAT  0x0003
+#define WAVE_FORMAT_EXTENSIBLE  0xFFFE
+
+typedef struct {
+    unsigned int format;
+    unsigned int channels;
+    unsigned int sampleRate;
+    unsigned int bitsPerSample;
+    unsigned int blockAlign;
+} waveFormat_t;
+
+// WAVE files are little-endian whatever the host is
+static uint16_t readLe16(const unsigned char *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t readLe32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool parseFormat(const unsigned char *chunk, uint32_t size, waveFormat_t *pFormat,
+        const char *name)
+{
+    if (size < 16) {
+        fprintf(stderr, "ERROR: %s: fmt chunk too short (%u bytes).\n", name, size);
+        return false;
+    }
+    pFormat->format = readLe16(chunk);
+    pFormat->channels = readLe16(chunk + 2);
+    pFormat->sampleRate = readLe32(chunk + 4);
+    pFormat->blockAlign = readLe16(chunk + 12);
+    pFormat->bitsPerSample = readLe16(chunk + 14);
+
+    // WAVEFORMATEXTENSIBLE: the real format is the first two bytes of the
+    // sub-format GUID, after cbSize(2), validBits(2) and channelMask(4).
+    if (pFormat->format == WAVE_FORMAT_EXTENSIBLE) {
+        if (size < 40) {
+            fprintf(stderr, "ERROR: %s: extensible fmt chunk too short.\n", name);
+            return false;
+        }
+        pFormat->format = readLe16(chunk + 24);
+    }
+
+    bool supported =
+        (pFormat->format == WAVE_FORMAT_PCM &&
+            (pFormat->bitsPerSample == 8 || pFormat->bitsPerSample == 16 ||
+             pFormat->bitsPerSample == 24 || pFormat->bitsPerSample == 32)) ||
+        (pFormat->format == WAVE_FORMAT_IEEE_FLOAT &&
+            (pFormat->bitsPerSample == 32 || pFormat->bitsPerSample == 64));
+    if (!supported) {
+        fprintf(stderr, "ERROR: %s: unsupported format 0x%04x, %u bits.\n",
+                name, pFormat->format, pFormat->bitsPerSample);
+        return false;
+    }
+    if (pFormat->channels == 0 || pFormat->sampleRate == 0 ||
+            pFormat->blockAlign < pFormat->channels * (pFormat->bitsPerSample / 8)) {
+        fprintf(stderr, "ERROR: %s: inconsistent fmt chunk (%u channels, %u Hz, align %u).\n",
+                name, pFormat->channels, pFormat->sampleRate, pFormat->blockAlign);
+        return false;
+    }
+    return true;
+}
+
+// One sample of any supported encoding, scaled to [-1, 1)
+static float decodeSample(const unsigned char *p, const waveFormat_t *pFormat)
+{
+    if (pFormat->format == WAVE_FORMAT_IEEE_FLOAT) {
+        if (pFormat->bitsPerSample == 32) {
+            uint32_t bits = readLe32(p);
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+        uint64_t bits = readLe32(p) | ((uint64_t)readLe32(p + 4) << 32);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return (float)value;
+    }
+    switch (pFormat->bitsPerSample) {
+    case 8:
+        return (p[0] - 128) / 128.0f;
+    case 16:
+        return (int16_t)readLe16(p) / 32768.0f;
+    case 24:
+        return (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24)
+                / 2147483648.0f;
+    default:
+        return (int32_t)readLe32(p) / 2147483648.0f;
+    }
+}
+
+static short toS16(float value)
+{
+    float scaled = value * 32768.0f;
+    if (scaled >= 32767.0f) {
+        return 32767;
+    }
+    if (scaled <= -32768.0f) {
+        return -32768;
+    }
+    return (short)lrintf(scaled);
+}
+
+int WaveLoader_decode(const void *bytes, size_t size, unsigned int sampleRate,
+        const char *name, short **ppData, int *pNumSamples)
+{
+    const unsigned char *file = bytes;
+    *ppData = NULL;
+    *pNumSamples = 0;
+
+    if (size < 12 || memcmp(file, "RIFF", 4) != 0 || memcmp(file + 8, "WAVE", 4) != 0) {
+        fprintf(stderr, "ERROR: %s is not a RIFF/WAVE file.\n", name);
+        return -1;
+    }
+
+    // Walk the chunks; only fmt and data matter (LIST, fact, cue... are skipped)
+    waveFormat_t format = {0};
+    bool haveFormat = false;
+    const unsigned char *data = NULL;
+    size_t dataSize = 0;
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        const unsigned char *chunk = file + pos + 8;
+        size_t chunkSize = readLe32(file + pos + 4);
+        size_t available = size - pos - 8;
+        if (memcmp(file + pos, "fmt ", 4) == 0) {
+            if (chunkSize > available ||
+                    !parseFormat(chunk, (uint32_t)chunkSize, &format, name)) {
+                if (chunkSize > available) {
+                    fprintf(stderr, "ERROR: %s: truncated fmt chunk.\n", name);
+                }
+                return -1;
+            }
+            haveFormat = true;
+        } else if (memcmp(file + pos, "data", 4) == 0) {
+            // Tolerate writers that leave the size at 0 / 0xFFFFFFFF or
+            // files cut short: use what is actually there.
+            data = chunk;
+            dataSize = (chunkSize == 0 || chunkSize > available) ? available : chunkSize;
+            break;
+        }
+        if (chunkSize >= available) {
+            break;
+        }
+        // Chunks are padded to an even size
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+    if (!haveFormat || data == NULL) {
+        fprintf(stderr, "ERROR: %s: missing %s chunk.\n", name, haveFormat ? "data" : "fmt");
+        return -1;
+    }
+
+    size_t inFrames = dataSize / format.blockAlign;
+    if (inFrames == 0) {
+        fprintf(stderr, "ERROR: %s has no samples.\n", name);
+        return -1;
+    }
+
+    // Downmix to mono floats
+    float *mono = malloc(inFrames * sizeof(*mono));
+    if (mono == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate %zu frames for %s.\n", inFrames, name);
+        return -1;
+    }
+    unsigned int bytesPerSample = format.bitsPerSample / 8;
+    for (size_t i = 0; i < inFrames; i++) {
+        const unsigned char *frame = data + i * format.blockAlign;
+        float sum = 0;
+        for (unsigned int c = 0; c < format.channels; c++) {
+            sum += decodeSample(frame + c * bytesPerSample, &format);
+        }
+        mono[i] = sum / format.channels;
+    }
+
+    // Resample (linear interpolation) to the output rate
+    size_t outFrames = (size_t)((double)inFrames * sampleRate / format.sampleRate);
+    if (outFrames == 0) {
+        outFrames = 1;
+    }
+    if (outFrames > INT32_MAX) {
+        fprintf(stderr, "ERROR: %s is too long.\n", name);
+        free(mono);
+        return -1;
+    }
+    short *out = malloc(outFrames * sizeof(*out));
+    if (out == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate %zu samples for %s.\n", outFrames, name);
+        free(mono);
+        return -1;
+    }
+    if (format.sampleRate == sampleRate) {
+        for (size_t i = 0; i < outFrames; i++) {
+            out[i] = toS16(mono[i]);
+        }
+    } else {
+        double step = (double)format.sampleRate / sampleRate;
+        for (size_t i = 0; i < outFrames; i++) {
+            double position = i * step;
+            size_t index = (size_t)position;
+            float fraction = (float)(position - index);
+            float a = mono[index];
+            float b = index + 1 < inFrames ? mono[index + 1] : a;
+            out[i] = toS16(a + (b - a) * fraction);
+        }
+    }
+    free(mono);
+
+    *ppData = out;
+    *pNumSamples = (int)outFrames;
+    return 0;
+}
+
+int WaveLoader_load(const char *fileName, unsigned int sampleRate,
+        short **ppData, int *pNumSamples)
+{
+    *ppData = NULL;
+    *pNumSamples = 0;
+
+    FILE *file = fopen(fileName, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "ERROR: Unable to open file %s.\n", fileName);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size <= 0) {
+        fprintf(stderr, "ERROR: Unable to read file %s.\n", fileName);
+        fclose(file);
+        return -1;
+    }
+
+    void *bytes = malloc(size);
+    if (bytes == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate %ld bytes for file %s.\n", size, fileName);
+        fclose(file);
+        return -1;
+    }
+    size_t bytesRead = fread(bytes, 1, size, file);
+    fclose(file);
+    if (bytesRead != (size_t)size) {
+        fprintf(stderr, "ERROR: Unable to read %ld bytes from file %s (read %zu).\n",
+                size, fileName, bytesRead);
+        free(bytes);
+        return -1;
+    }
+
+    int result = WaveLoader_decode(bytes, size, sampleRate, fileName, ppData, pNumSamples);
+    free(bytes);
+    return result;
+}
@@ -0,0 +1,33 @@
+// Decode RIFF/WAVE files into the mixer's native format (mono S16 at a
+// given sample rate). Chunks are walked rather than assuming a fixed
+// 44-byte header, and any channel count / rate / common sample format is
+// converted once here so playback never has to.
+#ifndef WAVE_LOADER_H
+#define WAVE_LOADER_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Supported input: PCM 8/16/24/32 bit, IEEE float 32/64 bit, including
+// WAVE_FORMAT_EXTENSIBLE wrappers of those; any number of channels
+// (downmixed by averaging) and any rate (linearly resampled).
+
+// Decode a whole WAVE file held in memory.
+// On success returns 0 and stores a malloc'd buffer of *pNumSamples
+// samples in *ppData (caller frees). On failure prints why (prefixed with
+// name) and returns -1, leaving *ppData NULL and *pNumSamples 0.
+int WaveLoader_decode(const void *bytes, size_t size, unsigned int sampleRate,
+        const char *name, short **ppData, int *pNumSamples);
+
+// Read fileName with a single read and decode it as above.
+int WaveLoader_load(const char *fileName, unsigned int sampleRate,
+        short **ppData, int *pNumSamples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
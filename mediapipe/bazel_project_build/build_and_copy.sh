@@ -6,9 +6,16 @@ cd "$(dirname "$0")/.." || exit
 # Make sure destination directory exists
 mkdir -p ~/cmpt433/public/mediapipe
 
+# --embed compiles the hand graph and models into the executable, so it no
+# longer needs hand_tracking_custom.pbtxt and mediapipe/modules/ beside it
+EXTRA_FLAGS=""
+if [ "$1" == "--embed" ]; then
+    EXTRA_FLAGS="--define EMBED_HAND_GRAPH=1"
+fi
+
 echo "Building project with Bazel..."
 # Build the project using bazel
-bazel build -c opt --crosstool_top=@crosstool//:toolchains --compiler=gcc --cpu=aarch64 --define MEDIAPIPE_DISABLE_GPU=1 //bazel_project_build:gesture_game
+bazel build -c opt --crosstool_top=@crosstool//:toolchains --compiler=gcc --cpu=aarch64 --define MEDIAPIPE_DISABLE_GPU=1 $EXTRA_FLAGS //bazel_project_build:gesture_game
 
 # Check if build was successful
 if [ $? -eq 0 ]; then
@@ -29,3 +29,21 @@ bool CameraHAL::captureFrame(cv::Mat &frame) {
     }
     return cap.read(frame);
 }
+
+bool CameraHAL::isOpen() const {
+    return cap.isOpened();
+}
+
+bool CameraHAL::grabFrame() {
+    if (!cap.isOpened()) {
+        return false;
+    }
+    return cap.grab();
+}
+
+bool CameraHAL::retrieveFrame(cv::Mat &frame) {
+    if (!cap.isOpened()) {
+        return false;
+    }
+    return cap.retrieve(frame);
+}
@@ -11,6 +11,13 @@ public:
     bool openCamera();
     void closeCamera();
     bool captureFrame(cv::Mat &frame);
+    bool isOpen() const;
+
+    // Dequeue the next frame without decoding it, so the stream and its
+    // auto-exposure keep running while nobody needs the pixels
+    bool grabFrame();
+    // Decode the frame taken by the last grabFrame()
+    bool retrieveFrame(cv::Mat &frame);
 
 private:
     std::string cameraDevice;
@@ -0,0 +1,442 @@
+#define _GNU_SOURCE
+#include "input_events.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+// A stamp more than this far ahead of CLOCK_MONOTONIC must be real time
+#define MAX_CLOCK_SKEW_NS 1000000000LL
+#define MAX_LINE 128
+
+// Every field is atomic so readers can copy a slot while a publisher may be
+// overwriting it: state is a per-slot seqlock, 2 * seq + 1 while the event
+// with that seq is being written and 2 * seq + 2 once it's complete.
+typedef struct {
+    atomic_ullong state;
+    atomic_llong timeNs;
+    atomic_int value;
+    atomic_int deviceTypeAndFlags;  // device | type << 8 | injected << 16
+} inputSlot_t;
+
+typedef struct {
+    atomic_bool active;
+    int fd;                         // eventfd, open from init to cleanup
+    unsigned long long cursor;      // Next seq to read; only touched by the reader
+    atomic_ullong dropped;
+} subscriber_t;
+
+static inputSlot_t s_ring[INPUT_QUEUE_SIZE];
+static atomic_ullong s_nextSeq = 0;
+
+// Subscribing takes the lock; publishing and reading don't
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool s_isInitialized = false;
+static subscriber_t s_subscribers[INPUT_MAX_SUBSCRIBERS];
+
+static const char *s_deviceNames[INPUT_NUM_DEVICES] = {
+    "rotary_button",
+    "joystick_button",
+    "joystick",
+};
+static const char *s_typeNames[INPUT_NUM_TYPES] = {
+    "press",
+    "release",
+    "direction",
+};
+
+static pthread_t s_recordThread;
+static FILE *s_pRecordFile = NULL;
+static atomic_bool s_recording = false;
+static pthread_t s_replayThread;
+static FILE *s_pReplayFile = NULL;
+static atomic_bool s_replaying = false;
+static bool s_replayThreadStarted = false;
+
+
+void Input_init(void)
+{
+    pthread_mutex_lock(&s_lock);
+    if (!s_isInitialized) {
+        for (int i = 0; i < INPUT_MAX_SUBSCRIBERS; i++) {
+            s_subscribers[i].fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (s_subscribers[i].fd < 0) {
+                perror("ERROR: Input unable to create eventfd");
+            }
+        }
+        s_isInitialized = true;
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+static void stopReplay(void)
+{
+    if (s_replayThreadStarted) {
+        atomic_store(&s_replaying, false);
+        pthread_join(s_replayThread, NULL);
+        s_replayThreadStarted = false;
+    }
+}
+
+void Input_cleanup(void)
+{
+    Input_stopRecording();
+    stopReplay();
+
+    pthread_mutex_lock(&s_lock);
+    if (s_isInitialized) {
+        for (int i = 0; i < INPUT_MAX_SUBSCRIBERS; i++) {
+            atomic_store(&s_subscribers[i].active, false);
+            if (s_subscribers[i].fd >= 0) {
+                close(s_subscribers[i].fd);
+            }
+            s_subscribers[i].fd = -1;
+        }
+        s_isInitialized = false;
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+static long long timespecToNs(const struct timespec *pTime)
+{
+    return (long long)pTime->tv_sec * 1000000000LL + pTime->tv_nsec;
+}
+
+long long Input_nowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return timespecToNs(&now);
+}
+
+long long Input_kernelTimeToNs(const struct timespec *pEventTime)
+{
+    long long monotonicNow = Input_nowNs();
+    long long eventNs = timespecToNs(pEventTime);
+    // A monotonic stamp is at most a little in the past; a real-time one is
+    // decades ahead of the monotonic clock
+    if (eventNs <= monotonicNow + MAX_CLOCK_SKEW_NS) {
+        return eventNs;
+    }
+    struct timespec realNow;
+    clock_gettime(CLOCK_REALTIME, &realNow);
+    return monotonicNow - (timespecToNs(&realNow) - eventNs);
+}
+
+static void publish(enum Input_device device, enum Input_type type, int value,
+                    long long timeNs, bool injected)
+{
+    unsigned long long seq = atomic_fetch_add(&s_nextSeq, 1);
+    inputSlot_t *pSlot = &s_ring[seq % INPUT_QUEUE_SIZE];
+
+    atomic_store_explicit(&pSlot->state, 2 * seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&pSlot->timeNs, timeNs, memory_order_relaxed);
+    atomic_store_explicit(&pSlot->value, value, memory_order_relaxed);
+    atomic_store_explicit(&pSlot->deviceTypeAndFlags,
+                          (int)device | (int)type << 8 | (injected ? 1 << 16 : 0),
+                          memory_order_relaxed);
+    atomic_store_explicit(&pSlot->state, 2 * seq + 2, memory_order_release);
+
+    // Wake the subscribers. The fds stay open when a slot is unsubscribed,
+    // so a racing unsubscribe at worst leaves one stale wakeup behind.
+    for (int i = 0; i < INPUT_MAX_SUBSCRIBERS; i++) {
+        if (atomic_load_explicit(&s_subscribers[i].active, memory_order_acquire)) {
+            eventfd_write(s_subscribers[i].fd, 1);
+        }
+    }
+}
+
+void Input_publish(enum Input_device device, enum Input_type type, int value)
+{
+    publish(device, type, value, Input_nowNs(), false);
+}
+
+void Input_publishAt(enum Input_device device, enum Input_type type, int value, long long timeNs)
+{
+    publish(device, type, value, timeNs, false);
+}
+
+void Input_inject(enum Input_device device, enum Input_type type, int value)
+{
+    publish(device, type, value, Input_nowNs(), true);
+}
+
+int Input_subscribe(void)
+{
+    int subscriberId = -1;
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < INPUT_MAX_SUBSCRIBERS; i++) {
+        subscriber_t *pSubscriber = &s_subscribers[i];
+        if (atomic_load(&pSubscriber->active) || pSubscriber->fd < 0) {
+            continue;
+        }
+        // Start with the events published from now on
+        eventfd_t stale;
+        eventfd_read(pSubscriber->fd, &stale);
+        pSubscriber->cursor = atomic_load(&s_nextSeq);
+        atomic_store(&pSubscriber->dropped, 0);
+        atomic_store_explicit(&pSubscriber->active, true, memory_order_release);
+        subscriberId = i;
+        break;
+    }
+    pthread_mutex_unlock(&s_lock);
+    if (subscriberId < 0) {
+        fprintf(stderr, "ERROR: Input has no free subscriber slot (or isn't initialized)\n");
+    }
+    return subscriberId;
+}
+
+static bool isValidSubscriber(int subscriberId)
+{
+    return subscriberId >= 0 && subscriberId < INPUT_MAX_SUBSCRIBERS &&
+        atomic_load_explicit(&s_subscribers[subscriberId].active, memory_order_acquire);
+}
+
+void Input_unsubscribe(int subscriberId)
+{
+    if (isValidSubscriber(subscriberId)) {
+        pthread_mutex_lock(&s_lock);
+        atomic_store(&s_subscribers[subscriberId].active, false);
+        pthread_mutex_unlock(&s_lock);
+    }
+}
+
+int Input_getFd(int subscriberId)
+{
+    return isValidSubscriber(subscriberId) ? s_subscribers[subscriberId].fd : -1;
+}
+
+unsigned long long Input_getDropped(int subscriberId)
+{
+    return isValidSubscriber(subscriberId) ? atomic_load(&s_subscribers[subscriberId].dropped) : 0;
+}
+
+bool Input_poll(int subscriberId, Input_event_t *pEvent)
+{
+    if (!isValidSubscriber(subscriberId)) {
+        return false;
+    }
+    subscriber_t *pSubscriber = &s_subscribers[subscriberId];
+
+    while (true) {
+        unsigned long long seq = pSubscriber->cursor;
+        unsigned long long nextSeq = atomic_load_explicit(&s_nextSeq, memory_order_acquire);
+        if (seq >= nextSeq) {
+            return false;
+        }
+        if (nextSeq - seq > INPUT_QUEUE_SIZE) {
+            // Those slots have been reused already
+            atomic_fetch_add(&pSubscriber->dropped, nextSeq - INPUT_QUEUE_SIZE - seq);
+            pSubscriber->cursor = nextSeq - INPUT_QUEUE_SIZE;
+            continue;
+        }
+
+        const inputSlot_t *pSlot = &s_ring[seq % INPUT_QUEUE_SIZE];
+        unsigned long long state = atomic_load_explicit(&pSlot->state, memory_order_acquire);
+        if (state < 2 * seq + 2) {
+            // Claimed but not written yet; the publisher wakes us when it is
+            return false;
+        }
+        long long timeNs = atomic_load_explicit(&pSlot->timeNs, memory_order_relaxed);
+        int value = atomic_load_explicit(&pSlot->value, memory_order_relaxed);
+        int deviceTypeAndFlags = atomic_load_explicit(&pSlot->deviceTypeAndFlags, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (state != 2 * seq + 2 ||
+            atomic_load_explicit(&pSlot->state, memory_order_relaxed) != state) {
+            // Overwritten by a publisher a whole ring ahead
+            atomic_fetch_add(&pSubscriber->dropped, 1);
+            pSubscriber->cursor = seq + 1;
+            continue;
+        }
+
+        pSubscriber->cursor = seq + 1;
+        pEvent->seq = seq;
+        pEvent->timeNs = timeNs;
+        pEvent->value = value;
+        pEvent->device = (enum Input_device)(deviceTypeAndFlags & 0xff);
+        pEvent->type = (enum Input_type)((deviceTypeAndFlags >> 8) & 0xff);
+        pEvent->injected = (deviceTypeAndFlags >> 16) & 1;
+        return true;
+    }
+}
+
+bool Input_wait(int subscriberId, Input_event_t *pEvent, int timeoutMs)
+{
+    long long deadlineNs = Input_nowNs() + (long long)timeoutMs * 1000000LL;
+    while (!Input_poll(subscriberId, pEvent)) {
+        int fd = Input_getFd(subscriberId);
+        if (fd < 0) {
+            return false;
+        }
+        int waitMs = -1;
+        if (timeoutMs >= 0) {
+            long long remainingNs = deadlineNs - Input_nowNs();
+            if (remainingNs <= 0) {
+                return false;
+            }
+            waitMs = (int)((remainingNs + 999999) / 1000000);
+        }
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        if (poll(&pfd, 1, waitMs) > 0) {
+            eventfd_t count;
+            eventfd_read(fd, &count);
+        }
+    }
+    return true;
+}
+
+const char *Input_deviceName(enum Input_device device)
+{
+    return (device >= 0 && device < INPUT_NUM_DEVICES) ? s_deviceNames[device] : "unknown";
+}
+
+const char *Input_typeName(enum Input_type type)
+{
+    return (type >= 0 && type < INPUT_NUM_TYPES) ? s_typeNames[type] : "unknown";
+}
+
+
+/*
+    Recording and replay
+*/
+static void *recordThread(void *pArg)
+{
+    int subscriberId = (int)(long)pArg;
+    long long firstNs = -1;
+    Input_event_t event;
+    while (atomic_load(&s_recording)) {
+        // Short timeout so stopping doesn't need a wakeup of its own
+        if (!Input_wait(subscriberId, &event, 100)) {
+            continue;
+        }
+        if (firstNs < 0) {
+            firstNs = event.timeNs;
+        }
+        fprintf(s_pRecordFile, "%lld %s %s %d\n", (event.timeNs - firstNs) / 1000,
+                Input_deviceName(event.device), Input_typeName(event.type), event.value);
+        fflush(s_pRecordFile);
+    }
+    Input_unsubscribe(subscriberId);
+    return NULL;
+}
+
+int Input_startRecording(const char *fileName)
+{
+    if (atomic_load(&s_recording)) {
+        fprintf(stderr, "ERROR: Input is already recording\n");
+        return -1;
+    }
+    s_pRecordFile = fopen(fileName, "w");
+    if (s_pRecordFile == NULL) {
+        fprintf(stderr, "ERROR: Input unable to open %s for recording\n", fileName);
+        return -1;
+    }
+    fprintf(s_pRecordFile, "# microseconds device type value\n");
+    int subscriberId = Input_subscribe();
+    if (subscriberId < 0) {
+        fclose(s_pRecordFile);
+        s_pRecordFile = NULL;
+        return -1;
+    }
+    atomic_store(&s_recording, true);
+    if (pthread_create(&s_recordThread, NULL, recordThread, (void *)(long)subscriberId) != 0) {
+        perror("ERROR: Input unable to start recording thread");
+        atomic_store(&s_recording, false);
+        Input_unsubscribe(subscriberId);
+        fclose(s_pRecordFile);
+        s_pRecordFile = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void Input_stopRecording(void)
+{
+    if (!atomic_exchange(&s_recording, false)) {
+        return;
+    }
+    pthread_join(s_recordThread, NULL);
+    fclose(s_pRecordFile);
+    s_pRecordFile = NULL;
+}
+
+static int lookupName(const char *name, const char **names, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void *replayThread(void *pArg)
+{
+    (void)pArg;
+    pthread_setname_np(pthread_self(), "input_replay");
+    long long startNs = Input_nowNs();
+    char line[MAX_LINE];
+    while (atomic_load(&s_replaying) && fgets(line, sizeof(line), s_pReplayFile)) {
+        long long offsetUs;
+        char deviceName[32];
+        char typeName[32];
+        int value = 0;
+        if (line[0] == '#' ||
+            sscanf(line, "%lld %31s %31s %d", &offsetUs, deviceName, typeName, &value) < 3) {
+            continue;
+        }
+        int device = lookupName(deviceName, s_deviceNames, INPUT_NUM_DEVICES);
+        int type = lookupName(typeName, s_typeNames, INPUT_NUM_TYPES);
+        if (device < 0 || type < 0) {
+            fprintf(stderr, "ERROR: Input replay skipping unknown event: %s", line);
+            continue;
+        }
+
+        // Sleep in short steps so a replay can be stopped
+        long long dueNs = startNs + offsetUs * 1000;
+        long long remainingNs;
+        while (atomic_load(&s_replaying) && (remainingNs = dueNs - Input_nowNs()) > 0) {
+            long long sleepNs = remainingNs < 100000000LL ? remainingNs : 100000000LL;
+            struct timespec delay = {sleepNs / 1000000000LL, sleepNs % 1000000000LL};
+            nanosleep(&delay, NULL);
+        }
+        if (atomic_load(&s_replaying)) {
+            Input_inject((enum Input_device)device, (enum Input_type)type, value);
+        }
+    }
+    fclose(s_pReplayFile);
+    s_pReplayFile = NULL;
+    atomic_store(&s_replaying, false);
+    return NULL;
+}
+
+int Input_replay(const char *fileName)
+{
+    if (atomic_load(&s_replaying)) {
+        fprintf(stderr, "ERROR: Input replay already running\n");
+        return -1;
+    }
+    // Reap the thread of a finished replay
+    stopReplay();
+
+    s_pReplayFile = fopen(fileName, "r");
+    if (s_pReplayFile == NULL) {
+        fprintf(stderr, "ERROR: Input unable to open %s for replay\n", fileName);
+        return -1;
+    }
+    atomic_store(&s_replaying, true);
+    if (pthread_create(&s_replayThread, NULL, replayThread, NULL) != 0) {
+        perror("ERROR: Input unable to start replay thread");
+        atomic_store(&s_replaying, false);
+        fclose(s_pReplayFile);
+        s_pReplayFile = NULL;
+        return -1;
+    }
+    s_replayThreadStarted = true;
+    return 0;
+}
@@ -0,0 +1,101 @@
+// One stream of timestamped events from every input device (rotary button,
+// joystick button, joystick stick), so any module can react to input without
+// its own polling thread or global flag, and latency can be measured from the
+// moment of the physical input.
+// Usage:
+//  - Devices call Input_publish() (or Input_publishAt() with the kernel's
+//    timestamp of a GPIO edge).
+//  - A consumer calls Input_subscribe() once, then Input_wait() or
+//    Input_poll() from one thread. Each subscriber sees every event published
+//    after it subscribed, in order.
+//  - Tests and the CLI can inject events, record them to a file and replay
+//    the file later with the original timing.
+//
+// Events go into one ring of INPUT_QUEUE_SIZE slots without locks; a
+// subscriber that falls more than a ring behind skips the oldest events and
+// counts them as dropped. Each subscriber also has an eventfd that is
+// readable while events may be waiting, for use with poll().
+#ifndef _INPUT_EVENTS_H_
+#define _INPUT_EVENTS_H_
+
+#include <stdbool.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INPUT_QUEUE_SIZE 256
+#define INPUT_MAX_SUBSCRIBERS 8
+
+enum Input_device {
+    INPUT_DEVICE_ROTARY_BUTTON,
+    INPUT_DEVICE_JOYSTICK_BUTTON,
+    INPUT_DEVICE_JOYSTICK,          // The analog stick
+    INPUT_NUM_DEVICES
+};
+
+enum Input_type {
+    INPUT_PRESS,                    // Button went down (debounced)
+    INPUT_RELEASE,                  // Button came back up
+    INPUT_DIRECTION,                // Stick direction changed; value is a Joystick_dir
+    INPUT_NUM_TYPES
+};
+
+typedef struct {
+    unsigned long long seq;         // Position in the stream, counting from 0
+    long long timeNs;               // CLOCK_MONOTONIC time of the input itself
+    enum Input_device device;
+    enum Input_type type;
+    int value;
+    bool injected;                  // From Input_inject() or a replay
+} Input_event_t;
+
+void Input_init(void);
+// Stops any recording or replay; call after the devices are cleaned up
+void Input_cleanup(void);
+
+// The clock used for event times (CLOCK_MONOTONIC), in ns
+long long Input_nowNs(void);
+// Convert a GPIO line event timestamp to Input_nowNs() time. Kernels before
+// 5.7 stamp line events with CLOCK_REALTIME instead of CLOCK_MONOTONIC.
+long long Input_kernelTimeToNs(const struct timespec *pEventTime);
+
+void Input_publish(enum Input_device device, enum Input_type type, int value);
+void Input_publishAt(enum Input_device device, enum Input_type type, int value, long long timeNs);
+// Publish an event as if a device had, marked as injected
+void Input_inject(enum Input_device device, enum Input_type type, int value);
+
+// Returns a subscriber id, or -1 if there are already INPUT_MAX_SUBSCRIBERS.
+// Only one thread may read from a subscriber.
+int Input_subscribe(void);
+void Input_unsubscribe(int subscriberId);
+// Readable (POLLIN) when events may be waiting for this subscriber
+int Input_getFd(int subscriberId);
+// Take the subscriber's next event if there is one
+bool Input_poll(int subscriberId, Input_event_t *pEvent);
+// Wait up to timeoutMs (-1 for ever) for the next event. Returns false on timeout.
+bool Input_wait(int subscriberId, Input_event_t *pEvent, int timeoutMs);
+// Events this subscriber missed by falling a whole ring behind
+unsigned long long Input_getDropped(int subscriberId);
+
+// Names used in recordings, e.g. "rotary_button" and "press"
+const char *Input_deviceName(enum Input_device device);
+const char *Input_typeName(enum Input_type type);
+
+// Write every event to fileName, one per line, until stopped:
+//     <microseconds since the first event> <device> <type> <value>
+// Returns 0, or -1 if the file can't be opened or a recording is running.
+int Input_startRecording(const char *fileName);
+void Input_stopRecording(void);
+// Inject the events of a recording (or a hand-written file in the same
+// format) in the background, keeping their relative timing. Lines starting
+// with '#' are skipped. Returns 0, or -1 if the file can't be opened or a
+// replay is already running.
+int Input_replay(const char *fileName);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
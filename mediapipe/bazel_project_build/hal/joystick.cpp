@@ -1,87 +1,224 @@
-#define DEBOUNCE_DELAY_MS 50  
 #include "joystick.h"
-#include <gpiod.h>
+#include "input_events.h"
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <linux/i2c.h>
 #include <linux/i2c-dev.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
+#include <atomic>
 #include <cstdint>
 
 #define I2C_BUS "/dev/i2c-1"
 #define I2C_DEVICE_ADDRESS 0x48
 #define REG_CONVERSION 0x00  
 #define REG_CONFIG 0x01
-#define MUX_CHANNEL_Y 0x83C2
-#define MUX_CHANNEL_X 0x93C2  
+// Config: channel mux, +/-4.096 V (PGA 001), continuous conversion,
+// 2400 samples/s (DR 101), comparator off (COMP_QUE 11). Each conversion
+// takes ~0.4 ms, well inside one step.
+#define MUX_CHANNEL_Y 0x82A3
+#define MUX_CHANNEL_X 0x92A3
+
+#define NS_PER_MS 1000000LL
+#define NS_PER_SEC 1000000000LL
+// Smoothing: each reading moves the average 1 / 2^FILTER_SHIFT of the way
+#define FILTER_SHIFT 1
+// Only report the first few I2C errors in a row
+#define MAX_REPORTED_ERRORS 3
+
+enum { AXIS_X, AXIS_Y, NUM_AXES };
+
+static int i2c_file_desc = -1;
+static pthread_t sampler_thread;
+static std::atomic<bool> sampler_running(false);
+
+// Both axes in one word, so a reader never mixes two different samples.
+// Centred until the first readings arrive.
+static std::atomic<uint32_t> filtered_xy(2048u << 16 | 2048u);
+static std::atomic<int> current_dir(JOYSTICK_NONE);
+static std::atomic<unsigned long> i2c_errors(0);
+
+struct sample_subscriber {
+    joystick_sample_callback_t callback;
+    void* pContext;
+};
+static pthread_mutex_t subscriber_lock = PTHREAD_MUTEX_INITIALIZER;
+static sample_subscriber subscribers[JOYSTICK_MAX_SUBSCRIBERS];
+// Slots are filled before the count is raised, so the sampler can read
+// the first num_subscribers without the lock
+static std::atomic<int> num_subscribers(0);
+
+static const uint16_t channel_config[NUM_AXES] = {MUX_CHANNEL_X, MUX_CHANNEL_Y};
+
+static void report_i2c_error(const char* what, int* p_errors_in_row) {
+    i2c_errors++;
+    if ((*p_errors_in_row)++ < MAX_REPORTED_ERRORS) {
+        perror(what);
+    }
+}
 
-static int i2c_file_desc;
+static int write_config(uint16_t config) {
+    uint8_t buffer[3] = {REG_CONFIG, (uint8_t)(config >> 8), (uint8_t)(config & 0xFF)};
+    struct i2c_msg msg = {I2C_DEVICE_ADDRESS, 0, sizeof(buffer), buffer};
+    struct i2c_rdwr_ioctl_data transfer = {&msg, 1};
+    return ioctl(i2c_file_desc, I2C_RDWR, &transfer) < 0 ? -1 : 0;
+}
 
-void joystick_init(void) {
-    i2c_file_desc = open(I2C_BUS, O_RDWR);
-    if (i2c_file_desc == -1) {
-        perror("Unable to open I2C bus");
-        exit(EXIT_FAILURE);
+// Read the conversion of the channel selected last step and select the next
+// channel, as one I2C transfer (repeated starts, no stop in between).
+// The write to the config register leaves the pointer there, so every
+// transfer points back at the conversion register first.
+static int read_and_select(uint16_t next_config, uint16_t* p_value) {
+    uint8_t pointer = REG_CONVERSION;
+    uint8_t data[2];
+    uint8_t config[3] = {REG_CONFIG, (uint8_t)(next_config >> 8), (uint8_t)(next_config & 0xFF)};
+    struct i2c_msg msgs[3] = {
+        {I2C_DEVICE_ADDRESS, 0, 1, &pointer},
+        {I2C_DEVICE_ADDRESS, I2C_M_RD, sizeof(data), data},
+        {I2C_DEVICE_ADDRESS, 0, sizeof(config), config},
+    };
+    struct i2c_rdwr_ioctl_data transfer = {msgs, 3};
+    if (ioctl(i2c_file_desc, I2C_RDWR, &transfer) < 0) {
+        return -1;
     }
+    uint16_t raw_value = (data[0] << 8) | data[1];
+    *p_value = raw_value >> 4;  // Right-align 12-bit
+    return 0;
+}
 
-    if (ioctl(i2c_file_desc, I2C_SLAVE, I2C_DEVICE_ADDRESS) == -1) {
-        perror("Unable to set I2C device to slave address");
-        exit(EXIT_FAILURE);
-    }
+static Joystick_dir classify_dir(int x, int y) {
+    if (x < 1000) return JOYSTICK_LEFT;
+    if (x > 3000) return JOYSTICK_RIGHT;
+    if (y < 1000) return JOYSTICK_UP;
+    if (y > 3000) return JOYSTICK_DOWN;
+    return JOYSTICK_NONE;
 }
 
-static void write_i2c_reg16(int i2c_file_desc, uint8_t reg_addr, uint16_t value) {
-    uint8_t buffer[3] = {reg_addr, (value >> 8) & 0xFF, value & 0xFF};
-    if (write(i2c_file_desc, buffer, 3) != 3) {
-        perror("Unable to write I2C register");
-        exit(EXIT_FAILURE);
+static void* sampler_loop(void* arg) {
+    (void)arg;
+    pthread_setname_np(pthread_self(), "joystick_adc");
+
+    int filtered[NUM_AXES] = {0, 0};
+    bool have_sample[NUM_AXES] = {false, false};
+    int axis = AXIS_X;
+    int errors_in_row = 0;
+
+    struct timespec next_step;
+    clock_gettime(CLOCK_MONOTONIC, &next_step);
+    while (sampler_running.load()) {
+        // Fixed rate: sleep to absolute times so the steps don't drift
+        next_step.tv_nsec += JOYSTICK_SAMPLE_PERIOD_MS * NS_PER_MS;
+        if (next_step.tv_nsec >= NS_PER_SEC) {
+            next_step.tv_sec++;
+            next_step.tv_nsec -= NS_PER_SEC;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_step, NULL);
+
+        int next_axis = (axis + 1) % NUM_AXES;
+        uint16_t value;
+        if (read_and_select(channel_config[next_axis], &value) < 0) {
+            report_i2c_error("Joystick: unable to read ADC", &errors_in_row);
+            // Select this axis again so the next reading is the right one
+            write_config(channel_config[axis]);
+            continue;
+        }
+        errors_in_row = 0;
+
+        if (have_sample[axis]) {
+            filtered[axis] += ((int)value - filtered[axis]) >> FILTER_SHIFT;
+        } else {
+            filtered[axis] = value;
+            have_sample[axis] = true;
+        }
+        axis = next_axis;
+        // Publish once per X/Y pair, after the Y reading
+        if (axis != AXIS_X || !have_sample[AXIS_X]) {
+            continue;
+        }
+
+        uint16_t x = filtered[AXIS_X];
+        uint16_t y = filtered[AXIS_Y];
+        filtered_xy.store((uint32_t)x << 16 | y);
+
+        Joystick_dir dir = classify_dir(x, y);
+        if (current_dir.exchange(dir) != dir) {
+            Input_publish(INPUT_DEVICE_JOYSTICK, INPUT_DIRECTION, dir);
+        }
+
+        int count = num_subscribers.load(std::memory_order_acquire);
+        for (int i = 0; i < count; i++) {
+            subscribers[i].callback(x, y, subscribers[i].pContext);
+        }
     }
+    return NULL;
 }
 
-int16_t read_i2c_reg16(int fd, uint8_t reg_addr) {
-    if (write(fd, &reg_addr, 1) != 1) {
-        perror("I2C: Unable to write register address");
-        exit(EXIT_FAILURE);
+int joystick_init(void) {
+    i2c_file_desc = open(I2C_BUS, O_RDWR);
+    if (i2c_file_desc == -1) {
+        perror("Unable to open I2C bus");
+        return -1;
+    }
+
+    // Start converting X; the sampler's first step reads it
+    if (write_config(MUX_CHANNEL_X) < 0) {
+        perror("Unable to configure joystick ADC");
+        close(i2c_file_desc);
+        i2c_file_desc = -1;
+        return -1;
     }
 
-    uint8_t data[2];
-    if (read(fd, data, 2) != 2) {
-        perror("I2C: Unable to read register");
-        exit(EXIT_FAILURE);
+    sampler_running = true;
+    if (pthread_create(&sampler_thread, NULL, sampler_loop, NULL) != 0) {
+        perror("Unable to start joystick sampler thread");
+        sampler_running = false;
+        close(i2c_file_desc);
+        i2c_file_desc = -1;
+        return -1;
     }
+    return 0;
+}
 
-    uint16_t raw_value = (data[0] << 8) | data[1];
-    return raw_value >> 4;  // Right-align 12-bit
+int joystick_subscribe(joystick_sample_callback_t callback, void* pContext) {
+    int result = -1;
+    pthread_mutex_lock(&subscriber_lock);
+    int count = num_subscribers.load();
+    if (count < JOYSTICK_MAX_SUBSCRIBERS) {
+        subscribers[count].callback = callback;
+        subscribers[count].pContext = pContext;
+        num_subscribers.store(count + 1, std::memory_order_release);
+        result = 0;
+    }
+    pthread_mutex_unlock(&subscriber_lock);
+    return result;
 }
 
 uint16_t read_joystick_y() {
-    write_i2c_reg16(i2c_file_desc, REG_CONFIG, MUX_CHANNEL_Y);
-    return read_i2c_reg16(i2c_file_desc, REG_CONVERSION);
+    return filtered_xy.load() & 0xFFFF;
 }
 
 uint16_t read_joystick_x() {
-    write_i2c_reg16(i2c_file_desc, REG_CONFIG, MUX_CHANNEL_X);
-    return read_i2c_reg16(i2c_file_desc, REG_CONVERSION);
+    return filtered_xy.load() >> 16;
 }
 
 Joystick_dir joystick_get_dir(void) {
-    int x = read_joystick_x();
-    int y = read_joystick_y();
+    return (Joystick_dir)current_dir.load();
+}
 
-    if (x < 1000) return JOYSTICK_LEFT;
-    if (x > 3000) return JOYSTICK_RIGHT;
-    if (y < 1000) return JOYSTICK_UP;
-    if (y > 3000) return JOYSTICK_DOWN;
-    return JOYSTICK_NONE;
+unsigned long joystick_get_i2c_errors(void) {
+    return i2c_errors.load();
 }
 
 void joystick_cleanup(void) {
-    close(i2c_file_desc);
+    if (sampler_running.exchange(false)) {
+        pthread_join(sampler_thread, NULL);
+    }
+    if (i2c_file_desc != -1) {
+        close(i2c_file_desc);
+        i2c_file_desc = -1;
+    }
 }
-
-
-
-
@@ -1,4 +1,3 @@
-
 #ifndef _JOYSTICK_H_
 #define _JOYSTICK_H_
 
@@ -12,11 +11,30 @@ typedef enum {
     JOYSTICK_NONE
 } Joystick_dir;
 
-void joystick_init(void);
+// Analog stick on an ADS1015 over I2C. A sampler thread keeps the ADC in
+// continuous-conversion mode and alternates between the X and Y channels,
+// one combined I2C transfer per step, so each axis is read every
+// 2 * JOYSTICK_SAMPLE_PERIOD_MS. The readings are smoothed and kept in
+// memory: the getters below never touch the bus.
+// Every change of direction is published to the input event stream
+// (input_events.h) as INPUT_DEVICE_JOYSTICK, with the Joystick_dir as value.
+#define JOYSTICK_SAMPLE_PERIOD_MS 5
+#define JOYSTICK_MAX_SUBSCRIBERS 4
+
+// Returns 0, or -1 if the ADC can't be opened or configured
+int joystick_init(void);
 void joystick_cleanup(void);
 
 Joystick_dir joystick_get_dir(void);
 int joystick_pressed(void);
+// Smoothed 12-bit readings, 0..4095
 uint16_t read_joystick_y(void);
 uint16_t read_joystick_x(void); 
+// Failed I2C transfers since init; the sampler retries on the next step
+unsigned long joystick_get_i2c_errors(void);
+
+// Called on the sampler thread with each new smoothed X/Y pair
+typedef void (*joystick_sample_callback_t)(uint16_t x, uint16_t y, void* pContext);
+// Returns 0, or -1 if there are already JOYSTICK_MAX_SUBSCRIBERS
+int joystick_subscribe(joystick_sample_callback_t callback, void* pContext);
 #endif
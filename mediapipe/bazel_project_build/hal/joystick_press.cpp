@@ -2,26 +2,23 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <poll.h>
+#include <sys/eventfd.h>
 #include "joystick_press.h"
-#include "periodTimer.h"
+#include "input_events.h"
 
 #define GPIO_CHIP "/dev/gpiochip2"
 #define GPIO_BUTTON 15
 
+// Edges read from the kernel at once
+#define MAX_EVENTS 16
+
 static struct gpiod_chip *chip;
 static struct gpiod_line *button_line;
 static pthread_t joystickThread;
-static int keepRunning = 1;
-
-static int isDetectingGesture = 0;
-
-void joystick_toggle_detection() {
-    isDetectingGesture = !isDetectingGesture;
-}
-
-int joystick_is_detecting() {
-    return isDetectingGesture;
-}
+static bool threadStarted = false;
+// Written by cleanup to wake the listener out of poll()
+static int stopFd = -1;
 
 void joystick_press_init() {
     chip = gpiod_chip_open(GPIO_CHIP);
@@ -34,53 +31,135 @@ void joystick_press_init() {
     if (!button_line) {
         perror("Failed to get GPIO line");
         gpiod_chip_close(chip);
+        chip = NULL;
         return;
     }
 
-    if (gpiod_line_request_input(button_line, "joystick_btn") < 0) {
-        perror("Failed to request button line as input");
+    // Both edges: a press is a falling edge, and the rising edge of the
+    // release is needed to tell when the contact has settled again
+    if (gpiod_line_request_both_edges_events(button_line, "joystick_btn") < 0) {
+        perror("Failed to request button line for events");
         gpiod_chip_close(chip);
+        chip = NULL;
+        button_line = NULL;
         return;
     }
 
+    stopFd = eventfd(0, EFD_CLOEXEC);
+    if (stopFd < 0) {
+        perror("Failed to create joystick stop eventfd");
+    }
+
     if (pthread_create(&joystickThread, NULL, joystick_listener_push, NULL) != 0) {
         perror("Failed to create joystick thread");
+        return;
     }
-    pthread_detach(joystickThread);
+    threadStarted = true;
 }
 
 void *joystick_listener_push(void *arg) {
     (void)arg;
-    static int lastState = 1;
-    static long lastPressTime = 0;
-
-    while (keepRunning) {
-        if (!button_line) continue;
+    pthread_setname_np(pthread_self(), "joystick");
+
+    const long long debounceNs = JOYSTICK_DEBOUNCE_MS * 1000000LL;
+    // Time of the last edge, bounce or not
+    long long lastEdgeNs = 0;
+    bool pressed = false;
+    // An edge was dropped as bounce, so once the line settles its level
+    // may no longer match `pressed` (e.g. a release that came too soon)
+    bool resyncPending = false;
+
+    struct pollfd fds[2];
+    fds[0].fd = gpiod_line_event_get_fd(button_line);
+    fds[0].events = POLLIN;
+    fds[1].fd = stopFd;
+    fds[1].events = POLLIN;
+
+    while (true) {
+        int timeoutMs = -1;
+        if (resyncPending) {
+            long long remainingNs = lastEdgeNs + debounceNs - Input_nowNs();
+            timeoutMs = remainingNs <= 0 ? 0 : (int)((remainingNs + 999999) / 1000000);
+        }
+        int ready = poll(fds, stopFd >= 0 ? 2 : 1, timeoutMs);
+        if (ready < 0) {
+            perror("Failed to wait for joystick events");
+            break;
+        }
+        if (ready == 0) {
+            // Steady for the debounce time: go by the level the line settled at
+            resyncPending = false;
+            int value = gpiod_line_get_value(button_line);
+            if (value < 0) {
+                perror("Failed to read joystick button");
+                continue;
+            }
+            bool isPress = value == 0;
+            if (isPress != pressed) {
+                pressed = isPress;
+                Input_publishAt(INPUT_DEVICE_JOYSTICK_BUTTON, isPress ? INPUT_PRESS : INPUT_RELEASE,
+                                0, lastEdgeNs);
+            }
+            continue;
+        }
+        if (fds[1].revents & POLLIN) {
+            break;
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
 
-        int currentState = gpiod_line_get_value(button_line);
-        long currentTime = periodTimer_getCurrentTimeMs();
+        struct gpiod_line_event events[MAX_EVENTS];
+        int numEvents = gpiod_line_event_read_multiple(button_line, events, MAX_EVENTS);
+        if (numEvents < 0) {
+            perror("Failed to read joystick events");
+            break;
+        }
 
-        if (lastState == 1 && currentState == 0) {
-            if (currentTime - lastPressTime > 200) {
-                lastPressTime = currentTime;
-                lastState = currentState;
+        for (int i = 0; i < numEvents; i++) {
+            long long edgeNs = Input_kernelTimeToNs(&events[i].ts);
+            // An edge only counts if the line had been steady for the
+            // debounce time before it; bounces come in quick runs
+            bool settled = lastEdgeNs == 0 ||
+                edgeNs - lastEdgeNs >= JOYSTICK_DEBOUNCE_MS * 1000000LL;
+            lastEdgeNs = edgeNs;
+            if (!settled) {
+                resyncPending = true;
+                continue;
+            }
 
-                joystick_toggle_detection();
+            // The button pulls the line low
+            bool isPress = events[i].event_type == GPIOD_LINE_EVENT_FALLING_EDGE;
+            if (isPress != pressed) {
+                pressed = isPress;
+                Input_publishAt(INPUT_DEVICE_JOYSTICK_BUTTON, isPress ? INPUT_PRESS : INPUT_RELEASE,
+                                0, edgeNs);
             }
         }
-
-        lastState = currentState;
-        usleep(100000);
     }
     return NULL;
 }
 
 void joystick_press_cleanup() {
-    keepRunning = 0;
+    if (threadStarted) {
+        if (stopFd >= 0) {
+            eventfd_write(stopFd, 1);
+        } else {
+            pthread_cancel(joystickThread);
+        }
+        pthread_join(joystickThread, NULL);
+        threadStarted = false;
+    }
+    if (stopFd >= 0) {
+        close(stopFd);
+        stopFd = -1;
+    }
     if (button_line) {
         gpiod_line_release(button_line);
+        button_line = NULL;
     }
     if (chip) {
         gpiod_chip_close(chip);
+        chip = NULL;
     }
 }
@@ -1,13 +1,18 @@
 #ifndef _JOYSTICK_PRESS_H_
 #define _JOYSTICK_PRESS_H_
 
+// Presses of the joystick button, read as GPIO edge events. The kernel
+// timestamps every edge, so bounces are filtered on those times rather than
+// by polling. Each press and release is published to the input event stream
+// (input_events.h) as INPUT_DEVICE_JOYSTICK_BUTTON, with the edge's time.
+
+// An edge within this long of the previous one is contact bounce; once the
+// line has then been steady this long, its level is read to catch up on
+// any real change that was in the bounce
+#define JOYSTICK_DEBOUNCE_MS 30
+
 void joystick_press_init();
 void* joystick_listener_push(void* arg);
 void joystick_press_cleanup();
 
-// track ON/OFF state for start/stop command
-// For toggling gesture detection
-void joystick_toggle_detection();
-int joystick_is_detecting();
-
 #endif
@@ -1,8 +1,10 @@
 // Sample rotary_push_state machine for one GPIO pin.
+#define _GNU_SOURCE
 
 #include "rotary_press_statemachine.h"
 #include <time.h>
 #include "gpio.h"
+#include "input_events.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -29,37 +31,38 @@ static bool isRunning = false;
 */
 struct stateEvent {
     struct rotary_push_state* pNextState;
-    void (*action)();
+    void (*action)(long long eventNs);
 };
 struct rotary_push_state {
     struct stateEvent rising;
     struct stateEvent falling;
 };
 
-static long long getTimeInMs(void)
-{
-    long long MS_PER_SEC = 1000;
-    long long NS_PER_MS = 1000000;
-    struct timespec spec;
-    clock_gettime(CLOCK_REALTIME, &spec);
-    long long seconds = spec.tv_sec;
-    long long nanoSeconds = spec.tv_nsec;
-    long long milliSeconds = seconds * MS_PER_SEC
-    + nanoSeconds / NS_PER_MS;
-    return milliSeconds;
-}
-static int delay = 0;
+// Kernel time of the last press that got through the cooldown
+static long long lastPressNs = 0;
+static bool pressAccepted = false;
 /*
     START STATEMACHINE
 */
 #define COOLDOWN 300
+#define NS_PER_MS 1000000LL
 #define NUM_OPTIONS 3
-static void on_release(void)
+// Edge times are the kernel's timestamps (see Input_kernelTimeToNs)
+static void on_press(long long eventNs)
+{
+    pressAccepted = eventNs - lastPressNs > COOLDOWN * NS_PER_MS;
+    if (pressAccepted){
+        lastPressNs = eventNs;
+        Input_publishAt(INPUT_DEVICE_ROTARY_BUTTON, INPUT_PRESS, 0, eventNs);
+    }
+}
+
+static void on_release(long long eventNs)
 {   
-    long long curr_time = getTimeInMs();
-    if (curr_time - delay > COOLDOWN){
+    if (pressAccepted){
+        pressAccepted = false;
         counter = (counter +1);
-        delay = curr_time;
+        Input_publishAt(INPUT_DEVICE_ROTARY_BUTTON, INPUT_RELEASE, 0, eventNs);
     }
     
 }
@@ -67,7 +70,7 @@ static void on_release(void)
 struct rotary_push_state rotary_push_states[] = {
     { // Not pressed
         .rising = {&rotary_push_states[0], NULL},
-        .falling = {&rotary_push_states[1], NULL},
+        .falling = {&rotary_push_states[1], on_press},
     },
 
     { // Pressed
@@ -141,7 +144,7 @@ static void* rotary_press_statemachine_doState()
 
             // Do the action
             if (pStateEvent->action != NULL) {
-                pStateEvent->action();
+                pStateEvent->action(Input_kernelTimeToNs(&event.ts));
             }
             rotary_pCurrentState = pStateEvent->pNextState;
 
@@ -171,6 +174,7 @@ void rotary_press_statemachine_init()
     isInitialized = true;
     isRunning = true;
     pthread_create(&rotary_press_thread, NULL, rotary_press_statemachine_doState, NULL);
+    pthread_setname_np(rotary_press_thread, "rotary");
 }
 void rotary_press_statemachine_cleanup()
 {
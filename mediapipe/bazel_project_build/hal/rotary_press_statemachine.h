@@ -7,6 +7,8 @@ extern "C" {
 #include <time.h>
 #include <stdbool.h>
 //For recognizing the press feature of the rotary encoder
+//Presses and releases are also published to the input event stream
+//(input_events.h) as INPUT_DEVICE_ROTARY_BUTTON
 void rotary_press_statemachine_init(void);
 void rotary_press_statemachine_cleanup(void);
 
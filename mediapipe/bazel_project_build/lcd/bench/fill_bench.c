@@ -0,0 +1,134 @@
+// Fill benchmark: row/vector fills vs the per pixel Paint_SetPixel paths they replace.
+// Each case is drawn with the old loop and the new primitive; the frame
+// buffers must match for every rotation and mirror setting.
+#include "../lib/GUI/GUI_Paint.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ITERATIONS 200
+#define PIXELS (LCD_1IN54_WIDTH * LCD_1IN54_HEIGHT)
+
+static UWORD s_reference[PIXELS];
+static UWORD s_fast[PIXELS];
+
+static long long getTimeInNs(void)
+{
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (long long)spec.tv_sec * 1000000000LL + spec.tv_nsec;
+}
+
+// The loops GUI_Paint used before the fill kernels
+static void old_clear(UWORD Color)
+{
+    for (UWORD Y = 0; Y < Paint.HeightByte; Y++) {
+        for (UWORD X = 0; X < Paint.WidthByte; X++) {
+            Paint.Image[X + Y * Paint.WidthByte] = Color;
+        }
+    }
+}
+
+static void old_clear_window(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color)
+{
+    for (UWORD Y = Ystart; Y < Yend; Y++) {
+        for (UWORD X = Xstart; X < Xend; X++) {
+            Paint_SetPixel(X, Y, Color);
+        }
+    }
+}
+
+static void old_fill_rectangle(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color, DOT_PIXEL Width)
+{
+    for (UWORD Y = Ystart; Y < Yend; Y++) {
+        Paint_DrawLine(Xstart, Y, Xend, Y, Color, Width, LINE_STYLE_SOLID);
+    }
+}
+
+static void new_fill_rectangle(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color, DOT_PIXEL Width)
+{
+    Paint_DrawRectangle(Xstart, Ystart, Xend, Yend, Color, Width, DRAW_FILL_FULL);
+}
+
+static void select_image(UWORD* image, UWORD rotate, UBYTE mirror)
+{
+    Paint_NewImage(image, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT, rotate, WHITE, 16);
+    if (mirror != MIRROR_NONE) {
+        Paint_SetMirroring(mirror);
+    }
+}
+
+static int check_shapes(void)
+{
+    static const UWORD rotations[] = {ROTATE_0, ROTATE_90, ROTATE_180, ROTATE_270};
+    static const UBYTE mirrors[] = {MIRROR_NONE, MIRROR_HORIZONTAL, MIRROR_VERTICAL, MIRROR_ORIGIN};
+    int failures = 0;
+
+    for (int r = 0; r < 4; r++) {
+        for (int m = 0; m < 4; m++) {
+            UWORD* images[2] = {s_reference, s_fast};
+            for (int i = 0; i < 2; i++) {
+                select_image(images[i], rotations[r], mirrors[m]);
+                memset(images[i], 0x55, sizeof(s_fast));
+                if (i == 0) {
+                    old_clear_window(10, 20, 130, 70, RED);
+                    old_clear_window(0, 0, 3, 240, GREEN);
+                    old_fill_rectangle(40, 90, 200, 150, BLUE, DOT_PIXEL_1X1);
+                    old_fill_rectangle(1, 2, 60, 230, MAGENTA, DOT_PIXEL_3X3);
+                    old_fill_rectangle(150, 5, 100, 40, BROWN, DOT_PIXEL_2X2);
+                } else {
+                    Paint_ClearWindow(10, 20, 130, 70, RED);
+                    Paint_ClearWindow(0, 0, 3, 240, GREEN);
+                    new_fill_rectangle(40, 90, 200, 150, BLUE, DOT_PIXEL_1X1);
+                    new_fill_rectangle(1, 2, 60, 230, MAGENTA, DOT_PIXEL_3X3);
+                    new_fill_rectangle(150, 5, 100, 40, BROWN, DOT_PIXEL_2X2);
+                }
+            }
+            if (memcmp(s_reference, s_fast, sizeof(s_fast)) != 0) {
+                printf("MISMATCH rotate %d mirror %d\n", rotations[r], mirrors[m]);
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+typedef void (*draw_fn)(void);
+
+static void old_clear_screen(void)  { old_clear(RED); }
+static void new_clear_screen(void)  { Paint_Clear(RED); }
+static void old_window(void)        { old_clear_window(0, 0, 240, 120, BLUE); }
+static void new_window(void)        { Paint_ClearWindow(0, 0, 240, 120, BLUE); }
+static void old_rectangle(void)     { old_fill_rectangle(20, 20, 220, 220, GREEN, DOT_PIXEL_1X1); }
+static void new_rectangle(void)     { new_fill_rectangle(20, 20, 220, 220, GREEN, DOT_PIXEL_1X1); }
+
+static double time_us(draw_fn draw, UWORD* image)
+{
+    select_image(image, ROTATE_0, MIRROR_NONE);
+    long long start = getTimeInNs();
+    for (int i = 0; i < ITERATIONS; i++) {
+        draw();
+    }
+    return (getTimeInNs() - start) / 1000.0 / ITERATIONS;
+}
+
+static int bench(const char* name, draw_fn oldDraw, draw_fn newDraw, UDOUBLE pixels)
+{
+    double oldUs = time_us(oldDraw, s_reference);
+    double newUs = time_us(newDraw, s_fast);
+    int same = memcmp(s_reference, s_fast, sizeof(s_fast)) == 0;
+    printf("%-14s old %8.1f us  new %7.1f us  %6.0f MB/s  speedup %5.1fx  %s\n",
+           name, oldUs, newUs, pixels * 2.0 / newUs, oldUs / newUs, same ? "identical" : "MISMATCH");
+    return same ? 0 : 1;
+}
+
+int main(void)
+{
+    int failures = check_shapes();
+    failures += bench("Paint_Clear", old_clear_screen, new_clear_screen, PIXELS);
+    failures += bench("ClearWindow", old_window, new_window, PIXELS / 2);
+    failures += bench("FillRectangle", old_rectangle, new_rectangle, 200 * 200);
+    return failures;
+}
@@ -0,0 +1,71 @@
+// Full screen text redraw benchmark: per pixel Paint_SetPixel path vs glyph atlas.
+// Renders the same screens with both paths, checks the frame buffers match
+// and prints the average time per redraw.
+#include "../lib/GUI/GUI_Paint.h"
+#include "../lib/GUI/GUI_Glyph.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ITERATIONS 200
+
+static long long getTimeInNs(void)
+{
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (long long)spec.tv_sec * 1000000000LL + spec.tv_nsec;
+}
+
+// Fill every text row of the panel, the worst case for lcd_display
+static void draw_screen(UWORD foreground, UWORD background)
+{
+    static const char* text = "Round 3 Player 2 ATK!";
+    Paint_Clear(WHITE);
+    for (UWORD y = 0; y + Font16.Height <= LCD_1IN54_HEIGHT; y += Font16.Height) {
+        Paint_DrawString_EN(0, y, text, &Font16, foreground, background);
+    }
+}
+
+static double run(UWORD* fb, UBYTE useGlyphs, UWORD foreground, UWORD background)
+{
+    Glyph_SetEnabled(useGlyphs);
+    Paint_NewImage(fb, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT, 0, WHITE, 16);
+    long long start = getTimeInNs();
+    for (int i = 0; i < ITERATIONS; i++) {
+        draw_screen(foreground, background);
+    }
+    return (getTimeInNs() - start) / 1000.0 / ITERATIONS;
+}
+
+static int bench(const char* name, UWORD foreground, UWORD background)
+{
+    size_t size = LCD_1IN54_WIDTH * LCD_1IN54_HEIGHT * sizeof(UWORD);
+    UWORD* reference = malloc(size);
+    UWORD* fast = malloc(size);
+    if (reference == NULL || fast == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+
+    double slowUs = run(reference, 0, foreground, background);
+    double fastUs = run(fast, 1, foreground, background);
+    int same = memcmp(reference, fast, size) == 0;
+
+    printf("%-12s setpixel %8.1f us  atlas %8.1f us  speedup %5.1fx  %s\n",
+           name, slowUs, fastUs, slowUs / fastUs, same ? "identical" : "MISMATCH");
+    free(reference);
+    free(fast);
+    return same ? 0 : 1;
+}
+
+int main(void)
+{
+    int failures = 0;
+    // lcd_display passes (WHITE, BLACK): black text on a transparent background
+    failures += bench("transparent", WHITE, BLACK);
+    failures += bench("opaque", BLUE, YELLOW);
+    Glyph_ClearCache();
+    return failures;
+}
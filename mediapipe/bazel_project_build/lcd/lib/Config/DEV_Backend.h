@@ -0,0 +1,42 @@
+/*****************************************************************************
+* | File        :   DEV_Backend.h
+* | Function    :   Pluggable GPIO/SPI backend for the LCD driver
+* | Info        :
+*   DEV_Config's public functions forward to the active backend: the lgpio
+*   hardware on the board, or the virtual ST7789 in DEV_Virtual.c for host
+*   benchmarks. Select one before DEV_ModuleInit, either with DEV_SetBackend
+*   or with the LCD_BACKEND environment variable ("lgpio" / "virtual").
+*----------------
+* | This version:   V1.0
+* | Info        :   Basic version
+*
+******************************************************************************/
+#ifndef _DEV_BACKEND_H_
+#define _DEV_BACKEND_H_
+
+#include "DEV_Config.h"
+
+typedef struct {
+    const char *Name;
+    UBYTE (*ModuleInit)(void);
+    void (*ModuleExit)(void);
+    void (*GPIO_Mode)(UWORD Pin, UWORD Mode);
+    void (*Digital_Write)(UWORD Pin, UBYTE Value);
+    UBYTE (*Digital_Read)(UWORD Pin);
+    void (*Delay_ms)(UDOUBLE xms);
+    // Rows of RowLen bytes, Stride bytes apart (0 repeats one row), sent as one burst
+    void (*SPI_Write_Rows)(const uint8_t *pData, uint32_t RowLen, uint32_t Stride, uint32_t Rows);
+} DEV_BACKEND;
+
+extern const DEV_BACKEND DEV_Hardware_Backend;
+extern const DEV_BACKEND DEV_Virtual_Backend;
+
+// NULL goes back to the LCD_BACKEND / hardware default
+void DEV_SetBackend(const DEV_BACKEND *Backend);
+const DEV_BACKEND *DEV_GetBackend(void);
+
+// For backends: restart / add to the counters returned by DEV_SPI_GetStats
+void DEV_SPI_ResetStats(uint32_t SpeedHz, uint32_t MaxMessage);
+void DEV_SPI_Account(uint64_t Bytes, uint64_t Messages, uint64_t BusyNs);
+
+#endif
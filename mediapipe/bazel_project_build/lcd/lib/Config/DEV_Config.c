@@ -10,6 +10,13 @@
 *
 ******************************************************************************/
 #include "DEV_Config.h"
+#include "DEV_Backend.h"
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <stdlib.h>
+#include <time.h>
+#include <linux/spi/spidev.h>
 
 //#if USE_DEV_LIB
 #include "lgpio.h"
@@ -18,6 +25,19 @@ int GPIO_Handle1;
 int GPIO_Handle2;
 int SPI_Handle;
 
+// Bulk transfers go straight to spidev so several rows can be chained into
+// one SPI_IOC_MESSAGE. lgSpiWrite is kept as the fallback if the open fails.
+#define DEV_SPI_DEVICE      "/dev/spidev0.0"
+#define DEV_SPI_SPEED_HZ    25000000
+#define DEV_SPI_BUFSIZ_PATH "/sys/module/spidev/parameters/bufsiz"
+#define DEV_SPI_MAX_XFERS   64      // spi_ioc_transfer entries per message
+
+static int SPI_Fd = -1;
+static uint32_t SPI_Bufsiz = 4096;  // spidev limit on the bytes of one message
+static DEV_SPI_STATS SPI_Stats;
+
+static const DEV_BACKEND *DEV_Active_Backend = NULL;
+
 typedef struct {
     int gpiochip;   // The GPIO chip number (e.g., 1, 2)
     int handle;     // The GPIO handle, after being claimed
@@ -41,6 +61,10 @@ DEV_GPIO_Pin LCD_BL_PIN  = {2, -1, 18}; // BL  is GPIO13 on gpiochip2 line 18
 // Array to map Pin constants to DEV_GPIO_Pin structures
 DEV_GPIO_Pin* DEV_GPIOS[4]; // Index 0 unused
 
+// Last level written to each output pin, -1 if unknown. Lets the LCD driver
+// toggle DC freely without paying for a GPIO ioctl when it is already set.
+static int DEV_PinLevel[4] = {-1, -1, -1, -1};
+
 //#endif
 
 void DEV_SetBacklight(UWORD Value)
@@ -51,9 +75,9 @@ void DEV_SetBacklight(UWORD Value)
 }
 
 /*****************************************
-                    GPIO
+              lgpio hardware backend
 *****************************************/
-void DEV_Digital_Write(UWORD Pin, UBYTE Value)
+static void HW_Digital_Write(UWORD Pin, UBYTE Value)
 {
 //#ifdef USE_DEV_LIB
     DEV_GPIO_Pin* gpio_pin = DEV_GPIOS[Pin];
@@ -61,12 +85,19 @@ void DEV_Digital_Write(UWORD Pin, UBYTE Value)
         printf("Invalid GPIO Pin: %d\n", Pin);
         return;
     }
+    if (DEV_PinLevel[Pin] == (Value ? 1 : 0)) {
+        return;
+    }
 
-    lgGpioWrite(gpio_pin->handle, gpio_pin->line, Value);
+    if (lgGpioWrite(gpio_pin->handle, gpio_pin->line, Value) >= 0) {
+        DEV_PinLevel[Pin] = Value ? 1 : 0;
+    } else {
+        DEV_PinLevel[Pin] = -1;
+    }
 //#endif
 }
 
-UBYTE DEV_Digital_Read(UWORD Pin)
+static UBYTE HW_Digital_Read(UWORD Pin)
 {
     UBYTE Read_value = 0;
 //#ifdef USE_DEV_LIB
@@ -80,7 +111,7 @@ UBYTE DEV_Digital_Read(UWORD Pin)
     return Read_value;
 }
 
-void DEV_GPIO_Mode(UWORD Pin, UWORD Mode)
+static void HW_GPIO_Mode(UWORD Pin, UWORD Mode)
 {
 //_DEV_LIB
     DEV_GPIO_Pin* gpio_pin = DEV_GPIOS[Pin];
@@ -91,8 +122,10 @@ void DEV_GPIO_Mode(UWORD Pin, UWORD Mode)
     }
     if(Mode == 0 || Mode == LG_SET_INPUT){
         lgGpioClaimInput(gpio_pin->handle, LFLAGS, gpio_pin->line);
+        DEV_PinLevel[Pin] = -1;
     } else {
-        lgGpioClaimOutput(gpio_pin->handle, LFLAGS, gpio_pin->line, LG_LOW);
+        int ret = lgGpioClaimOutput(gpio_pin->handle, LFLAGS, gpio_pin->line, LG_LOW);
+        DEV_PinLevel[Pin] = ret >= 0 ? 0 : -1;
     }
 //#endif   
 }
@@ -100,7 +133,7 @@ void DEV_GPIO_Mode(UWORD Pin, UWORD Mode)
 /**
  * delay x ms
 **/
-void DEV_Delay_ms(UDOUBLE xms)
+static void HW_Delay_ms(UDOUBLE xms)
 {
 //#ifdef USE_DEV_LIB  
     lguSleep(xms/1000.0);
@@ -108,14 +141,47 @@ void DEV_Delay_ms(UDOUBLE xms)
 //#endif
 }
 
+/**
+ * Open spidev directly for chained transfers
+**/
+static void HW_SPI_Init(void)
+{
+    uint8_t mode = SPI_MODE_0;
+    uint8_t bits = 8;
+    uint32_t speed = DEV_SPI_SPEED_HZ;
+
+    FILE *file = fopen(DEV_SPI_BUFSIZ_PATH, "r");
+    if (file != NULL) {
+        unsigned long bufsiz = 0;
+        if (fscanf(file, "%lu", &bufsiz) == 1 && bufsiz > 0) {
+            SPI_Bufsiz = bufsiz;
+        }
+        fclose(file);
+    }
+    DEV_SPI_ResetStats(speed, SPI_Bufsiz);
+
+    SPI_Fd = open(DEV_SPI_DEVICE, O_RDWR);
+    if (SPI_Fd < 0) {
+        printf("Unable to open %s, falling back to lgSpiWrite\n", DEV_SPI_DEVICE);
+        return;
+    }
+    if (ioctl(SPI_Fd, SPI_IOC_WR_MODE, &mode) < 0 ||
+        ioctl(SPI_Fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
+        ioctl(SPI_Fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0) {
+        perror("Unable to configure spidev, falling back to lgSpiWrite");
+        close(SPI_Fd);
+        SPI_Fd = -1;
+    }
+}
+
 static void DEV_GPIO_Init(void)
 {
-    DEV_GPIO_Mode(LCD_RST, 1);
-    DEV_GPIO_Mode(LCD_DC, 1);
-    DEV_GPIO_Mode(LCD_BL, 1);
+    HW_GPIO_Mode(LCD_RST, 1);
+    HW_GPIO_Mode(LCD_DC, 1);
+    HW_GPIO_Mode(LCD_BL, 1);
 }
 
-UBYTE DEV_ModuleInit(void)
+static UBYTE HW_ModuleInit(void)
 {
 
 //#ifdef USE_DEV_LIB
@@ -148,6 +214,9 @@ UBYTE DEV_ModuleInit(void)
     DEV_GPIOS[LCD_RST] = &LCD_RST_PIN;
     DEV_GPIOS[LCD_DC]  = &LCD_DC_PIN;
     DEV_GPIOS[LCD_BL]  = &LCD_BL_PIN;
+    for (int i = 0; i < 4; i++) {
+        DEV_PinLevel[i] = -1;
+    }
 
     // Open SPI channel
     SPI_Handle = lgSpiOpen(0, 0, 25000000, 0);
@@ -157,6 +226,7 @@ UBYTE DEV_ModuleInit(void)
         perror("Unable to open SPI");
         return -1;
     }
+    HW_SPI_Init();
     DEV_GPIO_Init();
 
 //#else
@@ -167,25 +237,217 @@ UBYTE DEV_ModuleInit(void)
     return 0;
 }
 
-void DEV_SPI_WriteByte(uint8_t Value)
+static uint64_t DEV_TimeNs(void)
+{
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (uint64_t)spec.tv_sec * 1000000000ULL + spec.tv_nsec;
+}
+
+static int HW_SPI_Submit(struct spi_ioc_transfer *Xfer, int Count)
+{
+    if (ioctl(SPI_Fd, SPI_IOC_MESSAGE(Count), Xfer) < 0) {
+        perror("SPI_IOC_MESSAGE failed");
+        return -1;
+    }
+    return 0;
+}
+
+/******************************************************************************
+function:	Write Rows of RowLen bytes, Stride bytes apart, in as few ioctls
+            as possible. Rows become chained spi_ioc_transfer entries (merged
+            when they are contiguous) and each message is filled up to the
+            spidev bufsiz. CS stays asserted within a message but spidev
+            releases it between messages; the panel doesn't mind, as DC
+            stays high and the memory write carries on until the next
+            command.
+******************************************************************************/
+static void HW_SPI_Write_Rows(const uint8_t *pData, uint32_t RowLen, uint32_t Stride, uint32_t Rows)
+{
+    uint64_t StartNs = DEV_TimeNs();
+    uint64_t Messages = 0;
+
+    if (SPI_Fd < 0) {
+        for (uint32_t Row = 0; Row < Rows; Row++) {
+            const uint8_t *p = pData + (size_t)Row * Stride;
+            uint32_t Left = RowLen;
+            while (Left > 0) {
+                uint32_t Chunk = Left < SPI_Bufsiz ? Left : SPI_Bufsiz;
+                lgSpiWrite(SPI_Handle, (const char*)p, Chunk);
+                p += Chunk;
+                Left -= Chunk;
+                Messages++;
+            }
+        }
+        DEV_SPI_Account((uint64_t)RowLen * Rows, Messages, DEV_TimeNs() - StartNs);
+        return;
+    }
+
+    struct spi_ioc_transfer Xfer[DEV_SPI_MAX_XFERS];
+    int Count = 0;
+    uint32_t MessageLen = 0;
+    memset(Xfer, 0, sizeof(Xfer));
+
+    for (uint32_t Row = 0; Row < Rows; Row++) {
+        const uint8_t *p = pData + (size_t)Row * Stride;
+        uint32_t Left = RowLen;
+        while (Left > 0) {
+            uint32_t Room = SPI_Bufsiz - MessageLen;
+            uint32_t Chunk = Left < Room ? Left : Room;
+
+            if (Count > 0 && Xfer[Count - 1].tx_buf + Xfer[Count - 1].len == (uintptr_t)p) {
+                Xfer[Count - 1].len += Chunk;
+            } else {
+                Xfer[Count].tx_buf = (uintptr_t)p;
+                Xfer[Count].len = Chunk;
+                Xfer[Count].speed_hz = DEV_SPI_SPEED_HZ;
+                Xfer[Count].bits_per_word = 8;
+                Count++;
+            }
+            MessageLen += Chunk;
+            p += Chunk;
+            Left -= Chunk;
+
+            if (MessageLen == SPI_Bufsiz || Count == DEV_SPI_MAX_XFERS) {
+                HW_SPI_Submit(Xfer, Count);
+                Messages++;
+                memset(Xfer, 0, Count * sizeof(Xfer[0]));
+                Count = 0;
+                MessageLen = 0;
+            }
+        }
+    }
+    if (Count > 0) {
+        HW_SPI_Submit(Xfer, Count);
+        Messages++;
+    }
+    DEV_SPI_Account((uint64_t)RowLen * Rows, Messages, DEV_TimeNs() - StartNs);
+}
+
+static void HW_ModuleExit(void)
 {
 //#ifdef USE_DEV_LIB 
-    lgSpiWrite(SPI_Handle, (char*)&Value, 1);
+    if (SPI_Fd >= 0) {
+        close(SPI_Fd);
+        SPI_Fd = -1;
+    }
+    lgSpiClose(SPI_Handle);
+    lgGpiochipClose(GPIO_Handle1);
+    lgGpiochipClose(GPIO_Handle2);
 //#endif
 }
 
-void DEV_SPI_Write_nByte(uint8_t *pData, uint32_t Len)
+const DEV_BACKEND DEV_Hardware_Backend = {
+    .Name = "lgpio",
+    .ModuleInit = HW_ModuleInit,
+    .ModuleExit = HW_ModuleExit,
+    .GPIO_Mode = HW_GPIO_Mode,
+    .Digital_Write = HW_Digital_Write,
+    .Digital_Read = HW_Digital_Read,
+    .Delay_ms = HW_Delay_ms,
+    .SPI_Write_Rows = HW_SPI_Write_Rows,
+};
+
+/*****************************************
+            Backend selection
+*****************************************/
+void DEV_SetBackend(const DEV_BACKEND *Backend)
+{
+    DEV_Active_Backend = Backend;
+}
+
+/**
+ * Returns the backend set with DEV_SetBackend, otherwise the one named by
+ * LCD_BACKEND ("virtual" or "lgpio"), otherwise the lgpio hardware.
+**/
+const DEV_BACKEND *DEV_GetBackend(void)
+{
+    if (DEV_Active_Backend == NULL) {
+        const char *name = getenv("LCD_BACKEND");
+        if (name != NULL && strcmp(name, DEV_Virtual_Backend.Name) == 0) {
+            DEV_Active_Backend = &DEV_Virtual_Backend;
+        } else {
+            DEV_Active_Backend = &DEV_Hardware_Backend;
+        }
+    }
+    return DEV_Active_Backend;
+}
+
+UBYTE DEV_ModuleInit(void)
+{
+    return DEV_GetBackend()->ModuleInit();
+}
+
+void DEV_ModuleExit(void)
+{
+    DEV_GetBackend()->ModuleExit();
+}
+
+void DEV_GPIO_Mode(UWORD Pin, UWORD Mode)
+{
+    DEV_GetBackend()->GPIO_Mode(Pin, Mode);
+}
+
+void DEV_Digital_Write(UWORD Pin, UBYTE Value)
+{
+    DEV_GetBackend()->Digital_Write(Pin, Value);
+}
+
+UBYTE DEV_Digital_Read(UWORD Pin)
+{
+    return DEV_GetBackend()->Digital_Read(Pin);
+}
+
+void DEV_Delay_ms(UDOUBLE xms)
+{
+    DEV_GetBackend()->Delay_ms(xms);
+}
+
+/******************************************************************************
+function:	Write Rows of RowLen bytes, Stride bytes apart, as one burst.
+            A Stride of 0 sends the same row Rows times.
+******************************************************************************/
+void DEV_SPI_Write_Rows(const uint8_t *pData, uint32_t RowLen, uint32_t Stride, uint32_t Rows)
+{
+    if (RowLen == 0 || Rows == 0) {
+        return;
+    }
+    DEV_GetBackend()->SPI_Write_Rows(pData, RowLen, Stride, Rows);
+}
+
+void DEV_SPI_WriteByte(uint8_t Value)
 {
 //#ifdef USE_DEV_LIB 
-    lgSpiWrite(SPI_Handle, (char*)pData, Len);
+    DEV_SPI_Write_Rows(&Value, 1, 1, 1);
 //#endif
 }
 
-void DEV_ModuleExit(void)
+void DEV_SPI_Write_nByte(uint8_t *pData, uint32_t Len)
 {
 //#ifdef USE_DEV_LIB 
-    lgSpiClose(SPI_Handle);
-    lgGpiochipClose(GPIO_Handle1);
-    lgGpiochipClose(GPIO_Handle2);
+    DEV_SPI_Write_Rows(pData, Len, Len, 1);
 //#endif
 }
+
+void DEV_SPI_ResetStats(uint32_t SpeedHz, uint32_t MaxMessage)
+{
+    memset(&SPI_Stats, 0, sizeof(SPI_Stats));
+    SPI_Stats.speed_hz = SpeedHz;
+    SPI_Stats.max_message = MaxMessage;
+}
+
+void DEV_SPI_Account(uint64_t Bytes, uint64_t Messages, uint64_t BusyNs)
+{
+    __atomic_fetch_add(&SPI_Stats.bytes, Bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&SPI_Stats.messages, Messages, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&SPI_Stats.busy_ns, BusyNs, __ATOMIC_RELAXED);
+}
+
+void DEV_SPI_GetStats(DEV_SPI_STATS *stats)
+{
+    stats->bytes = __atomic_load_n(&SPI_Stats.bytes, __ATOMIC_RELAXED);
+    stats->messages = __atomic_load_n(&SPI_Stats.messages, __ATOMIC_RELAXED);
+    stats->busy_ns = __atomic_load_n(&SPI_Stats.busy_ns, __ATOMIC_RELAXED);
+    stats->speed_hz = SPI_Stats.speed_hz;
+    stats->max_message = SPI_Stats.max_message;
+}
@@ -39,6 +39,15 @@
 #define UWORD   uint16_t
 #define UDOUBLE uint32_t
 
+// SPI throughput counters, see DEV_SPI_GetStats
+typedef struct {
+    uint64_t bytes;         // payload bytes clocked out
+    uint64_t messages;      // SPI_IOC_MESSAGE ioctls (lgSpiWrite calls in fallback mode)
+    uint64_t busy_ns;       // time spent inside the transfer calls
+    uint32_t speed_hz;      // configured SCLK
+    uint32_t max_message;   // spidev bufsiz, the most bytes one ioctl can carry
+} DEV_SPI_STATS;
+
 /*----------------------------------------------------------------------
 Define the pin constants to match those in DEV_Config.c
 ----------------------------------------------------------------------*/
@@ -72,6 +81,8 @@ void DEV_Delay_ms(UDOUBLE xms);
 
 void DEV_SPI_WriteByte(UBYTE Value);
 void DEV_SPI_Write_nByte(uint8_t *pData, uint32_t Len);
+void DEV_SPI_Write_Rows(const uint8_t *pData, uint32_t RowLen, uint32_t Stride, uint32_t Rows);
+void DEV_SPI_GetStats(DEV_SPI_STATS *stats);
 void DEV_SetBacklight(UWORD Value);
 
 #endif
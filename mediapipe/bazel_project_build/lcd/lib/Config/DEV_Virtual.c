@@ -0,0 +1,465 @@
+/*****************************************************************************
+* | File        :   DEV_Virtual.c
+* | Function    :   Headless ST7789 panel for running the LCD stack off board
+* | Info        :
+*   See DEV_Virtual.h
+*----------------
+* | This version:   V1.0
+* | Info        :   Basic version
+*
+******************************************************************************/
+#include "DEV_Virtual.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define VIRTUAL_DEFAULT_SPI_HZ  25000000
+
+// ST7789 commands the model understands
+#define ST7789_SLPIN    0x10
+#define ST7789_SLPOUT   0x11
+#define ST7789_INVOFF   0x20
+#define ST7789_INVON    0x21
+#define ST7789_DISPOFF  0x28
+#define ST7789_DISPON   0x29
+#define ST7789_CASET    0x2A
+#define ST7789_RASET    0x2B
+#define ST7789_RAMWR    0x2C
+#define ST7789_MADCTL   0x36
+#define ST7789_COLMOD   0x3A
+
+static pthread_mutex_t Virtual_Lock = PTHREAD_MUTEX_INITIALIZER;
+static DEV_VIRTUAL_STATS Virtual_Stats;
+static UWORD Virtual_RAM[VIRTUAL_LCD_WIDTH * VIRTUAL_LCD_HEIGHT];
+static int Virtual_PinLevel[4];
+static uint32_t Virtual_SpiHz = 0;      // 0 until set or read from the environment
+static int Virtual_Realtime = -1;       // -1 until set or read from the environment
+
+// Command decoder state
+static UBYTE Virtual_Command;
+static UBYTE Virtual_Params[4];
+static UBYTE Virtual_ParamCount;
+static UBYTE Virtual_PixelHigh;
+static UBYTE Virtual_HaveHigh;
+static UWORD Virtual_CursorX;
+static UWORD Virtual_CursorY;
+
+static uint32_t Virtual_GetSpiHz(void)
+{
+    if (Virtual_SpiHz == 0) {
+        const char *value = getenv("LCD_VIRTUAL_SPI_HZ");
+        Virtual_SpiHz = value ? (uint32_t)strtoul(value, NULL, 10) : 0;
+        if (Virtual_SpiHz == 0) {
+            Virtual_SpiHz = VIRTUAL_DEFAULT_SPI_HZ;
+        }
+    }
+    return Virtual_SpiHz;
+}
+
+static int Virtual_IsRealtime(void)
+{
+    if (Virtual_Realtime < 0) {
+        const char *value = getenv("LCD_VIRTUAL_REALTIME");
+        Virtual_Realtime = (value != NULL && atoi(value) != 0);
+    }
+    return Virtual_Realtime;
+}
+
+static void Virtual_Sleep(uint64_t Ns)
+{
+    struct timespec spec;
+    spec.tv_sec = Ns / 1000000000ULL;
+    spec.tv_nsec = Ns % 1000000000ULL;
+    nanosleep(&spec, NULL);
+}
+
+static void Virtual_ResetPanel(void)
+{
+    Virtual_Command = 0;
+    Virtual_ParamCount = 0;
+    Virtual_HaveHigh = 0;
+    Virtual_Stats.window[0] = 0;
+    Virtual_Stats.window[1] = VIRTUAL_LCD_WIDTH - 1;
+    Virtual_Stats.window[2] = 0;
+    Virtual_Stats.window[3] = VIRTUAL_LCD_HEIGHT - 1;
+    Virtual_Stats.madctl = 0;
+    Virtual_Stats.colmod = 0x66;
+    Virtual_Stats.sleeping = 1;
+    Virtual_Stats.inverted = 0;
+    Virtual_Stats.display_on = 0;
+    Virtual_CursorX = 0;
+    Virtual_CursorY = 0;
+}
+
+/******************************************************************************
+function:	Decode one byte of the SPI stream
+******************************************************************************/
+static void Virtual_CommandByte(UBYTE Command)
+{
+    Virtual_Command = Command;
+    Virtual_ParamCount = 0;
+    Virtual_HaveHigh = 0;
+    Virtual_Stats.command_bytes++;
+
+    switch (Command) {
+    case ST7789_SLPIN:   Virtual_Stats.sleeping = 1; break;
+    case ST7789_SLPOUT:  Virtual_Stats.sleeping = 0; break;
+    case ST7789_INVOFF:  Virtual_Stats.inverted = 0; break;
+    case ST7789_INVON:   Virtual_Stats.inverted = 1; break;
+    case ST7789_DISPOFF: Virtual_Stats.display_on = 0; break;
+    case ST7789_DISPON:  Virtual_Stats.display_on = 1; break;
+    case ST7789_RAMWR:
+        Virtual_CursorX = Virtual_Stats.window[0];
+        Virtual_CursorY = Virtual_Stats.window[2];
+        break;
+    case ST7789_CASET:
+    case ST7789_RASET:
+    case ST7789_MADCTL:
+    case ST7789_COLMOD:
+        break;
+    default:
+        // Porch, gamma and power settings don't change what is shown
+        if (Command < 0xB0) {
+            Virtual_Stats.unknown_commands++;
+        }
+        break;
+    }
+}
+
+static void Virtual_StorePixel(UWORD Color)
+{
+    if (Virtual_CursorX < VIRTUAL_LCD_WIDTH && Virtual_CursorY < VIRTUAL_LCD_HEIGHT) {
+        Virtual_RAM[Virtual_CursorY * VIRTUAL_LCD_WIDTH + Virtual_CursorX] = Color;
+    }
+    Virtual_Stats.pixels++;
+
+    // Column first, then row; past the last row the ST7789 wraps to the first
+    if (Virtual_CursorX >= Virtual_Stats.window[1]) {
+        Virtual_CursorX = Virtual_Stats.window[0];
+        if (Virtual_CursorY >= Virtual_Stats.window[3]) {
+            Virtual_CursorY = Virtual_Stats.window[2];
+        } else {
+            Virtual_CursorY++;
+        }
+    } else {
+        Virtual_CursorX++;
+    }
+}
+
+static void Virtual_DataByte(UBYTE Data)
+{
+    switch (Virtual_Command) {
+    case ST7789_CASET:
+    case ST7789_RASET:
+        if (Virtual_ParamCount < 4) {
+            Virtual_Params[Virtual_ParamCount++] = Data;
+        }
+        if (Virtual_ParamCount == 4) {
+            UWORD Start = (Virtual_Params[0] << 8) | Virtual_Params[1];
+            UWORD End = (Virtual_Params[2] << 8) | Virtual_Params[3];
+            int Index = Virtual_Command == ST7789_CASET ? 0 : 2;
+            Virtual_Stats.window[Index] = Start;
+            Virtual_Stats.window[Index + 1] = End;
+        }
+        break;
+    case ST7789_MADCTL:
+        Virtual_Stats.madctl = Data;
+        break;
+    case ST7789_COLMOD:
+        Virtual_Stats.colmod = Data;
+        break;
+    case ST7789_RAMWR:
+        if (Virtual_HaveHigh) {
+            Virtual_StorePixel((Virtual_PixelHigh << 8) | Data);
+            Virtual_HaveHigh = 0;
+        } else {
+            Virtual_PixelHigh = Data;
+            Virtual_HaveHigh = 1;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/*****************************************
+              Backend functions
+*****************************************/
+static UBYTE Virtual_ModuleInit(void)
+{
+    pthread_mutex_lock(&Virtual_Lock);
+    memset(&Virtual_Stats, 0, sizeof(Virtual_Stats));
+    memset(Virtual_RAM, 0, sizeof(Virtual_RAM));
+    for (int i = 0; i < 4; i++) {
+        Virtual_PinLevel[i] = 0;
+    }
+    Virtual_ResetPanel();
+    Virtual_Stats.spi_hz = Virtual_GetSpiHz();
+    pthread_mutex_unlock(&Virtual_Lock);
+
+    DEV_SPI_ResetStats(Virtual_GetSpiHz(), VIRTUAL_LCD_WIDTH * VIRTUAL_LCD_HEIGHT * 2);
+    return 0;
+}
+
+static void Virtual_ModuleExit(void)
+{
+}
+
+static void Virtual_GPIO_Mode(UWORD Pin, UWORD Mode)
+{
+    (void)Mode;
+    if (Pin < 4) {
+        Virtual_PinLevel[Pin] = 0;
+    }
+}
+
+static void Virtual_Digital_Write(UWORD Pin, UBYTE Value)
+{
+    if (Pin >= 4) {
+        printf("Invalid GPIO Pin: %d\n", Pin);
+        return;
+    }
+    Value = Value ? 1 : 0;
+
+    pthread_mutex_lock(&Virtual_Lock);
+    if (Virtual_PinLevel[Pin] != Value) {
+        Virtual_Stats.gpio_writes++;
+        // Rising edge on RST ends a hardware reset
+        if (Pin == LCD_RST && Value == 1) {
+            Virtual_ResetPanel();
+        }
+        Virtual_PinLevel[Pin] = Value;
+    }
+    if (Pin == LCD_BL) {
+        Virtual_Stats.backlight = Value;
+    }
+    pthread_mutex_unlock(&Virtual_Lock);
+}
+
+static UBYTE Virtual_Digital_Read(UWORD Pin)
+{
+    return Pin < 4 ? Virtual_PinLevel[Pin] : 0;
+}
+
+static void Virtual_Delay_ms(UDOUBLE xms)
+{
+    pthread_mutex_lock(&Virtual_Lock);
+    Virtual_Stats.simulated_delay_ns += (uint64_t)xms * 1000000ULL;
+    pthread_mutex_unlock(&Virtual_Lock);
+    if (Virtual_IsRealtime()) {
+        Virtual_Sleep((uint64_t)xms * 1000000ULL);
+    }
+}
+
+static void Virtual_SPI_Write_Rows(const uint8_t *pData, uint32_t RowLen, uint32_t Stride, uint32_t Rows)
+{
+    uint64_t Bytes = (uint64_t)RowLen * Rows;
+    uint64_t Ns = Bytes * 8ULL * 1000000000ULL / Virtual_GetSpiHz();
+
+    pthread_mutex_lock(&Virtual_Lock);
+    int Command = (Virtual_PinLevel[LCD_DC] == 0);
+    for (uint32_t Row = 0; Row < Rows; Row++) {
+        const uint8_t *p = pData + (size_t)Row * Stride;
+        for (uint32_t i = 0; i < RowLen; i++) {
+            if (Command) {
+                Virtual_CommandByte(p[i]);
+            } else {
+                Virtual_DataByte(p[i]);
+            }
+        }
+    }
+    Virtual_Stats.bytes += Bytes;
+    Virtual_Stats.bursts++;
+    Virtual_Stats.simulated_spi_ns += Ns;
+    pthread_mutex_unlock(&Virtual_Lock);
+
+    if (Virtual_IsRealtime()) {
+        Virtual_Sleep(Ns);
+    }
+    DEV_SPI_Account(Bytes, 1, Ns);
+}
+
+const DEV_BACKEND DEV_Virtual_Backend = {
+    .Name = "virtual",
+    .ModuleInit = Virtual_ModuleInit,
+    .ModuleExit = Virtual_ModuleExit,
+    .GPIO_Mode = Virtual_GPIO_Mode,
+    .Digital_Write = Virtual_Digital_Write,
+    .Digital_Read = Virtual_Digital_Read,
+    .Delay_ms = Virtual_Delay_ms,
+    .SPI_Write_Rows = Virtual_SPI_Write_Rows,
+};
+
+/*****************************************
+              Inspection
+*****************************************/
+void DEV_Virtual_SetSpiClock(uint32_t Hz)
+{
+    pthread_mutex_lock(&Virtual_Lock);
+    Virtual_SpiHz = Hz ? Hz : VIRTUAL_DEFAULT_SPI_HZ;
+    Virtual_Stats.spi_hz = Virtual_SpiHz;
+    pthread_mutex_unlock(&Virtual_Lock);
+}
+
+void DEV_Virtual_SetRealtime(UBYTE Enable)
+{
+    Virtual_Realtime = Enable ? 1 : 0;
+}
+
+void DEV_Virtual_GetStats(DEV_VIRTUAL_STATS *Stats)
+{
+    pthread_mutex_lock(&Virtual_Lock);
+    *Stats = Virtual_Stats;
+    pthread_mutex_unlock(&Virtual_Lock);
+}
+
+void DEV_Virtual_ResetStats(void)
+{
+    pthread_mutex_lock(&Virtual_Lock);
+    Virtual_Stats.bytes = 0;
+    Virtual_Stats.command_bytes = 0;
+    Virtual_Stats.pixels = 0;
+    Virtual_Stats.bursts = 0;
+    Virtual_Stats.gpio_writes = 0;
+    Virtual_Stats.unknown_commands = 0;
+    Virtual_Stats.simulated_spi_ns = 0;
+    Virtual_Stats.simulated_delay_ns = 0;
+    pthread_mutex_unlock(&Virtual_Lock);
+}
+
+void DEV_Virtual_ReadRAM(UWORD *Pixels)
+{
+    pthread_mutex_lock(&Virtual_Lock);
+    memcpy(Pixels, Virtual_RAM, sizeof(Virtual_RAM));
+    pthread_mutex_unlock(&Virtual_Lock);
+}
+
+/*****************************************
+    PNG output (stored deflate, no zlib)
+*****************************************/
+static uint32_t Virtual_Crc32(uint32_t Crc, const uint8_t *Data, size_t Len)
+{
+    Crc = ~Crc;
+    for (size_t i = 0; i < Len; i++) {
+        Crc ^= Data[i];
+        for (int k = 0; k < 8; k++) {
+            Crc = (Crc >> 1) ^ (0xEDB88320u & (0u - (Crc & 1)));
+        }
+    }
+    return ~Crc;
+}
+
+static void Virtual_PutBE32(uint8_t *p, uint32_t Value)
+{
+    p[0] = Value >> 24;
+    p[1] = Value >> 16;
+    p[2] = Value >> 8;
+    p[3] = Value;
+}
+
+static int Virtual_WriteChunk(FILE *File, const char *Type, const uint8_t *Data, uint32_t Len)
+{
+    uint8_t Header[8];
+    uint8_t Trailer[4];
+    Virtual_PutBE32(Header, Len);
+    memcpy(Header + 4, Type, 4);
+    uint32_t Crc = Virtual_Crc32(0, Header + 4, 4);
+    Crc = Virtual_Crc32(Crc, Data, Len);
+    Virtual_PutBE32(Trailer, Crc);
+
+    if (fwrite(Header, 1, 8, File) != 8 ||
+        (Len > 0 && fwrite(Data, 1, Len, File) != Len) ||
+        fwrite(Trailer, 1, 4, File) != 4) {
+        return -1;
+    }
+    return 0;
+}
+
+int DEV_Virtual_SavePNG(const char *Path)
+{
+    static const uint8_t Signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    const uint32_t RowBytes = 1 + VIRTUAL_LCD_WIDTH * 3;       // filter byte + RGB
+    const uint32_t RawLen = RowBytes * VIRTUAL_LCD_HEIGHT;
+    const uint32_t Blocks = (RawLen + 65534) / 65535;
+    const uint32_t IdatLen = 2 + RawLen + Blocks * 5 + 4;
+
+    UWORD *Pixels = (UWORD *)malloc(sizeof(Virtual_RAM));
+    uint8_t *Raw = (uint8_t *)malloc(RawLen);
+    uint8_t *Idat = (uint8_t *)malloc(IdatLen);
+    if (Pixels == NULL || Raw == NULL || Idat == NULL) {
+        free(Pixels);
+        free(Raw);
+        free(Idat);
+        return -1;
+    }
+    DEV_Virtual_ReadRAM(Pixels);
+
+    // Scanlines with filter type 0, RGB565 expanded to 8 bits per channel
+    uint8_t *p = Raw;
+    for (int y = 0; y < VIRTUAL_LCD_HEIGHT; y++) {
+        *p++ = 0;
+        for (int x = 0; x < VIRTUAL_LCD_WIDTH; x++) {
+            UWORD Color = Pixels[y * VIRTUAL_LCD_WIDTH + x];
+            UBYTE R = (Color >> 11) & 0x1F;
+            UBYTE G = (Color >> 5) & 0x3F;
+            UBYTE B = Color & 0x1F;
+            *p++ = (R << 3) | (R >> 2);
+            *p++ = (G << 2) | (G >> 4);
+            *p++ = (B << 3) | (B >> 2);
+        }
+    }
+
+    // zlib stream made of stored (uncompressed) deflate blocks
+    uint8_t *q = Idat;
+    *q++ = 0x78;
+    *q++ = 0x01;
+    uint32_t A = 1, B = 0;
+    for (uint32_t Offset = 0; Offset < RawLen; ) {
+        uint32_t Len = RawLen - Offset < 65535 ? RawLen - Offset : 65535;
+        *q++ = (Offset + Len == RawLen) ? 1 : 0;
+        *q++ = Len & 0xFF;
+        *q++ = Len >> 8;
+        *q++ = ~Len & 0xFF;
+        *q++ = (~Len >> 8) & 0xFF;
+        memcpy(q, Raw + Offset, Len);
+        for (uint32_t i = 0; i < Len; i++) {
+            A = (A + Raw[Offset + i]) % 65521;
+            B = (B + A) % 65521;
+        }
+        q += Len;
+        Offset += Len;
+    }
+    Virtual_PutBE32(q, (B << 16) | A);
+
+    uint8_t Ihdr[13];
+    Virtual_PutBE32(Ihdr, VIRTUAL_LCD_WIDTH);
+    Virtual_PutBE32(Ihdr + 4, VIRTUAL_LCD_HEIGHT);
+    Ihdr[8] = 8;    // bit depth
+    Ihdr[9] = 2;    // truecolor
+    Ihdr[10] = 0;   // deflate
+    Ihdr[11] = 0;   // adaptive filtering
+    Ihdr[12] = 0;   // no interlace
+
+    int Ret = -1;
+    FILE *File = fopen(Path, "wb");
+    if (File != NULL) {
+        if (fwrite(Signature, 1, 8, File) == 8 &&
+            Virtual_WriteChunk(File, "IHDR", Ihdr, sizeof(Ihdr)) == 0 &&
+            Virtual_WriteChunk(File, "IDAT", Idat, IdatLen) == 0 &&
+            Virtual_WriteChunk(File, "IEND", NULL, 0) == 0) {
+            Ret = 0;
+        }
+        if (fclose(File) != 0) {
+            Ret = -1;
+        }
+    }
+    if (Ret != 0) {
+        printf("Unable to write %s\n", Path);
+    }
+
+    free(Pixels);
+    free(Raw);
+    free(Idat);
+    return Ret;
+}
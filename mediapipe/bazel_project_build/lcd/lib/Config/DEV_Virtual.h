@@ -0,0 +1,58 @@
+/*****************************************************************************
+* | File        :   DEV_Virtual.h
+* | Function    :   Headless ST7789 panel for running the LCD stack off board
+* | Info        :
+*   The virtual panel decodes the same command/data stream the driver sends
+*   over SPI (DC low = command, DC high = parameters / pixels). It keeps the
+*   CASET/RASET window and RAMWR cursor, wraps the cursor the way the ST7789
+*   does, and stores pixels in a 240x240 RAM. MADCTL is recorded but not
+*   applied, so RAM matches the driver's logical framebuffer layout.
+*   SPI time is simulated from the byte count at the configured SCLK, and
+*   DEV_Delay_ms only adds to the simulated time unless realtime is enabled.
+*   Environment: LCD_VIRTUAL_SPI_HZ sets the clock, LCD_VIRTUAL_REALTIME=1
+*   makes transfers and delays sleep for their simulated duration.
+*----------------
+* | This version:   V1.0
+* | Info        :   Basic version
+*
+******************************************************************************/
+#ifndef _DEV_VIRTUAL_H_
+#define _DEV_VIRTUAL_H_
+
+#include "DEV_Backend.h"
+
+#define VIRTUAL_LCD_WIDTH   240
+#define VIRTUAL_LCD_HEIGHT  240
+
+typedef struct {
+    uint64_t bytes;             // all bytes clocked out
+    uint64_t command_bytes;     // bytes sent with DC low
+    uint64_t pixels;            // RAMWR pixels stored
+    uint64_t bursts;            // SPI_Write_Rows calls
+    uint64_t gpio_writes;       // Digital_Write calls that changed a level
+    uint64_t unknown_commands;  // commands the panel model ignores
+    uint64_t simulated_spi_ns;  // bytes * 8 / spi_hz
+    uint64_t simulated_delay_ns;
+    uint32_t spi_hz;
+    UWORD window[4];            // Xstart, Xend, Ystart, Yend (inclusive)
+    UBYTE madctl;
+    UBYTE colmod;
+    UBYTE sleeping;
+    UBYTE inverted;
+    UBYTE display_on;
+    UBYTE backlight;
+} DEV_VIRTUAL_STATS;
+
+void DEV_Virtual_SetSpiClock(uint32_t Hz);
+void DEV_Virtual_SetRealtime(UBYTE Enable);
+
+void DEV_Virtual_GetStats(DEV_VIRTUAL_STATS *Stats);
+// Zero the counters; panel state and RAM are kept
+void DEV_Virtual_ResetStats(void);
+
+// Copy of the panel RAM as RGB565 (native order, not byte swapped)
+void DEV_Virtual_ReadRAM(UWORD *Pixels);
+// Write the panel RAM as a 24-bit PNG, returns 0 on success
+int DEV_Virtual_SavePNG(const char *Path);
+
+#endif
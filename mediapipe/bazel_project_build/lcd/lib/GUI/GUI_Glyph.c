@@ -0,0 +1,136 @@
+/*****************************************************************************
+* | File      	:   GUI_Glyph.c
+* | Function    :   Pre-rendered glyph atlas for the sFONT bitmap fonts
+* | Info        :
+*   See GUI_Glyph.h
+*----------------
+* |	This version:   V1.0
+* | Info        :   Basic version
+*
+******************************************************************************/
+#include "GUI_Glyph.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static GLYPH_ATLAS s_cache[GLYPH_CACHE_SLOTS];
+static UDOUBLE s_useCounter = 0;
+static UBYTE s_enabled = 1;
+
+static UWORD Glyph_Swap(UWORD Color)
+{
+    return ((Color<<8)&0xff00)|(Color>>8);
+}
+
+/******************************************************************************
+function: Render every glyph of the atlas font into its tiles and masks
+******************************************************************************/
+static void Glyph_Build(GLYPH_ATLAS* Atlas)
+{
+    const sFONT* Font = Atlas->Font;
+    UWORD Foreground = Glyph_Swap(Atlas->Color_Foreground);
+    UWORD Background = Glyph_Swap(Atlas->Color_Background);
+    UWORD BytesPerRow = Font->Width / 8 + (Font->Width % 8 ? 1 : 0);
+    UDOUBLE TileSize = (UDOUBLE)Font->Width * Font->Height;
+
+    for (UWORD Glyph = 0; Glyph < GLYPH_COUNT; Glyph++) {
+        const unsigned char *ptr = &Font->table[(UDOUBLE)Glyph * Font->Height * BytesPerRow];
+        UWORD *Tile = &Atlas->Tiles[Glyph * TileSize];
+        UDOUBLE *Mask = &Atlas->Masks[Glyph * Font->Height];
+
+        for (UWORD Page = 0; Page < Font->Height; Page++) {
+            UDOUBLE RowMask = 0;
+            for (UWORD Column = 0; Column < Font->Width; Column++) {
+                if (ptr[Column / 8] & (0x80 >> (Column % 8))) {
+                    Tile[Page * Font->Width + Column] = Foreground;
+                    RowMask |= 0x80000000u >> Column;
+                } else {
+                    Tile[Page * Font->Width + Column] = Background;
+                }
+            }
+            Mask[Page] = RowMask;
+            ptr += BytesPerRow;
+        }
+    }
+}
+
+/******************************************************************************
+function: Find or build the atlas of a font / color pair
+parameter:
+    Font             ：Font to render
+    Color_Foreground : Color of the set font pixels
+    Color_Background : Color of the clear font pixels
+******************************************************************************/
+const GLYPH_ATLAS* Glyph_GetAtlas(const sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
+{
+    if (Font == NULL || Font->Width == 0 || Font->Width > GLYPH_MAX_WIDTH) {
+        return NULL;
+    }
+
+    GLYPH_ATLAS* Victim = &s_cache[0];
+    for (int i = 0; i < GLYPH_CACHE_SLOTS; i++) {
+        GLYPH_ATLAS* Atlas = &s_cache[i];
+        if (Atlas->Font == Font && Atlas->Color_Foreground == Color_Foreground &&
+            Atlas->Color_Background == Color_Background) {
+            Atlas->LastUse = ++s_useCounter;
+            return Atlas;
+        }
+        // Empty slots have LastUse 0, so they are picked before any used one
+        if (Atlas->LastUse < Victim->LastUse) {
+            Victim = Atlas;
+        }
+    }
+
+    // Evict the least recently used slot
+    free(Victim->Tiles);
+    free(Victim->Masks);
+    memset(Victim, 0, sizeof(*Victim));
+
+    UDOUBLE TileSize = (UDOUBLE)Font->Width * Font->Height;
+    Victim->Tiles = (UWORD *)malloc(GLYPH_COUNT * TileSize * sizeof(UWORD));
+    Victim->Masks = (UDOUBLE *)malloc(GLYPH_COUNT * Font->Height * sizeof(UDOUBLE));
+    if (Victim->Tiles == NULL || Victim->Masks == NULL) {
+        DEBUG("Glyph_GetAtlas: unable to allocate atlas\r\n");
+        free(Victim->Tiles);
+        free(Victim->Masks);
+        memset(Victim, 0, sizeof(*Victim));
+        return NULL;
+    }
+
+    Victim->Font = Font;
+    Victim->Color_Foreground = Color_Foreground;
+    Victim->Color_Background = Color_Background;
+    Victim->LastUse = ++s_useCounter;
+    Glyph_Build(Victim);
+    return Victim;
+}
+
+const UWORD* Glyph_Tile(const GLYPH_ATLAS* Atlas, char Acsii_Char)
+{
+    UDOUBLE TileSize = (UDOUBLE)Atlas->Font->Width * Atlas->Font->Height;
+    return &Atlas->Tiles[(Acsii_Char - GLYPH_FIRST_CHAR) * TileSize];
+}
+
+const UDOUBLE* Glyph_Masks(const GLYPH_ATLAS* Atlas, char Acsii_Char)
+{
+    return &Atlas->Masks[(Acsii_Char - GLYPH_FIRST_CHAR) * Atlas->Font->Height];
+}
+
+void Glyph_SetEnabled(UBYTE Enable)
+{
+    s_enabled = Enable ? 1 : 0;
+}
+
+UBYTE Glyph_IsEnabled(void)
+{
+    return s_enabled;
+}
+
+void Glyph_ClearCache(void)
+{
+    for (int i = 0; i < GLYPH_CACHE_SLOTS; i++) {
+        free(s_cache[i].Tiles);
+        free(s_cache[i].Masks);
+        memset(&s_cache[i], 0, sizeof(s_cache[i]));
+    }
+}
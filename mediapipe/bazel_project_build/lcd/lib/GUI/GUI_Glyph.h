@@ -0,0 +1,52 @@
+/*****************************************************************************
+* | File      	:   GUI_Glyph.h
+* | Function    :   Pre-rendered glyph atlas for the sFONT bitmap fonts
+* | Info        :
+*   Each atlas holds every printable ASCII glyph of one font rendered in one
+*   foreground/background pair as byte-swapped RGB565 tiles (the layout the
+*   ST7789 expects), plus a per-row bit mask of the foreground pixels so
+*   transparent text can be drawn as spans as well.
+*   Atlases are built on first use and kept in a small LRU cache.
+*   Not thread safe: use from the same thread that owns Paint.
+*----------------
+* |	This version:   V1.0
+* | Info        :   Basic version
+*
+******************************************************************************/
+#ifndef __GUI_GLYPH_H
+#define __GUI_GLYPH_H
+
+#include "../Config/DEV_Config.h"
+#include "../Fonts/fonts.h"
+
+#define GLYPH_FIRST_CHAR    ' '
+#define GLYPH_LAST_CHAR     '~'
+#define GLYPH_COUNT         (GLYPH_LAST_CHAR - GLYPH_FIRST_CHAR + 1)
+#define GLYPH_MAX_WIDTH     32      // Row masks are 32 bits wide
+#define GLYPH_CACHE_SLOTS   4
+
+typedef struct {
+    const sFONT *Font;
+    UWORD Color_Foreground;
+    UWORD Color_Background;
+    UWORD *Tiles;       // GLYPH_COUNT tiles of Width*Height pixels, byte-swapped
+    UDOUBLE *Masks;     // GLYPH_COUNT * Height masks, bit 31 = leftmost column
+    UDOUBLE LastUse;
+} GLYPH_ATLAS;
+
+// Returns the atlas for Font in the given colors, building it if needed.
+// Returns NULL if the font is too wide or memory could not be allocated.
+const GLYPH_ATLAS* Glyph_GetAtlas(const sFONT* Font, UWORD Color_Foreground, UWORD Color_Background);
+
+// Start of the tile / masks of one character (must be a printable ASCII char)
+const UWORD* Glyph_Tile(const GLYPH_ATLAS* Atlas, char Acsii_Char);
+const UDOUBLE* Glyph_Masks(const GLYPH_ATLAS* Atlas, char Acsii_Char);
+
+// Enable/disable atlas based text drawing in GUI_Paint (enabled by default)
+void Glyph_SetEnabled(UBYTE Enable);
+UBYTE Glyph_IsEnabled(void);
+
+// Free every cached atlas
+void Glyph_ClearCache(void);
+
+#endif
@@ -35,12 +35,19 @@
 *
 ******************************************************************************/
 #include "GUI_Paint.h"
+#include "GUI_Glyph.h"
 
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h> //memset()
 #include <math.h>
 
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 PAINT Paint;
 
 /******************************************************************************
@@ -199,6 +206,109 @@ void Paint_SetPixel(UWORD Xpoint, UWORD Ypoint, UWORD Color)
     }
 }
 
+/******************************************************************************
+function: Fill Count 16 bit words with Value
+info:
+    Words whose two bytes match (WHITE, BLACK) go through memset, the rest
+    through NEON/SSE2 stores or a 64 bit pattern when neither is available.
+******************************************************************************/
+void Paint_Fill16(UWORD *Dst, UWORD Value, UDOUBLE Count)
+{
+    if ((Value >> 8) == (Value & 0xFF)) {
+        memset(Dst, Value & 0xFF, (size_t)Count * sizeof(UWORD));
+        return;
+    }
+
+#if defined(__ARM_NEON)
+    uint16x8_t Vector = vdupq_n_u16(Value);
+    for (; Count >= 32; Count -= 32, Dst += 32) {
+        vst1q_u16(Dst, Vector);
+        vst1q_u16(Dst + 8, Vector);
+        vst1q_u16(Dst + 16, Vector);
+        vst1q_u16(Dst + 24, Vector);
+    }
+    for (; Count >= 8; Count -= 8, Dst += 8) {
+        vst1q_u16(Dst, Vector);
+    }
+#elif defined(__SSE2__)
+    __m128i Vector = _mm_set1_epi16((short)Value);
+    for (; Count >= 32; Count -= 32, Dst += 32) {
+        _mm_storeu_si128((__m128i *)Dst, Vector);
+        _mm_storeu_si128((__m128i *)(Dst + 8), Vector);
+        _mm_storeu_si128((__m128i *)(Dst + 16), Vector);
+        _mm_storeu_si128((__m128i *)(Dst + 24), Vector);
+    }
+    for (; Count >= 8; Count -= 8, Dst += 8) {
+        _mm_storeu_si128((__m128i *)Dst, Vector);
+    }
+#else
+    uint64_t Pattern = Value * 0x0001000100010001ULL;
+    for (; Count > 0 && ((uintptr_t)Dst & 7); Count--) {
+        *Dst++ = Value;
+    }
+    for (; Count >= 4; Count -= 4, Dst += 4) {
+        memcpy(Dst, &Pattern, sizeof(Pattern));
+    }
+#endif
+    while (Count--) {
+        *Dst++ = Value;
+    }
+}
+
+/******************************************************************************
+function: Fill the pixels (Xstart..Xend, Ystart..Yend), inclusive, one row
+          at a time
+info:
+    Rotation and mirroring map a rectangle onto a rectangle, so the fill
+    works in memory coordinates. The area is clipped to the image. Returns 0
+    for 1 bit images, which still need Paint_SetPixel.
+******************************************************************************/
+static UBYTE Paint_FillRect(int Xstart, int Ystart, int Xend, int Yend, UWORD Color)
+{
+    if (Paint.Depth != 16) {
+        return 0;
+    }
+    if (Xstart < 0) Xstart = 0;
+    if (Ystart < 0) Ystart = 0;
+    if (Xend > Paint.Width - 1) Xend = Paint.Width - 1;
+    if (Yend > Paint.Height - 1) Yend = Paint.Height - 1;
+    if (Xstart > Xend || Ystart > Yend) {
+        return 1;
+    }
+
+    // Map both corners the same way Paint_SetPixel does
+    int X[2] = {Xstart, Xend};
+    int Y[2] = {Ystart, Yend};
+    for (int i = 0; i < 2; i++) {
+        int Xpoint = X[i], Ypoint = Y[i];
+        switch (Paint.Rotate) {
+        case 0:   X[i] = Xpoint; Y[i] = Ypoint; break;
+        case 90:  X[i] = Paint.WidthMemory - Ypoint - 1; Y[i] = Xpoint; break;
+        case 180: X[i] = Paint.WidthMemory - Xpoint - 1; Y[i] = Paint.HeightMemory - Ypoint - 1; break;
+        case 270: X[i] = Ypoint; Y[i] = Paint.HeightMemory - Xpoint - 1; break;
+        default:  return 1;
+        }
+        if (Paint.Mirror == MIRROR_HORIZONTAL || Paint.Mirror == MIRROR_ORIGIN) {
+            X[i] = Paint.WidthMemory - X[i] - 1;
+        }
+        if (Paint.Mirror == MIRROR_VERTICAL || Paint.Mirror == MIRROR_ORIGIN) {
+            Y[i] = Paint.HeightMemory - Y[i] - 1;
+        }
+    }
+    int Left = X[0] < X[1] ? X[0] : X[1];
+    int Right = X[0] < X[1] ? X[1] : X[0];
+    int Top = Y[0] < Y[1] ? Y[0] : Y[1];
+    int Bottom = Y[0] < Y[1] ? Y[1] : Y[0];
+
+    Color = ((Color<<8)&0xff00)|(Color>>8);
+    UWORD *Row = &Paint.Image[Left + (UDOUBLE)Top * Paint.WidthByte];
+    for (int Ypoint = Top; Ypoint <= Bottom; Ypoint++) {
+        Paint_Fill16(Row, Color, Right - Left + 1);
+        Row += Paint.WidthByte;
+    }
+    return 1;
+}
+
 /******************************************************************************
 function: Clear the color of the picture
 parameter:
@@ -206,12 +316,7 @@ parameter:
 ******************************************************************************/
 void Paint_Clear(UWORD Color)
 {
-    for (UWORD Y = 0; Y < Paint.HeightByte; Y++) {
-        for (UWORD X = 0; X < Paint.WidthByte; X++ ) {//8 pixel =  1 byte
-            UDOUBLE Addr = X + Y*Paint.WidthByte;
-            Paint.Image[Addr] = Color;
-        }
-    }
+    Paint_Fill16(Paint.Image, Color, (UDOUBLE)Paint.WidthByte * Paint.HeightByte);
 }
 
 /******************************************************************************
@@ -225,6 +330,13 @@ parameter:
 ******************************************************************************/
 void Paint_ClearWindow(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color)
 {
+    if (Xend <= Xstart || Yend <= Ystart) {
+        return;
+    }
+    if (Paint_FillRect(Xstart, Ystart, Xend - 1, Yend - 1, Color)) {
+        return;
+    }
+
     UWORD X, Y;
     for (Y = Ystart; Y < Yend; Y++) {
         for (X = Xstart; X < Xend; X++) {//8 pixel =  1 byte
@@ -351,6 +463,20 @@ void Paint_DrawRectangle(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
     }
 
     if (Draw_Fill) {
+        // Same pixels the DrawLine per row below sets: a DOT_FILL_AROUND point
+        // of width w covers [p - w, p + w - 2] and points closer than w to the
+        // top/left edge draw nothing.
+        int w = Line_width;
+        int Xlow = Xstart < Xend ? Xstart : Xend;
+        int X1 = Xstart < Xend ? Xend : Xstart;
+        int X0 = Xlow > w ? Xlow : w;
+        int Y0 = Ystart > w ? Ystart : w;
+        int Y1 = (int)Yend - 1;
+        if (X0 > X1 || Y0 > Y1 ||
+            Paint_FillRect(X0 - w, Y0 - w, X1 + w - 2, Y1 + w - 2, Color)) {
+            return;
+        }
+
         UWORD Ypoint;
         for(Ypoint = Ystart; Ypoint < Yend; Ypoint++) {
             Paint_DrawLine(Xstart, Ypoint, Xend, Ypoint, Color , Line_width, LINE_STYLE_SOLID);
@@ -433,6 +559,56 @@ void Paint_DrawCircle(UWORD X_Center, UWORD Y_Center, UWORD Radius,
     }
 }
 
+/******************************************************************************
+function: Draw a character from the pre-rendered glyph atlas
+info:
+    Only used for unrotated, unmirrored 16 bit images when the whole glyph
+    fits on the image; returns 0 so the caller falls back to Paint_SetPixel
+    otherwise. Opaque glyphs are copied a row at a time, transparent ones
+    (FONT_BACKGROUND) as runs of set pixels taken from the row masks.
+******************************************************************************/
+static UBYTE Paint_DrawCharFast(UWORD Xpoint, UWORD Ypoint, const char Acsii_Char,
+                                sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
+{
+    if (!Glyph_IsEnabled() || Paint.Depth != 16 || Paint.Rotate != ROTATE_0 ||
+        Paint.Mirror != MIRROR_NONE || Acsii_Char < GLYPH_FIRST_CHAR || Acsii_Char > GLYPH_LAST_CHAR ||
+        Xpoint + Font->Width > Paint.Width || Ypoint + Font->Height > Paint.Height) {
+        return 0;
+    }
+
+    const GLYPH_ATLAS *Atlas = Glyph_GetAtlas(Font, Color_Foreground, Color_Background);
+    if (Atlas == NULL) {
+        return 0;
+    }
+
+    const UWORD *Tile = Glyph_Tile(Atlas, Acsii_Char);
+    UWORD *Row = &Paint.Image[Xpoint + (UDOUBLE)Ypoint * Paint.WidthByte];
+
+    if (FONT_BACKGROUND != Color_Background) {
+        for (UWORD Page = 0; Page < Font->Height; Page++) {
+            memcpy(Row, Tile, Font->Width * sizeof(UWORD));
+            Row += Paint.WidthByte;
+            Tile += Font->Width;
+        }
+        return 1;
+    }
+
+    const UDOUBLE *Masks = Glyph_Masks(Atlas, Acsii_Char);
+    for (UWORD Page = 0; Page < Font->Height; Page++) {
+        UDOUBLE Mask = Masks[Page];
+        while (Mask) {
+            UWORD Start = __builtin_clz(Mask);
+            UDOUBLE Inverted = ~(Mask << Start);
+            UWORD Length = Inverted ? __builtin_clz(Inverted) : 32;
+            memcpy(&Row[Start], &Tile[Start], Length * sizeof(UWORD));
+            Mask &= (Start + Length >= 32) ? 0 : (0xFFFFFFFFu >> (Start + Length));
+        }
+        Row += Paint.WidthByte;
+        Tile += Font->Width;
+    }
+    return 1;
+}
+
 /******************************************************************************
 function: Show English characters
 parameter:
@@ -453,6 +629,10 @@ void Paint_DrawChar(UWORD Xpoint, UWORD Ypoint, const char Acsii_Char,
         return;
     }
 
+    if (Paint_DrawCharFast(Xpoint, Ypoint, Acsii_Char, Font, Color_Foreground, Color_Background)) {
+        return;
+    }
+
     uint32_t Char_Offset = (Acsii_Char - ' ') * Font->Height * (Font->Width / 8 + (Font->Width % 8 ? 1 : 0));
     const unsigned char *ptr = &Font->table[Char_Offset];
 
@@ -151,6 +151,7 @@ void Paint_SetMirroring(UBYTE mirror);
 void Paint_SetPixel(UWORD Xpoint, UWORD Ypoint, UWORD Color);
 
 void Paint_Clear(UWORD Color);
+void Paint_Fill16(UWORD *Dst, UWORD Value, UDOUBLE Count);
 void Paint_ClearWindow(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color);
 
 //Drawing
@@ -26,12 +26,14 @@ parameter:
 ******************************************************************************/
 static void LCD_1IN54_Reset(void)
 {
+    // ST7789: reset low for at least 10 us, then up to 120 ms before it
+    // accepts commands again
     LCD_1IN54_RST_1;
-    DEV_Delay_ms(100);
+    DEV_Delay_ms(1);
     LCD_1IN54_RST_0;
-    DEV_Delay_ms(100);
+    DEV_Delay_ms(1);
     LCD_1IN54_RST_1;
-    DEV_Delay_ms(100);
+    DEV_Delay_ms(120);
 }
 
 /******************************************************************************
@@ -56,6 +58,18 @@ static void LCD_1IN54_SendData_8Bit(UBYTE Data)
     DEV_SPI_WriteByte(Data);
 }
 
+/******************************************************************************
+function :	send several data bytes in one transfer
+parameter:
+    pData : Data to write
+    Len   : Number of bytes
+******************************************************************************/
+static void LCD_1IN54_SendData_nByte(UBYTE *pData, UDOUBLE Len)
+{
+    LCD_1IN54_DC_1;
+    DEV_SPI_Write_nByte(pData, Len);
+}
+
 /******************************************************************************
 function :	send data
 parameter:
@@ -63,9 +77,8 @@ parameter:
 ******************************************************************************/
 static void LCD_1IN54_SendData_16Bit(UWORD Data)
 {
-    LCD_1IN54_DC_1;
-    DEV_SPI_WriteByte((Data >> 8) & 0xFF);
-    DEV_SPI_WriteByte(Data & 0xFF);
+    UBYTE Bytes[2] = {(Data >> 8) & 0xFF, Data & 0xFF};
+    LCD_1IN54_SendData_nByte(Bytes, 2);
 }
 
 /******************************************************************************
@@ -202,19 +215,20 @@ parameter:
 ********************************************************************************/
 void LCD_1IN54_SetWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend)
 {
+    // DC is a GPIO, so each command byte and its parameters need their own
+    // transfer; the parameters are at least sent as one burst.
+    UBYTE Columns[4] = {(Xstart >> 8) & 0xFF, Xstart & 0xFF,
+                        ((Xend - 1) >> 8) & 0xFF, (Xend - 1) & 0xFF};
+    UBYTE Rows[4] = {(Ystart >> 8) & 0xFF, Ystart & 0xFF,
+                     ((Yend - 1) >> 8) & 0xFF, (Yend - 1) & 0xFF};
+
     //set the X coordinates
     LCD_1IN54_SendCommand(0x2A);
-    LCD_1IN54_SendData_8Bit((Xstart >> 8) & 0xFF);
-    LCD_1IN54_SendData_8Bit(Xstart & 0xFF);
-    LCD_1IN54_SendData_8Bit(((Xend  - 1) >> 8) & 0xFF);
-    LCD_1IN54_SendData_8Bit((Xend  - 1) & 0xFF);
+    LCD_1IN54_SendData_nByte(Columns, 4);
 
     //set the Y coordinates
     LCD_1IN54_SendCommand(0x2B);
-    LCD_1IN54_SendData_8Bit((Ystart >> 8) & 0xFF);
-    LCD_1IN54_SendData_8Bit(Ystart & 0xFF);
-    LCD_1IN54_SendData_8Bit(((Yend  - 1) >> 8) & 0xFF);
-    LCD_1IN54_SendData_8Bit((Yend  - 1) & 0xFF);
+    LCD_1IN54_SendData_nByte(Rows, 4);
 
     LCD_1IN54_SendCommand(0X2C);
 }
@@ -225,20 +239,23 @@ parameter:
 ******************************************************************************/
 void LCD_1IN54_Clear(UWORD Color)
 {
+    // One pre-swapped row, sent HEIGHT times (stride 0); only refilled when
+    // the color changes
+    static UWORD Row[LCD_1IN54_WIDTH];
+    static int RowColor = -1;
     UWORD j;
-    UWORD Image[LCD_1IN54_WIDTH*LCD_1IN54_HEIGHT];
-    
-    Color = ((Color<<8)&0xff00)|(Color>>8);
-   
-    for (j = 0; j < LCD_1IN54_HEIGHT*LCD_1IN54_WIDTH; j++) {
-        Image[j] = Color;
+
+    if (RowColor != Color) {
+        UWORD Swapped = ((Color<<8)&0xff00)|(Color>>8);
+        for (j = 0; j < LCD_1IN54_WIDTH; j++) {
+            Row[j] = Swapped;
+        }
+        RowColor = Color;
     }
-    
+
     LCD_1IN54_SetWindows(0, 0, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT);
     LCD_1IN54_DC_1;
-    for(j = 0; j < LCD_1IN54_HEIGHT; j++){
-        DEV_SPI_Write_nByte((uint8_t *)&Image[j*LCD_1IN54_WIDTH], LCD_1IN54_WIDTH*2);
-    }
+    DEV_SPI_Write_Rows((uint8_t *)Row, LCD_1IN54_WIDTH*2, 0, LCD_1IN54_HEIGHT);
 }
 
 /******************************************************************************
@@ -247,26 +264,19 @@ parameter:
 ******************************************************************************/
 void LCD_1IN54_Display(UWORD *Image)
 {
-    UWORD j;
     LCD_1IN54_SetWindows(0, 0, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT);
     LCD_1IN54_DC_1;
-    for (j = 0; j < LCD_1IN54_HEIGHT; j++) {
-        DEV_SPI_Write_nByte((uint8_t *)&Image[j*LCD_1IN54_WIDTH], LCD_1IN54_WIDTH*2);
-    }
+    DEV_SPI_Write_Rows((uint8_t *)Image, LCD_1IN54_WIDTH*2, LCD_1IN54_WIDTH*2, LCD_1IN54_HEIGHT);
 }
 
 void LCD_1IN54_DisplayWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD *Image)
 {
     // display
-    UDOUBLE Addr = 0;
+    UDOUBLE Addr = Xstart + Ystart * LCD_1IN54_WIDTH;
 
-    UWORD j;
     LCD_1IN54_SetWindows(Xstart, Ystart, Xend , Yend);
     LCD_1IN54_DC_1;
-    for (j = Ystart; j < Yend - 1; j++) {
-        Addr = Xstart + j * LCD_1IN54_WIDTH ;
-        DEV_SPI_Write_nByte((uint8_t *)&Image[Addr], (Xend-Xstart)*2);
-    }
+    DEV_SPI_Write_Rows((uint8_t *)&Image[Addr], (Xend-Xstart)*2, LCD_1IN54_WIDTH*2, Yend-Ystart);
 }
 
 void LCD_1IN54_DisplayPoint(UWORD X, UWORD Y, UWORD Color)
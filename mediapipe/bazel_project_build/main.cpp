@@ -3,6 +3,7 @@
 #include <sstream>
 #include <chrono>
 #include <thread>
+#include <pthread.h>
 #include <cstdlib>
 #include <algorithm>
 #include <fstream>
@@ -16,16 +17,75 @@
 #include "app/GameState.h"
 #include "app/DisplayManager.h"
 #include "app/GestureDetector.h"
+#include "app/hand_recognition.hpp"
 #include "app/GestureEventSender.h"
+#include "app/StartupOrchestrator.h"
+#include "app/assetCache.h"
 #include "app/lcd_display.h"
 #include "hal/rotary_press_statemachine.h"
 #include "hal/joystick_press.h"
+#include "hal/input_events.h"
 #include "app/SoundManager.h"
 #include "app/audioMixer.h"
+#include "app/periodTimer.h"
+#include "app/metrics.h"
+#include "app/trace.h"
+#include "app/logger.h"
+#include "app/threadTopology.h"
 
 //bazel build -c opt --crosstool_top=@crosstool//:toolchains --compiler=gcc --cpu=aarch64 --define MEDIAPIPE_DISABLE_GPU=1 //bazel_project_build:gesture_game
 
-std::atomic<bool> joystickRunning = false;
+// Acts on input events nobody else handles: a joystick press starts
+// gesture detection. Runs until *pRunning goes false.
+static void runInputActions(GestureDetector* detector, bool* pDetectionRunning, std::atomic<bool>* pRunning) {
+    static const int startLatencyMetric = Metrics_registerSummary("input_to_action_ms", "action=\"start_detection\"",
+        "Time from the input event (kernel timestamp for buttons) until its action was done, in ms.");
+    pthread_setname_np(pthread_self(), "input_actions");
+    Topology_applySelf();
+    int subscriber = Input_subscribe();
+    if (subscriber < 0) {
+        return;
+    }
+
+    while (pRunning->load()) {
+        Input_event_t event;
+        // The timeout is only so the thread notices when to exit
+        if (!Input_wait(subscriber, &event, 200) ||
+            event.device != INPUT_DEVICE_JOYSTICK_BUTTON || event.type != INPUT_PRESS) {
+            continue;
+        }
+
+        // Every press starts detection; it is stopped by the game or 'stop'
+        if (detector->isRunning()) {
+            std::cout << "\n[JOYSTICK] Already running.\n";
+            continue;
+        }
+        std::cout << "\n[JOYSTICK] Press detected — starting gesture detection...\n";
+        detector->start();
+        *pDetectionRunning = true;
+
+        double latencyMs = (Input_nowNs() - event.timeNs) / 1e6;
+        Metrics_observe(startLatencyMetric, latencyMs);
+        std::cout << "[JOYSTICK] Gesture detection started " << latencyMs << " ms after the press.\n";
+    }
+    Input_unsubscribe(subscriber);
+}
+
+// Parse "<device> <type>" names as used in input recordings
+static bool parseInputEvent(const std::string& deviceName, const std::string& typeName,
+                            Input_device* pDevice, Input_type* pType) {
+    int device = 0;
+    while (device < INPUT_NUM_DEVICES && deviceName != Input_deviceName((Input_device)device)) {
+        device++;
+    }
+    int type = 0;
+    while (type < INPUT_NUM_TYPES && typeName != Input_typeName((Input_type)type)) {
+        type++;
+    }
+    *pDevice = (Input_device)device;
+    *pType = (Input_type)type;
+    return device < INPUT_NUM_DEVICES && type < INPUT_NUM_TYPES;
+}
 
 
 // Function to display available commands
@@ -42,7 +102,16 @@ void displayHelp() {
     std::cout << "  notready            - Set your status to not ready" << std::endl;
     std::cout << "  start               - Start gesture detection" << std::endl;
     std::cout << "  stop                - Stop gesture detection" << std::endl;
+    std::cout << "  standby on|off      - Keep the camera streaming between rounds (default on)" << std::endl;
     std::cout << "  webcamtest          - Test Your Webcam to see if it works" << std::endl;
+    std::cout << "  trace on|off        - Start/stop recording a timeline trace" << std::endl;
+    std::cout << "  trace dump [file]   - Write the trace as Chrome JSON (default /tmp/gesture_game.trace.json)" << std::endl;
+    std::cout << "  profile on [path] [ms] - Profile the hand graph; trace logs go to <path>N.binarypb every ms" << std::endl;
+    std::cout << "  profile off         - Stop profiling the hand graph" << std::endl;
+    std::cout << "  input record <file> - Record input events to a file ('input stop' to finish)" << std::endl;
+    std::cout << "  input replay <file> - Replay recorded input events" << std::endl;
+    std::cout << "  input inject <device> <type> [value] - Inject one event, e.g. 'input inject rotary_button press'" << std::endl;
+    std::cout << "  metrics             - Print all metrics (also served on 127.0.0.1:" << METRICS_DEFAULT_PORT << "/metrics)" << std::endl;
     // Testing commands - to be removed in final version
     std::cout << "  starttimer [seconds]  - Test: Start timer (default 30s)" << std::endl;
     std::cout << "  stoptimer             - Test: Stop timer" << std::endl;
@@ -50,6 +119,40 @@ void displayHelp() {
     std::cout << "  exit                - Exit the application" << std::endl;
 }
 
+// Metrics pulled from modules that already keep their own statistics
+static void collectDeviceMetrics(void* pContext) {
+    static const int lcdFramesMetric = Metrics_registerCounter("lcd_frames_total", nullptr,
+        "Frames drawn and flushed to the LCD.");
+    static const int lcdCoalescedMetric = Metrics_registerCounter("lcd_updates_coalesced_total", nullptr,
+        "LCD updates replaced by a newer one before being drawn.");
+    static const int lcdFlushMetric = Metrics_registerGauge("lcd_last_flush_ms", nullptr,
+        "SPI flush time of the last LCD frame, in ms.");
+    static const int lcdMaxFrameMetric = Metrics_registerGauge("lcd_max_frame_ms", nullptr,
+        "Longest LCD frame (render and flush) since startup, in ms.");
+    static const int xrunsMetric = Metrics_registerCounter("audio_xruns_total", nullptr,
+        "ALSA playback under-runs.");
+    static const int audioIdleMetric = Metrics_registerGauge("audio_idle_ratio", nullptr,
+        "Fraction of the time the audio output has been parked with nothing to play.");
+    static const int logDroppedMetric = Metrics_registerCounter("log_dropped_total", nullptr,
+        "Log messages lost because the log queue was full.");
+    static const int logSuppressedMetric = Metrics_registerCounter("log_suppressed_total", nullptr,
+        "Repeated log messages held back by rate limiting.");
+    (void)pContext;
+
+    lcd_render_stats lcdStats;
+    lcd_get_render_stats(&lcdStats);
+    Metrics_set(lcdFramesMetric, lcdStats.frames_rendered);
+    Metrics_set(lcdCoalescedMetric, lcdStats.updates_coalesced);
+    Metrics_set(lcdFlushMetric, lcdStats.last_flush_ms);
+    Metrics_set(lcdMaxFrameMetric, lcdStats.max_frame_ms);
+    Metrics_set(xrunsMetric, AudioMixer_getXrunCount());
+    Metrics_set(audioIdleMetric, AudioMixer_getIdleFraction());
+    Log_stats_t logStats;
+    Log_getStats(&logStats);
+    Metrics_set(logDroppedMetric, logStats.dropped);
+    Metrics_set(logSuppressedMetric, logStats.suppressed);
+}
+
 int main(int argc, char* argv[]) {
     // More aggressive silencing of output from specific warnings by redirecting stderr
     std::freopen("/dev/null", "w", stderr);
@@ -72,38 +175,27 @@ int main(int argc, char* argv[]) {
     std::streambuf* stderr_buf = std::cerr.rdbuf();
     std::cerr.rdbuf(logFile.rdbuf());
 
-    std::thread joystickThread;
-
+    // Timing, logging and metrics come first so every module can use them.
+    // Log messages go to the console and, with time and category, the log file.
+    Period_init();
+    Log_init();
+    Log_openFile("/tmp/mediapipe.log");
+    Metrics_init();
+    Trace_init();
+    Input_init();
+    // Before the hand graph starts, which sizes its pools from it
+    if (Topology_init() != 0) {
+        std::cerr << "WARNING: Thread topology not loaded; threads keep their defaults" << std::endl;
+    }
+    // Before anything loads sounds or models: startup reads the local
+    // copies, and the share is only checked once startup is done
+    AssetCache_init(nullptr);
     
     try {
-        // Initialize WebSocket client
-        std::cout << "Connecting to server via WebSocket..." << std::endl;
+        // Objects first: constructing them touches no hardware or network
         WebSocketClient* webSocketClient = new WebSocketClient("four33project.onrender.com", 443, "/", true);
         
-        // Try to connect with retries
-        int retries = 0;
-        const int maxRetries = 3;
-        bool connected = false;
-        
-        while (retries < maxRetries && !connected) {
-            if (retries > 0) {
-                std::cout << "Retrying connection (attempt " << retries + 1 << " of " << maxRetries << ")..." << std::endl;
-                // Wait 2 seconds between retries
-                std::this_thread::sleep_for(std::chrono::seconds(2));
-            }
-            
-            connected = webSocketClient->connect();
-            retries++;
-        }
-        
-        if (!connected) {
-            std::cerr << "FATAL: Failed to connect to WebSocket server after " << maxRetries << " attempts. Cannot proceed." << std::endl;
-            delete webSocketClient;
-            return 1;
-        }
-        
         // Create room manager with WebSocket client first
-        std::cout << "Initializing Room Manager..." << std::endl;
         RoomManager* roomManager = new RoomManager(webSocketClient);
         
         // Create components in the correct order to handle dependencies
@@ -122,50 +214,124 @@ int main(int argc, char* argv[]) {
         // Create message handler using the correct parameter order
         MessageHandler* messageHandler = new MessageHandler(roomManager, gameState, webSocketClient);
         
-        // Start the WebSocket receiver to listen for server responses
-        std::cout << "Starting WebSocket receiver..." << std::endl;
-        if (!roomManager->startReceiver()) {
-            std::cerr << "WARNING: Failed to start WebSocket receiver. Some functionality may be limited." << std::endl;
-            std::cerr << "Check network connectivity and firewall settings." << std::endl;
-        } else {
-            std::cout << "WebSocket receiver started successfully." << std::endl;
-        }
-        
-        // Connection test is already done during the WebSocketClient::connect() call
-        // No need to send an additional test message
-        std::cout << "Successfully connected to server." << std::endl;
-        
-        std::cout << "Initializing gesture detector..." << std::endl;
         GestureDetector* detector = new GestureDetector(roomManager);
         
         // Connect gesture detector to room manager for auto-play
         roomManager->setGestureDetector(detector);
         
         // Create and initialize gesture event sender
-        std::cout << "Initializing gesture event sender..." << std::endl;
         roomManager->gestureEventSender = new GestureEventSender(webSocketClient);
-        
-        // Test camera access
-        std::cout << "Testing camera access..." << std::endl;
-        if (!detector->testCameraAccess()) {
-            std::cerr << "WARNING: Could not access camera. Gesture detection will not work." << std::endl;
-            std::cerr << "Please check camera permissions and connections." << std::endl;
-        } else {
-            std::cout << "Camera access successful." << std::endl;
+
+        // Then the slow parts, each as soon as what it needs is ready. The
+        // LCD shows progress once the panel itself is up.
+        StartupOrchestrator startup;
+        std::atomic<bool> lcdReady(false);
+        startup.addPhase("lcd", {}, [&]() {
+            lcd_init();
+            lcdReady = true;
+            return true;
+        });
+        startup.addPhase("server", {}, [&]() {
+            std::cout << "Connecting to server via WebSocket..." << std::endl;
+            // Try to connect with retries
+            const int maxRetries = 3;
+            for (int retries = 0; retries < maxRetries; retries++) {
+                if (retries > 0) {
+                    std::cout << "Retrying connection (attempt " << retries + 1 << " of " << maxRetries << ")..." << std::endl;
+                    // Wait 2 seconds between retries
+                    std::this_thread::sleep_for(std::chrono::seconds(2));
+                }
+                if (webSocketClient->connect()) {
+                    return true;
+                }
+            }
+            std::cerr << "FATAL: Failed to connect to WebSocket server after " << maxRetries << " attempts. Cannot proceed." << std::endl;
+            return false;
+        });
+        startup.addPhase("receiver", {"server"}, [&]() {
+            // Start the WebSocket receiver to listen for server responses
+            if (!roomManager->startReceiver()) {
+                std::cerr << "WARNING: Failed to start WebSocket receiver. Some functionality may be limited." << std::endl;
+                std::cerr << "Check network connectivity and firewall settings." << std::endl;
+                return false;
+            }
+            return true;
+        }, false);
+        startup.addPhase("camera", {}, [&]() {
+            // Open the camera now and keep it streaming, so the first round
+            // doesn't pay for the open and the exposure settling
+            if (!detector->warmUp(5000)) {
+                std::cerr << "WARNING: Could not access camera. Gesture detection will not work." << std::endl;
+                std::cerr << "Please check camera permissions and connections." << std::endl;
+                return false;
+            }
+            return true;
+        }, false);
+        startup.addPhase("models", {}, [&]() {
+            // Load the hand models and run a few frames through them now,
+            // rather than during the first round
+            HandWarmUpStats warmUp;
+            absl::Status status = hand_warm_up(5, &warmUp);
+            if (!status.ok()) {
+                std::cerr << "WARNING: Hand model warm-up failed: " << status.message() << std::endl;
+                return false;
+            }
+            std::cout << "Hand models ready: graph start " << warmUp.start_ms << " ms, first frame "
+                      << warmUp.first_frame_ms << " ms, frame " << warmUp.frames << " "
+                      << warmUp.last_frame_ms << " ms" << std::endl;
+            return true;
+        }, false);
+        startup.addPhase("inputs", {}, [&]() {
+            rotary_press_statemachine_init();
+            joystick_press_init();
+            return true;
+        });
+        startup.addPhase("audio", {}, [&]() {
+            // 2 x 5ms periods, mixed straight into the DAC's ring buffer
+            AudioMixer_initLowLatency(5000, 2, true);
+            SoundManager_init();
+            return true;
+        });
+        startup.setProgressCallback([&](const StartupOrchestrator::Phase& phase, int finished, int total) {
+            std::cout << "Startup: " << phase.name << " "
+                      << (phase.state == StartupOrchestrator::PhaseState::Done ? "ready" : "failed")
+                      << " (" << finished << "/" << total << ")" << std::endl;
+            if (lcdReady) {
+                std::string progress = std::to_string(finished) + " of " + std::to_string(total) + " ready";
+                char* progressMsg[] = {(char*)"Starting up", (char*)progress.c_str()};
+                lcd_place_message(progressMsg, 2, lcd_center);
+            }
+        });
+
+        bool started = startup.run();
+        startup.printTimeline(std::cout);
+        if (!started) {
+            if (lcdReady) {
+                char* failedMsg[] = {(char*)"No connection", (char*)"to server"};
+                lcd_place_message(failedMsg, 2, lcd_center);
+            }
+            joystick_press_cleanup();
+            // As at exit: the camera thread and the hand graph (which uses
+            // the cache's mapped models) go before the asset cache
+            delete detector;
+            hand_close_session();
+            SoundManager_cleanup();
+            AudioMixer_cleanup();
+            AssetCache_cleanup();
+            Log_cleanup();
+            delete webSocketClient;
+            return 1;
         }
         
-        // Initialize LCD at startup
-        std::cout << "Initializing LCD display..." << std::endl;
-        lcd_init();
-        
-        // Initialize rotary encoder and joystick
-        std::cout << "Initializing input controls..." << std::endl;
-        rotary_press_statemachine_init();
-        joystick_press_init();
-
-        std::cout << "Initializing audio system..." << std::endl;
-        AudioMixer_init();
-        SoundManager_init();
+        // Connection test is already done during the WebSocketClient::connect() call
+        // No need to send an additional test message
+        std::cout << "Successfully connected to server." << std::endl;
+        Metrics_addCollector(collectDeviceMetrics, nullptr);
+        AssetCache_startRefresh();
+        // Every long-running thread exists by now
+        int topologyThreads = Topology_apply();
+        std::cout << "Thread topology '" << Topology_getName() << "' applied to "
+                  << topologyThreads << " threads." << std::endl;
         
         // Display welcome message
         char* welcomeMsg[] = {"Gesture Tower", "Game", "Ready!"};
@@ -174,30 +340,9 @@ int main(int argc, char* argv[]) {
         bool detectionRunning = false;
         bool inputLocked = false;
 
-        // Start background joystick thread for instant activation
-        joystickThread = std::thread([&]() {
-            while (true) {
-                if (joystick_is_detecting() && !joystickRunning.load()) {
-                    joystickRunning = true;  // prevent retriggering
-
-                    std::cout << "\n[JOYSTICK] Press detected — starting gesture detection...\n";
-
-                    if (!detector->isRunning()) {
-                        detector->start();
-                        detectionRunning = true;
-                        std::cout << "[JOYSTICK] Gesture detection started.\n";
-                    } else {
-                        std::cout << "[JOYSTICK] Already running.\n";
-                    }
-
-                    joystick_toggle_detection();  // Reset toggle state
-                    std::this_thread::sleep_for(std::chrono::milliseconds(500)); // Debounce
-                    joystickRunning = false;
-                }
-
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            }
-        });
+        // Joystick presses start detection as soon as their event arrives
+        std::atomic<bool> inputActionsRunning(true);
+        std::thread inputActionsThread(runInputActions, detector, &detectionRunning, &inputActionsRunning);
 
         
         std::cout << "=== Beagle Board Gesture Control Client ===" << std::endl;
@@ -292,6 +437,155 @@ int main(int argc, char* argv[]) {
                         (roomManager->isConnected() ? ("Connected to room " + roomManager->getCurrentRoomId()) : "Not connected") << std::endl;
                     std::cout << "Ready status: " << (roomManager->isReady() ? "Ready" : "Not ready") << std::endl;
                     std::cout << "Gesture detection: " << (detectionRunning ? "Running" : "Stopped") << std::endl;
+                    std::cout << "Camera: " << (detector->isCameraReady() ? "streaming" : "closed")
+                              << ", warm standby " << (detector->isWarmStandby() ? "on" : "off") << std::endl;
+                    AssetCache_stats_t assetStats;
+                    AssetCache_getStats(&assetStats);
+                    std::cout << "Asset cache: " << assetStats.numCached << " of " << assetStats.numAssets
+                              << " files local, " << assetStats.numRefreshed << " updated, "
+                              << assetStats.numFailed << " failed updates, "
+                              << assetStats.numCorrupt << " corrupt" << std::endl;
+                    Log_stats_t logStats;
+                    Log_getStats(&logStats);
+                    std::cout << "Log: " << logStats.written << " written, " << logStats.dropped
+                              << " dropped, " << logStats.suppressed << " rate-limited" << std::endl;
+                    std::cout << "Thread topology: " << Topology_getName() << std::endl;
+
+                    lcd_render_stats lcdStats;
+                    lcd_get_render_stats(&lcdStats);
+                    std::cout << "LCD frames: " << lcdStats.frames_rendered
+                              << " (posted " << lcdStats.updates_posted
+                              << ", coalesced " << lcdStats.updates_coalesced << ")" << std::endl;
+                    if (lcdStats.frames_rendered > 0) {
+                        std::cout << "LCD frame time: last " << lcdStats.last_frame_ms
+                                  << " ms (render " << lcdStats.last_render_ms
+                                  << ", flush " << lcdStats.last_flush_ms
+                                  << "), avg " << lcdStats.total_frame_ms / lcdStats.frames_rendered
+                                  << " ms, max " << lcdStats.max_frame_ms << " ms" << std::endl;
+                        std::cout << "LCD SPI: " << lcdStats.spi_bytes << " bytes in "
+                                  << lcdStats.spi_messages << " transfers, "
+                                  << lcdStats.spi_bytes_per_sec / 1e6 << " MB/s of "
+                                  << lcdStats.spi_bus_bytes_per_sec / 1e6 << " MB/s bus limit" << std::endl;
+                    }
+
+                    // Audio timing since the last status
+                    Period_snapshot_t fillStats;
+                    Period_snapshot_t latencyStats;
+                    Period_snapshot_t xrunStats;
+                    Period_snapshotAndClear(PERIOD_EVENT_AUDIO_BUFFER_FILL, &fillStats);
+                    Period_snapshotAndClear(PERIOD_EVENT_AUDIO_LATENCY, &latencyStats);
+                    Period_snapshotAndClear(PERIOD_EVENT_AUDIO_XRUN, &xrunStats);
+                    std::cout << "Audio fill period: avg " << fillStats.periodMs.mean
+                              << " ms (p99 " << fillStats.periodMs.p99
+                              << ", max " << fillStats.periodMs.max << ")" << std::endl;
+                    std::cout << "Audio output latency: p50 " << latencyStats.value.p50
+                              << " ms (p99 " << latencyStats.value.p99
+                              << ", max " << latencyStats.value.max << "), "
+                              << xrunStats.numMarks << " under-runs" << std::endl;
+                    std::cout << "Audio idle: " << AudioMixer_getIdleFraction() * 100.0
+                              << "% of the time" << std::endl;
+
+                    // Hand graph calculators, busiest first, while profiling
+                    if (hand_get_profiling().enabled) {
+                        std::vector<HandCalculatorStats> calculatorStats = hand_get_calculator_stats();
+                        std::cout << "Hand graph calculators (process time since profiling started):" << std::endl;
+                        if (calculatorStats.empty()) {
+                            std::cout << "  (no frames yet)" << std::endl;
+                        }
+                        for (size_t i = 0; i < calculatorStats.size() && i < 12; i++) {
+                            const HandCalculatorStats& calc = calculatorStats[i];
+                            std::cout << "  " << calc.name << ": " << calc.count << " calls, p50 "
+                                      << calc.p50_ms << " ms, p90 " << calc.p90_ms
+                                      << " ms, p99 " << calc.p99_ms << " ms, total "
+                                      << calc.total_ms << " ms" << std::endl;
+                        }
+                    }
+                }
+                else if (command == "trace") {
+                    std::string action;
+                    std::string fileName;
+                    iss >> action >> fileName;
+                    if (action == "on" || action == "off") {
+                        Trace_setEnabled(action == "on");
+                        std::cout << "Tracing " << (action == "on" ? "started" : "stopped") << "." << std::endl;
+                    } else if (action == "dump") {
+                        if (fileName.empty()) {
+                            fileName = "/tmp/gesture_game.trace.json";
+                        }
+                        if (Trace_dump(fileName.c_str()) == 0) {
+                            std::cout << "Trace written to " << fileName
+                                      << " (open in chrome://tracing or ui.perfetto.dev)" << std::endl;
+                        } else {
+                            std::cout << "Could not write " << fileName << std::endl;
+                        }
+                    } else {
+                        std::cout << "Usage: trace on|off|dump [file]" << std::endl;
+                    }
+                }
+                else if (command == "profile") {
+                    std::string action;
+                    HandProfilingOptions options;
+                    iss >> action >> options.trace_log_path;
+                    int intervalMs = 0;
+                    if (iss >> intervalMs && intervalMs > 0) {
+                        options.trace_log_interval_ms = intervalMs;
+                    }
+                    if (action == "on" || action == "off") {
+                        options.enabled = (action == "on");
+                        hand_set_profiling(options);
+                        if (!options.enabled) {
+                            std::cout << "Hand graph profiling stopped." << std::endl;
+                        } else if (options.trace_log_path.empty()) {
+                            std::cout << "Hand graph profiling started; see 'status'." << std::endl;
+                        } else {
+                            std::cout << "Hand graph profiling started; trace logs in "
+                                      << options.trace_log_path << "N.binarypb" << std::endl;
+                        }
+                    } else {
+                        std::cout << "Usage: profile on [path] [interval_ms] | profile off" << std::endl;
+                    }
+                }
+                else if (command == "input") {
+                    std::string action;
+                    std::string argument;
+                    iss >> action >> argument;
+                    if (action == "record" && !argument.empty()) {
+                        if (Input_startRecording(argument.c_str()) == 0) {
+                            std::cout << "Recording input events to " << argument << std::endl;
+                        } else {
+                            std::cout << "Could not start recording to " << argument << std::endl;
+                        }
+                    } else if (action == "stop") {
+                        Input_stopRecording();
+                        std::cout << "Input recording stopped." << std::endl;
+                    } else if (action == "replay" && !argument.empty()) {
+                        if (Input_replay(argument.c_str()) == 0) {
+                            std::cout << "Replaying input events from " << argument << std::endl;
+                        } else {
+                            std::cout << "Could not replay " << argument << std::endl;
+                        }
+                    } else if (action == "inject") {
+                        std::string typeName;
+                        int value = 0;
+                        iss >> typeName >> value;
+                        Input_device device;
+                        Input_type type;
+                        if (parseInputEvent(argument, typeName, &device, &type)) {
+                            Input_inject(device, type, value);
+                        } else {
+                            std::cout << "Unknown input event: " << argument << " " << typeName << std::endl;
+                        }
+                    } else {
+                        std::cout << "Usage: input record <file> | input stop | input replay <file> | "
+                                  << "input inject <device> <type> [value]" << std::endl;
+                    }
+                }
+                else if (command == "metrics") {
+                    char* metricsText = Metrics_render();
+                    if (metricsText) {
+                        std::cout << metricsText;
+                        free(metricsText);
+                    }
                 }
                 else if (command == "ready") {
                     if (roomManager->isConnected()) {
@@ -343,6 +637,18 @@ int main(int argc, char* argv[]) {
                         std::cout << "Gesture detection is already stopped." << std::endl;
                     }
                 }
+                else if (command == "standby") {
+                    std::string action;
+                    iss >> action;
+                    if (action == "on" || action == "off") {
+                        detector->setWarmStandby(action == "on");
+                        std::cout << "Warm standby " << action << ": the camera is "
+                                  << (action == "on" ? "kept streaming" : "closed")
+                                  << " between rounds." << std::endl;
+                    } else {
+                        std::cout << "Usage: standby on|off" << std::endl;
+                    }
+                }
                 else if (command == "webcamtest") {
                     detector->runTestingMode();
                 }
@@ -402,9 +708,13 @@ int main(int argc, char* argv[]) {
         }
         
         // Clean up resources
+        inputActionsRunning = false;
+        inputActionsThread.join();
+        joystick_press_cleanup();
         if (detector) {
             delete detector;
         }
+        hand_close_session();
         
         if (roomManager) {
             delete roomManager;
@@ -428,7 +738,13 @@ int main(int argc, char* argv[]) {
         }
 
         SoundManager_cleanup();
+        AssetCache_cleanup();
+        Input_cleanup();
+        Trace_cleanup();
+        Log_cleanup();
+        Metrics_cleanup();
         AudioMixer_cleanup();   
+        Period_cleanup();
 
         
         // Restore stderr
@@ -439,7 +755,5 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    joystickThread.detach();  
-
     return 0;
 }
@@ -54,6 +54,8 @@ class InferenceCalculatorCpuImpl
   absl::StatusOr<std::vector<Tensor>> Process(
       CalculatorContext* cc, const TensorSpan& tensor_span) override;
   std::unique_ptr<InferenceRunner> inference_runner_;
+  // Kept here because the XNNPACK delegate only stores a pointer to it.
+  std::string xnnpack_weight_cache_file_path_;
 };
 
 absl::Status InferenceCalculatorCpuImpl::UpdateContract(
@@ -156,6 +158,12 @@ InferenceCalculatorCpuImpl::MaybeCreateDelegate(CalculatorContext* cc) {
     auto xnnpack_opts = TfLiteXNNPackDelegateOptionsDefault();
     xnnpack_opts.num_threads =
         GetXnnpackNumThreads(opts_has_delegate, opts_delegate);
+    xnnpack_weight_cache_file_path_ =
+        opts_delegate.xnnpack().weight_cache_file_path();
+    if (!xnnpack_weight_cache_file_path_.empty()) {
+      xnnpack_opts.weight_cache_file_path =
+          xnnpack_weight_cache_file_path_.c_str();
+    }
     return TfLiteDelegatePtr(TfLiteXNNPackDelegateCreate(&xnnpack_opts),
                              &TfLiteXNNPackDelegateDelete);
   }
@@ -51,6 +51,8 @@ class InferenceCalculatorXnnpackImpl
   absl::StatusOr<TfLiteDelegatePtr> CreateDelegate(CalculatorContext* cc);
 
   std::unique_ptr<InferenceRunner> inference_runner_;
+  // Kept here because the XNNPACK delegate only stores a pointer to it.
+  std::string weight_cache_file_path_;
 };
 
 absl::Status InferenceCalculatorXnnpackImpl::UpdateContract(
@@ -119,6 +121,10 @@ InferenceCalculatorXnnpackImpl::CreateDelegate(CalculatorContext* cc) {
   auto xnnpack_opts = TfLiteXNNPackDelegateOptionsDefault();
   xnnpack_opts.num_threads =
       GetXnnpackNumThreads(opts_has_delegate, opts_delegate);
+  weight_cache_file_path_ = opts_delegate.xnnpack().weight_cache_file_path();
+  if (!weight_cache_file_path_.empty()) {
+    xnnpack_opts.weight_cache_file_path = weight_cache_file_path_.c_str();
+  }
   return TfLiteDelegatePtr(TfLiteXNNPackDelegateCreate(&xnnpack_opts),
                            &TfLiteXNNPackDelegateDelete);
 }
@@ -25,8 +25,12 @@ load("//mediapipe/framework/tool:build_defs.bzl", "clean_dep")
 load("//mediapipe/framework/deps:descriptor_set.bzl", "direct_descriptor_set", "transitive_descriptor_set")
 load("@org_tensorflow//tensorflow/lite/core/shims:cc_library_with_tflite.bzl", "cc_library_with_tflite")
 
-def mediapipe_binary_graph(name, graph = None, output_name = None, deps = [], testonly = False, **kwargs):
-    """Converts a graph from text format to binary format."""
+def mediapipe_binary_graph(name, graph = None, output_name = None, deps = [], testonly = False, expand_subgraphs = False, **kwargs):
+    """Converts a graph from text format to binary format.
+
+    With expand_subgraphs, subgraph nodes are replaced by their contents, so
+    deps must include the subgraphs' libraries.
+    """
 
     if not graph:
         fail("No input graph file specified.")
@@ -60,7 +64,8 @@ def mediapipe_binary_graph(name, graph = None, output_name = None, deps = [], te
         cmd = (
             "$(location " + name + "_text_to_binary_graph" + ") " +
             ("--proto_source=$(location %s) " % graph) +
-            ("--proto_output=\"$@\" ")
+            ("--proto_output=\"$@\" ") +
+            ("--expand_subgraphs " if expand_subgraphs else "")
         ),
         tools = [name + "_text_to_binary_graph"],
         testonly = testonly,
@@ -28,12 +28,17 @@
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/tool/subgraph_expansion.h"
 
 ABSL_FLAG(std::string, proto_source, "",
           "The template source file containing CalculatorGraphConfig "
           "protobuf text with inline template params.");
 ABSL_FLAG(std::string, proto_output, "",
           "An output template file in binary CalculatorGraphTemplate form.");
+ABSL_FLAG(bool, expand_subgraphs, false,
+          "Replace subgraph nodes with the nodes of the subgraphs, so the "
+          "graph doesn't need expanding when it is loaded. The subgraphs "
+          "must be linked into this binary.");
 
 #define EXIT_IF_ERROR(status)  \
   if (!status.ok()) {          \
@@ -112,6 +117,9 @@ int main(int argc, char** argv) {
   mediapipe::CalculatorGraphConfig config;
   EXIT_IF_ERROR(
       mediapipe::ReadFile(absl::GetFlag(FLAGS_proto_source), true, &config));
+  if (absl::GetFlag(FLAGS_expand_subgraphs)) {
+    EXIT_IF_ERROR(mediapipe::tool::ExpandSubgraphs(&config));
+  }
   EXIT_IF_ERROR(
       mediapipe::WriteFile(absl::GetFlag(FLAGS_proto_output), false, config));
   return EXIT_SUCCESS;